@@ -1,9 +1,650 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <string.h>
 
 #include "snes.h"
 #include "snes_cart.h"
+#include "snes_apu_dsp.h"
+#include "snes_audio.h"
+#include "snes_ppu_tile.h"
+#include "snes_ppu_mode7.h"
 
+//Audio frames gathered during a video frame, about 534 at 32kHz
+#define AUDIO_FRAME_SAMPLES 2048
+
+
+void print_cpu_stats(snes_t *snes)
+{
+	snes_cpu_stats_t stats;
+	snes_get_cpu_stats(snes, &stats);
+	printf("Instructions : %llu\n", (unsigned long long)stats.instructions);
+	printf("Instructions/s : %.0f\n", stats.instructions_per_second);
+	printf("Master cycles : %llu (%.3f s emulated)\n", (unsigned long long)stats.cycles,
+		   (double)stats.cycles / SNES_MASTER_CLOCK);
+	printf("Halted cycles : %llu\n", (unsigned long long)stats.halted_cycles);
+	printf("Idle loop cycles skipped : %llu\n", (unsigned long long)stats.idle_cycles);
+	printf("APU upload bytes fast-forwarded : %llu\n", (unsigned long long)stats.upload_bytes);
+	printf("Decode cache hit rate : %.2f%% (%llu hits, %llu misses)\n", stats.hit_rate * 100,
+		   (unsigned long long)stats.cache_hits, (unsigned long long)stats.cache_misses);
+	printf("JIT instructions : %llu (%llu blocks translated)\n", (unsigned long long)stats.jit_instructions,
+		   (unsigned long long)stats.jit_blocks);
+}
+
+/*
+ * Reads reads bytes through the bus from the ROM (LoROM bank $80 and its
+ * SlowROM mirror), the WRAM and its low RAM mirror, and prints the rate
+ */
+void bench_bus(snes_t *snes, uint32_t reads)
+{
+	static const struct {
+		const char *name;
+		uint32_t base;
+		uint32_t size;
+	} regions[] = {
+		{ "ROM $00:8000", 0x008000, 0x8000 },
+		{ "ROM $80:8000", 0x808000, 0x8000 },
+		{ "WRAM $7E:0000", 0x7E0000, 0x10000 },
+		{ "Low RAM $80:0000", 0x800000, 0x2000 },
+	};
+	snes_bus_t *bus = snes_get_bus(snes);
+	struct timespec start;
+	struct timespec end;
+	double elapsed;
+	uint32_t sum;
+	uint32_t i;
+	uint32_t r;
+
+	for(r = 0; r < sizeof(regions) / sizeof(regions[0]); r++) {
+		sum = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(i = 0; i < reads; i++)
+			sum += snes_bus_read(bus, regions[r].base + (i & (regions[r].size - 1)));
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		printf("Bus reads %s : %u in %.3f s", regions[r].name, reads, elapsed);
+		if(elapsed > 0)
+			printf(", %.0f reads/s", reads / elapsed);
+		//The sum keeps the reads
+		printf(" (sum %u)\n", sum);
+	}
+}
+
+/*
+ * Runs the SPC700 alone for cycles SPC700 cycles, from where the frames left
+ * it (e.g. after the game uploaded its sound driver).
+ */
+void bench_apu(snes_t *snes, uint64_t cycles)
+{
+	snes_apu_spc_stats_t before;
+	snes_apu_spc_stats_t after;
+	struct timespec start;
+	struct timespec end;
+	double elapsed;
+
+	snes_get_apu_stats(snes, &before);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	snes_run_apu_cycles(snes, cycles);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	snes_get_apu_stats(snes, &after);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("SPC700 instructions : %llu\n", (unsigned long long)(after.instructions - before.instructions));
+	printf("SPC700 cycles : %llu in %.3f s\n", (unsigned long long)(after.cycles - before.cycles), elapsed);
+	if(elapsed > 0) {
+		printf("SPC700 cycles/s : %.0f (%.1fx real time)\n", (after.cycles - before.cycles) / elapsed,
+			   (after.cycles - before.cycles) / elapsed / SNES_APU_SPC_CLOCK);
+	}
+	snes_dump_apu(snes);
+}
+
+//CPU benchmark : code and data in different low RAM pages (the data writes would
+//invalidate the decoded code), operands valid BCD for the decimal mode
+#define BENCH_CPU_CODE 0x001000
+#define BENCH_CPU_DATA 0x000010
+#define BENCH_CPU_STACK 0x0001FF
+#define BENCH_CPU_A 0x4321
+#define BENCH_CPU_ADD 0x9895
+#define BENCH_CPU_SUB 0x0987
+#define BENCH_CPU_CMP 0x5050
+
+void bench_cpu_code(snes_bus_t *bus, uint32_t *addr, const uint8_t *code, uint32_t len)
+{
+	while(len-- > 0)
+		snes_bus_write(bus, (*addr)++, *code++);
+}
+
+//The digits low digits of a packed BCD value
+uint32_t bench_cpu_from_bcd(uint32_t value, uint32_t digits)
+{
+	uint32_t result = 0;
+	uint32_t scale = 1;
+
+	for(; digits > 0; digits--) {
+		result += (value & 0xF) * scale;
+		scale *= 10;
+		value >>= 4;
+	}
+	return result;
+}
+
+uint32_t bench_cpu_to_bcd(uint32_t value)
+{
+	uint32_t result = 0;
+	uint32_t shift;
+
+	for(shift = 0; value > 0; shift += 4) {
+		result |= (value % 10) << shift;
+		value /= 10;
+	}
+	return result;
+}
+
+/*
+ * One iteration of the loop body (CLC, ADC, SBC, CMP) on a, with each flag
+ * computed right away. In decimal mode V is the one of the binary sum of the
+ * top digits, with the carry of the digits below.
+ */
+void bench_cpu_reference(uint32_t *a, uint8_t *p, uint8_t m16, uint8_t decimal)
+{
+	int32_t digits = m16 ? 4 : 2;
+	int32_t mask = m16 ? 0xFFFF : 0xFF;
+	int32_t sign = m16 ? 0x8000 : 0x80;
+	int32_t modulo = m16 ? 10000 : 100;
+	int32_t top = digits * 4 - 4;
+	int32_t acc = *a & mask;
+	int32_t operand;
+	int32_t result;
+	int32_t carry = 0;
+	int32_t carry_in;
+	int32_t overflow;
+
+	operand = BENCH_CPU_ADD & mask;
+	if(decimal) {
+		carry_in = bench_cpu_from_bcd(acc, digits - 1) + bench_cpu_from_bcd(operand, digits - 1) + carry >= modulo / 10;
+		result = (acc >> top) + (operand >> top) + carry_in;
+		overflow = !((acc ^ operand) & sign) && (((acc >> top) ^ result) & 8);
+		result = bench_cpu_from_bcd(acc, digits) + bench_cpu_from_bcd(operand, digits) + carry;
+		carry = result >= modulo;
+		acc = bench_cpu_to_bcd(result % modulo);
+	} else {
+		result = acc + operand + carry;
+		overflow = ~(acc ^ operand) & (acc ^ result) & sign;
+		carry = result > mask;
+		acc = result & mask;
+	}
+
+	operand = BENCH_CPU_SUB & mask;
+	if(decimal) {
+		//The complement of the operand is added
+		carry_in = (int32_t)bench_cpu_from_bcd(acc, digits - 1) - (int32_t)bench_cpu_from_bcd(operand, digits - 1) - !carry >= 0;
+		result = (acc >> top) + (15 - (operand >> top)) + carry_in;
+		overflow = ((acc ^ operand) & sign) && (((acc >> top) ^ result) & 8);
+		result = (int32_t)bench_cpu_from_bcd(acc, digits) - (int32_t)bench_cpu_from_bcd(operand, digits) - !carry;
+		carry = result >= 0;
+		acc = bench_cpu_to_bcd((result + modulo) % modulo);
+	} else {
+		result = acc - operand - !carry;
+		overflow = (acc ^ operand) & (acc ^ result) & sign;
+		carry = result >= 0;
+		acc = result & mask;
+	}
+
+	operand = BENCH_CPU_CMP & mask;
+	result = acc - operand;
+	*p &= ~(STATUS_FLAG_N | STATUS_FLAG_V | STATUS_FLAG_Z | STATUS_FLAG_C);
+	if(result & sign)
+		*p |= STATUS_FLAG_N;
+	if(overflow)
+		*p |= STATUS_FLAG_V;
+	if((result & mask) == 0)
+		*p |= STATUS_FLAG_Z;
+	if(result >= 0)
+		*p |= STATUS_FLAG_C;
+	*a = acc;
+}
+
+/*
+ * Runs a LDA/CLC/ADC/SBC/CMP/STA/DEX/BNE loop in WRAM for about iterations
+ * iterations in each M and X width, in binary then decimal mode, and checks
+ * the final A and P against bench_cpu_reference. The game is left stopped.
+ */
+int bench_cpu(snes_t *snes, uint32_t iterations)
+{
+	static const uint8_t body[] = {
+		0xAD, 0x10, 0x00, //LDA $0010
+		0x18,             //CLC
+		0x6D, 0x12, 0x00, //ADC $0012
+		0xED, 0x14, 0x00, //SBC $0014
+		0xCD, 0x16, 0x00, //CMP $0016
+		0x8D, 0x10, 0x00, //STA $0010
+	};
+	//LDX #0
+	static const uint8_t ldx[] = { 0xA2, 0x00, 0x00 };
+	//PHP, SEP #$20, LDA #1, STA $001A, STP
+	static const uint8_t done[] = { 0x08, 0xE2, 0x20, 0xA9, 0x01, 0x8D, 0x1A, 0x00, 0xDB };
+	static const uint8_t operands[] = {
+		BENCH_CPU_A & 0xFF, BENCH_CPU_A >> 8, BENCH_CPU_ADD & 0xFF, BENCH_CPU_ADD >> 8,
+		BENCH_CPU_SUB & 0xFF, BENCH_CPU_SUB >> 8, BENCH_CPU_CMP & 0xFF, BENCH_CPU_CMP >> 8,
+	};
+	//SEI, CLC, XCE, REP #$38, LDX #$01FF, TXS, SEP #$20, LDA #0, PHA, PLB, REP #$20, SEP #flags
+	uint8_t setup[] = { 0x78, 0x18, 0xFB, 0xC2, 0x38, 0xA2, BENCH_CPU_STACK & 0xFF, BENCH_CPU_STACK >> 8,
+						0x9A, 0xE2, 0x20, 0xA9, 0x00, 0x48, 0xAB, 0xC2, 0x20, 0xE2, 0x00 };
+	//DEX, BNE loop
+	uint8_t dex[] = { 0xCA, 0xD0, 0x00 };
+	//REP #$20, DEC $0018, SEP #flags, BNE outer
+	uint8_t next[] = { 0xC2, 0x20, 0xCE, 0x18, 0x00, 0xE2, 0x00, 0xD0, 0x00 };
+	snes_bus_t *bus = snes_get_bus(snes);
+	snes_cpu_stats_t before;
+	snes_cpu_stats_t after;
+	struct timespec start;
+	struct timespec end;
+	double elapsed;
+	uint32_t addr;
+	uint32_t data;
+	uint32_t outer_pc;
+	uint32_t loop_pc;
+	uint32_t inner;
+	uint32_t outer;
+	uint64_t total;
+	uint64_t i;
+	uint32_t a;
+	uint8_t p;
+	uint8_t flags;
+	uint8_t m16;
+	uint8_t x16;
+	uint8_t decimal;
+	uint8_t v;
+	int ret = 0;
+
+	//No NMI, IRQ or HDMA in the middle of the loop
+	snes_bus_write(bus, 0x004200, 0);
+	snes_bus_write(bus, 0x00420C, 0);
+
+	for(v = 0; v < 8 && ret == 0; v++) {
+		m16 = v & 1;
+		x16 = (v >> 1) & 1;
+		decimal = v >> 2;
+		flags = (m16 ? 0 : STATUS_FLAG_M) | (x16 ? 0 : STATUS_FLAG_X) | (decimal ? STATUS_FLAG_D : 0);
+		inner = x16 ? 0x10000 : 0x100;
+		outer = (iterations + inner - 1) / inner;
+		if(outer == 0)
+			outer = 1;
+		if(outer > 0xFFFF)
+			outer = 0xFFFF;
+
+		setup[sizeof(setup) - 1] = flags;
+		next[6] = flags;
+		addr = BENCH_CPU_CODE;
+		bench_cpu_code(bus, &addr, setup, sizeof(setup));
+		outer_pc = addr;
+		bench_cpu_code(bus, &addr, ldx, x16 ? 3 : 2);
+		loop_pc = addr;
+		bench_cpu_code(bus, &addr, body, sizeof(body));
+		dex[2] = loop_pc - (addr + sizeof(dex));
+		bench_cpu_code(bus, &addr, dex, sizeof(dex));
+		next[8] = outer_pc - (addr + sizeof(next));
+		bench_cpu_code(bus, &addr, next, sizeof(next));
+		//One more iteration without DEX keeps the flags of CMP
+		bench_cpu_code(bus, &addr, body, sizeof(body));
+		bench_cpu_code(bus, &addr, done, sizeof(done));
+
+		addr = BENCH_CPU_DATA;
+		bench_cpu_code(bus, &addr, operands, sizeof(operands));
+		snes_bus_write(bus, BENCH_CPU_DATA + 8, outer & 0xFF);
+		snes_bus_write(bus, BENCH_CPU_DATA + 9, outer >> 8);
+		snes_bus_write(bus, BENCH_CPU_DATA + 10, 0);
+
+		snes_get_cpu_stats(snes, &before);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		snes_jump(snes, BENCH_CPU_CODE);
+		while(ret == 0 && snes_bus_read(bus, BENCH_CPU_DATA + 10) == 0)
+			ret = snes_run_cycles(snes, SNES_FRAME_CYCLES);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		snes_get_cpu_stats(snes, &after);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+		printf("CPU M%u X%u %s : %llu instructions in %.3f s", m16 ? 16 : 8, x16 ? 16 : 8,
+			   decimal ? "decimal" : "binary", (unsigned long long)(after.instructions - before.instructions), elapsed);
+		if(elapsed > 0)
+			printf(", %.0f instructions/s", (after.instructions - before.instructions) / elapsed);
+		printf("\n");
+		if(ret) {
+			printf("CPU benchmark stopped !\n");
+			break;
+		}
+
+		a = BENCH_CPU_A;
+		p = flags | STATUS_FLAG_I;
+		total = (uint64_t)inner * outer + 1;
+		for(i = 0; i < total; i++)
+			bench_cpu_reference(&a, &p, m16, decimal);
+		data = snes_bus_read(bus, BENCH_CPU_DATA);
+		if(m16)
+			data |= snes_bus_read(bus, BENCH_CPU_DATA + 1) << 8;
+		if(data != a || snes_bus_read(bus, BENCH_CPU_STACK) != p) {
+			printf("CPU M%u X%u %s : A 0x%04X P 0x%02X, expected A 0x%04X P 0x%02X !\n", m16 ? 16 : 8, x16 ? 16 : 8,
+				   decimal ? "decimal" : "binary", data, snes_bus_read(bus, BENCH_CPU_STACK), a, p);
+			ret = -1;
+		}
+	}
+	return ret ? -1 : 0;
+}
+
+//8 voices looping over random BRR blocks, with noise, pitch modulation and echo
+void bench_dsp_setup(snes_apu_dsp_t *dsp, uint8_t *ram)
+{
+	static const uint8_t fir[8] = { 0x0C, 0x21, 0x2B, 0x2B, 0x13, 0xFE, 0xF3, 0xF9 };
+	static const uint8_t gains[8] = { 0, 0x7F, 0, 0xDC, 0, 0xC8, 0, 0x50 };
+	uint32_t seed = 12345;
+	uint32_t i;
+	int v;
+
+	//Directory at $0200, 64 blocks at $1000 looping from the 8th, echo at $8000
+	ram[0x200] = 0x00;
+	ram[0x201] = 0x10;
+	ram[0x202] = 9 * 8;
+	ram[0x203] = 0x10;
+	for(i = 0; i < 64 * 9; i++) {
+		seed = seed * 1103515245 + 12345;
+		ram[0x1000 + i] = seed >> 16;
+		if(i % 9 == 0)
+			ram[0x1000 + i] &= 0xFC;
+	}
+	ram[0x1000 + 63 * 9] |= 0x03;
+
+	snes_apu_dsp_write(dsp, 0x5D, 0x02); //DIR
+	snes_apu_dsp_write(dsp, 0x6D, 0x80); //ESA
+	snes_apu_dsp_write(dsp, 0x7D, 0x04); //EDL
+	snes_apu_dsp_write(dsp, 0x0D, 0x40); //EFB
+	for(i = 0; i < 8; i++)
+		snes_apu_dsp_write(dsp, (i << 4) | 0x0F, fir[i]);
+	snes_apu_dsp_write(dsp, 0x0C, 0x7F); //MVOL
+	snes_apu_dsp_write(dsp, 0x1C, 0x7F);
+	snes_apu_dsp_write(dsp, 0x2C, 0x30); //EVOL
+	snes_apu_dsp_write(dsp, 0x3C, 0xD0);
+	for(v = 0; v < 8; v++) {
+		snes_apu_dsp_write(dsp, (v << 4) | 0x00, 0x40 + v);
+		snes_apu_dsp_write(dsp, (v << 4) | 0x01, 0x30 - v);
+		snes_apu_dsp_write(dsp, (v << 4) | 0x02, 0x34 * v);
+		snes_apu_dsp_write(dsp, (v << 4) | 0x03, 0x08 + v * 3);
+		//ADSR on even voices, GAIN modes on odd ones
+		snes_apu_dsp_write(dsp, (v << 4) | 0x05, v & 1 ? 0x00 : 0x8F);
+		snes_apu_dsp_write(dsp, (v << 4) | 0x06, 0xE0 | v);
+		snes_apu_dsp_write(dsp, (v << 4) | 0x07, gains[v]);
+	}
+	snes_apu_dsp_write(dsp, 0x2D, 0x04); //PMON
+	snes_apu_dsp_write(dsp, 0x3D, 0x80); //NON
+	snes_apu_dsp_write(dsp, 0x4D, 0xFF); //EON
+	snes_apu_dsp_write(dsp, 0x6C, 0x1A); //FLG
+	snes_apu_dsp_write(dsp, 0x4C, 0xFF); //KON
+}
+
+/*
+ * Runs the DSP alone for samples samples with each code path of the host,
+ * and checks their output against the scalar one.
+ */
+int bench_dsp(uint32_t samples)
+{
+	snes_apu_dsp_simd_t simd;
+	snes_apu_dsp_t *dsp;
+	int16_t *reference = NULL;
+	int16_t *output;
+	uint8_t *ram;
+	struct timespec start;
+	struct timespec end;
+	double elapsed;
+	uint32_t i;
+	int ret = 0;
+
+	for(simd = SNES_APU_DSP_SIMD_SCALAR; simd <= snes_apu_dsp_get_max_simd(); simd++) {
+		ram = calloc(64 * 1024, 1);
+		output = malloc(samples * 2 * sizeof(int16_t));
+		dsp = ram != NULL && output != NULL ? snes_apu_dsp_init(ram) : NULL;
+		if(dsp == NULL) {
+			printf("Unable to init the DSP benchmark !\n");
+			free(output);
+			free(ram);
+			ret = -1;
+			break;
+		}
+		snes_apu_dsp_set_simd(dsp, simd);
+		bench_dsp_setup(dsp, ram);
+		snes_apu_dsp_set_output(dsp, output, samples);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		snes_apu_dsp_run_until(dsp, samples);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+		printf("DSP %s : %u samples in %.3f s", snes_apu_dsp_simd_tostring(simd), samples, elapsed);
+		if(elapsed > 0) {
+			printf(", %.0f voices*samples/s (%.1fx real time)", SNES_APU_DSP_VOICES * samples / elapsed,
+				   samples / elapsed / SNES_APU_DSP_RATE);
+		}
+		printf("\n");
+
+		if(reference == NULL) {
+			reference = output;
+		} else {
+			for(i = 0; i < samples * 2 && output[i] == reference[i]; i++);
+			if(i < samples * 2) {
+				printf("DSP %s differs from the scalar reference at sample %u !\n",
+					   snes_apu_dsp_simd_tostring(simd), i / 2);
+				ret = -1;
+			}
+			free(output);
+		}
+		snes_apu_dsp_destroy(dsp);
+		free(ram);
+	}
+	free(reference);
+	return ret;
+}
+
+//Tiles decoded over and over, random bitplanes enough for the 8 bpp ones
+#define BENCH_TILES 4096
+
+/*
+ * Decodes tiles 2, 4 and 8 bpp tiles with each code path of the host, and
+ * checks their pixels against the scalar ones.
+ */
+int bench_tiles(uint32_t tiles)
+{
+	static const uint8_t formats[3] = { 2, 4, 8 };
+	snes_ppu_tile_simd_t simd;
+	uint8_t *planes = malloc(BENCH_TILES * 64);
+	uint8_t *reference = malloc(BENCH_TILES * SNES_PPU_TILE_PIXELS);
+	uint8_t *pixels = malloc(BENCH_TILES * SNES_PPU_TILE_PIXELS);
+	uint32_t seed = 12345;
+	struct timespec start;
+	struct timespec end;
+	double elapsed;
+	uint32_t i;
+	uint8_t f;
+	int ret = 0;
+
+	if(planes == NULL || reference == NULL || pixels == NULL) {
+		printf("Unable to init the tile benchmark !\n");
+		ret = -1;
+		goto end;
+	}
+	for(i = 0; i < BENCH_TILES * 64; i++) {
+		seed = seed * 1103515245 + 12345;
+		planes[i] = seed >> 16;
+	}
+	for(f = 0; f < 3; f++) {
+		for(i = 0; i < BENCH_TILES; i++)
+			snes_ppu_tile_decode(SNES_PPU_TILE_SIMD_SCALAR, planes + i * 8 * formats[f], formats[f],
+								 reference + i * SNES_PPU_TILE_PIXELS);
+		for(simd = SNES_PPU_TILE_SIMD_SCALAR; simd <= snes_ppu_tile_get_max_simd(); simd++) {
+			memset(pixels, 0xFF, BENCH_TILES * SNES_PPU_TILE_PIXELS);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for(i = 0; i < tiles; i++)
+				snes_ppu_tile_decode(simd, planes + (i % BENCH_TILES) * 8 * formats[f], formats[f],
+									 pixels + (i % BENCH_TILES) * SNES_PPU_TILE_PIXELS);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+			printf("Tiles %ubpp %s : %u tiles in %.3f s", formats[f], snes_ppu_tile_simd_tostring(simd),
+				   tiles, elapsed);
+			if(elapsed > 0)
+				printf(", %.0f tiles/s", tiles / elapsed);
+			printf("\n");
+
+			for(i = 0; i < BENCH_TILES * SNES_PPU_TILE_PIXELS && i < tiles * SNES_PPU_TILE_PIXELS &&
+				pixels[i] == reference[i]; i++);
+			if(i < BENCH_TILES * SNES_PPU_TILE_PIXELS && i < tiles * SNES_PPU_TILE_PIXELS) {
+				printf("Tiles %ubpp %s differ from the scalar reference at tile %u !\n", formats[f],
+					   snes_ppu_tile_simd_tostring(simd), i / SNES_PPU_TILE_PIXELS);
+				ret = -1;
+			}
+		}
+	}
+end:
+	free(pixels);
+	free(reference);
+	free(planes);
+	return ret;
+}
+
+//Random transforms rendered over and over
+#define BENCH_MODE7_LINES 4096
+
+uint32_t bench_random(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 8;
+}
+
+/*
+ * Renders lines mode 7 lines of random matrices, centers, offsets and
+ * M7SEL over a random VRAM with each code path of the host, and checks
+ * their pixels against the scalar ones.
+ */
+int bench_mode7(uint32_t lines)
+{
+	snes_ppu_mode7_simd_t simd;
+	snes_ppu_mode7_t *mode7 = malloc(BENCH_MODE7_LINES * sizeof(snes_ppu_mode7_t));
+	uint8_t *vram = malloc(SNES_PPU_VRAM_SIZE);
+	uint8_t *reference = malloc(BENCH_MODE7_LINES * SNES_PPU_WIDTH);
+	uint8_t *pixels = malloc(BENCH_MODE7_LINES * SNES_PPU_WIDTH);
+	uint32_t seed = 12345;
+	struct timespec start;
+	struct timespec end;
+	double elapsed;
+	uint32_t i;
+	int ret = 0;
+
+	if(mode7 == NULL || vram == NULL || reference == NULL || pixels == NULL) {
+		printf("Unable to init the mode 7 benchmark !\n");
+		ret = -1;
+		goto end;
+	}
+	for(i = 0; i < SNES_PPU_VRAM_SIZE; i++)
+		vram[i] = bench_random(&seed);
+	for(i = 0; i < BENCH_MODE7_LINES; i++) {
+		//Scales around 1 most of the time, anything otherwise
+		mode7[i].a = (i & 3) ? (int16_t)(0x100 + (bench_random(&seed) & 0x1FF) - 0xFF) : (int16_t)bench_random(&seed);
+		mode7[i].b = (i & 3) ? (int16_t)((bench_random(&seed) & 0x1FF) - 0xFF) : (int16_t)bench_random(&seed);
+		mode7[i].c = (i & 3) ? (int16_t)((bench_random(&seed) & 0x1FF) - 0xFF) : (int16_t)bench_random(&seed);
+		mode7[i].d = (i & 3) ? (int16_t)(0x100 + (bench_random(&seed) & 0x1FF) - 0xFF) : (int16_t)bench_random(&seed);
+		mode7[i].x = (int16_t)(bench_random(&seed) << 3) >> 3;
+		mode7[i].y = (int16_t)(bench_random(&seed) << 3) >> 3;
+		mode7[i].hofs = (int16_t)(bench_random(&seed) << 3) >> 3;
+		mode7[i].vofs = (int16_t)(bench_random(&seed) << 3) >> 3;
+		mode7[i].sel = bench_random(&seed) & 0xC3;
+	}
+	for(i = 0; i < BENCH_MODE7_LINES; i++)
+		snes_ppu_mode7_render(SNES_PPU_MODE7_SIMD_SCALAR, &mode7[i], vram, i, reference + i * SNES_PPU_WIDTH);
+
+	for(simd = SNES_PPU_MODE7_SIMD_SCALAR; simd <= snes_ppu_mode7_get_max_simd(); simd++) {
+		memset(pixels, 0xFF, BENCH_MODE7_LINES * SNES_PPU_WIDTH);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(i = 0; i < lines; i++)
+			snes_ppu_mode7_render(simd, &mode7[i % BENCH_MODE7_LINES], vram, i % BENCH_MODE7_LINES,
+								  pixels + (i % BENCH_MODE7_LINES) * SNES_PPU_WIDTH);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+		printf("Mode 7 %s : %u lines in %.3f s", snes_ppu_mode7_simd_tostring(simd), lines, elapsed);
+		if(elapsed > 0)
+			printf(", %.0f lines/s", lines / elapsed);
+		printf("\n");
+
+		for(i = 0; i < BENCH_MODE7_LINES * SNES_PPU_WIDTH && i < lines * SNES_PPU_WIDTH &&
+			pixels[i] == reference[i]; i++);
+		if(i < BENCH_MODE7_LINES * SNES_PPU_WIDTH && i < lines * SNES_PPU_WIDTH) {
+			printf("Mode 7 %s differs from the scalar reference at line %u, pixel %u !\n",
+				   snes_ppu_mode7_simd_tostring(simd), i / SNES_PPU_WIDTH, i % SNES_PPU_WIDTH);
+			ret = -1;
+		}
+	}
+end:
+	free(pixels);
+	free(reference);
+	free(vram);
+	free(mode7);
+	return ret;
+}
+
+void list_breakpoints(snes_t *snes)
+{
+	snes_bus_watchpoint_t watchpoints[SNES_BUS_MAX_WATCHPOINTS];
+	uint32_t addrs[64];
+	uint32_t count;
+	uint32_t i;
+
+	count = snes_list_breakpoints(snes, SNES_BREAKPOINT_TYPE_CPU, addrs, 64);
+	for(i = 0; i < count && i < 64; i++)
+		printf("Breakpoint 0x%06X\n", addrs[i]);
+	if(count > 64)
+		printf("... %u more\n", count - 64);
+
+	count = snes_list_watchpoints(snes, watchpoints, SNES_BUS_MAX_WATCHPOINTS);
+	for(i = 0; i < count; i++) {
+		printf("Watchpoint %s 0x%06X-0x%06X", watchpoints[i].type == SNES_BUS_WATCH_READ ? "r" : "w",
+			   watchpoints[i].start, watchpoints[i].end);
+		if(watchpoints[i].value >= 0)
+			printf(" = 0x%02X", watchpoints[i].value);
+		printf("\n");
+	}
+}
+
+/*
+ * Parses "[r|w|x] start[-end] [value]" after a b or d command, x (execution)
+ * being the default. Returns -1 if there is no address.
+ */
+int parse_breakpoint(const char *input, snes_breakpoint_type_t *type,
+					 uint32_t *start, uint32_t *end, int16_t *value)
+{
+	unsigned int data;
+	int len = 0;
+
+	//Skip the command
+	input++;
+	while(*input == ' ')
+		input++;
+	*type = SNES_BREAKPOINT_TYPE_CPU;
+	if(input[0] == 'r' || input[0] == 'w' || input[0] == 'x') {
+		if(input[0] == 'r')
+			*type = SNES_BREAKPOINT_TYPE_READ;
+		else if(input[0] == 'w')
+			*type = SNES_BREAKPOINT_TYPE_WRITE;
+		input++;
+	}
+	if(sscanf(input, " %x%n", start, &len) != 1)
+		return -1;
+	input += len;
+	*end = *start;
+	if(sscanf(input, " -%x%n", end, &len) == 1)
+		input += len;
+	*value = -1;
+	if(sscanf(input, " %x", &data) == 1)
+		*value = data & 0xFF;
+	return 0;
+}
 
 void handle_user_input(snes_t *snes)
 {
@@ -11,6 +652,10 @@ void handle_user_input(snes_t *snes)
 	char command;
 	char previous_command = 0;
 	uint32_t params;
+	snes_breakpoint_type_t type;
+	uint32_t start;
+	uint32_t end;
+	int16_t value;
 	for(;;) {
 		input[0] = 0;
 		command = 0;
@@ -27,13 +672,39 @@ void handle_user_input(snes_t *snes)
 				break;
 			case 'b':
 			case 'B':
-				snes_set_breakpoint(snes, SNES_BREAKPOINT_TYPE_CPU, params);
+				if(parse_breakpoint(input, &type, &start, &end, &value) < 0) {
+					printf("Usage : b [r|w|x] start[-end] [value]\n");
+					break;
+				}
+				if(type == SNES_BREAKPOINT_TYPE_CPU)
+					value = -1;
+				if(snes_set_breakpoint_range(snes, type, start, end, value) < 0)
+					printf("Unable to set breakpoint 0x%06X-0x%06X\n", start, end);
+				else
+					printf("Setting breakpoint 0x%06X-0x%06X\n", start, end);
+				break;
+			case 'd':
+			case 'D':
+				if(parse_breakpoint(input, &type, &start, &end, &value) < 0) {
+					printf("Usage : d [r|w|x] start\n");
+					break;
+				}
+				if(snes_remove_breakpoint(snes, type, start) < 0)
+					printf("No breakpoint at 0x%06X\n", start);
+				break;
+			case 'l':
+			case 'L':
+				list_breakpoints(snes);
 				break;
 			case 'r':
 			case 'R':
 				printf("run\n");
 				snes_run_cpu(snes);
 				break;
+			case 's':
+			case 'S':
+				print_cpu_stats(snes);
+				break;
 			case 'q':
 			case 'Q':
 				printf("Exiting ...\n");
@@ -42,17 +713,188 @@ void handle_user_input(snes_t *snes)
 				printf("Unkonwn command %c\n",command);
 				printf("Valid commands are:\n");
 				printf("\tn: next instruction\n");
-				printf("\tb: set breakpoint\n");
+				printf("\tb: set breakpoint, b [r|w|x] start[-end] [value]\n");
+				printf("\td: delete breakpoint, d [r|w|x] start\n");
+				printf("\tl: list breakpoints\n");
 				printf("\tr: run program\n");
+				printf("\ts: print cpu statistics\n");
 				break;
 		}
 		previous_command = command;
 	}
 }
 
+//Binary PPM of the last frame rendered
+int write_frame(snes_t *snes, const char *path)
+{
+	const uint32_t *pixels = snes_get_framebuffer(snes, NULL);
+	uint8_t line[SNES_PPU_WIDTH * 3];
+	FILE *file;
+	uint32_t x;
+	uint32_t y;
+
+	file = fopen(path, "wb");
+	if(file == NULL) {
+		printf("Unable to open image file %s !\n", path);
+		return -1;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", SNES_PPU_WIDTH, SNES_PPU_HEIGHT);
+	for(y = 0; y < SNES_PPU_HEIGHT; y++) {
+		for(x = 0; x < SNES_PPU_WIDTH; x++) {
+			line[x * 3] = pixels[x] >> 16;
+			line[x * 3 + 1] = pixels[x] >> 8;
+			line[x * 3 + 2] = pixels[x];
+		}
+		fwrite(line, 1, sizeof(line), file);
+		pixels += SNES_PPU_WIDTH;
+	}
+	fclose(file);
+	return 0;
+}
+
+//Headless run of a number of frames, stops on breakpoints. audio may be NULL
+int run_frames(snes_t *snes, uint32_t frames, snes_audio_t *audio)
+{
+	int16_t samples[AUDIO_FRAME_SAMPLES * 2];
+	uint32_t i;
+	int ret = 0;
+
+	if(audio != NULL)
+		snes_set_audio_output(snes, samples, AUDIO_FRAME_SAMPLES);
+	for(i = 0; i < frames && ret == 0; i++) {
+		ret = snes_run_frame(snes);
+		if(audio != NULL) {
+			if(snes_audio_write(audio, samples, snes_get_audio_output_count(snes)) < 0)
+				audio = NULL;
+			snes_set_audio_output(snes, audio != NULL ? samples : NULL, AUDIO_FRAME_SAMPLES);
+		}
+		if(ret == SNES_CPU_STOP_BREAKPOINT) {
+			printf("Breakpoint reached at frame %u !\n", i);
+		} else if(ret == SNES_CPU_STOP_WATCHPOINT) {
+			printf("Frame %u : ", i);
+			snes_print_watch_hit(snes);
+		} else if(ret) {
+			printf("JIT lockstep mismatch at frame %u !\n", i);
+		}
+	}
+	//The samples buffer goes out of scope, the output is only set with a capture
+	if(audio != NULL)
+		snes_set_audio_output(snes, NULL, 0);
+	return ret ? -1 : 0;
+}
+
+void usage(const char *name)
+{
+	printf("Usage : %s [-t trace_file] [-j] [-l] [-i] [-a] [-f frames] [-b reads] [-s cycles] [-c iterations] [-p samples] [-d tiles] [-m lines] [-w audio_file] [-r rate] [-o image_file] rom_file\n", name);
+	printf("\t-t: write an execution trace of the CPU in trace_file\n");
+	printf("\t-j: run the CPU with the JIT recompiler\n");
+	printf("\t-l: run the JIT in lockstep with the interpreter and stop on divergence\n");
+	printf("\t-i: don't skip idle loops (accuracy testing)\n");
+	printf("\t-a: run the APU in its own thread instead of in step with the CPU\n");
+	printf("\t-f: run frames frames without the debugger, print the statistics and exit\n");
+	printf("\t-b: then read reads bytes through the bus and print its speed\n");
+	printf("\t-s: then run the SPC700 alone for cycles cycles and print its speed\n");
+	printf("\t-c: then run an ADC/SBC/CMP loop for about iterations iterations in each width and in decimal mode, print the speed of the CPU and check its results\n");
+	printf("\t-p: benchmark the DSP code paths over samples samples and exit, no rom needed\n");
+	printf("\t-d: benchmark the tile decoders over tiles tiles and exit, no rom needed\n");
+	printf("\t-m: benchmark the mode 7 renderers over lines random lines and exit, no rom needed\n");
+	printf("\t-w: write the audio of the frames to audio_file, raw PCM if it ends in .raw, WAV otherwise\n");
+	printf("\t-r: resample the audio file to rate (44100 or 48000) instead of 32000\n");
+	printf("\t-o: write the last frame rendered to image_file (PPM)\n");
+}
+
 int main(int argc, char *argv[])
 {
-	snes_cart_t *cart = snes_cart_power_up(argv[1]);
+	FILE *trace = NULL;
+	snes_cpu_jit_mode jit = SNES_CPU_JIT_OFF;
+	uint32_t frames = 0;
+	uint64_t apu_cycles = 0;
+	uint32_t bus_reads = 0;
+	uint32_t cpu_iterations = 0;
+	uint32_t dsp_samples = 0;
+	uint32_t bench_tile_count = 0;
+	uint32_t bench_mode7_lines = 0;
+	const char *audio_path = NULL;
+	const char *image_path = NULL;
+	uint32_t audio_rate = 0;
+	snes_audio_t *audio = NULL;
+	snes_audio_format_t audio_format;
+	size_t len;
+	uint8_t idle_skip = 1;
+	uint8_t apu_threaded = 0;
+	int ret = 0;
+	int opt;
+
+	while((opt = getopt(argc, argv, "t:jliaf:b:s:c:p:d:m:w:r:o:")) != -1) {
+		switch(opt) {
+			case 't':
+				trace = fopen(optarg, "w");
+				if(trace == NULL) {
+					printf("Unable to open trace file %s !\n", optarg);
+					return -1;
+				}
+				break;
+			case 'j':
+				jit = SNES_CPU_JIT_ON;
+				break;
+			case 'l':
+				jit = SNES_CPU_JIT_LOCKSTEP;
+				break;
+			case 'i':
+				idle_skip = 0;
+				break;
+			case 'a':
+				apu_threaded = 1;
+				break;
+			case 'f':
+				frames = strtoul(optarg, NULL, 0);
+				break;
+			case 'b':
+				bus_reads = strtoul(optarg, NULL, 0);
+				break;
+			case 's':
+				apu_cycles = strtoull(optarg, NULL, 0);
+				break;
+			case 'c':
+				cpu_iterations = strtoul(optarg, NULL, 0);
+				break;
+			case 'p':
+				dsp_samples = strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				bench_tile_count = strtoul(optarg, NULL, 0);
+				break;
+			case 'm':
+				bench_mode7_lines = strtoul(optarg, NULL, 0);
+				break;
+			case 'w':
+				audio_path = optarg;
+				break;
+			case 'r':
+				audio_rate = strtoul(optarg, NULL, 0);
+				if(audio_rate == SNES_APU_DSP_RATE)
+					audio_rate = 0;
+				break;
+			case 'o':
+				image_path = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+	if(dsp_samples > 0)
+		return bench_dsp(dsp_samples);
+	if(bench_tile_count > 0)
+		return bench_tiles(bench_tile_count);
+	if(bench_mode7_lines > 0)
+		return bench_mode7(bench_mode7_lines);
+	if(optind >= argc) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	snes_cart_t *cart = snes_cart_power_up(argv[optind]);
 	if(cart == NULL) {
 		printf("Unable to powerup cart !\n");
 		goto error_cart;
@@ -67,20 +909,61 @@ int main(int argc, char *argv[])
 		goto error_snes;
 	}
 
+	snes_set_cpu_trace(snes, trace);
+	if(snes_set_cpu_jit(snes, jit) < 0)
+		printf("JIT unavailable, using the interpreter\n");
+	snes_set_cpu_idle_skip(snes, idle_skip);
+	snes_set_apu_threaded(snes, apu_threaded);
+
 	//snes_set_breakpoint(snes, SNES_BREAKPOINT_TYPE_CPU, 0x0080D6);
 	//snes_set_breakpoint(snes, SNES_BREAKPOINT_TYPE_CPU, 0x0088DC);
 
 	snes_power_up(snes);
 
-	handle_user_input(snes);
+	if(audio_path != NULL && frames > 0) {
+		len = strlen(audio_path);
+		audio_format = SNES_AUDIO_FORMAT_WAV;
+		if(len >= 4 && strcmp(audio_path + len - 4, ".raw") == 0)
+			audio_format = SNES_AUDIO_FORMAT_RAW;
+		if(apu_threaded)
+			printf("The audio capture needs the APU in step with the CPU\n");
+		else
+			audio = snes_audio_init(audio_path, audio_format, audio_rate);
+	}
+
+	if(frames > 0 || apu_cycles > 0 || bus_reads > 0 || cpu_iterations > 0) {
+		//A lockstep mismatch or a breakpoint stop fails the run
+		ret = run_frames(snes, frames, audio);
+		if(audio != NULL) {
+			snes_audio_destroy(audio);
+			printf("Audio written to %s\n", audio_path);
+		}
+		if(image_path != NULL && write_frame(snes, image_path) == 0)
+			printf("Frame written to %s\n", image_path);
+		print_cpu_stats(snes);
+		if(bus_reads > 0)
+			bench_bus(snes, bus_reads);
+		if(apu_cycles > 0) {
+			if(apu_threaded)
+				printf("The SPC700 benchmark needs the APU in step with the CPU\n");
+			else
+				bench_apu(snes, apu_cycles);
+		}
+		if(cpu_iterations > 0 && bench_cpu(snes, cpu_iterations) < 0)
+			ret = -1;
+	} else {
+		handle_user_input(snes);
+	}
 
 	//This function will never return (at this point of the dev)
 	printf("Destroying snes\n");
 	snes_destroy(snes);
 	printf("Stopping cart\n");
 	snes_cart_power_down(cart);
+	if(trace != NULL)
+		fclose(trace);
 
-	return 0;
+	return ret ? 1 : 0;
 error_snes:
 	snes_cart_power_down(cart);
 error_cart:
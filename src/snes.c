@@ -8,6 +8,8 @@
 #include "snes_cpu.h"
 #include "snes_ram.h"
 #include "snes_apu.h"
+#include "snes_irq.h"
+#include "snes_ppu.h"
 
 struct _snes {
 	snes_cart_t *cart;
@@ -15,6 +17,8 @@ struct _snes {
 	snes_cpu_t *cpu;
 	snes_ram_t *wram;
 	snes_apu_t *apu;
+	snes_irq_t *irq;
+	snes_ppu_t *ppu;
 };
 
 snes_t *snes_init(snes_cart_t *cart)
@@ -23,7 +27,7 @@ snes_t *snes_init(snes_cart_t *cart)
 
 	snes->cart = cart;
 
-	snes->wram = snes_ram_init(128*1024);
+	snes->wram = snes_ram_init(SNES_BUS_WRAM_SIZE);
 	if(snes->wram == NULL) {
 		printf("Unable to init wram !\n");
 		goto error_wram;
@@ -35,7 +39,19 @@ snes_t *snes_init(snes_cart_t *cart)
 		goto error_apu;
 	}
 
-	snes->bus_a = snes_bus_init(cart, snes->wram, snes->apu);
+	snes->irq = snes_irq_init();
+	if(snes->irq == NULL) {
+		printf("Unable to init irq !\n");
+		goto error_irq;
+	}
+
+	snes->ppu = snes_ppu_init();
+	if(snes->ppu == NULL) {
+		printf("Unable to init ppu !\n");
+		goto error_ppu;
+	}
+
+	snes->bus_a = snes_bus_init(cart, snes->wram, snes->apu, snes->irq, snes->ppu);
 	if(snes->bus_a == NULL) {
 		printf("Unable to init bus_a !\n");
 		goto error_bus_a;
@@ -51,6 +67,10 @@ snes_t *snes_init(snes_cart_t *cart)
 error_cpu:
 	snes_bus_destroy(snes->bus_a);
 error_bus_a:
+	snes_ppu_destroy(snes->ppu);
+error_ppu:
+	snes_irq_destroy(snes->irq);
+error_irq:
 	snes_apu_destroy(snes->apu);
 error_apu:
 	snes_ram_destroy(snes->wram);
@@ -66,6 +86,8 @@ void snes_destroy(snes_t *snes)
 	snes_cpu_destroy(snes->cpu);
 	snes_apu_destroy(snes->apu);
 	snes_bus_destroy(snes->bus_a);
+	snes_ppu_destroy(snes->ppu);
+	snes_irq_destroy(snes->irq);
 	snes_ram_destroy(snes->wram);
 	free(snes);
 }
@@ -74,21 +96,22 @@ int snes_power_up(snes_t *snes)
 {
 	int ret = 0;
 
-	ret = snes_cpu_power_up(snes->cpu);
+	//The APU ports must be ready before the CPU looks at them
+	ret = snes_apu_power_up(snes->apu);
 	if(ret < 0) {
-		goto error_cpu;
+		goto error_apu;
 	}
 
-	ret = snes_apu_power_up(snes->apu);
+	ret = snes_cpu_power_up(snes->cpu);
 	if(ret < 0) {
-		goto error_apu;
+		goto error_cpu;
 	}
 
 	return ret;
 
-error_apu:
-	snes_cpu_power_down(snes->cpu);
 error_cpu:
+	snes_apu_power_down(snes->apu);
+error_apu:
 	return ret;
 }
 
@@ -102,14 +125,70 @@ void snes_power_down(snes_t *snes)
 
 void snes_set_breakpoint(snes_t *snes, snes_breakpoint_type_t breakpoint_type, uint32_t addr)
 {
+	snes_set_breakpoint_range(snes, breakpoint_type, addr, addr, -1);
+}
+
+int snes_set_breakpoint_range(snes_t *snes, snes_breakpoint_type_t breakpoint_type,
+							  uint32_t start, uint32_t end, int16_t value)
+{
+	uint32_t addr;
+
+	start &= 0xFFFFFF;
+	end &= 0xFFFFFF;
+	if(end < start)
+		return -1;
 	switch (breakpoint_type) {
 		case SNES_BREAKPOINT_TYPE_CPU:
-			snes_cpu_set_breakpoint(snes->cpu, addr);
-			break;
+			for(addr = start; addr <= end; addr++) {
+				if(snes_cpu_set_breakpoint(snes->cpu, addr) < 0)
+					return -1;
+			}
+			return 0;
+		case SNES_BREAKPOINT_TYPE_READ:
+			return snes_bus_add_watchpoint(snes->bus_a, SNES_BUS_WATCH_READ, start, end, value);
+		case SNES_BREAKPOINT_TYPE_WRITE:
+			return snes_bus_add_watchpoint(snes->bus_a, SNES_BUS_WATCH_WRITE, start, end, value);
 		default:
 			printf("Breakpoint type invalid !\n");
 			assert(0);
 	}
+	return -1;
+}
+
+int snes_remove_breakpoint(snes_t *snes, snes_breakpoint_type_t breakpoint_type, uint32_t addr)
+{
+	switch (breakpoint_type) {
+		case SNES_BREAKPOINT_TYPE_CPU:
+			return snes_cpu_remove_breakpoint(snes->cpu, addr);
+		case SNES_BREAKPOINT_TYPE_READ:
+			return snes_bus_remove_watchpoint(snes->bus_a, SNES_BUS_WATCH_READ, addr);
+		case SNES_BREAKPOINT_TYPE_WRITE:
+			return snes_bus_remove_watchpoint(snes->bus_a, SNES_BUS_WATCH_WRITE, addr);
+		default:
+			printf("Breakpoint type invalid !\n");
+			return -1;
+	}
+}
+
+uint32_t snes_list_breakpoints(snes_t *snes, snes_breakpoint_type_t breakpoint_type, uint32_t *addrs, uint32_t max)
+{
+	switch (breakpoint_type) {
+		case SNES_BREAKPOINT_TYPE_CPU:
+			return snes_cpu_get_breakpoints(snes->cpu, addrs, max);
+		default:
+			printf("Breakpoint type invalid !\n");
+			return 0;
+	}
+}
+
+uint32_t snes_list_watchpoints(snes_t *snes, snes_bus_watchpoint_t *watchpoints, uint32_t max)
+{
+	return snes_bus_get_watchpoints(snes->bus_a, watchpoints, max);
+}
+
+void snes_print_watch_hit(snes_t *snes)
+{
+	snes_cpu_print_watch_hit(snes->cpu);
 }
 
 void snes_do_cpu_tick(snes_t *snes)
@@ -122,6 +201,99 @@ void snes_run_cpu(snes_t *snes)
 	snes_cpu_set_execution_mode(snes->cpu, SNES_CPU_EXECUTION_MODE_RUN);
 }
 
+int snes_run_cycles(snes_t *snes, uint64_t cycles)
+{
+	return snes_cpu_run_cycles(snes->cpu, cycles);
+}
+
+int snes_run_frame(snes_t *snes)
+{
+	uint64_t frame = snes_cpu_get_cycles(snes->cpu) / SNES_FRAME_CYCLES;
+	return snes_cpu_run_until(snes->cpu, (frame + 1) * SNES_FRAME_CYCLES);
+}
+
+int snes_step(snes_t *snes)
+{
+	return snes_cpu_step(snes->cpu);
+}
+
+void snes_reset(snes_t *snes)
+{
+	snes_cpu_reset(snes->cpu);
+}
+
+void snes_jump(snes_t *snes, uint32_t addr)
+{
+	snes_cpu_jump(snes->cpu, addr);
+}
+
+uint64_t snes_get_cycles(snes_t *snes)
+{
+	return snes_cpu_get_cycles(snes->cpu);
+}
+
+void snes_set_cpu_trace(snes_t *snes, FILE *trace)
+{
+	snes_cpu_set_trace(snes->cpu, trace);
+}
+
+int snes_set_cpu_jit(snes_t *snes, snes_cpu_jit_mode mode)
+{
+	return snes_cpu_set_jit(snes->cpu, mode);
+}
+
+void snes_set_apu_threaded(snes_t *snes, uint8_t enable)
+{
+	snes_apu_set_threaded(snes->apu, enable);
+}
+
+void snes_set_cpu_idle_skip(snes_t *snes, uint8_t enable)
+{
+	snes_cpu_set_idle_skip(snes->cpu, enable);
+}
+
+void snes_get_cpu_stats(snes_t *snes, snes_cpu_stats_t *stats)
+{
+	snes_cpu_get_stats(snes->cpu, stats);
+}
+
+void snes_run_apu_cycles(snes_t *snes, uint64_t cycles)
+{
+	snes_apu_run_cycles(snes->apu, cycles);
+}
+
+void snes_get_apu_stats(snes_t *snes, snes_apu_spc_stats_t *stats)
+{
+	snes_apu_get_stats(snes->apu, stats);
+}
+
+void snes_dump_apu(snes_t *snes)
+{
+	snes_apu_dump(snes->apu);
+}
+
+void snes_set_audio_output(snes_t *snes, int16_t *buffer, uint32_t frames)
+{
+	snes_apu_set_output(snes->apu, buffer, frames);
+}
+
+uint32_t snes_get_audio_output_count(snes_t *snes)
+{
+	return snes_apu_get_output_count(snes->apu);
+}
+
+const uint32_t *snes_get_framebuffer(snes_t *snes, uint64_t *frames)
+{
+	if(frames != NULL)
+		*frames = snes_ppu_get_frames(snes->ppu);
+	return snes_ppu_get_framebuffer(snes->ppu);
+}
+
+snes_bus_t *snes_get_bus(snes_t *snes)
+{
+	return snes->bus_a;
+}
+
 void nmi(snes_t *snes)
 {
 	snes_cpu_nmi(snes->cpu);
@@ -2,11 +2,19 @@
 #define SNES_H
 
 #include "snes_cart.h"
+#include "snes_cpu.h"
+#include "snes_bus.h"
+#include "snes_apu_spc.h"
 
 typedef struct _snes snes_t;
 
+//NTSC frame : 262 scanlines of 1364 master cycles
+#define SNES_FRAME_CYCLES (262 * 1364)
+
 typedef enum _snes_breakpoint_type {
-	SNES_BREAKPOINT_TYPE_CPU,
+	SNES_BREAKPOINT_TYPE_CPU, //Execution
+	SNES_BREAKPOINT_TYPE_READ, //Data reads (watchpoints)
+	SNES_BREAKPOINT_TYPE_WRITE, //Data writes (watchpoints)
 }snes_breakpoint_type_t;
 
 snes_t *snes_init(snes_cart_t *cart);
@@ -18,10 +26,68 @@ void snes_power_down(snes_t *snes);
 void snes_set_breakpoint(snes_t *snes,
 						 snes_breakpoint_type_t breakpoint_type,
 						 uint32_t addr);
+/*
+ * Breakpoint on each address from start to end included. value is -1, or the
+ * only data value stopping a read or write watchpoint (-1 for CPU breakpoints).
+ * Watchpoints stop after the instruction doing the access.
+ */
+int snes_set_breakpoint_range(snes_t *snes,
+							  snes_breakpoint_type_t breakpoint_type,
+							  uint32_t start, uint32_t end, int16_t value);
+/*Returns -1 if there is no such breakpoint, watchpoints are given by their start*/
+int snes_remove_breakpoint(snes_t *snes,
+						   snes_breakpoint_type_t breakpoint_type,
+						   uint32_t addr);
+/*Fills addrs with up to max addresses, returns the number of breakpoints*/
+uint32_t snes_list_breakpoints(snes_t *snes,
+							   snes_breakpoint_type_t breakpoint_type,
+							   uint32_t *addrs, uint32_t max);
+/*Fills watchpoints with up to max entries, returns the number of watchpoints*/
+uint32_t snes_list_watchpoints(snes_t *snes, snes_bus_watchpoint_t *watchpoints, uint32_t max);
+/*Prints and clears the last watchpoint hit*/
+void snes_print_watch_hit(snes_t *snes);
 
 void snes_do_cpu_tick(snes_t *snes);
 void snes_run_cpu(snes_t *snes);
 
+/*
+ * Headless execution on the caller's thread, see snes_cpu_run_until. Not to be
+ * used while the CPU thread runs (snes_run_cpu, snes_do_cpu_tick).
+ * snes_run_frame runs up to the end of the current frame.
+ */
+int snes_run_cycles(snes_t *snes, uint64_t cycles);
+int snes_run_frame(snes_t *snes);
+int snes_step(snes_t *snes);
+void snes_reset(snes_t *snes);
+/*Continues at the 24 bits address addr, for benchmarks and tools*/
+void snes_jump(snes_t *snes, uint32_t addr);
+uint64_t snes_get_cycles(snes_t *snes);
+
+void snes_set_cpu_trace(snes_t *snes, FILE *trace);
+int snes_set_cpu_jit(snes_t *snes, snes_cpu_jit_mode mode);
+void snes_set_cpu_idle_skip(snes_t *snes, uint8_t enable);
+/*APU in its own thread instead of caught up by the CPU, before snes_power_up*/
+void snes_set_apu_threaded(snes_t *snes, uint8_t enable);
+void snes_get_cpu_stats(snes_t *snes, snes_cpu_stats_t *stats);
+/*Runs the SPC700 alone for cycles SPC700 cycles, on the caller's thread*/
+void snes_run_apu_cycles(snes_t *snes, uint64_t cycles);
+void snes_get_apu_stats(snes_t *snes, snes_apu_spc_stats_t *stats);
+void snes_dump_apu(snes_t *snes);
+/*
+ * The APU's 32kHz samples go to buffer as left/right pairs, up to frames
+ * pairs, until it is set again
+ */
+void snes_set_audio_output(snes_t *snes, int16_t *buffer, uint32_t frames);
+uint32_t snes_get_audio_output_count(snes_t *snes);
+/*
+ * Last frame rendered, SNES_PPU_WIDTH x SNES_PPU_HEIGHT 0x00RRGGBB pixels.
+ * frames (may be NULL) gets the number of frames rendered.
+ */
+const uint32_t *snes_get_framebuffer(snes_t *snes, uint64_t *frames);
+
+/*Bus of the CPU, for benchmarks and tools*/
+snes_bus_t *snes_get_bus(snes_t *snes);
+
 void nmi(snes_t *snes);
 
 
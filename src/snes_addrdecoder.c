@@ -4,15 +4,13 @@
 #include "snes_addrdecoder.h"
 
 
-struct _snes_address{
-	enum snes_memtype type;
-	uint32_t dec_addr;
-};
-
 struct _snes_address_decoder{
 	enum snes_rom_type rom_type;
+	snes_address_page_t pages[SNES_ADDRDECODER_PAGE_COUNT];
 };
 
+static void snes_addrdecoder_init_pages(snes_address_decoder_t *decoder);
+
 snes_address_decoder_t *snes_addrdecoder_init(snes_rom_t *rom)
 {
 	snes_address_decoder_t *decoder = (snes_address_decoder_t *)malloc(sizeof(snes_address_decoder_t));
@@ -28,6 +26,7 @@ snes_address_decoder_t *snes_addrdecoder_init(snes_rom_t *rom)
 			   snes_rom_type_to_string(decoder->rom_type));
 		goto error_rom;
 	}
+	snes_addrdecoder_init_pages(decoder);
 	return decoder;
 error_rom:
 	free(decoder);
@@ -53,9 +52,9 @@ static uint32_t snes_addrdecoder_trans_wram_addr(uint8_t bank, uint16_t offset)
 {
 	uint32_t addr = ((uint32_t)bank << 16) + offset;
 
-	/*Low pages*/
-	if(bank >= 0x00 && bank <= 0x3F)
-			return (uint32_t) offset;
+	/*Low pages, the first 8KB of the WRAM in banks 0x00-0x3F and 0x80-0xBF*/
+	if((bank & 0x7F) <= 0x3F)
+		return (uint32_t) offset & 0x1FFF;
 
 	return addr - 0x7E0000;
 }
@@ -65,92 +64,107 @@ static uint32_t snes_addrdecoder_trans_rom_addr(uint8_t bank, uint16_t offset)
 	return (bank & 0x7F) * 0x8000 + (offset - 0x8000);
 }
 
-static uint32_t snes_addrdecoder_trans_apu_addr(uint8_t bank, uint16_t offset)
+//B bus address : PPU, APU ports, WRAM port
+static uint32_t snes_addrdecoder_trans_bbus_addr(uint8_t bank, uint16_t offset)
 {
-	return (offset - 0x2140);
+	return (offset - 0x2100);
 }
 
-snes_address_t *snes_addrdecoder_decode(snes_address_decoder_t *decoder, uint32_t addr)
+snes_address_t snes_addrdecoder_decode(snes_address_decoder_t *decoder, uint32_t addr)
 {
-	snes_address_t *address = malloc(sizeof(snes_address_t));
+	snes_address_t address;
 	uint8_t bank = addr >> 16;
 	uint16_t offset = addr;
 
-	address->type = OTHER;
-	address->dec_addr = addr;
+	address.type = OTHER;
+	address.dec_addr = addr;
 
 	if ((bank >= 0x00 && bank <= 0x3F) || (bank >= 0x80 && bank <= 0xBF)) {
 		if(offset >= 0x0000 && offset <= 0x1FFF) {
-			address->type = WRAM;
-			address->dec_addr = snes_addrdecoder_trans_wram_addr(bank, offset);
+			address.type = WRAM;
+			address.dec_addr = snes_addrdecoder_trans_wram_addr(bank, offset);
 		} else if (offset >= 0x2000 && offset <= 0x20FF) {
 			// Nor used !
-		} else if (offset >= 0x2100 && offset <= 0x213F) {
-			address->type = OTHER;
-		} else if (offset >= 0x2140 && offset <= 0x217F) {
-			//Not so true. PPU1 and 2 are also here !
-			address->type = PPU1_APU;
-			address->dec_addr = snes_addrdecoder_trans_apu_addr(bank, offset);
-		} else if (offset >= 0x2180 && offset <= 0x2FFF) {
-			address->type = OTHER;
+		} else if (offset >= 0x2100 && offset <= 0x21FF) {
+			//The whole B bus : PPU1 and 2, APU, WRAM port
+			address.type = PPU1_APU;
+			address.dec_addr = snes_addrdecoder_trans_bbus_addr(bank, offset);
 		} else if (offset >= 0x2200 && offset <= 0x2FFF) {
 			// Nor used !
 		} else if (offset >= 0x3000 && offset <= 0x3FFF) {
 			// Nor used ! (specific)
-			address->type = CART_SPECIFIC;
+			address.type = CART_SPECIFIC;
 		} else if (offset >= 0x4000 && offset <= 0x40FF) {
-			address->type = OLD_PAD;
+			address.type = OLD_PAD;
 		} else if (offset >= 0x4100 && offset <= 0x41FF) {
 			// Nor used !
 		} else if (offset >= 0x4200 && offset <= 0x44FF) {
-			address->type = PPU2_DMA;
+			address.type = PPU2_DMA;
 		} else if (offset >= 0x4500 && offset <= 0x5FFF) {
 			// Nor used !
 		} else if (offset >= 0x6000 && offset <= 0x7FFF) {
-			address->type = CART_SPECIFIC;
+			address.type = CART_SPECIFIC;
 		} else if (offset >= 0x8000 && offset <= 0xFFFF) {
-			address->type = ROM;
-			address->dec_addr = snes_addrdecoder_trans_rom_addr(bank, offset);
+			address.type = ROM;
+			address.dec_addr = snes_addrdecoder_trans_rom_addr(bank, offset);
 		}
 	} else if((bank >= 0x40 && bank <= 0x6F) || (bank >= 0xC0 && bank <= 0xEF)) {
-		address->type = ROM;
-		address->dec_addr = snes_addrdecoder_trans_rom_addr(bank,offset);
+		address.type = ROM;
+		address.dec_addr = snes_addrdecoder_trans_rom_addr(bank,offset);
 	} else if ((bank >= 0x70 && bank <= 0x7D) || (bank >= 0xF0 && bank <= 0xFD)) {
 		if(offset >= 0x0000 && offset <= 0x7FFF) {
-			address->type = SRAM;
-			address->dec_addr = snes_addrdecoder_trans_sram_addr(bank,offset);
+			address.type = SRAM;
+			address.dec_addr = snes_addrdecoder_trans_sram_addr(bank,offset);
 		} else {
-			address->type = ROM;
-			address->dec_addr = snes_addrdecoder_trans_rom_addr(bank,offset);
+			address.type = ROM;
+			address.dec_addr = snes_addrdecoder_trans_rom_addr(bank,offset);
 		}
 	} else if(bank == 0x7E || bank == 0x7F) {
-		address->type = WRAM;
-		address->dec_addr = snes_addrdecoder_trans_wram_addr(bank, offset);
+		address.type = WRAM;
+		address.dec_addr = snes_addrdecoder_trans_wram_addr(bank, offset);
 	} else if(bank == 0xFE || bank == 0xFF) {
 		if(offset >= 0x0000 && offset <= 0x7fff) {
-			address->type = SRAM;
-			address->dec_addr = snes_addrdecoder_trans_sram_addr(bank,offset);
+			address.type = SRAM;
+			address.dec_addr = snes_addrdecoder_trans_sram_addr(bank,offset);
 		} else {
-			address->type = ROM;
-			address->dec_addr = snes_addrdecoder_trans_rom_addr(bank,offset);
+			address.type = ROM;
+			address.dec_addr = snes_addrdecoder_trans_rom_addr(bank,offset);
 		}
 	}
 	return address;
 }
 
-void snes_addrdecoder_destroy_adress(snes_address_t *address)
+static uint8_t snes_addrdecoder_is_memory(enum snes_memtype type)
 {
-	free(address);
+	switch (type) {
+		case ROM:
+		case SRAM:
+		case WRAM:
+			return 1;
+		default:
+			return 0;
+	}
 }
 
-enum snes_memtype snes_addrdecoder_get_memtype(snes_address_t *address)
+static void snes_addrdecoder_init_pages(snes_address_decoder_t *decoder)
 {
-	return address->type;
+	uint32_t page;
+
+	for(page = 0; page < SNES_ADDRDECODER_PAGE_COUNT; page++) {
+		uint32_t addr = page << SNES_ADDRDECODER_PAGE_SHIFT;
+		snes_address_t first = snes_addrdecoder_decode(decoder, addr);
+		snes_address_t last = snes_addrdecoder_decode(decoder, addr + SNES_ADDRDECODER_PAGE_MASK);
+
+		decoder->pages[page].base = first;
+		decoder->pages[page].linear = snes_addrdecoder_is_memory(first.type) &&
+									  first.type == last.type &&
+									  last.dec_addr == first.dec_addr + SNES_ADDRDECODER_PAGE_MASK;
+	}
 }
 
-uint32_t snes_addrdecoder_get_transaddr(snes_address_t *address)
+const snes_address_page_t *snes_addrdecoder_get_page(snes_address_decoder_t *decoder, uint32_t page)
 {
-	return address->dec_addr;
+	return &(decoder->pages[page]);
 }
 
 const char *snes_memtype_to_string(enum snes_memtype type)
@@ -4,6 +4,12 @@
 #include <stdint.h>
 #include "snes_rom.h"
 
+/*The 24 bits address space is split in 4KB pages*/
+#define SNES_ADDRDECODER_PAGE_SHIFT 12
+#define SNES_ADDRDECODER_PAGE_SIZE (1 << SNES_ADDRDECODER_PAGE_SHIFT)
+#define SNES_ADDRDECODER_PAGE_MASK (SNES_ADDRDECODER_PAGE_SIZE - 1)
+#define SNES_ADDRDECODER_PAGE_COUNT (1 << (24 - SNES_ADDRDECODER_PAGE_SHIFT))
+
 typedef struct _snes_address_decoder snes_address_decoder_t;
 typedef struct _snes_address snes_address_t;
 
@@ -18,16 +24,30 @@ enum snes_memtype {
 	OTHER,
 };
 
+struct _snes_address{
+	enum snes_memtype type;
+	uint32_t dec_addr;
+};
+
+/*
+ * Page descriptor, computed once at init time.
+ * A linear page is entirely mapped on a single memory type with a contiguous
+ * translation, so that any address of the page is base.dec_addr + page offset.
+ * Other pages (MMIO, mixed) must go through snes_addrdecoder_decode.
+ */
+typedef struct _snes_address_page{
+	snes_address_t base;
+	uint8_t linear;
+} snes_address_page_t;
+
 const char *snes_memtype_to_string(enum snes_memtype type);
 
 snes_address_decoder_t *snes_addrdecoder_init(snes_rom_t *rom);
 void snes_addrdecoder_destroy(snes_address_decoder_t *decoder);
 
 
-snes_address_t *snes_addrdecoder_decode(snes_address_decoder_t *decoder, uint32_t addr);
-enum snes_memtype snes_addrdecoder_get_memtype(snes_address_t *address);
-uint32_t snes_addrdecoder_get_transaddr(snes_address_t *address);
-void snes_addrdecoder_destroy_adress(snes_address_t *address);
+snes_address_t snes_addrdecoder_decode(snes_address_decoder_t *decoder, uint32_t addr);
+const snes_address_page_t *snes_addrdecoder_get_page(snes_address_decoder_t *decoder, uint32_t page);
 
 
 #endif //SNES_ADDRDECODER_H
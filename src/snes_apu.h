@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "snes_apu_port.h"
+#include "snes_apu_spc.h"
 
 typedef struct _snes_apu snes_apu_t;
 
@@ -14,4 +15,33 @@ void snes_apu_power_down(snes_apu_t *apu);
 
 snes_apu_port_t *snes_apu_get_port(snes_apu_t *apu);
 
+/*
+ * The APU is run on the CPU's thread : the bus catches it up to the master
+ * clock before each access to $2140-$2143, and at the end of each CPU run.
+ * The threaded mode (set before power up) runs it from its own thread
+ * instead, for comparison : snes_apu_catch_up only publishes the clock.
+ */
+void snes_apu_set_threaded(snes_apu_t *apu, uint8_t threaded);
+void snes_apu_catch_up(snes_apu_t *apu, uint64_t now);
+
+/*Runs the SPC700 alone for cycles SPC700 cycles (benchmark), not in threaded mode*/
+void snes_apu_run_cycles(snes_apu_t *apu, uint64_t cycles);
+void snes_apu_get_stats(snes_apu_t *apu, snes_apu_spc_stats_t *stats);
+void snes_apu_dump(snes_apu_t *apu);
+
+/*
+ * Upload loop fast path of the CPU : catches up to now, then count bytes of
+ * the block being received by the IPL, from index on, are stored at once. The
+ * ports are left as the CPU and the IPL leave them after the last byte.
+ * Returns -1 when the IPL isn't waiting for that byte, and in threaded mode.
+ */
+int snes_apu_ipl_upload(snes_apu_t *apu, uint64_t now, uint8_t index, const uint8_t *data, uint32_t count);
+
+/*
+ * 32kHz stereo samples of the DSP, see snes_apu_dsp_set_output. In threaded
+ * mode the buffer is filled from the APU thread.
+ */
+void snes_apu_set_output(snes_apu_t *apu, int16_t *buffer, uint32_t frames);
+uint32_t snes_apu_get_output_count(snes_apu_t *apu);
+
 #endif //SNES_APU_PORT_H
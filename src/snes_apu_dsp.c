@@ -0,0 +1,780 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_apu_dsp.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SNES_APU_DSP_X86
+#include <immintrin.h>
+#endif
+
+//Voice registers, at voice * 0x10
+#define SNES_APU_DSP_VOLL 0x00
+#define SNES_APU_DSP_VOLR 0x01
+#define SNES_APU_DSP_PITCHL 0x02
+#define SNES_APU_DSP_PITCHH 0x03
+#define SNES_APU_DSP_SRCN 0x04
+#define SNES_APU_DSP_ADSR1 0x05
+#define SNES_APU_DSP_ADSR2 0x06
+#define SNES_APU_DSP_GAIN 0x07
+#define SNES_APU_DSP_ENVX 0x08
+#define SNES_APU_DSP_OUTX 0x09
+#define SNES_APU_DSP_FIR 0x0F
+
+//Global registers
+#define SNES_APU_DSP_MVOLL 0x0C
+#define SNES_APU_DSP_MVOLR 0x1C
+#define SNES_APU_DSP_EVOLL 0x2C
+#define SNES_APU_DSP_EVOLR 0x3C
+#define SNES_APU_DSP_KON 0x4C
+#define SNES_APU_DSP_KOFF 0x5C
+#define SNES_APU_DSP_FLG 0x6C
+#define SNES_APU_DSP_ENDX 0x7C
+#define SNES_APU_DSP_EFB 0x0D
+#define SNES_APU_DSP_PMON 0x2D
+#define SNES_APU_DSP_NON 0x3D
+#define SNES_APU_DSP_EON 0x4D
+#define SNES_APU_DSP_DIR 0x5D
+#define SNES_APU_DSP_ESA 0x6D
+#define SNES_APU_DSP_EDL 0x7D
+
+#define SNES_APU_DSP_FLG_RESET 0x80
+#define SNES_APU_DSP_FLG_MUTE 0x40
+#define SNES_APU_DSP_FLG_ECHO_OFF 0x20
+#define SNES_APU_DSP_FLG_NOISE_RATE 0x1F
+
+//BRR blocks : a header then 16 samples of 4 bits
+#define SNES_APU_DSP_BRR_BLOCK 9
+#define SNES_APU_DSP_BRR_SAMPLES 16
+#define SNES_APU_DSP_BRR_END 0x01
+#define SNES_APU_DSP_BRR_LOOP 0x02
+//The interpolation reads the 3 samples before the current one
+#define SNES_APU_DSP_BRR_HISTORY 3
+
+//Samples between key on and the first output
+#define SNES_APU_DSP_KON_DELAY 5
+
+//The rates count down on a shared counter
+#define SNES_APU_DSP_COUNTER_RANGE (2048 * 5 * 3)
+
+typedef enum _snes_apu_dsp_env_mode {
+	SNES_APU_DSP_ENV_RELEASE,
+	SNES_APU_DSP_ENV_ATTACK,
+	SNES_APU_DSP_ENV_DECAY,
+	SNES_APU_DSP_ENV_SUSTAIN,
+} snes_apu_dsp_env_mode_t;
+
+typedef struct {
+	//Tail of the previous block, then the current block
+	int16_t samples[SNES_APU_DSP_BRR_HISTORY + SNES_APU_DSP_BRR_SAMPLES];
+	uint32_t interp_pos; //Position in the block, 12 bits of fraction
+	uint16_t brr_addr; //Current block
+	uint8_t brr_header;
+	uint8_t kon_delay;
+	snes_apu_dsp_env_mode_t env_mode;
+	int env;
+	int hidden_env;
+	int output; //Last output, the next voice's pitch modulation
+} snes_apu_dsp_voice_t;
+
+/*
+ * Decodes a BRR block to 16 samples : samples[-2] and samples[-1] hold the
+ * previous block's last ones for the filters.
+ */
+typedef void (*snes_apu_dsp_brr_func)(const uint8_t *block, int16_t *samples);
+/*Echo FIR filter over the 8 last echo samples of each side, oldest first*/
+typedef void (*snes_apu_dsp_fir_func)(const int16_t *left, const int16_t *right,
+									  const int16_t *coefficients, int *out);
+
+struct _snes_apu_dsp {
+	uint8_t *ram;
+	uint8_t registers[SNES_APU_DSP_REGISTERS];
+	snes_apu_dsp_voice_t voices[SNES_APU_DSP_VOICES];
+	uint64_t samples;
+	int counter;
+	int noise;
+	uint8_t new_kon; //Written since the last key on poll
+	uint8_t every_other;
+	//Echo
+	uint32_t echo_offset;
+	uint32_t echo_length;
+	int16_t fir[8];
+	//History of the echo samples, twice in a row so that the window is contiguous
+	int16_t echo_left[16];
+	int16_t echo_right[16];
+	uint8_t echo_pos;
+	//Output
+	int16_t *buffer;
+	uint32_t buffer_frames;
+	uint32_t buffer_count;
+	snes_apu_dsp_simd_t simd;
+	snes_apu_dsp_brr_func brr_decode;
+	snes_apu_dsp_fir_func fir_filter;
+};
+
+//Period of each rate in samples, rate 0 never happens
+static const uint16_t snes_apu_dsp_rates[32] = {
+	SNES_APU_DSP_COUNTER_RANGE + 1, 2048, 1536,
+	1280, 1024, 768,
+	640, 512, 384,
+	320, 256, 192,
+	160, 128, 96,
+	80, 64, 48,
+	40, 32, 24,
+	20, 16, 12,
+	10, 8, 6,
+	5, 4, 3,
+	2, 1,
+};
+
+static const uint16_t snes_apu_dsp_rate_offsets[32] = {
+	1, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	536, 0, 1040,
+	0, 0,
+};
+
+static const char *const snes_apu_dsp_simd_names[] = {
+	[SNES_APU_DSP_SIMD_SCALAR] = "scalar",
+	[SNES_APU_DSP_SIMD_SSE2] = "SSE2",
+	[SNES_APU_DSP_SIMD_AVX2] = "AVX2",
+};
+
+static inline int snes_apu_dsp_clamp16(int value)
+{
+	if(value < -32768)
+		return -32768;
+	if(value > 32767)
+		return 32767;
+	return value;
+}
+
+static inline uint16_t snes_apu_dsp_read16(const uint8_t *ram, uint16_t addr)
+{
+	return ram[addr] | (ram[(uint16_t)(addr + 1)] << 8);
+}
+
+//True when the event of this rate happens on the current sample
+static inline int snes_apu_dsp_rate_tick(snes_apu_dsp_t *dsp, uint8_t rate)
+{
+	return (dsp->counter + snes_apu_dsp_rate_offsets[rate]) % snes_apu_dsp_rates[rate] == 0;
+}
+
+/*
+ * Interpolation kernel of the console's ROM : gauss[i] weighs a sample
+ * (512 - i) / 256 samples away, the 4 weights of a position add up to 2047-2049
+ */
+static const int16_t snes_apu_dsp_gauss[512] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2,
+	2, 2, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 5, 5, 5, 5,
+	6, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 10,
+	11, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 15, 16, 16, 17, 17,
+	18, 19, 19, 20, 20, 21, 21, 22, 23, 23, 24, 24, 25, 26, 27, 27,
+	28, 29, 29, 30, 31, 32, 32, 33, 34, 35, 36, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56,
+	58, 59, 60, 61, 62, 64, 65, 66, 67, 69, 70, 71, 73, 74, 76, 77,
+	78, 80, 81, 83, 84, 86, 87, 89, 90, 92, 94, 95, 97, 99, 100, 102,
+	104, 106, 107, 109, 111, 113, 115, 117, 118, 120, 122, 124, 126, 128, 130, 132,
+	134, 137, 139, 141, 143, 145, 147, 150, 152, 154, 156, 159, 161, 163, 166, 168,
+	171, 173, 175, 178, 180, 183, 186, 188, 191, 193, 196, 199, 201, 204, 207, 210,
+	212, 215, 218, 221, 224, 227, 230, 233, 236, 239, 242, 245, 248, 251, 254, 257,
+	260, 263, 267, 270, 273, 276, 280, 283, 286, 290, 293, 297, 300, 304, 307, 311,
+	314, 318, 321, 325, 328, 332, 336, 339, 343, 347, 351, 354, 358, 362, 366, 370,
+	374, 378, 381, 385, 389, 393, 397, 401, 405, 410, 414, 418, 422, 426, 430, 434,
+	439, 443, 447, 451, 456, 460, 464, 469, 473, 477, 482, 486, 491, 495, 499, 504,
+	508, 513, 517, 522, 527, 531, 536, 540, 545, 550, 554, 559, 563, 568, 573, 577,
+	582, 587, 592, 596, 601, 606, 611, 615, 620, 625, 630, 635, 640, 644, 649, 654,
+	659, 664, 669, 674, 678, 683, 688, 693, 698, 703, 708, 713, 718, 723, 728, 732,
+	737, 742, 747, 752, 757, 762, 767, 772, 777, 782, 787, 792, 797, 802, 806, 811,
+	816, 821, 826, 831, 836, 841, 846, 851, 855, 860, 865, 870, 875, 880, 884, 889,
+	894, 899, 904, 908, 913, 918, 923, 927, 932, 937, 941, 946, 951, 955, 960, 965,
+	969, 974, 978, 983, 988, 992, 997, 1001, 1005, 1010, 1014, 1019, 1023, 1027, 1032, 1036,
+	1040, 1045, 1049, 1053, 1057, 1061, 1066, 1070, 1074, 1078, 1082, 1086, 1090, 1094, 1098, 1102,
+	1106, 1109, 1113, 1117, 1121, 1125, 1128, 1132, 1136, 1139, 1143, 1146, 1150, 1153, 1157, 1160,
+	1164, 1167, 1170, 1174, 1177, 1180, 1183, 1186, 1190, 1193, 1196, 1199, 1202, 1205, 1207, 1210,
+	1213, 1216, 1219, 1221, 1224, 1227, 1229, 1232, 1234, 1237, 1239, 1241, 1244, 1246, 1248, 1251,
+	1253, 1255, 1257, 1259, 1261, 1263, 1265, 1267, 1269, 1270, 1272, 1274, 1275, 1277, 1279, 1280,
+	1282, 1283, 1284, 1286, 1287, 1288, 1290, 1291, 1292, 1293, 1294, 1295, 1296, 1297, 1297, 1298,
+	1299, 1300, 1300, 1301, 1302, 1302, 1303, 1303, 1303, 1304, 1304, 1304, 1304, 1304, 1305, 1305
+};
+
+//Filters 1 to 3 predict each sample from the two before
+static void snes_apu_dsp_brr_filter(int16_t *samples, const int16_t *shifted, uint8_t filter)
+{
+	int p1;
+	int p2;
+	int s;
+	int i;
+
+	for(i = 0; i < SNES_APU_DSP_BRR_SAMPLES; i++) {
+		s = shifted[i];
+		p1 = samples[i - 1];
+		p2 = samples[i - 2] >> 1;
+		if(filter == 1) {
+			s += p1 >> 1;
+			s += (-p1) >> 5;
+		} else if(filter == 2) {
+			s += p1 - p2;
+			s += p2 >> 4;
+			s += (p1 * -3) >> 6;
+		} else if(filter == 3) {
+			s += p1 - p2;
+			s += (p1 * -13) >> 7;
+			s += (p2 * 3) >> 4;
+		}
+		samples[i] = (int16_t)(snes_apu_dsp_clamp16(s) * 2);
+	}
+}
+
+static void snes_apu_dsp_brr_scalar(const uint8_t *block, int16_t *samples)
+{
+	int16_t shifted[SNES_APU_DSP_BRR_SAMPLES];
+	uint8_t range = block[0] >> 4;
+	int s;
+	int i;
+
+	for(i = 0; i < SNES_APU_DSP_BRR_SAMPLES; i++) {
+		//High nibble first, signed
+		s = (int8_t)(block[1 + i / 2] << ((i & 1) * 4)) >> 4;
+		if(range <= 12)
+			s = (s * (1 << range)) >> 1;
+		else
+			s = s < 0 ? -2048 : 0;
+		shifted[i] = s;
+	}
+	snes_apu_dsp_brr_filter(samples, shifted, (block[0] >> 2) & 0x03);
+}
+
+/*
+ * The taps are rounded one by one, the 7 first wrap to 16 bits and only the
+ * last one saturates.
+ */
+static void snes_apu_dsp_fir_scalar(const int16_t *left, const int16_t *right,
+									const int16_t *coefficients, int *out)
+{
+	const int16_t *history[2] = { left, right };
+	int sum;
+	int i;
+	int c;
+
+	for(c = 0; c < 2; c++) {
+		sum = 0;
+		for(i = 0; i < 7; i++)
+			sum += (history[c][i] * coefficients[i]) >> 6;
+		sum = (int16_t)sum;
+		sum += (history[c][7] * coefficients[7]) >> 6;
+		out[c] = snes_apu_dsp_clamp16(sum) & ~1;
+	}
+}
+
+#ifdef SNES_APU_DSP_X86
+/*
+ * The filters are a recurrence, only the unpacking and the range shift are
+ * done on all 16 samples at once. Filter 0 needs nothing more.
+ */
+static void snes_apu_dsp_brr_sse2(const uint8_t *block, int16_t *samples)
+{
+	int16_t shifted[SNES_APU_DSP_BRR_SAMPLES];
+	uint8_t range = block[0] >> 4;
+	uint8_t filter = (block[0] >> 2) & 0x03;
+	__m128i data = _mm_loadl_epi64((const __m128i *)(block + 1));
+	//Each byte in the top of a 16 bits lane, the arithmetic shifts sign the nibbles
+	__m128i bytes = _mm_unpacklo_epi8(_mm_setzero_si128(), data);
+	__m128i high = _mm_srai_epi16(bytes, 12);
+	__m128i low = _mm_srai_epi16(_mm_slli_epi16(bytes, 4), 12);
+	__m128i first = _mm_unpacklo_epi16(high, low);
+	__m128i second = _mm_unpackhi_epi16(high, low);
+
+	if(range <= 12) {
+		first = _mm_srai_epi16(_mm_sll_epi16(first, _mm_cvtsi32_si128(range)), 1);
+		second = _mm_srai_epi16(_mm_sll_epi16(second, _mm_cvtsi32_si128(range)), 1);
+	} else {
+		first = _mm_and_si128(_mm_srai_epi16(first, 15), _mm_set1_epi16(-2048));
+		second = _mm_and_si128(_mm_srai_epi16(second, 15), _mm_set1_epi16(-2048));
+	}
+	if(filter == 0) {
+		_mm_storeu_si128((__m128i *)samples, _mm_add_epi16(first, first));
+		_mm_storeu_si128((__m128i *)(samples + 8), _mm_add_epi16(second, second));
+		return;
+	}
+	_mm_storeu_si128((__m128i *)shifted, first);
+	_mm_storeu_si128((__m128i *)(shifted + 8), second);
+	snes_apu_dsp_brr_filter(samples, shifted, filter);
+}
+
+//Sum of the 7 first taps, the last one is returned in last
+static inline int snes_apu_dsp_fir_sse2_side(__m128i history, __m128i coefficients, int *last)
+{
+	__m128i low = _mm_mullo_epi16(history, coefficients);
+	__m128i high = _mm_mulhi_epi16(history, coefficients);
+	__m128i taps0 = _mm_srai_epi32(_mm_unpacklo_epi16(low, high), 6);
+	__m128i taps1 = _mm_srai_epi32(_mm_unpackhi_epi16(low, high), 6);
+	__m128i sum;
+
+	*last = _mm_cvtsi128_si32(_mm_shuffle_epi32(taps1, 0xFF));
+	taps1 = _mm_and_si128(taps1, _mm_set_epi32(0, -1, -1, -1));
+	sum = _mm_add_epi32(taps0, taps1);
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+}
+
+static void snes_apu_dsp_fir_sse2(const int16_t *left, const int16_t *right,
+								  const int16_t *coefficients, int *out)
+{
+	__m128i c = _mm_loadu_si128((const __m128i *)coefficients);
+	int last;
+	int sum;
+
+	sum = (int16_t)snes_apu_dsp_fir_sse2_side(_mm_loadu_si128((const __m128i *)left), c, &last);
+	out[0] = snes_apu_dsp_clamp16(sum + last) & ~1;
+	sum = (int16_t)snes_apu_dsp_fir_sse2_side(_mm_loadu_si128((const __m128i *)right), c, &last);
+	out[1] = snes_apu_dsp_clamp16(sum + last) & ~1;
+}
+
+//The 16 samples of a block fit a single register
+__attribute__((target("avx2")))
+static void snes_apu_dsp_brr_avx2(const uint8_t *block, int16_t *samples)
+{
+	int16_t shifted[SNES_APU_DSP_BRR_SAMPLES];
+	uint8_t range = block[0] >> 4;
+	uint8_t filter = (block[0] >> 2) & 0x03;
+	__m128i data = _mm_loadl_epi64((const __m128i *)(block + 1));
+	__m128i mask = _mm_set1_epi8(0x0F);
+	__m128i nibbles = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(data, 4), mask),
+										_mm_and_si128(data, mask));
+	__m256i s;
+
+	//Sign the 4 bits values then widen them
+	nibbles = _mm_sub_epi8(_mm_xor_si128(nibbles, _mm_set1_epi8(0x08)), _mm_set1_epi8(0x08));
+	s = _mm256_cvtepi8_epi16(nibbles);
+	if(range <= 12)
+		s = _mm256_srai_epi16(_mm256_sll_epi16(s, _mm_cvtsi32_si128(range)), 1);
+	else
+		s = _mm256_and_si256(_mm256_srai_epi16(s, 15), _mm256_set1_epi16(-2048));
+	if(filter == 0) {
+		_mm256_storeu_si256((__m256i *)samples, _mm256_add_epi16(s, s));
+		return;
+	}
+	_mm256_storeu_si256((__m256i *)shifted, s);
+	snes_apu_dsp_brr_filter(samples, shifted, filter);
+}
+
+//Both sides in the two halves of a register
+__attribute__((target("avx2")))
+static void snes_apu_dsp_fir_avx2(const int16_t *left, const int16_t *right,
+								  const int16_t *coefficients, int *out)
+{
+	__m256i history = _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)left)),
+		_mm_loadu_si128((const __m128i *)right), 1);
+	__m256i c = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)coefficients));
+	__m256i low = _mm256_mullo_epi16(history, c);
+	__m256i high = _mm256_mulhi_epi16(history, c);
+	__m256i taps0 = _mm256_srai_epi32(_mm256_unpacklo_epi16(low, high), 6);
+	__m256i taps1 = _mm256_srai_epi32(_mm256_unpackhi_epi16(low, high), 6);
+	int last_left = _mm256_extract_epi32(taps1, 3);
+	int last_right = _mm256_extract_epi32(taps1, 7);
+	__m256i sum;
+
+	taps1 = _mm256_and_si256(taps1, _mm256_set_epi32(0, -1, -1, -1, 0, -1, -1, -1));
+	sum = _mm256_add_epi32(taps0, taps1);
+	sum = _mm256_add_epi32(sum, _mm256_shuffle_epi32(sum, 0x4E));
+	sum = _mm256_add_epi32(sum, _mm256_shuffle_epi32(sum, 0xB1));
+	out[0] = snes_apu_dsp_clamp16((int16_t)_mm256_extract_epi32(sum, 0) + last_left) & ~1;
+	out[1] = snes_apu_dsp_clamp16((int16_t)_mm256_extract_epi32(sum, 4) + last_right) & ~1;
+}
+#endif
+
+snes_apu_dsp_simd_t snes_apu_dsp_get_max_simd()
+{
+#ifdef SNES_APU_DSP_X86
+	if(__builtin_cpu_supports("avx2"))
+		return SNES_APU_DSP_SIMD_AVX2;
+	return SNES_APU_DSP_SIMD_SSE2;
+#else
+	return SNES_APU_DSP_SIMD_SCALAR;
+#endif
+}
+
+snes_apu_dsp_simd_t snes_apu_dsp_get_default_simd()
+{
+	snes_apu_dsp_simd_t simd = snes_apu_dsp_get_max_simd();
+
+	return simd > SNES_APU_DSP_SIMD_SSE2 ? SNES_APU_DSP_SIMD_SSE2 : simd;
+}
+
+int snes_apu_dsp_set_simd(snes_apu_dsp_t *dsp, snes_apu_dsp_simd_t simd)
+{
+	if(simd > snes_apu_dsp_get_max_simd())
+		return -1;
+	dsp->simd = simd;
+	dsp->brr_decode = snes_apu_dsp_brr_scalar;
+	dsp->fir_filter = snes_apu_dsp_fir_scalar;
+#ifdef SNES_APU_DSP_X86
+	if(simd == SNES_APU_DSP_SIMD_SSE2) {
+		dsp->brr_decode = snes_apu_dsp_brr_sse2;
+		dsp->fir_filter = snes_apu_dsp_fir_sse2;
+	} else if(simd == SNES_APU_DSP_SIMD_AVX2) {
+		dsp->brr_decode = snes_apu_dsp_brr_avx2;
+		dsp->fir_filter = snes_apu_dsp_fir_avx2;
+	}
+#endif
+	return 0;
+}
+
+const char *snes_apu_dsp_simd_tostring(snes_apu_dsp_simd_t simd)
+{
+	return snes_apu_dsp_simd_names[simd];
+}
+
+snes_apu_dsp_t *snes_apu_dsp_init(uint8_t *ram)
+{
+	snes_apu_dsp_t *dsp = malloc(sizeof(snes_apu_dsp_t));
+	if(dsp == NULL) {
+		printf("Error at allocation time !\n");
+		return NULL;
+	}
+	memset(dsp, 0, sizeof(snes_apu_dsp_t));
+	dsp->ram = ram;
+	snes_apu_dsp_set_simd(dsp, snes_apu_dsp_get_default_simd());
+	snes_apu_dsp_reset(dsp);
+	return dsp;
+}
+
+void snes_apu_dsp_destroy(snes_apu_dsp_t *dsp)
+{
+	free(dsp);
+}
+
+void snes_apu_dsp_reset(snes_apu_dsp_t *dsp)
+{
+	memset(dsp->registers, 0, sizeof(dsp->registers));
+	memset(dsp->voices, 0, sizeof(dsp->voices));
+	memset(dsp->fir, 0, sizeof(dsp->fir));
+	memset(dsp->echo_left, 0, sizeof(dsp->echo_left));
+	memset(dsp->echo_right, 0, sizeof(dsp->echo_right));
+	//Voices off, muted, echo writes disabled
+	dsp->registers[SNES_APU_DSP_FLG] = SNES_APU_DSP_FLG_RESET | SNES_APU_DSP_FLG_MUTE | SNES_APU_DSP_FLG_ECHO_OFF;
+	dsp->counter = 0;
+	dsp->noise = 0x4000;
+	dsp->new_kon = 0;
+	dsp->every_other = 0;
+	dsp->echo_offset = 0;
+	dsp->echo_length = 0;
+	dsp->echo_pos = 0;
+}
+
+uint8_t snes_apu_dsp_read(snes_apu_dsp_t *dsp, uint8_t addr)
+{
+	return dsp->registers[addr & 0x7F];
+}
+
+void snes_apu_dsp_write(snes_apu_dsp_t *dsp, uint8_t addr, uint8_t data)
+{
+	addr &= 0x7F;
+	dsp->registers[addr] = data;
+	if((addr & 0x0F) == SNES_APU_DSP_FIR) {
+		dsp->fir[addr >> 4] = (int8_t)data;
+	} else if(addr == SNES_APU_DSP_KON) {
+		dsp->new_kon |= data;
+	} else if(addr == SNES_APU_DSP_ENDX) {
+		//Any write clears it
+		dsp->registers[addr] = 0;
+	}
+}
+
+void snes_apu_dsp_set_output(snes_apu_dsp_t *dsp, int16_t *buffer, uint32_t frames)
+{
+	dsp->buffer = buffer;
+	dsp->buffer_frames = buffer != NULL ? frames : 0;
+	dsp->buffer_count = 0;
+}
+
+uint32_t snes_apu_dsp_get_output_count(snes_apu_dsp_t *dsp)
+{
+	return dsp->buffer_count;
+}
+
+uint64_t snes_apu_dsp_get_samples(snes_apu_dsp_t *dsp)
+{
+	return dsp->samples;
+}
+
+//Decodes the block at brr_addr, after the tail of the previous one
+static void snes_apu_dsp_decode_block(snes_apu_dsp_t *dsp, snes_apu_dsp_voice_t *voice)
+{
+	uint8_t block[SNES_APU_DSP_BRR_BLOCK];
+	int i;
+
+	for(i = 0; i < SNES_APU_DSP_BRR_BLOCK; i++)
+		block[i] = dsp->ram[(uint16_t)(voice->brr_addr + i)];
+	memcpy(voice->samples, voice->samples + SNES_APU_DSP_BRR_SAMPLES,
+		   SNES_APU_DSP_BRR_HISTORY * sizeof(int16_t));
+	voice->brr_header = block[0];
+	dsp->brr_decode(block, voice->samples + SNES_APU_DSP_BRR_HISTORY);
+}
+
+//Sample directory entry of the voice : start then loop address
+static uint16_t snes_apu_dsp_source(snes_apu_dsp_t *dsp, int v, int loop)
+{
+	uint16_t entry = dsp->registers[SNES_APU_DSP_DIR] * 0x100 +
+		dsp->registers[(v << 4) | SNES_APU_DSP_SRCN] * 4;
+	return snes_apu_dsp_read16(dsp->ram, entry + (loop ? 2 : 0));
+}
+
+static void snes_apu_dsp_key_on(snes_apu_dsp_t *dsp, snes_apu_dsp_voice_t *voice, int v)
+{
+	memset(voice->samples, 0, sizeof(voice->samples));
+	voice->brr_addr = snes_apu_dsp_source(dsp, v, 0);
+	snes_apu_dsp_decode_block(dsp, voice);
+	voice->interp_pos = 0;
+	voice->kon_delay = SNES_APU_DSP_KON_DELAY;
+	voice->env_mode = SNES_APU_DSP_ENV_ATTACK;
+	voice->env = 0;
+	voice->hidden_env = 0;
+	dsp->registers[SNES_APU_DSP_ENDX] &= ~(1 << v);
+}
+
+//Leaves the current block : to the next one, or the loop point after the last
+static void snes_apu_dsp_next_block(snes_apu_dsp_t *dsp, snes_apu_dsp_voice_t *voice, int v)
+{
+	if(voice->brr_header & SNES_APU_DSP_BRR_END) {
+		dsp->registers[SNES_APU_DSP_ENDX] |= 1 << v;
+		voice->brr_addr = snes_apu_dsp_source(dsp, v, 1);
+		if(!(voice->brr_header & SNES_APU_DSP_BRR_LOOP)) {
+			voice->env_mode = SNES_APU_DSP_ENV_RELEASE;
+			voice->env = 0;
+		}
+	} else {
+		voice->brr_addr += SNES_APU_DSP_BRR_BLOCK;
+	}
+	snes_apu_dsp_decode_block(dsp, voice);
+}
+
+static int snes_apu_dsp_interpolate(snes_apu_dsp_t *dsp, snes_apu_dsp_voice_t *voice)
+{
+	//The 4 samples up to the current one, oldest first
+	const int16_t *in = voice->samples + (voice->interp_pos >> 12);
+	uint32_t offset = (voice->interp_pos >> 4) & 0xFF;
+	const int16_t *fwd = snes_apu_dsp_gauss + 255 - offset;
+	const int16_t *rev = snes_apu_dsp_gauss + offset;
+	int out;
+
+	out = (fwd[0] * in[0]) >> 11;
+	out += (fwd[256] * in[1]) >> 11;
+	out += (rev[256] * in[2]) >> 11;
+	out = (int16_t)out;
+	out += (rev[0] * in[3]) >> 11;
+	return snes_apu_dsp_clamp16(out) & ~1;
+}
+
+static void snes_apu_dsp_envelope(snes_apu_dsp_t *dsp, snes_apu_dsp_voice_t *voice, const uint8_t *vregs)
+{
+	int env = voice->env;
+	uint8_t adsr1 = vregs[SNES_APU_DSP_ADSR1];
+	uint8_t data;
+	uint8_t rate;
+	uint8_t mode;
+
+	if(voice->env_mode == SNES_APU_DSP_ENV_RELEASE) {
+		env -= 8;
+		voice->env = env < 0 ? 0 : env;
+		return;
+	}
+
+	if(adsr1 & 0x80) {
+		data = vregs[SNES_APU_DSP_ADSR2];
+		if(voice->env_mode >= SNES_APU_DSP_ENV_DECAY) {
+			env--;
+			env -= env >> 8;
+			rate = data & 0x1F;
+			if(voice->env_mode == SNES_APU_DSP_ENV_DECAY)
+				rate = ((adsr1 >> 3) & 0x0E) + 0x10;
+		} else {
+			rate = (adsr1 & 0x0F) * 2 + 1;
+			env += rate < 31 ? 0x20 : 0x400;
+		}
+	} else {
+		data = vregs[SNES_APU_DSP_GAIN];
+		mode = data >> 5;
+		if(mode < 4) {
+			//Direct
+			env = data * 0x10;
+			rate = 31;
+		} else {
+			rate = data & 0x1F;
+			if(mode == 4) {
+				env -= 0x20;
+			} else if(mode == 5) {
+				env--;
+				env -= env >> 8;
+			} else {
+				env += 0x20;
+				//Bent line : slower above 3/4
+				if(mode == 7 && (unsigned)voice->hidden_env >= 0x600)
+					env += 0x08 - 0x20;
+			}
+		}
+	}
+
+	//Sustain level
+	if((env >> 8) == (data >> 5) && voice->env_mode == SNES_APU_DSP_ENV_DECAY)
+		voice->env_mode = SNES_APU_DSP_ENV_SUSTAIN;
+	voice->hidden_env = env;
+	if((unsigned)env > 0x7FF) {
+		env = env < 0 ? 0 : 0x7FF;
+		if(voice->env_mode == SNES_APU_DSP_ENV_ATTACK)
+			voice->env_mode = SNES_APU_DSP_ENV_DECAY;
+	}
+	if(snes_apu_dsp_rate_tick(dsp, rate))
+		voice->env = env;
+}
+
+static void snes_apu_dsp_sample(snes_apu_dsp_t *dsp)
+{
+	uint8_t *regs = dsp->registers;
+	snes_apu_dsp_voice_t *voice;
+	uint8_t *vregs;
+	uint8_t kon = 0;
+	uint8_t koff = 0;
+	uint8_t bit;
+	uint16_t echo_addr;
+	int main_out[2] = { 0, 0 };
+	int echo_out[2] = { 0, 0 };
+	int echo_in[2];
+	int pmon_input = 0;
+	int output;
+	int pitch;
+	int value;
+	int out[2];
+	int v;
+	int c;
+
+	if(--dsp->counter < 0)
+		dsp->counter = SNES_APU_DSP_COUNTER_RANGE - 1;
+
+	if(snes_apu_dsp_rate_tick(dsp, regs[SNES_APU_DSP_FLG] & SNES_APU_DSP_FLG_NOISE_RATE)) {
+		value = (dsp->noise << 13) ^ (dsp->noise << 14);
+		dsp->noise = (value & 0x4000) ^ (dsp->noise >> 1);
+	}
+
+	//Key on and key off are polled every other sample
+	dsp->every_other ^= 1;
+	if(dsp->every_other) {
+		kon = dsp->new_kon;
+		koff = regs[SNES_APU_DSP_KOFF];
+		dsp->new_kon = 0;
+	}
+
+	for(v = 0; v < SNES_APU_DSP_VOICES; v++) {
+		voice = &dsp->voices[v];
+		vregs = regs + (v << 4);
+		bit = 1 << v;
+
+		if(kon & bit)
+			snes_apu_dsp_key_on(dsp, voice, v);
+		if(koff & bit)
+			voice->env_mode = SNES_APU_DSP_ENV_RELEASE;
+		if(regs[SNES_APU_DSP_FLG] & SNES_APU_DSP_FLG_RESET) {
+			voice->env_mode = SNES_APU_DSP_ENV_RELEASE;
+			voice->env = 0;
+		}
+
+		if(voice->kon_delay) {
+			voice->kon_delay--;
+			voice->output = 0;
+			vregs[SNES_APU_DSP_ENVX] = 0;
+			vregs[SNES_APU_DSP_OUTX] = 0;
+			pmon_input = 0;
+			continue;
+		}
+
+		pitch = (vregs[SNES_APU_DSP_PITCHL] | (vregs[SNES_APU_DSP_PITCHH] << 8)) & 0x3FFF;
+		if((regs[SNES_APU_DSP_PMON] & bit) && v > 0)
+			pitch += ((pmon_input >> 5) * pitch) >> 10;
+
+		if(regs[SNES_APU_DSP_NON] & bit)
+			output = (int16_t)(dsp->noise * 2);
+		else
+			output = snes_apu_dsp_interpolate(dsp, voice);
+		output = ((output * voice->env) >> 11) & ~1;
+		voice->output = output;
+		pmon_input = output;
+		vregs[SNES_APU_DSP_ENVX] = voice->env >> 4;
+		vregs[SNES_APU_DSP_OUTX] = output >> 8;
+
+		for(c = 0; c < 2; c++) {
+			value = (output * (int8_t)vregs[SNES_APU_DSP_VOLL + c]) >> 7;
+			main_out[c] = snes_apu_dsp_clamp16(main_out[c] + value);
+			if(regs[SNES_APU_DSP_EON] & bit)
+				echo_out[c] = snes_apu_dsp_clamp16(echo_out[c] + value);
+		}
+
+		snes_apu_dsp_envelope(dsp, voice, vregs);
+
+		if(pitch > 0x7FFF)
+			pitch = 0x7FFF;
+		voice->interp_pos += pitch;
+		if(voice->interp_pos >= SNES_APU_DSP_BRR_SAMPLES << 12) {
+			voice->interp_pos -= SNES_APU_DSP_BRR_SAMPLES << 12;
+			snes_apu_dsp_next_block(dsp, voice, v);
+		}
+	}
+
+	//Echo : the samples written one buffer ago go through the FIR filter
+	if(dsp->echo_offset == 0)
+		dsp->echo_length = (regs[SNES_APU_DSP_EDL] & 0x0F) * 0x800;
+	echo_addr = regs[SNES_APU_DSP_ESA] * 0x100 + dsp->echo_offset;
+	dsp->echo_offset += 4;
+	if(dsp->echo_offset >= dsp->echo_length)
+		dsp->echo_offset = 0;
+
+	dsp->echo_left[dsp->echo_pos] = dsp->echo_left[dsp->echo_pos + 8] =
+		(int16_t)snes_apu_dsp_read16(dsp->ram, echo_addr) >> 1;
+	dsp->echo_right[dsp->echo_pos] = dsp->echo_right[dsp->echo_pos + 8] =
+		(int16_t)snes_apu_dsp_read16(dsp->ram, echo_addr + 2) >> 1;
+	dsp->fir_filter(dsp->echo_left + dsp->echo_pos + 1, dsp->echo_right + dsp->echo_pos + 1,
+					dsp->fir, echo_in);
+	dsp->echo_pos = (dsp->echo_pos + 1) & 7;
+
+	for(c = 0; c < 2; c++) {
+		value = (main_out[c] * (int8_t)regs[SNES_APU_DSP_MVOLL + (c << 4)]) >> 7;
+		value += (echo_in[c] * (int8_t)regs[SNES_APU_DSP_EVOLL + (c << 4)]) >> 7;
+		out[c] = snes_apu_dsp_clamp16(value);
+		if(regs[SNES_APU_DSP_FLG] & SNES_APU_DSP_FLG_MUTE)
+			out[c] = 0;
+
+		value = (echo_in[c] * (int8_t)regs[SNES_APU_DSP_EFB]) >> 7;
+		echo_out[c] = snes_apu_dsp_clamp16(echo_out[c] + value) & ~1;
+	}
+	if(!(regs[SNES_APU_DSP_FLG] & SNES_APU_DSP_FLG_ECHO_OFF)) {
+		for(c = 0; c < 2; c++) {
+			dsp->ram[(uint16_t)(echo_addr + c * 2)] = echo_out[c];
+			dsp->ram[(uint16_t)(echo_addr + c * 2 + 1)] = echo_out[c] >> 8;
+		}
+	}
+
+	if(dsp->buffer_count < dsp->buffer_frames) {
+		dsp->buffer[dsp->buffer_count * 2] = out[0];
+		dsp->buffer[dsp->buffer_count * 2 + 1] = out[1];
+		dsp->buffer_count++;
+	}
+}
+
+void snes_apu_dsp_run_until(snes_apu_dsp_t *dsp, uint64_t sample)
+{
+	while(dsp->samples < sample) {
+		snes_apu_dsp_sample(dsp);
+		dsp->samples++;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef SNES_APU_DSP_H
+#define SNES_APU_DSP_H
+
+#include <stdint.h>
+
+/*
+ * S-DSP of the APU : 8 voices playing BRR samples from the APU RAM with
+ * Gaussian interpolation, ADSR/GAIN envelopes, noise, and an echo through an
+ * 8 taps FIR filter. It makes a stereo sample every 32 SPC700 cycles.
+ */
+#define SNES_APU_DSP_RATE 32000
+#define SNES_APU_DSP_VOICES 8
+#define SNES_APU_DSP_REGISTERS 128
+
+typedef struct _snes_apu_dsp snes_apu_dsp_t;
+
+//Code paths of the BRR decoder and of the echo FIR filter
+typedef enum _snes_apu_dsp_simd {
+	SNES_APU_DSP_SIMD_SCALAR, //Reference
+	SNES_APU_DSP_SIMD_SSE2,
+	SNES_APU_DSP_SIMD_AVX2,
+} snes_apu_dsp_simd_t;
+
+snes_apu_dsp_t *snes_apu_dsp_init(uint8_t *ram);
+void snes_apu_dsp_destroy(snes_apu_dsp_t *dsp);
+void snes_apu_dsp_reset(snes_apu_dsp_t *dsp);
+
+uint8_t snes_apu_dsp_read(snes_apu_dsp_t *dsp, uint8_t addr);
+void snes_apu_dsp_write(snes_apu_dsp_t *dsp, uint8_t addr, uint8_t data);
+
+/*Makes the samples up to sample, counted since init*/
+void snes_apu_dsp_run_until(snes_apu_dsp_t *dsp, uint64_t sample);
+uint64_t snes_apu_dsp_get_samples(snes_apu_dsp_t *dsp);
+
+/*
+ * The samples go to buffer as left/right pairs, up to frames pairs : the next
+ * ones are dropped until the buffer is set again. NULL drops everything.
+ */
+void snes_apu_dsp_set_output(snes_apu_dsp_t *dsp, int16_t *buffer, uint32_t frames);
+uint32_t snes_apu_dsp_get_output_count(snes_apu_dsp_t *dsp);
+
+/*Widest path of the host. set_simd returns -1 for a path the host lacks*/
+snes_apu_dsp_simd_t snes_apu_dsp_get_max_simd();
+/*Path set at init : AVX2 measures no faster than SSE2 on the BRR blocks and the 8 taps FIR (-p)*/
+snes_apu_dsp_simd_t snes_apu_dsp_get_default_simd();
+int snes_apu_dsp_set_simd(snes_apu_dsp_t *dsp, snes_apu_dsp_simd_t simd);
+const char *snes_apu_dsp_simd_tostring(snes_apu_dsp_simd_t simd);
+
+#endif //SNES_APU_DSP_H
@@ -1,13 +1,32 @@
 #include <stdlib.h>
 #include <stdio.h>
-#include "snes_ram.h"
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 #include "snes_apu_port.h"
+#include "snes_apu_port_internal.h"
 
+/*
+ * The CPU thread writes input, the APU thread writes output (and may clear
+ * input through CONTROL). The four ports of a direction are packed in one word
+ * so a reader always sees a consistent snapshot, and a release store makes
+ * the data ports visible before the port 0 cookie that announces them.
+ */
 struct _snes_apu_port{
-	snes_ram_t *input_port;
-	snes_ram_t *output_port;
+	_Atomic uint32_t input_port;
+	_Atomic uint32_t output_port;
+	_Atomic uint32_t version; //Bumped on each CPU write, the APU waits on it
+	_Atomic uint32_t waiting; //Set while the APU sleeps on version
 };
 
+#define SNES_APU_PORT_SHIFT(address) (((address) & 3) * 8)
 
 snes_apu_port_t *snes_apu_port_init()
 {
@@ -17,54 +36,104 @@ snes_apu_port_t *snes_apu_port_init()
 		goto error_alloc;
 	}
 
-	port->input_port = snes_ram_init(4);
-	if(port->input_port == NULL) {
-		goto error_input;
-	}
-
-	port->output_port = snes_ram_init(4);
-	if(port->output_port == NULL) {
-		goto error_output;
-	}
+	atomic_init(&port->input_port, 0);
+	atomic_init(&port->output_port, 0);
+	atomic_init(&port->version, 0);
+	atomic_init(&port->waiting, 0);
 	return port;
 
-error_output:
-	snes_ram_destroy(port->input_port);
-error_input:
-	free(port);
 error_alloc:
 	return NULL;
 }
 
 void snes_apu_port_destroy(snes_apu_port_t *port)
 {
-	snes_ram_destroy(port->output_port);
-	snes_ram_destroy(port->input_port);
 	free(port);
 }
 
+static void snes_apu_port_set(_Atomic uint32_t *ports, uint32_t address, uint8_t data)
+{
+	uint32_t value = atomic_load_explicit(ports, memory_order_relaxed);
+	uint32_t update;
+
+	//Uncontended but for the input clear, it's a single try
+	do {
+		update = value & ~(0xFFu << SNES_APU_PORT_SHIFT(address));
+		update |= (uint32_t)data << SNES_APU_PORT_SHIFT(address);
+	} while(!atomic_compare_exchange_weak_explicit(ports, &value, update,
+												   memory_order_release, memory_order_relaxed));
+}
+
 uint8_t snes_apu_port_read(snes_apu_port_t *port, uint32_t address)
 {
-	uint8_t data = snes_ram_read(port->output_port, address);
-	//printf("CPU is reading APU port 0x%x : data is 0x%x\n",0x2140 + address,data);
-	return data;
+	uint32_t value = atomic_load_explicit(&port->output_port, memory_order_acquire);
+	return value >> SNES_APU_PORT_SHIFT(address);
 }
 
 void snes_apu_port_write(snes_apu_port_t *port, uint32_t address, uint8_t data)
 {
-	//printf("CPU is writing APU port 0x%x : data is 0x%x\n",0x2140 + address,data);
-	snes_ram_write(port->input_port, address, data);
+	snes_apu_port_set(&port->input_port, address, data);
+	snes_apu_port_internal_wake(port);
 }
 
 uint8_t snes_apu_port_internal_read(snes_apu_port_t *port, uint32_t address)
 {
-	uint8_t data = snes_ram_read(port->input_port, address);
-	//printf("APU is reading APU port 0x%x : data is 0x%x\n",0x2140 + address,data);
-	return data;
+	uint32_t value = atomic_load_explicit(&port->input_port, memory_order_acquire);
+	return value >> SNES_APU_PORT_SHIFT(address);
+}
+
+uint32_t snes_apu_port_internal_read_all(snes_apu_port_t *port)
+{
+	return atomic_load_explicit(&port->input_port, memory_order_acquire);
 }
 
 void snes_apu_port_internal_write(snes_apu_port_t *port, uint32_t address, uint8_t data)
 {
-	//printf("APU is writing APU port 0x%x : data is 0x%x\n",0x2140 + address,data);
-	snes_ram_write(port->output_port, address, data);
+	snes_apu_port_set(&port->output_port, address, data);
+}
+
+void snes_apu_port_internal_clear(snes_apu_port_t *port, uint32_t mask)
+{
+	atomic_fetch_and_explicit(&port->input_port, ~mask, memory_order_release);
+}
+
+uint32_t snes_apu_port_internal_version(snes_apu_port_t *port)
+{
+	return atomic_load_explicit(&port->version, memory_order_acquire);
+}
+
+void snes_apu_port_internal_wake(snes_apu_port_t *port)
+{
+	atomic_fetch_add_explicit(&port->version, 1, memory_order_acq_rel);
+	//The syscall is only paid when the APU actually sleeps
+	if(atomic_load_explicit(&port->waiting, memory_order_acquire) == 0)
+		return;
+#ifdef __linux__
+	syscall(SYS_futex, &port->version, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+int snes_apu_port_internal_wait(snes_apu_port_t *port, uint32_t version, uint32_t timeout_us)
+{
+	int ret = 0;
+#ifdef __linux__
+	struct timespec timeout;
+
+	timeout.tv_sec = timeout_us / 1000000;
+	timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+	atomic_store_explicit(&port->waiting, 1, memory_order_seq_cst);
+	//The kernel compares version again, a write in between doesn't get lost
+	if(atomic_load_explicit(&port->version, memory_order_seq_cst) == version &&
+	   syscall(SYS_futex, &port->version, FUTEX_WAIT_PRIVATE, version, &timeout, NULL, 0) < 0 &&
+	   errno == ETIMEDOUT)
+		ret = -1;
+	atomic_store_explicit(&port->waiting, 0, memory_order_relaxed);
+#else
+	(void)timeout_us;
+	if(atomic_load_explicit(&port->version, memory_order_acquire) == version) {
+		sched_yield();
+		ret = -1;
+	}
+#endif
+	return ret;
 }
@@ -4,7 +4,21 @@
 #include "snes_apu_port.h"
 
 uint8_t snes_apu_port_internal_read(snes_apu_port_t *port, uint32_t address);
+/*The four input ports at once, port 0 in the low byte*/
+uint32_t snes_apu_port_internal_read_all(snes_apu_port_t *port);
 void snes_apu_port_internal_write(snes_apu_port_t *port, uint32_t address, uint8_t data);
+/*Clears the input ports bits set in mask (CONTROL bits 4-5)*/
+void snes_apu_port_internal_clear(snes_apu_port_t *port, uint32_t mask);
+
+/*
+ * Port traffic notification : the version changes on each CPU write. The APU
+ * reads it, looks at the ports, then waits for a newer version instead of
+ * polling. snes_apu_port_internal_wait returns -1 on timeout, it may also
+ * return early. snes_apu_port_internal_wake releases a waiting APU.
+ */
+uint32_t snes_apu_port_internal_version(snes_apu_port_t *port);
+int snes_apu_port_internal_wait(snes_apu_port_t *port, uint32_t version, uint32_t timeout_us);
+void snes_apu_port_internal_wake(snes_apu_port_t *port);
 
 
 #endif //SNES_APU_PORT_INTERNAL_H
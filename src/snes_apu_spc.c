@@ -0,0 +1,880 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_apu_spc.h"
+#include "snes_apu_spc_opcodes.h"
+#include "snes_apu_port_internal.h"
+#include "snes_apu_dsp.h"
+
+#define likely(x)       __builtin_expect((x),1)
+#define unlikely(x)     __builtin_expect((x),0)
+
+//Use GCC labels as values when available, a plain switch otherwise
+#if defined(__GNUC__) && !defined(SNES_APU_SPC_DISPATCH_SWITCH)
+#define SNES_APU_SPC_COMPUTED_GOTO
+#endif
+
+#define SNES_APU_SPC_IPL_BASE 0xFFC0
+#define SNES_APU_SPC_IPL_SIZE 64
+
+//Registers
+#define SNES_APU_SPC_TEST 0xF0
+#define SNES_APU_SPC_CONTROL 0xF1
+#define SNES_APU_SPC_DSPADDR 0xF2
+#define SNES_APU_SPC_DSPDATA 0xF3
+#define SNES_APU_SPC_CPUIO0 0xF4
+#define SNES_APU_SPC_CPUIO3 0xF7
+#define SNES_APU_SPC_T0TARGET 0xFA
+#define SNES_APU_SPC_T2TARGET 0xFC
+#define SNES_APU_SPC_T0OUT 0xFD
+#define SNES_APU_SPC_T2OUT 0xFF
+
+#define SNES_APU_SPC_CONTROL_IPL 0x80
+#define SNES_APU_SPC_CONTROL_CLEAR01 0x10
+#define SNES_APU_SPC_CONTROL_CLEAR23 0x20
+
+//PSW flags
+#define SNES_APU_SPC_N 0x80
+#define SNES_APU_SPC_V 0x40
+#define SNES_APU_SPC_P 0x20
+#define SNES_APU_SPC_B 0x10
+#define SNES_APU_SPC_HC 0x08
+#define SNES_APU_SPC_I 0x04
+#define SNES_APU_SPC_Z 0x02
+#define SNES_APU_SPC_C 0x01
+
+#define SNES_APU_SPC_TIMERS 3
+
+//IPL receive loop, waiting for the CPU to write the index of the next byte
+#define SNES_APU_SPC_IPL_RECEIVE 0xFFDA
+//Instructions stepped to bring a busy IPL back to its receive loop
+#define SNES_APU_SPC_IPL_STEPS 8
+
+//SPC700 cycles per DSP sample
+#define SNES_APU_SPC_DSP_PERIOD (SNES_APU_SPC_CLOCK / SNES_APU_DSP_RATE)
+
+//Timers 0 and 1 tick at 8kHz, timer 2 at 64kHz
+static const uint32_t snes_apu_spc_timer_periods[SNES_APU_SPC_TIMERS] = { 128, 128, 16 };
+
+//Boot ROM : clears the zero page, says $AA $BB and receives blocks through the ports
+static const uint8_t snes_apu_spc_ipl[SNES_APU_SPC_IPL_SIZE] = {
+	0xCD, 0xEF, 0xBD, 0xE8, 0x00, 0xC6, 0x1D, 0xD0, 0xFC, 0x8F, 0xAA, 0xF4, 0x8F, 0xBB, 0xF5, 0x78,
+	0xCC, 0xF4, 0xD0, 0xFB, 0x2F, 0x19, 0xEB, 0xF4, 0xD0, 0xFC, 0x7E, 0xF4, 0xD0, 0x0B, 0xE4, 0xF5,
+	0xCB, 0xF4, 0xD7, 0x00, 0xFC, 0xD0, 0xF3, 0xAB, 0x01, 0x10, 0xEF, 0x7E, 0xF4, 0x10, 0xEB, 0xBA,
+	0xF6, 0xDA, 0x00, 0xBA, 0xF4, 0xC4, 0xF4, 0xDD, 0x5D, 0xD0, 0xDB, 0x1F, 0x00, 0x00, 0xC0, 0xFF,
+};
+
+#define SNES_APU_SPC_OPCODE_CYCLES(opcode, syntax, bytes, cycles) [opcode] = cycles,
+static const uint8_t snes_apu_spc_cycles[256] = { SNES_APU_SPC_OPCODES(SNES_APU_SPC_OPCODE_CYCLES) };
+#define SNES_APU_SPC_OPCODE_SYNTAX(opcode, syntax, bytes, cycles) [opcode] = syntax,
+static const char *const snes_apu_spc_syntax[256] = { SNES_APU_SPC_OPCODES(SNES_APU_SPC_OPCODE_SYNTAX) };
+#define SNES_APU_SPC_OPCODE_BYTES(opcode, syntax, bytes, cycles) [opcode] = bytes,
+static const uint8_t snes_apu_spc_bytes[256] = { SNES_APU_SPC_OPCODES(SNES_APU_SPC_OPCODE_BYTES) };
+
+typedef struct {
+	uint8_t target; //0 means 256
+	uint8_t stage; //Internal counter, compared to target
+	uint8_t out; //4 bits counter, cleared when read
+} snes_apu_spc_timer_t;
+
+struct _snes_apu_spc {
+	uint8_t *ram;
+	snes_apu_port_t *port;
+	snes_apu_dsp_t *dsp;
+	uint8_t a;
+	uint8_t x;
+	uint8_t y;
+	uint8_t sp;
+	uint8_t psw;
+	uint16_t pc;
+	uint8_t sleeping; //SLEEP or STOP, only a reset wakes the core
+	uint64_t cycles;
+	uint64_t instructions;
+	uint8_t control;
+	uint8_t dsp_addr;
+	snes_apu_spc_timer_t timers[SNES_APU_SPC_TIMERS];
+	uint64_t timers_cycles; //Clock of the last timers update
+};
+
+snes_apu_spc_t *snes_apu_spc_init(uint8_t *ram, snes_apu_port_t *port, snes_apu_dsp_t *dsp)
+{
+	snes_apu_spc_t *spc = malloc(sizeof(snes_apu_spc_t));
+	if(spc == NULL) {
+		printf("Error at allocation time !\n");
+		return NULL;
+	}
+	memset(spc, 0, sizeof(snes_apu_spc_t));
+	spc->ram = ram;
+	spc->port = port;
+	spc->dsp = dsp;
+	snes_apu_spc_reset(spc);
+	return spc;
+}
+
+void snes_apu_spc_destroy(snes_apu_spc_t *spc)
+{
+	free(spc);
+}
+
+void snes_apu_spc_reset(snes_apu_spc_t *spc)
+{
+	spc->a = 0;
+	spc->x = 0;
+	spc->y = 0;
+	spc->sp = 0xEF;
+	spc->psw = 0;
+	spc->sleeping = 0;
+	spc->control = SNES_APU_SPC_CONTROL_IPL;
+	spc->dsp_addr = 0;
+	snes_apu_dsp_reset(spc->dsp);
+	memset(spc->timers, 0, sizeof(spc->timers));
+	spc->timers_cycles = spc->cycles;
+	spc->pc = snes_apu_spc_ipl[SNES_APU_SPC_IPL_SIZE - 2] | (snes_apu_spc_ipl[SNES_APU_SPC_IPL_SIZE - 1] << 8);
+}
+
+//Ticks the timer ticks times : out counts the times the stage reached target
+static void snes_apu_spc_timer_tick(snes_apu_spc_timer_t *timer, uint64_t ticks)
+{
+	uint32_t target = timer->target ? timer->target : 256;
+	uint32_t first = (uint8_t)(timer->target - timer->stage);
+
+	if(first == 0)
+		first = 256;
+	if(ticks < first) {
+		timer->stage += ticks;
+		return;
+	}
+	ticks -= first;
+	timer->out = (timer->out + 1 + ticks / target) & 0x0F;
+	timer->stage = ticks % target;
+}
+
+//The DSP also runs late, until its registers are accessed
+static inline void snes_apu_spc_dsp_update(snes_apu_spc_t *spc)
+{
+	snes_apu_dsp_run_until(spc->dsp, spc->cycles / SNES_APU_SPC_DSP_PERIOD);
+}
+
+//Timers are only brought up to date when a register is accessed
+static void snes_apu_spc_timers_update(snes_apu_spc_t *spc)
+{
+	uint64_t ticks;
+	uint32_t period;
+	int i;
+
+	for(i = 0; i < SNES_APU_SPC_TIMERS; i++) {
+		if(!(spc->control & (1 << i)))
+			continue;
+		//The dividers run all the time, ticks are counted from the clock
+		period = snes_apu_spc_timer_periods[i];
+		ticks = spc->cycles / period - spc->timers_cycles / period;
+		if(ticks > 0)
+			snes_apu_spc_timer_tick(&spc->timers[i], ticks);
+	}
+	spc->timers_cycles = spc->cycles;
+}
+
+static uint8_t snes_apu_spc_io_read(snes_apu_spc_t *spc, uint16_t addr)
+{
+	uint8_t data;
+
+	switch(addr) {
+		case SNES_APU_SPC_DSPADDR:
+			return spc->dsp_addr;
+		case SNES_APU_SPC_DSPDATA:
+			snes_apu_spc_dsp_update(spc);
+			return snes_apu_dsp_read(spc->dsp, spc->dsp_addr);
+		case SNES_APU_SPC_CPUIO0:
+		case SNES_APU_SPC_CPUIO0 + 1:
+		case SNES_APU_SPC_CPUIO0 + 2:
+		case SNES_APU_SPC_CPUIO3:
+			return snes_apu_port_internal_read(spc->port, addr - SNES_APU_SPC_CPUIO0);
+		case SNES_APU_SPC_T0OUT:
+		case SNES_APU_SPC_T0OUT + 1:
+		case SNES_APU_SPC_T2OUT:
+			snes_apu_spc_timers_update(spc);
+			data = spc->timers[addr - SNES_APU_SPC_T0OUT].out;
+			spc->timers[addr - SNES_APU_SPC_T0OUT].out = 0;
+			return data;
+		case SNES_APU_SPC_TEST:
+		case SNES_APU_SPC_CONTROL:
+		case SNES_APU_SPC_T0TARGET:
+		case SNES_APU_SPC_T0TARGET + 1:
+		case SNES_APU_SPC_T2TARGET:
+			//Write only
+			return 0;
+		default:
+			//$F8-$F9 are plain RAM
+			return spc->ram[addr];
+	}
+}
+
+static void snes_apu_spc_io_write(snes_apu_spc_t *spc, uint16_t addr, uint8_t data)
+{
+	int i;
+
+	switch(addr) {
+		case SNES_APU_SPC_CONTROL:
+			snes_apu_spc_timers_update(spc);
+			//A timer being enabled restarts from 0
+			for(i = 0; i < SNES_APU_SPC_TIMERS; i++) {
+				if((data & (1 << i)) && !(spc->control & (1 << i))) {
+					spc->timers[i].stage = 0;
+					spc->timers[i].out = 0;
+				}
+			}
+			if(data & SNES_APU_SPC_CONTROL_CLEAR01)
+				snes_apu_port_internal_clear(spc->port, 0x0000FFFF);
+			if(data & SNES_APU_SPC_CONTROL_CLEAR23)
+				snes_apu_port_internal_clear(spc->port, 0xFFFF0000);
+			spc->control = data;
+			break;
+		case SNES_APU_SPC_DSPADDR:
+			spc->dsp_addr = data;
+			break;
+		case SNES_APU_SPC_DSPDATA:
+			//$80-$FF are read only mirrors
+			if(!(spc->dsp_addr & 0x80)) {
+				snes_apu_spc_dsp_update(spc);
+				snes_apu_dsp_write(spc->dsp, spc->dsp_addr, data);
+			}
+			break;
+		case SNES_APU_SPC_CPUIO0:
+		case SNES_APU_SPC_CPUIO0 + 1:
+		case SNES_APU_SPC_CPUIO0 + 2:
+		case SNES_APU_SPC_CPUIO3:
+			snes_apu_port_internal_write(spc->port, addr - SNES_APU_SPC_CPUIO0, data);
+			break;
+		case SNES_APU_SPC_T0TARGET:
+		case SNES_APU_SPC_T0TARGET + 1:
+		case SNES_APU_SPC_T2TARGET:
+			snes_apu_spc_timers_update(spc);
+			spc->timers[addr - SNES_APU_SPC_T0TARGET].target = data;
+			break;
+		default:
+			break;
+	}
+}
+
+static uint8_t snes_apu_spc_read_slow(snes_apu_spc_t *spc, uint16_t addr)
+{
+	if(addr >= SNES_APU_SPC_IPL_BASE) {
+		if(spc->control & SNES_APU_SPC_CONTROL_IPL)
+			return snes_apu_spc_ipl[addr - SNES_APU_SPC_IPL_BASE];
+		return spc->ram[addr];
+	}
+	return snes_apu_spc_io_read(spc, addr);
+}
+
+//Plain RAM everywhere but the registers page and the boot ROM
+static inline uint8_t snes_apu_spc_read(snes_apu_spc_t *spc, uint16_t addr)
+{
+	if(likely((uint16_t)(addr - 0xF0) >= 0x10 && addr < SNES_APU_SPC_IPL_BASE))
+		return spc->ram[addr];
+	return snes_apu_spc_read_slow(spc, addr);
+}
+
+//Writes always reach the RAM, even below the boot ROM
+static inline void snes_apu_spc_write(snes_apu_spc_t *spc, uint16_t addr, uint8_t data)
+{
+	spc->ram[addr] = data;
+	if(unlikely((uint16_t)(addr - 0xF0) < 0x10))
+		snes_apu_spc_io_write(spc, addr, data);
+}
+
+static inline uint8_t snes_apu_spc_adc(uint8_t *psw, uint8_t a, uint8_t b)
+{
+	uint32_t r = a + b + (*psw & SNES_APU_SPC_C);
+
+	*psw &= ~(SNES_APU_SPC_N | SNES_APU_SPC_V | SNES_APU_SPC_HC | SNES_APU_SPC_Z | SNES_APU_SPC_C);
+	if(~(a ^ b) & (a ^ r) & 0x80)
+		*psw |= SNES_APU_SPC_V;
+	if((a ^ b ^ r) & 0x10)
+		*psw |= SNES_APU_SPC_HC;
+	if(r > 0xFF)
+		*psw |= SNES_APU_SPC_C;
+	*psw |= r & SNES_APU_SPC_N;
+	if((uint8_t)r == 0)
+		*psw |= SNES_APU_SPC_Z;
+	return r;
+}
+
+static inline uint8_t snes_apu_spc_cmp(uint8_t *psw, uint8_t a, uint8_t b)
+{
+	uint32_t r = a - b;
+
+	*psw &= ~(SNES_APU_SPC_N | SNES_APU_SPC_Z | SNES_APU_SPC_C);
+	if(a >= b)
+		*psw |= SNES_APU_SPC_C;
+	*psw |= r & SNES_APU_SPC_N;
+	if((uint8_t)r == 0)
+		*psw |= SNES_APU_SPC_Z;
+	//The destination is kept
+	return a;
+}
+
+static inline uint8_t snes_apu_spc_nz(uint8_t *psw, uint8_t r)
+{
+	*psw &= ~(SNES_APU_SPC_N | SNES_APU_SPC_Z);
+	*psw |= r & SNES_APU_SPC_N;
+	if(r == 0)
+		*psw |= SNES_APU_SPC_Z;
+	return r;
+}
+
+static inline void snes_apu_spc_nz16(uint8_t *psw, uint16_t r)
+{
+	*psw &= ~(SNES_APU_SPC_N | SNES_APU_SPC_Z);
+	if(r & 0x8000)
+		*psw |= SNES_APU_SPC_N;
+	if(r == 0)
+		*psw |= SNES_APU_SPC_Z;
+}
+
+//Binary operations of the ALU rows
+#define SNES_APU_SPC_ALU_OR(a, b) snes_apu_spc_nz(&psw, (a) | (b))
+#define SNES_APU_SPC_ALU_AND(a, b) snes_apu_spc_nz(&psw, (a) & (b))
+#define SNES_APU_SPC_ALU_EOR(a, b) snes_apu_spc_nz(&psw, (a) ^ (b))
+#define SNES_APU_SPC_ALU_CMP(a, b) snes_apu_spc_cmp(&psw, a, b)
+#define SNES_APU_SPC_ALU_ADC(a, b) snes_apu_spc_adc(&psw, a, b)
+#define SNES_APU_SPC_ALU_SBC(a, b) snes_apu_spc_adc(&psw, a, ~(b))
+//CMP doesn't write its memory destination
+#define SNES_APU_SPC_ALU_STORES_OR 1
+#define SNES_APU_SPC_ALU_STORES_AND 1
+#define SNES_APU_SPC_ALU_STORES_EOR 1
+#define SNES_APU_SPC_ALU_STORES_CMP 0
+#define SNES_APU_SPC_ALU_STORES_ADC 1
+#define SNES_APU_SPC_ALU_STORES_SBC 1
+
+uint64_t snes_apu_spc_get_cycles(snes_apu_spc_t *spc)
+{
+	return spc->cycles;
+}
+
+void snes_apu_spc_get_stats(snes_apu_spc_t *spc, snes_apu_spc_stats_t *stats)
+{
+	stats->instructions = spc->instructions;
+	stats->cycles = spc->cycles;
+}
+
+void snes_apu_spc_dump(snes_apu_spc_t *spc)
+{
+	uint8_t opcode = snes_apu_spc_read(spc, spc->pc);
+	int i;
+
+	printf("[SPC] 0x%04X : %02X", spc->pc, opcode);
+	for(i = 1; i < snes_apu_spc_bytes[opcode]; i++)
+		printf(" %02X", snes_apu_spc_read(spc, spc->pc + i));
+	printf(" %-12s A:%02X X:%02X Y:%02X SP:%02X PSW:%02X%s\n", snes_apu_spc_syntax[opcode],
+		   spc->a, spc->x, spc->y, spc->sp, spc->psw, spc->sleeping ? " (sleeping)" : "");
+}
+
+//CMP Y,$F4 / BNE / BPL of the IPL receive loop
+static uint8_t snes_apu_spc_ipl_receiving(snes_apu_spc_t *spc)
+{
+	if(spc->sleeping || !(spc->control & SNES_APU_SPC_CONTROL_IPL))
+		return 0;
+	switch(spc->pc) {
+		case 0xFFDA: case 0xFFDC: case 0xFFE9: case 0xFFEB: case 0xFFED:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+int snes_apu_spc_ipl_upload(snes_apu_spc_t *spc, uint8_t index, const uint8_t *data, uint32_t count)
+{
+	uint32_t start;
+	uint32_t end;
+	int i;
+
+	//The IPL may still be storing the previous byte
+	for(i = 0; i < SNES_APU_SPC_IPL_STEPS && !snes_apu_spc_ipl_receiving(spc); i++)
+		snes_apu_spc_run_until(spc, spc->cycles + 1);
+	if(!snes_apu_spc_ipl_receiving(spc) || spc->y != index ||
+	   snes_apu_port_internal_read(spc->port, 0) != (uint8_t)(index - 1))
+		return -1;
+
+	//Y must not wrap (INC $01), the registers and the pointer itself take the slow way
+	start = (spc->ram[0] | (spc->ram[1] << 8)) + index;
+	end = start + count;
+	if(count == 0 || count > 0xFFu - index || end > 0x10000 ||
+	   start < 2 || (start < 0x100 && end > 0xF0))
+		return -1;
+	memcpy(&spc->ram[start], data, count);
+
+	//Left as after the last byte : acknowledged, Y incremented, back to the loop
+	spc->a = data[count - 1];
+	spc->y = index + count;
+	spc->psw &= ~(SNES_APU_SPC_N | SNES_APU_SPC_Z);
+	spc->psw |= spc->y & SNES_APU_SPC_N;
+	spc->pc = SNES_APU_SPC_IPL_RECEIVE;
+	snes_apu_port_internal_write(spc->port, 0, index + count - 1);
+	return 0;
+}
+
+#ifdef SNES_APU_SPC_COMPUTED_GOTO
+#define SNES_APU_SPC_LABEL(opcode, syntax, bytes, cycles) [opcode] = &&op_##opcode,
+#define SNES_APU_SPC_CASE(opcode) op_##opcode:
+#define SNES_APU_SPC_DISPATCH() goto *dispatch_table[opcode];
+#define SNES_APU_SPC_END()
+#else
+#define SNES_APU_SPC_CASE(opcode) case opcode:
+#define SNES_APU_SPC_DISPATCH() switch(opcode) {
+#define SNES_APU_SPC_END() }
+#endif
+
+#define SNES_APU_SPC_NEXT() goto next;
+
+#define RD(addr) snes_apu_spc_read(spc, (uint16_t)(addr))
+#define WR(addr, data) snes_apu_spc_write(spc, (uint16_t)(addr), (data))
+#define IMM() RD(pc++)
+#define ABS() (pc += 2, RD(pc - 2) | (RD(pc - 1) << 8))
+#define DP(addr) (dp | ((addr) & 0xFF))
+#define DP_WORD(addr) (RD(DP(addr)) | (RD(DP((addr) + 1)) << 8))
+#define PUSH(data) WR(0x100 | sp--, data)
+#define POP() RD(0x100 | ++sp)
+#define SET_DP() dp = (psw & SNES_APU_SPC_P) ? 0x100 : 0;
+#define FLAG(flag, cond) psw = (cond) ? (psw | (flag)) : (psw & ~(flag))
+#define BRANCH(cond) \
+	{ \
+		int8_t rel = IMM(); \
+		if(cond) { \
+			pc += rel; \
+			spc->cycles += 2; \
+		} \
+	}
+
+//The twelve operand forms of an ALU row
+#define SNES_APU_SPC_ALU_ROW(mne, op_dp, op_abs, op_x, op_dpxind, op_imm, op_dpdp, \
+							 op_dpx, op_absx, op_absy, op_dpindy, op_dpimm, op_xy) \
+	SNES_APU_SPC_CASE(op_dp) a = SNES_APU_SPC_ALU_##mne(a, RD(DP(IMM()))); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_abs) addr = ABS(); a = SNES_APU_SPC_ALU_##mne(a, RD(addr)); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_x) a = SNES_APU_SPC_ALU_##mne(a, RD(DP(x))); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_dpxind) \
+		data = IMM() + x; \
+		a = SNES_APU_SPC_ALU_##mne(a, RD(DP_WORD(data))); \
+		SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_imm) a = SNES_APU_SPC_ALU_##mne(a, IMM()); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_dpdp) \
+		data = RD(DP(IMM())); \
+		addr = DP(IMM()); \
+		data = SNES_APU_SPC_ALU_##mne(RD(addr), data); \
+		if(SNES_APU_SPC_ALU_STORES_##mne) \
+			WR(addr, data); \
+		SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_dpx) a = SNES_APU_SPC_ALU_##mne(a, RD(DP(IMM() + x))); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_absx) addr = ABS(); a = SNES_APU_SPC_ALU_##mne(a, RD(addr + x)); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_absy) addr = ABS(); a = SNES_APU_SPC_ALU_##mne(a, RD(addr + y)); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_dpindy) \
+		data = IMM(); \
+		a = SNES_APU_SPC_ALU_##mne(a, RD(DP_WORD(data) + y)); \
+		SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_dpimm) \
+		data = IMM(); \
+		addr = DP(IMM()); \
+		data = SNES_APU_SPC_ALU_##mne(RD(addr), data); \
+		if(SNES_APU_SPC_ALU_STORES_##mne) \
+			WR(addr, data); \
+		SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_xy) \
+		data = RD(DP(y)); \
+		addr = DP(x); \
+		data = SNES_APU_SPC_ALU_##mne(RD(addr), data); \
+		if(SNES_APU_SPC_ALU_STORES_##mne) \
+			WR(addr, data); \
+		SNES_APU_SPC_NEXT()
+
+//Read-modify-write on direct page, absolute, direct page + X and A
+#define SNES_APU_SPC_RMW_ROW(op_dp, op_abs, op_dpx, op_a, expr) \
+	SNES_APU_SPC_CASE(op_dp) addr = DP(IMM()); data = RD(addr); WR(addr, expr); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_abs) addr = ABS(); data = RD(addr); WR(addr, expr); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_dpx) addr = DP(IMM() + x); data = RD(addr); WR(addr, expr); SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_a) data = a; a = expr; SNES_APU_SPC_NEXT()
+
+#define SNES_APU_SPC_ASL() (FLAG(SNES_APU_SPC_C, data & 0x80), snes_apu_spc_nz(&psw, data << 1))
+#define SNES_APU_SPC_ROL() \
+	(carry = psw & SNES_APU_SPC_C, FLAG(SNES_APU_SPC_C, data & 0x80), snes_apu_spc_nz(&psw, (data << 1) | carry))
+#define SNES_APU_SPC_LSR() (FLAG(SNES_APU_SPC_C, data & 0x01), snes_apu_spc_nz(&psw, data >> 1))
+#define SNES_APU_SPC_ROR() \
+	(carry = psw & SNES_APU_SPC_C, FLAG(SNES_APU_SPC_C, data & 0x01), snes_apu_spc_nz(&psw, (data >> 1) | (carry << 7)))
+#define SNES_APU_SPC_INC() snes_apu_spc_nz(&psw, data + 1)
+#define SNES_APU_SPC_DEC() snes_apu_spc_nz(&psw, data - 1)
+
+//SET1/CLR1 d.b and BBS/BBC d.b,r, b being the opcode bits 5-7
+#define SNES_APU_SPC_BIT_COLUMN(op_set, op_bbs, op_clr, op_bbc) \
+	SNES_APU_SPC_CASE(op_set) \
+		addr = DP(IMM()); \
+		WR(addr, RD(addr) | (1 << (opcode >> 5))); \
+		SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_clr) \
+		addr = DP(IMM()); \
+		WR(addr, RD(addr) & ~(1 << (opcode >> 5))); \
+		SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_bbs) \
+		data = RD(DP(IMM())); \
+		BRANCH(data & (1 << (opcode >> 5))) \
+		SNES_APU_SPC_NEXT() \
+	SNES_APU_SPC_CASE(op_bbc) \
+		data = RD(DP(IMM())); \
+		BRANCH(!(data & (1 << (opcode >> 5)))) \
+		SNES_APU_SPC_NEXT()
+
+//Calls through the vector table at $FFDE-$FFC0, downwards
+#define SNES_APU_SPC_TCALL(op) \
+	SNES_APU_SPC_CASE(op) \
+		addr = 0xFFDE - 2 * (opcode >> 4); \
+		PUSH(pc >> 8); \
+		PUSH(pc & 0xFF); \
+		pc = RD(addr) | (RD(addr + 1) << 8); \
+		SNES_APU_SPC_NEXT()
+
+//1 bit operations : 13 bits address, bit number in the top 3 bits
+#define SNES_APU_SPC_MEMBIT_ADDRESS() \
+	addr = ABS(); \
+	bit = addr >> 13; \
+	addr &= 0x1FFF;
+#define SNES_APU_SPC_MEMBIT() \
+	SNES_APU_SPC_MEMBIT_ADDRESS() \
+	data = (RD(addr) >> bit) & 1;
+
+void snes_apu_spc_run_until(snes_apu_spc_t *spc, uint64_t cycle)
+{
+	uint8_t a = spc->a;
+	uint8_t x = spc->x;
+	uint8_t y = spc->y;
+	uint8_t sp = spc->sp;
+	uint8_t psw = spc->psw;
+	uint16_t pc = spc->pc;
+	uint16_t dp;
+	uint16_t addr;
+	uint16_t word;
+	uint32_t result;
+	uint8_t opcode;
+	uint8_t data;
+	uint8_t carry;
+	uint8_t bit;
+#ifdef SNES_APU_SPC_COMPUTED_GOTO
+	static const void *const dispatch_table[256] = { SNES_APU_SPC_OPCODES(SNES_APU_SPC_LABEL) };
+#endif
+
+	if(spc->sleeping) {
+		if(spc->cycles < cycle)
+			spc->cycles = cycle;
+		snes_apu_spc_dsp_update(spc);
+		return;
+	}
+	SET_DP()
+	while(spc->cycles < cycle) {
+		opcode = IMM();
+		spc->cycles += snes_apu_spc_cycles[opcode];
+		spc->instructions++;
+		SNES_APU_SPC_DISPATCH()
+
+		SNES_APU_SPC_ALU_ROW(OR, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19)
+		SNES_APU_SPC_ALU_ROW(AND, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39)
+		SNES_APU_SPC_ALU_ROW(EOR, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59)
+		SNES_APU_SPC_ALU_ROW(CMP, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79)
+		SNES_APU_SPC_ALU_ROW(ADC, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99)
+		SNES_APU_SPC_ALU_ROW(SBC, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9)
+
+		SNES_APU_SPC_RMW_ROW(0x0B, 0x0C, 0x1B, 0x1C, SNES_APU_SPC_ASL())
+		SNES_APU_SPC_RMW_ROW(0x2B, 0x2C, 0x3B, 0x3C, SNES_APU_SPC_ROL())
+		SNES_APU_SPC_RMW_ROW(0x4B, 0x4C, 0x5B, 0x5C, SNES_APU_SPC_LSR())
+		SNES_APU_SPC_RMW_ROW(0x6B, 0x6C, 0x7B, 0x7C, SNES_APU_SPC_ROR())
+		SNES_APU_SPC_RMW_ROW(0x8B, 0x8C, 0x9B, 0x9C, SNES_APU_SPC_DEC())
+		SNES_APU_SPC_RMW_ROW(0xAB, 0xAC, 0xBB, 0xBC, SNES_APU_SPC_INC())
+
+		SNES_APU_SPC_BIT_COLUMN(0x02, 0x03, 0x12, 0x13)
+		SNES_APU_SPC_BIT_COLUMN(0x22, 0x23, 0x32, 0x33)
+		SNES_APU_SPC_BIT_COLUMN(0x42, 0x43, 0x52, 0x53)
+		SNES_APU_SPC_BIT_COLUMN(0x62, 0x63, 0x72, 0x73)
+		SNES_APU_SPC_BIT_COLUMN(0x82, 0x83, 0x92, 0x93)
+		SNES_APU_SPC_BIT_COLUMN(0xA2, 0xA3, 0xB2, 0xB3)
+		SNES_APU_SPC_BIT_COLUMN(0xC2, 0xC3, 0xD2, 0xD3)
+		SNES_APU_SPC_BIT_COLUMN(0xE2, 0xE3, 0xF2, 0xF3)
+
+		SNES_APU_SPC_TCALL(0x01) SNES_APU_SPC_TCALL(0x11) SNES_APU_SPC_TCALL(0x21) SNES_APU_SPC_TCALL(0x31)
+		SNES_APU_SPC_TCALL(0x41) SNES_APU_SPC_TCALL(0x51) SNES_APU_SPC_TCALL(0x61) SNES_APU_SPC_TCALL(0x71)
+		SNES_APU_SPC_TCALL(0x81) SNES_APU_SPC_TCALL(0x91) SNES_APU_SPC_TCALL(0xA1) SNES_APU_SPC_TCALL(0xB1)
+		SNES_APU_SPC_TCALL(0xC1) SNES_APU_SPC_TCALL(0xD1) SNES_APU_SPC_TCALL(0xE1) SNES_APU_SPC_TCALL(0xF1)
+
+		//Branches
+		SNES_APU_SPC_CASE(0x10) BRANCH(!(psw & SNES_APU_SPC_N)) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x30) BRANCH(psw & SNES_APU_SPC_N) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x50) BRANCH(!(psw & SNES_APU_SPC_V)) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x70) BRANCH(psw & SNES_APU_SPC_V) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x90) BRANCH(!(psw & SNES_APU_SPC_C)) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xB0) BRANCH(psw & SNES_APU_SPC_C) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xD0) BRANCH(!(psw & SNES_APU_SPC_Z)) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xF0) BRANCH(psw & SNES_APU_SPC_Z) SNES_APU_SPC_NEXT()
+		//BRA's base count already has the taken branch
+		SNES_APU_SPC_CASE(0x2F) data = IMM(); pc += (int8_t)data; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x2E) data = RD(DP(IMM())); BRANCH(a != data) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xDE) data = RD(DP(IMM() + x)); BRANCH(a != data) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x6E)
+			addr = DP(IMM());
+			data = RD(addr) - 1;
+			WR(addr, data);
+			BRANCH(data != 0)
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xFE) y--; BRANCH(y != 0) SNES_APU_SPC_NEXT()
+
+		//Jumps, calls and returns
+		SNES_APU_SPC_CASE(0x5F) pc = ABS(); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x1F) addr = ABS() + x; pc = RD(addr) | (RD(addr + 1) << 8); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x3F)
+			addr = ABS();
+			PUSH(pc >> 8);
+			PUSH(pc & 0xFF);
+			pc = addr;
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x4F)
+			data = IMM();
+			PUSH(pc >> 8);
+			PUSH(pc & 0xFF);
+			pc = 0xFF00 | data;
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x0F)
+			PUSH(pc >> 8);
+			PUSH(pc & 0xFF);
+			PUSH(psw);
+			psw = (psw | SNES_APU_SPC_B) & ~SNES_APU_SPC_I;
+			pc = RD(0xFFDE) | (RD(0xFFDF) << 8);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x6F) pc = POP(); pc |= POP() << 8; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x7F)
+			psw = POP();
+			SET_DP()
+			pc = POP();
+			pc |= POP() << 8;
+			SNES_APU_SPC_NEXT()
+
+		//Stack
+		SNES_APU_SPC_CASE(0x0D) PUSH(psw); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x2D) PUSH(a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x4D) PUSH(x); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x6D) PUSH(y); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x8E) psw = POP(); SET_DP() SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xAE) a = POP(); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xCE) x = POP(); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xEE) y = POP(); SNES_APU_SPC_NEXT()
+
+		//Loads, flags set
+		SNES_APU_SPC_CASE(0xE4) a = snes_apu_spc_nz(&psw, RD(DP(IMM()))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xE5) addr = ABS(); a = snes_apu_spc_nz(&psw, RD(addr)); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xE6) a = snes_apu_spc_nz(&psw, RD(DP(x))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xE7) data = IMM() + x; a = snes_apu_spc_nz(&psw, RD(DP_WORD(data))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xE8) a = snes_apu_spc_nz(&psw, IMM()); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xF4) a = snes_apu_spc_nz(&psw, RD(DP(IMM() + x))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xF5) addr = ABS(); a = snes_apu_spc_nz(&psw, RD(addr + x)); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xF6) addr = ABS(); a = snes_apu_spc_nz(&psw, RD(addr + y)); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xF7) data = IMM(); a = snes_apu_spc_nz(&psw, RD(DP_WORD(data) + y)); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xBF) a = snes_apu_spc_nz(&psw, RD(DP(x))); x++; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xCD) x = snes_apu_spc_nz(&psw, IMM()); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xE9) addr = ABS(); x = snes_apu_spc_nz(&psw, RD(addr)); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xF8) x = snes_apu_spc_nz(&psw, RD(DP(IMM()))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xF9) x = snes_apu_spc_nz(&psw, RD(DP(IMM() + y))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x8D) y = snes_apu_spc_nz(&psw, IMM()); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xEB) y = snes_apu_spc_nz(&psw, RD(DP(IMM()))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xEC) addr = ABS(); y = snes_apu_spc_nz(&psw, RD(addr)); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xFB) y = snes_apu_spc_nz(&psw, RD(DP(IMM() + x))); SNES_APU_SPC_NEXT()
+
+		//Stores, no flag
+		SNES_APU_SPC_CASE(0xC4) WR(DP(IMM()), a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xC5) addr = ABS(); WR(addr, a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xC6) WR(DP(x), a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xC7) data = IMM() + x; WR(DP_WORD(data), a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xD4) WR(DP(IMM() + x), a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xD5) addr = ABS(); WR(addr + x, a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xD6) addr = ABS(); WR(addr + y, a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xD7) data = IMM(); WR(DP_WORD(data) + y, a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xAF) WR(DP(x), a); x++; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xC9) addr = ABS(); WR(addr, x); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xD8) WR(DP(IMM()), x); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xD9) WR(DP(IMM() + y), x); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xCB) WR(DP(IMM()), y); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xCC) addr = ABS(); WR(addr, y); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xDB) WR(DP(IMM() + x), y); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x8F) data = IMM(); WR(DP(IMM()), data); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xFA) data = RD(DP(IMM())); WR(DP(IMM()), data); SNES_APU_SPC_NEXT()
+
+		//Register transfers
+		SNES_APU_SPC_CASE(0x5D) x = snes_apu_spc_nz(&psw, a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x7D) a = snes_apu_spc_nz(&psw, x); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xDD) a = snes_apu_spc_nz(&psw, y); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xFD) y = snes_apu_spc_nz(&psw, a); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x9D) x = snes_apu_spc_nz(&psw, sp); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xBD) sp = x; SNES_APU_SPC_NEXT()
+
+		//Index registers
+		SNES_APU_SPC_CASE(0x1D) x = snes_apu_spc_nz(&psw, x - 1); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x3D) x = snes_apu_spc_nz(&psw, x + 1); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xDC) y = snes_apu_spc_nz(&psw, y - 1); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xFC) y = snes_apu_spc_nz(&psw, y + 1); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xC8) snes_apu_spc_cmp(&psw, x, IMM()); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x3E) snes_apu_spc_cmp(&psw, x, RD(DP(IMM()))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x1E) addr = ABS(); snes_apu_spc_cmp(&psw, x, RD(addr)); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xAD) snes_apu_spc_cmp(&psw, y, IMM()); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x7E) snes_apu_spc_cmp(&psw, y, RD(DP(IMM()))); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x5E) addr = ABS(); snes_apu_spc_cmp(&psw, y, RD(addr)); SNES_APU_SPC_NEXT()
+
+		//16 bits operations on YA, the word wraps in the direct page
+		SNES_APU_SPC_CASE(0xBA)
+			data = IMM();
+			word = DP_WORD(data);
+			a = word;
+			y = word >> 8;
+			snes_apu_spc_nz16(&psw, word);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xDA)
+			data = IMM();
+			WR(DP(data), a);
+			WR(DP(data + 1), y);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x3A)
+		SNES_APU_SPC_CASE(0x1A)
+			data = IMM();
+			word = DP_WORD(data) + (opcode == 0x3A ? 1 : -1);
+			WR(DP(data), word & 0xFF);
+			WR(DP(data + 1), word >> 8);
+			snes_apu_spc_nz16(&psw, word);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x7A)
+		SNES_APU_SPC_CASE(0x9A)
+			data = IMM();
+			word = DP_WORD(data);
+			addr = (y << 8) | a;
+			psw &= ~(SNES_APU_SPC_V | SNES_APU_SPC_HC | SNES_APU_SPC_C);
+			if(opcode == 0x7A) {
+				result = addr + word;
+				if(~(addr ^ word) & (addr ^ result) & 0x8000)
+					psw |= SNES_APU_SPC_V;
+				if((addr ^ word ^ result) & 0x1000)
+					psw |= SNES_APU_SPC_HC;
+				if(result > 0xFFFF)
+					psw |= SNES_APU_SPC_C;
+			} else {
+				//H and C are set when there is no borrow
+				result = (uint16_t)(addr - word);
+				if((addr ^ word) & (addr ^ result) & 0x8000)
+					psw |= SNES_APU_SPC_V;
+				if(!((addr ^ word ^ result) & 0x1000))
+					psw |= SNES_APU_SPC_HC;
+				if(addr >= word)
+					psw |= SNES_APU_SPC_C;
+			}
+			a = result;
+			y = result >> 8;
+			snes_apu_spc_nz16(&psw, result);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x5A)
+			data = IMM();
+			word = DP_WORD(data);
+			addr = (y << 8) | a;
+			FLAG(SNES_APU_SPC_C, addr >= word);
+			snes_apu_spc_nz16(&psw, addr - word);
+			SNES_APU_SPC_NEXT()
+
+		//Multiply, divide and decimal adjust
+		SNES_APU_SPC_CASE(0xCF)
+			word = y * a;
+			a = word;
+			y = word >> 8;
+			snes_apu_spc_nz(&psw, y);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x9E)
+			//Out of range quotients give the same garbage as the hardware
+			word = (y << 8) | a;
+			FLAG(SNES_APU_SPC_HC, (x & 0x0F) <= (y & 0x0F));
+			FLAG(SNES_APU_SPC_V, y >= x);
+			if(y < (x << 1)) {
+				a = word / x;
+				y = word % x;
+			} else {
+				a = 255 - (word - (x << 9)) / (256 - x);
+				y = x + (word - (x << 9)) % (256 - x);
+			}
+			snes_apu_spc_nz(&psw, a);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xDF)
+			if((psw & SNES_APU_SPC_C) || a > 0x99) {
+				a += 0x60;
+				psw |= SNES_APU_SPC_C;
+			}
+			if((psw & SNES_APU_SPC_HC) || (a & 0x0F) > 0x09)
+				a += 0x06;
+			snes_apu_spc_nz(&psw, a);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xBE)
+			if(!(psw & SNES_APU_SPC_C) || a > 0x99) {
+				a -= 0x60;
+				psw &= ~SNES_APU_SPC_C;
+			}
+			if(!(psw & SNES_APU_SPC_HC) || (a & 0x0F) > 0x09)
+				a -= 0x06;
+			snes_apu_spc_nz(&psw, a);
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x9F) a = snes_apu_spc_nz(&psw, (a >> 4) | (a << 4)); SNES_APU_SPC_NEXT()
+
+		//Test and set/clear against A, flags as CMP A,mem without C
+		SNES_APU_SPC_CASE(0x0E)
+		SNES_APU_SPC_CASE(0x4E)
+			addr = ABS();
+			data = RD(addr);
+			snes_apu_spc_nz(&psw, a - data);
+			WR(addr, opcode == 0x0E ? data | a : data & ~a);
+			SNES_APU_SPC_NEXT()
+
+		//1 bit operations with C
+		SNES_APU_SPC_CASE(0x0A) SNES_APU_SPC_MEMBIT() FLAG(SNES_APU_SPC_C, (psw & SNES_APU_SPC_C) || data); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x2A) SNES_APU_SPC_MEMBIT() FLAG(SNES_APU_SPC_C, (psw & SNES_APU_SPC_C) || !data); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x4A) SNES_APU_SPC_MEMBIT() FLAG(SNES_APU_SPC_C, (psw & SNES_APU_SPC_C) && data); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x6A) SNES_APU_SPC_MEMBIT() FLAG(SNES_APU_SPC_C, (psw & SNES_APU_SPC_C) && !data); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x8A) SNES_APU_SPC_MEMBIT() FLAG(SNES_APU_SPC_C, (psw & SNES_APU_SPC_C) ^ data); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xAA) SNES_APU_SPC_MEMBIT() FLAG(SNES_APU_SPC_C, data); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xCA)
+			SNES_APU_SPC_MEMBIT_ADDRESS()
+			data = RD(addr);
+			if(psw & SNES_APU_SPC_C)
+				WR(addr, data | (1 << bit));
+			else
+				WR(addr, data & ~(1 << bit));
+			SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xEA)
+			SNES_APU_SPC_MEMBIT_ADDRESS()
+			WR(addr, RD(addr) ^ (1 << bit));
+			SNES_APU_SPC_NEXT()
+
+		//Flags
+		SNES_APU_SPC_CASE(0x60) psw &= ~SNES_APU_SPC_C; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x80) psw |= SNES_APU_SPC_C; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xED) psw ^= SNES_APU_SPC_C; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xE0) psw &= ~(SNES_APU_SPC_V | SNES_APU_SPC_HC); SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x20) psw &= ~SNES_APU_SPC_P; SET_DP() SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0x40) psw |= SNES_APU_SPC_P; SET_DP() SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xA0) psw |= SNES_APU_SPC_I; SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xC0) psw &= ~SNES_APU_SPC_I; SNES_APU_SPC_NEXT()
+
+		SNES_APU_SPC_CASE(0x00) SNES_APU_SPC_NEXT()
+		SNES_APU_SPC_CASE(0xEF)
+		SNES_APU_SPC_CASE(0xFF)
+			//No interrupt source on the APU, only a reset leaves SLEEP or STOP
+			pc--;
+			spc->sleeping = 1;
+			spc->cycles = cycle;
+			SNES_APU_SPC_NEXT()
+
+		SNES_APU_SPC_END()
+next:
+		;
+	}
+	spc->a = a;
+	spc->x = x;
+	spc->y = y;
+	spc->sp = sp;
+	spc->psw = psw;
+	spc->pc = pc;
+	snes_apu_spc_dsp_update(spc);
+}
@@ -0,0 +1,42 @@
+#ifndef SNES_APU_SPC_H
+#define SNES_APU_SPC_H
+
+#include <stdint.h>
+#include "snes_apu_port.h"
+#include "snes_apu_dsp.h"
+
+/*
+ * SPC700 core of the APU, with its three timers and the $F0-$FF registers.
+ * It runs on the 64KB of APU RAM given at init, the boot ROM (IPL) shows at
+ * $FFC0-$FFFF while CONTROL bit 7 is set. The clock counts SPC700 cycles
+ * (SNES_APU_SPC_CLOCK per second), the DSP behind $F2/$F3 follows it.
+ */
+#define SNES_APU_SPC_CLOCK 1024000
+
+typedef struct _snes_apu_spc snes_apu_spc_t;
+
+typedef struct {
+	uint64_t instructions;
+	uint64_t cycles;
+} snes_apu_spc_stats_t;
+
+snes_apu_spc_t *snes_apu_spc_init(uint8_t *ram, snes_apu_port_t *port, snes_apu_dsp_t *dsp);
+void snes_apu_spc_destroy(snes_apu_spc_t *spc);
+
+/*Starts from the IPL reset vector and resets the DSP, the RAM is kept*/
+void snes_apu_spc_reset(snes_apu_spc_t *spc);
+/*Runs until the clock reaches cycle, a sleeping core jumps there*/
+void snes_apu_spc_run_until(snes_apu_spc_t *spc, uint64_t cycle);
+uint64_t snes_apu_spc_get_cycles(snes_apu_spc_t *spc);
+void snes_apu_spc_get_stats(snes_apu_spc_t *spc, snes_apu_spc_stats_t *stats);
+void snes_apu_spc_dump(snes_apu_spc_t *spc);
+
+/*
+ * IPL transfer fast path : with the IPL waiting for byte index of a block,
+ * stores count bytes as if they came one by one through ports 0-1 and leaves
+ * the IPL waiting for the next one. The CPU side of the ports is left to the
+ * caller. Returns -1 when the IPL isn't in that state, nothing is stored then.
+ */
+int snes_apu_spc_ipl_upload(snes_apu_spc_t *spc, uint8_t index, const uint8_t *data, uint32_t count);
+
+#endif //SNES_APU_SPC_H
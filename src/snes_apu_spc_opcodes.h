@@ -0,0 +1,269 @@
+#ifndef SNES_APU_SPC_OPCODES_H
+#define SNES_APU_SPC_OPCODES_H
+
+/*
+ * SPC700 opcode table : OP(opcode, syntax, bytes, cycles)
+ * Operands in the syntax : d direct page, !a absolute, #i immediate, r relative,
+ * m.b 13 bits address and bit number, u PCALL offset. dd,ds encodes ds first.
+ * Cycles are the base count, a taken branch adds 2.
+ * Shared by the dispatch table and the disassembler.
+ */
+#define SNES_APU_SPC_OPCODES(OP) \
+	OP(0x00, "NOP", 1, 2) \
+	OP(0x01, "TCALL 0", 1, 8) \
+	OP(0x02, "SET1 d.0", 2, 4) \
+	OP(0x03, "BBS d.0,r", 3, 5) \
+	OP(0x04, "OR A,d", 2, 3) \
+	OP(0x05, "OR A,!a", 3, 4) \
+	OP(0x06, "OR A,(X)", 1, 3) \
+	OP(0x07, "OR A,[d+X]", 2, 6) \
+	OP(0x08, "OR A,#i", 2, 2) \
+	OP(0x09, "OR dd,ds", 3, 6) \
+	OP(0x0A, "OR1 C,m.b", 3, 5) \
+	OP(0x0B, "ASL d", 2, 4) \
+	OP(0x0C, "ASL !a", 3, 5) \
+	OP(0x0D, "PUSH PSW", 1, 4) \
+	OP(0x0E, "TSET1 !a", 3, 6) \
+	OP(0x0F, "BRK", 1, 8) \
+	OP(0x10, "BPL r", 2, 2) \
+	OP(0x11, "TCALL 1", 1, 8) \
+	OP(0x12, "CLR1 d.0", 2, 4) \
+	OP(0x13, "BBC d.0,r", 3, 5) \
+	OP(0x14, "OR A,d+X", 2, 4) \
+	OP(0x15, "OR A,!a+X", 3, 5) \
+	OP(0x16, "OR A,!a+Y", 3, 5) \
+	OP(0x17, "OR A,[d]+Y", 2, 6) \
+	OP(0x18, "OR d,#i", 3, 5) \
+	OP(0x19, "OR (X),(Y)", 1, 5) \
+	OP(0x1A, "DECW d", 2, 6) \
+	OP(0x1B, "ASL d+X", 2, 5) \
+	OP(0x1C, "ASL A", 1, 2) \
+	OP(0x1D, "DEC X", 1, 2) \
+	OP(0x1E, "CMP X,!a", 3, 4) \
+	OP(0x1F, "JMP [!a+X]", 3, 6) \
+	OP(0x20, "CLRP", 1, 2) \
+	OP(0x21, "TCALL 2", 1, 8) \
+	OP(0x22, "SET1 d.1", 2, 4) \
+	OP(0x23, "BBS d.1,r", 3, 5) \
+	OP(0x24, "AND A,d", 2, 3) \
+	OP(0x25, "AND A,!a", 3, 4) \
+	OP(0x26, "AND A,(X)", 1, 3) \
+	OP(0x27, "AND A,[d+X]", 2, 6) \
+	OP(0x28, "AND A,#i", 2, 2) \
+	OP(0x29, "AND dd,ds", 3, 6) \
+	OP(0x2A, "OR1 C,/m.b", 3, 5) \
+	OP(0x2B, "ROL d", 2, 4) \
+	OP(0x2C, "ROL !a", 3, 5) \
+	OP(0x2D, "PUSH A", 1, 4) \
+	OP(0x2E, "CBNE d,r", 3, 5) \
+	OP(0x2F, "BRA r", 2, 4) \
+	OP(0x30, "BMI r", 2, 2) \
+	OP(0x31, "TCALL 3", 1, 8) \
+	OP(0x32, "CLR1 d.1", 2, 4) \
+	OP(0x33, "BBC d.1,r", 3, 5) \
+	OP(0x34, "AND A,d+X", 2, 4) \
+	OP(0x35, "AND A,!a+X", 3, 5) \
+	OP(0x36, "AND A,!a+Y", 3, 5) \
+	OP(0x37, "AND A,[d]+Y", 2, 6) \
+	OP(0x38, "AND d,#i", 3, 5) \
+	OP(0x39, "AND (X),(Y)", 1, 5) \
+	OP(0x3A, "INCW d", 2, 6) \
+	OP(0x3B, "ROL d+X", 2, 5) \
+	OP(0x3C, "ROL A", 1, 2) \
+	OP(0x3D, "INC X", 1, 2) \
+	OP(0x3E, "CMP X,d", 2, 3) \
+	OP(0x3F, "CALL !a", 3, 8) \
+	OP(0x40, "SETP", 1, 2) \
+	OP(0x41, "TCALL 4", 1, 8) \
+	OP(0x42, "SET1 d.2", 2, 4) \
+	OP(0x43, "BBS d.2,r", 3, 5) \
+	OP(0x44, "EOR A,d", 2, 3) \
+	OP(0x45, "EOR A,!a", 3, 4) \
+	OP(0x46, "EOR A,(X)", 1, 3) \
+	OP(0x47, "EOR A,[d+X]", 2, 6) \
+	OP(0x48, "EOR A,#i", 2, 2) \
+	OP(0x49, "EOR dd,ds", 3, 6) \
+	OP(0x4A, "AND1 C,m.b", 3, 4) \
+	OP(0x4B, "LSR d", 2, 4) \
+	OP(0x4C, "LSR !a", 3, 5) \
+	OP(0x4D, "PUSH X", 1, 4) \
+	OP(0x4E, "TCLR1 !a", 3, 6) \
+	OP(0x4F, "PCALL u", 2, 6) \
+	OP(0x50, "BVC r", 2, 2) \
+	OP(0x51, "TCALL 5", 1, 8) \
+	OP(0x52, "CLR1 d.2", 2, 4) \
+	OP(0x53, "BBC d.2,r", 3, 5) \
+	OP(0x54, "EOR A,d+X", 2, 4) \
+	OP(0x55, "EOR A,!a+X", 3, 5) \
+	OP(0x56, "EOR A,!a+Y", 3, 5) \
+	OP(0x57, "EOR A,[d]+Y", 2, 6) \
+	OP(0x58, "EOR d,#i", 3, 5) \
+	OP(0x59, "EOR (X),(Y)", 1, 5) \
+	OP(0x5A, "CMPW YA,d", 2, 4) \
+	OP(0x5B, "LSR d+X", 2, 5) \
+	OP(0x5C, "LSR A", 1, 2) \
+	OP(0x5D, "MOV X,A", 1, 2) \
+	OP(0x5E, "CMP Y,!a", 3, 4) \
+	OP(0x5F, "JMP !a", 3, 3) \
+	OP(0x60, "CLRC", 1, 2) \
+	OP(0x61, "TCALL 6", 1, 8) \
+	OP(0x62, "SET1 d.3", 2, 4) \
+	OP(0x63, "BBS d.3,r", 3, 5) \
+	OP(0x64, "CMP A,d", 2, 3) \
+	OP(0x65, "CMP A,!a", 3, 4) \
+	OP(0x66, "CMP A,(X)", 1, 3) \
+	OP(0x67, "CMP A,[d+X]", 2, 6) \
+	OP(0x68, "CMP A,#i", 2, 2) \
+	OP(0x69, "CMP dd,ds", 3, 6) \
+	OP(0x6A, "AND1 C,/m.b", 3, 4) \
+	OP(0x6B, "ROR d", 2, 4) \
+	OP(0x6C, "ROR !a", 3, 5) \
+	OP(0x6D, "PUSH Y", 1, 4) \
+	OP(0x6E, "DBNZ d,r", 3, 5) \
+	OP(0x6F, "RET", 1, 5) \
+	OP(0x70, "BVS r", 2, 2) \
+	OP(0x71, "TCALL 7", 1, 8) \
+	OP(0x72, "CLR1 d.3", 2, 4) \
+	OP(0x73, "BBC d.3,r", 3, 5) \
+	OP(0x74, "CMP A,d+X", 2, 4) \
+	OP(0x75, "CMP A,!a+X", 3, 5) \
+	OP(0x76, "CMP A,!a+Y", 3, 5) \
+	OP(0x77, "CMP A,[d]+Y", 2, 6) \
+	OP(0x78, "CMP d,#i", 3, 5) \
+	OP(0x79, "CMP (X),(Y)", 1, 5) \
+	OP(0x7A, "ADDW YA,d", 2, 5) \
+	OP(0x7B, "ROR d+X", 2, 5) \
+	OP(0x7C, "ROR A", 1, 2) \
+	OP(0x7D, "MOV A,X", 1, 2) \
+	OP(0x7E, "CMP Y,d", 2, 3) \
+	OP(0x7F, "RETI", 1, 6) \
+	OP(0x80, "SETC", 1, 2) \
+	OP(0x81, "TCALL 8", 1, 8) \
+	OP(0x82, "SET1 d.4", 2, 4) \
+	OP(0x83, "BBS d.4,r", 3, 5) \
+	OP(0x84, "ADC A,d", 2, 3) \
+	OP(0x85, "ADC A,!a", 3, 4) \
+	OP(0x86, "ADC A,(X)", 1, 3) \
+	OP(0x87, "ADC A,[d+X]", 2, 6) \
+	OP(0x88, "ADC A,#i", 2, 2) \
+	OP(0x89, "ADC dd,ds", 3, 6) \
+	OP(0x8A, "EOR1 C,m.b", 3, 5) \
+	OP(0x8B, "DEC d", 2, 4) \
+	OP(0x8C, "DEC !a", 3, 5) \
+	OP(0x8D, "MOV Y,#i", 2, 2) \
+	OP(0x8E, "POP PSW", 1, 4) \
+	OP(0x8F, "MOV d,#i", 3, 5) \
+	OP(0x90, "BCC r", 2, 2) \
+	OP(0x91, "TCALL 9", 1, 8) \
+	OP(0x92, "CLR1 d.4", 2, 4) \
+	OP(0x93, "BBC d.4,r", 3, 5) \
+	OP(0x94, "ADC A,d+X", 2, 4) \
+	OP(0x95, "ADC A,!a+X", 3, 5) \
+	OP(0x96, "ADC A,!a+Y", 3, 5) \
+	OP(0x97, "ADC A,[d]+Y", 2, 6) \
+	OP(0x98, "ADC d,#i", 3, 5) \
+	OP(0x99, "ADC (X),(Y)", 1, 5) \
+	OP(0x9A, "SUBW YA,d", 2, 5) \
+	OP(0x9B, "DEC d+X", 2, 5) \
+	OP(0x9C, "DEC A", 1, 2) \
+	OP(0x9D, "MOV X,SP", 1, 2) \
+	OP(0x9E, "DIV YA,X", 1, 12) \
+	OP(0x9F, "XCN A", 1, 5) \
+	OP(0xA0, "EI", 1, 3) \
+	OP(0xA1, "TCALL 10", 1, 8) \
+	OP(0xA2, "SET1 d.5", 2, 4) \
+	OP(0xA3, "BBS d.5,r", 3, 5) \
+	OP(0xA4, "SBC A,d", 2, 3) \
+	OP(0xA5, "SBC A,!a", 3, 4) \
+	OP(0xA6, "SBC A,(X)", 1, 3) \
+	OP(0xA7, "SBC A,[d+X]", 2, 6) \
+	OP(0xA8, "SBC A,#i", 2, 2) \
+	OP(0xA9, "SBC dd,ds", 3, 6) \
+	OP(0xAA, "MOV1 C,m.b", 3, 4) \
+	OP(0xAB, "INC d", 2, 4) \
+	OP(0xAC, "INC !a", 3, 5) \
+	OP(0xAD, "CMP Y,#i", 2, 2) \
+	OP(0xAE, "POP A", 1, 4) \
+	OP(0xAF, "MOV (X)+,A", 1, 4) \
+	OP(0xB0, "BCS r", 2, 2) \
+	OP(0xB1, "TCALL 11", 1, 8) \
+	OP(0xB2, "CLR1 d.5", 2, 4) \
+	OP(0xB3, "BBC d.5,r", 3, 5) \
+	OP(0xB4, "SBC A,d+X", 2, 4) \
+	OP(0xB5, "SBC A,!a+X", 3, 5) \
+	OP(0xB6, "SBC A,!a+Y", 3, 5) \
+	OP(0xB7, "SBC A,[d]+Y", 2, 6) \
+	OP(0xB8, "SBC d,#i", 3, 5) \
+	OP(0xB9, "SBC (X),(Y)", 1, 5) \
+	OP(0xBA, "MOVW YA,d", 2, 5) \
+	OP(0xBB, "INC d+X", 2, 5) \
+	OP(0xBC, "INC A", 1, 2) \
+	OP(0xBD, "MOV SP,X", 1, 2) \
+	OP(0xBE, "DAS A", 1, 3) \
+	OP(0xBF, "MOV A,(X)+", 1, 4) \
+	OP(0xC0, "DI", 1, 3) \
+	OP(0xC1, "TCALL 12", 1, 8) \
+	OP(0xC2, "SET1 d.6", 2, 4) \
+	OP(0xC3, "BBS d.6,r", 3, 5) \
+	OP(0xC4, "MOV d,A", 2, 4) \
+	OP(0xC5, "MOV !a,A", 3, 5) \
+	OP(0xC6, "MOV (X),A", 1, 4) \
+	OP(0xC7, "MOV [d+X],A", 2, 7) \
+	OP(0xC8, "CMP X,#i", 2, 2) \
+	OP(0xC9, "MOV !a,X", 3, 5) \
+	OP(0xCA, "MOV1 m.b,C", 3, 6) \
+	OP(0xCB, "MOV d,Y", 2, 4) \
+	OP(0xCC, "MOV !a,Y", 3, 5) \
+	OP(0xCD, "MOV X,#i", 2, 2) \
+	OP(0xCE, "POP X", 1, 4) \
+	OP(0xCF, "MUL YA", 1, 9) \
+	OP(0xD0, "BNE r", 2, 2) \
+	OP(0xD1, "TCALL 13", 1, 8) \
+	OP(0xD2, "CLR1 d.6", 2, 4) \
+	OP(0xD3, "BBC d.6,r", 3, 5) \
+	OP(0xD4, "MOV d+X,A", 2, 5) \
+	OP(0xD5, "MOV !a+X,A", 3, 6) \
+	OP(0xD6, "MOV !a+Y,A", 3, 6) \
+	OP(0xD7, "MOV [d]+Y,A", 2, 7) \
+	OP(0xD8, "MOV d,X", 2, 4) \
+	OP(0xD9, "MOV d+Y,X", 2, 5) \
+	OP(0xDA, "MOVW d,YA", 2, 5) \
+	OP(0xDB, "MOV d+X,Y", 2, 5) \
+	OP(0xDC, "DEC Y", 1, 2) \
+	OP(0xDD, "MOV A,Y", 1, 2) \
+	OP(0xDE, "CBNE d+X,r", 3, 6) \
+	OP(0xDF, "DAA A", 1, 3) \
+	OP(0xE0, "CLRV", 1, 2) \
+	OP(0xE1, "TCALL 14", 1, 8) \
+	OP(0xE2, "SET1 d.7", 2, 4) \
+	OP(0xE3, "BBS d.7,r", 3, 5) \
+	OP(0xE4, "MOV A,d", 2, 3) \
+	OP(0xE5, "MOV A,!a", 3, 4) \
+	OP(0xE6, "MOV A,(X)", 1, 3) \
+	OP(0xE7, "MOV A,[d+X]", 2, 6) \
+	OP(0xE8, "MOV A,#i", 2, 2) \
+	OP(0xE9, "MOV X,!a", 3, 4) \
+	OP(0xEA, "NOT1 m.b", 3, 5) \
+	OP(0xEB, "MOV Y,d", 2, 3) \
+	OP(0xEC, "MOV Y,!a", 3, 4) \
+	OP(0xED, "NOTC", 1, 3) \
+	OP(0xEE, "POP Y", 1, 4) \
+	OP(0xEF, "SLEEP", 1, 3) \
+	OP(0xF0, "BEQ r", 2, 2) \
+	OP(0xF1, "TCALL 15", 1, 8) \
+	OP(0xF2, "CLR1 d.7", 2, 4) \
+	OP(0xF3, "BBC d.7,r", 3, 5) \
+	OP(0xF4, "MOV A,d+X", 2, 4) \
+	OP(0xF5, "MOV A,!a+X", 3, 5) \
+	OP(0xF6, "MOV A,!a+Y", 3, 5) \
+	OP(0xF7, "MOV A,[d]+Y", 2, 6) \
+	OP(0xF8, "MOV X,d", 2, 3) \
+	OP(0xF9, "MOV X,d+Y", 2, 4) \
+	OP(0xFA, "MOV dd,ds", 3, 5) \
+	OP(0xFB, "MOV Y,d+X", 2, 4) \
+	OP(0xFC, "INC Y", 1, 2) \
+	OP(0xFD, "MOV Y,A", 1, 2) \
+	OP(0xFE, "DBNZ Y,r", 2, 4) \
+	OP(0xFF, "STOP", 1, 3)
+
+#endif //SNES_APU_SPC_OPCODES_H
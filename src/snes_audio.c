@@ -0,0 +1,403 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "snes_audio.h"
+#include "snes_apu_dsp.h"
+
+//Frames per buffer, about a quarter of a second
+#define SNES_AUDIO_BUFFER_FRAMES 8192
+#define SNES_AUDIO_WAV_HEADER 44
+
+//Resampler kernel : 32 taps, cut at 90% of the 16kHz input band
+#define SNES_AUDIO_TAPS 32
+#define SNES_AUDIO_CUTOFF 0.9
+
+typedef struct {
+	uint32_t up; //Output rate / input rate, reduced
+	uint32_t down;
+	uint32_t phase; //Position of the next output after the center tap, in 1/up
+	float *kernel; //up phases of SNES_AUDIO_TAPS taps
+	//Last input frames, twice in a row so that the window is contiguous
+	float history[2][SNES_AUDIO_TAPS * 2];
+	uint32_t position;
+} snes_audio_resampler_t;
+
+struct _snes_audio {
+	FILE *file;
+	snes_audio_format_t format;
+	uint32_t rate;
+	snes_audio_resampler_t *resampler;
+	int16_t *buffers[2];
+	uint32_t counts[2];
+	uint8_t pending[2]; //Handed to the writer thread
+	uint8_t current; //Buffer being filled
+	uint8_t stop;
+	uint8_t error; //Set by the writer thread, under the lock
+	uint64_t frames;
+	//Writer thread own buffers
+	int16_t *resampled;
+	uint8_t *bytes;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+static uint32_t snes_audio_gcd(uint32_t a, uint32_t b)
+{
+	uint32_t t;
+
+	while(b != 0) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static snes_audio_resampler_t *snes_audio_resampler_init(uint32_t rate)
+{
+	snes_audio_resampler_t *resampler;
+	uint32_t gcd = snes_audio_gcd(rate, SNES_APU_DSP_RATE);
+	uint32_t phase;
+	double sum;
+	double t;
+	double x;
+	double h;
+	float *taps;
+	int k;
+
+	resampler = malloc(sizeof(snes_audio_resampler_t));
+	if(resampler == NULL)
+		return NULL;
+	memset(resampler, 0, sizeof(snes_audio_resampler_t));
+	resampler->up = rate / gcd;
+	resampler->down = SNES_APU_DSP_RATE / gcd;
+	resampler->kernel = malloc(resampler->up * SNES_AUDIO_TAPS * sizeof(float));
+	if(resampler->kernel == NULL) {
+		free(resampler);
+		return NULL;
+	}
+
+	//Blackman windowed sinc, each phase normalized for a unity gain
+	for(phase = 0; phase < resampler->up; phase++) {
+		taps = resampler->kernel + phase * SNES_AUDIO_TAPS;
+		sum = 0;
+		for(k = 0; k < SNES_AUDIO_TAPS; k++) {
+			t = (double)phase / resampler->up - (k - (SNES_AUDIO_TAPS / 2 - 1));
+			x = SNES_AUDIO_CUTOFF * t;
+			h = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+			x = t / (SNES_AUDIO_TAPS / 2);
+			h *= 0.42 + 0.5 * cos(M_PI * x) + 0.08 * cos(2 * M_PI * x);
+			taps[k] = h;
+			sum += h;
+		}
+		for(k = 0; k < SNES_AUDIO_TAPS; k++)
+			taps[k] /= sum;
+	}
+	return resampler;
+}
+
+static void snes_audio_resampler_destroy(snes_audio_resampler_t *resampler)
+{
+	free(resampler->kernel);
+	free(resampler);
+}
+
+static inline int16_t snes_audio_clamp16(float value)
+{
+	if(value <= -32768.0f)
+		return -32768;
+	if(value >= 32767.0f)
+		return 32767;
+	return (int16_t)lrintf(value);
+}
+
+//Returns the number of frames put in out
+static uint32_t snes_audio_resample(snes_audio_resampler_t *resampler, const int16_t *in,
+									uint32_t count, int16_t *out)
+{
+	const float *window;
+	const float *taps;
+	uint32_t produced = 0;
+	uint32_t i;
+	float sum;
+	int c;
+	int k;
+
+	for(i = 0; i < count; i++) {
+		for(c = 0; c < 2; c++) {
+			resampler->history[c][resampler->position] = in[i * 2 + c];
+			resampler->history[c][resampler->position + SNES_AUDIO_TAPS] = in[i * 2 + c];
+		}
+		resampler->position = (resampler->position + 1) % SNES_AUDIO_TAPS;
+
+		//The outputs between the center tap and the next input
+		while(resampler->phase < resampler->up) {
+			taps = resampler->kernel + resampler->phase * SNES_AUDIO_TAPS;
+			for(c = 0; c < 2; c++) {
+				window = resampler->history[c] + resampler->position;
+				sum = 0;
+				for(k = 0; k < SNES_AUDIO_TAPS; k++)
+					sum += window[k] * taps[k];
+				out[produced * 2 + c] = snes_audio_clamp16(sum);
+			}
+			produced++;
+			resampler->phase += resampler->down;
+		}
+		resampler->phase -= resampler->up;
+	}
+	return produced;
+}
+
+static void snes_audio_put16(uint8_t *bytes, uint16_t value)
+{
+	bytes[0] = value;
+	bytes[1] = value >> 8;
+}
+
+static void snes_audio_put32(uint8_t *bytes, uint32_t value)
+{
+	snes_audio_put16(bytes, value);
+	snes_audio_put16(bytes + 2, value >> 16);
+}
+
+//Sizes are completed when the file is closed
+static int snes_audio_write_header(snes_audio_t *audio)
+{
+	uint8_t header[SNES_AUDIO_WAV_HEADER];
+	uint32_t data_size = audio->frames * 4;
+
+	memcpy(header, "RIFF", 4);
+	snes_audio_put32(header + 4, SNES_AUDIO_WAV_HEADER - 8 + data_size);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	snes_audio_put32(header + 16, 16);
+	snes_audio_put16(header + 20, 1); //PCM
+	snes_audio_put16(header + 22, 2);
+	snes_audio_put32(header + 24, audio->rate);
+	snes_audio_put32(header + 28, audio->rate * 4);
+	snes_audio_put16(header + 32, 4);
+	snes_audio_put16(header + 34, 16);
+	memcpy(header + 36, "data", 4);
+	snes_audio_put32(header + 40, data_size);
+	if(fwrite(header, SNES_AUDIO_WAV_HEADER, 1, audio->file) != 1)
+		return -1;
+	return 0;
+}
+
+//Writer thread side, returns the number of frames written or -1
+static int snes_audio_flush(snes_audio_t *audio, const int16_t *frames, uint32_t count)
+{
+	uint32_t i;
+
+	if(audio->resampler != NULL) {
+		count = snes_audio_resample(audio->resampler, frames, count, audio->resampled);
+		frames = audio->resampled;
+	}
+	for(i = 0; i < count * 2; i++)
+		snes_audio_put16(audio->bytes + i * 2, frames[i]);
+	if(count > 0 && fwrite(audio->bytes, count * 4, 1, audio->file) != 1) {
+		printf("Unable to write the audio file !\n");
+		return -1;
+	}
+	return count;
+}
+
+static void *snes_audio_writer(void *data)
+{
+	snes_audio_t *audio = (snes_audio_t *)data;
+	uint8_t index = 0;
+	uint8_t error;
+	int written;
+
+	pthread_mutex_lock(&audio->lock);
+	for(;;) {
+		while(!audio->pending[index] && !audio->stop)
+			pthread_cond_wait(&audio->cond, &audio->lock);
+		if(!audio->pending[index])
+			break;
+		error = audio->error;
+		pthread_mutex_unlock(&audio->lock);
+
+		written = 0;
+		if(!error)
+			written = snes_audio_flush(audio, audio->buffers[index], audio->counts[index]);
+
+		pthread_mutex_lock(&audio->lock);
+		if(written < 0)
+			audio->error = 1;
+		else
+			audio->frames += written;
+		audio->pending[index] = 0;
+		pthread_cond_broadcast(&audio->cond);
+		index ^= 1;
+	}
+	pthread_mutex_unlock(&audio->lock);
+	return NULL;
+}
+
+static uint8_t snes_audio_get_error(snes_audio_t *audio)
+{
+	uint8_t error;
+
+	pthread_mutex_lock(&audio->lock);
+	error = audio->error;
+	pthread_mutex_unlock(&audio->lock);
+	return error;
+}
+
+//Gives the current buffer to the writer thread, waits only if it still has the other
+static void snes_audio_hand_over(snes_audio_t *audio)
+{
+	uint8_t next = audio->current ^ 1;
+
+	pthread_mutex_lock(&audio->lock);
+	audio->pending[audio->current] = 1;
+	pthread_cond_broadcast(&audio->cond);
+	while(audio->pending[next])
+		pthread_cond_wait(&audio->cond, &audio->lock);
+	pthread_mutex_unlock(&audio->lock);
+	audio->current = next;
+	audio->counts[next] = 0;
+}
+
+snes_audio_t *snes_audio_init(const char *path, snes_audio_format_t format, uint32_t rate)
+{
+	snes_audio_t *audio;
+	uint32_t resampled_frames = SNES_AUDIO_BUFFER_FRAMES;
+
+	if(rate != 0 && rate != 44100 && rate != 48000) {
+		printf("Unsupported audio rate %u !\n", rate);
+		goto error_rate;
+	}
+
+	audio = malloc(sizeof(snes_audio_t));
+	if(audio == NULL) {
+		printf("Unable to alloc audio sink !\n");
+		goto error_alloc;
+	}
+	memset(audio, 0, sizeof(snes_audio_t));
+	audio->format = format;
+	audio->rate = rate ? rate : SNES_APU_DSP_RATE;
+
+	if(rate != 0) {
+		audio->resampler = snes_audio_resampler_init(rate);
+		if(audio->resampler == NULL) {
+			printf("Unable to init the resampler !\n");
+			goto error_resampler;
+		}
+		//At most one more output than the exact ratio
+		resampled_frames = SNES_AUDIO_BUFFER_FRAMES * audio->resampler->up / audio->resampler->down + 1;
+	}
+
+	audio->buffers[0] = malloc(SNES_AUDIO_BUFFER_FRAMES * 4);
+	audio->buffers[1] = malloc(SNES_AUDIO_BUFFER_FRAMES * 4);
+	audio->resampled = malloc(resampled_frames * 4);
+	audio->bytes = malloc(resampled_frames * 4);
+	if(audio->buffers[0] == NULL || audio->buffers[1] == NULL ||
+	   audio->resampled == NULL || audio->bytes == NULL) {
+		printf("Unable to alloc audio buffers !\n");
+		goto error_buffers;
+	}
+
+	audio->file = fopen(path, "wb");
+	if(audio->file == NULL) {
+		printf("Unable to open audio file %s !\n", path);
+		goto error_file;
+	}
+	if(format == SNES_AUDIO_FORMAT_WAV && snes_audio_write_header(audio) < 0) {
+		printf("Unable to write the audio file !\n");
+		goto error_header;
+	}
+
+	pthread_mutex_init(&audio->lock, NULL);
+	pthread_cond_init(&audio->cond, NULL);
+	if(pthread_create(&audio->thread, NULL, snes_audio_writer, audio) != 0) {
+		printf("Unable to start the audio writer !\n");
+		goto error_thread;
+	}
+
+	return audio;
+
+error_thread:
+	pthread_cond_destroy(&audio->cond);
+	pthread_mutex_destroy(&audio->lock);
+error_header:
+	fclose(audio->file);
+error_file:
+error_buffers:
+	free(audio->bytes);
+	free(audio->resampled);
+	free(audio->buffers[1]);
+	free(audio->buffers[0]);
+	if(audio->resampler != NULL)
+		snes_audio_resampler_destroy(audio->resampler);
+error_resampler:
+	free(audio);
+error_alloc:
+error_rate:
+	return NULL;
+}
+
+void snes_audio_destroy(snes_audio_t *audio)
+{
+	int16_t silence[SNES_AUDIO_TAPS] = { 0 }; //Stereo, SNES_AUDIO_TAPS / 2 frames
+
+	//Pushes out the frames still in the resampler's window
+	if(audio->resampler != NULL)
+		snes_audio_write(audio, silence, SNES_AUDIO_TAPS / 2);
+	if(audio->counts[audio->current] > 0)
+		snes_audio_hand_over(audio);
+
+	pthread_mutex_lock(&audio->lock);
+	audio->stop = 1;
+	pthread_cond_broadcast(&audio->cond);
+	pthread_mutex_unlock(&audio->lock);
+	pthread_join(audio->thread, NULL);
+
+	if(audio->format == SNES_AUDIO_FORMAT_WAV && !snes_audio_get_error(audio)) {
+		if(fseek(audio->file, 0, SEEK_SET) != 0 || snes_audio_write_header(audio) < 0)
+			printf("Unable to complete the WAV header !\n");
+	}
+	fclose(audio->file);
+
+	pthread_cond_destroy(&audio->cond);
+	pthread_mutex_destroy(&audio->lock);
+	free(audio->bytes);
+	free(audio->resampled);
+	free(audio->buffers[1]);
+	free(audio->buffers[0]);
+	if(audio->resampler != NULL)
+		snes_audio_resampler_destroy(audio->resampler);
+	free(audio);
+}
+
+int snes_audio_write(snes_audio_t *audio, const int16_t *frames, uint32_t count)
+{
+	uint32_t room;
+
+	while(count > 0) {
+		room = SNES_AUDIO_BUFFER_FRAMES - audio->counts[audio->current];
+		if(room > count)
+			room = count;
+		memcpy(audio->buffers[audio->current] + audio->counts[audio->current] * 2, frames, room * 4);
+		audio->counts[audio->current] += room;
+		frames += room * 2;
+		count -= room;
+		if(audio->counts[audio->current] == SNES_AUDIO_BUFFER_FRAMES)
+			snes_audio_hand_over(audio);
+	}
+	return snes_audio_get_error(audio) ? -1 : 0;
+}
+
+uint64_t snes_audio_get_frames(snes_audio_t *audio)
+{
+	uint64_t frames;
+
+	pthread_mutex_lock(&audio->lock);
+	frames = audio->frames;
+	pthread_mutex_unlock(&audio->lock);
+	return frames;
+}
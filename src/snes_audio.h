@@ -0,0 +1,28 @@
+#ifndef SNES_AUDIO_H
+#define SNES_AUDIO_H
+
+#include <stdint.h>
+
+/*
+ * Headless audio sink : the APU's 32kHz stereo frames are streamed to a file
+ * by a writer thread. The frames are gathered in one of two buffers while the
+ * thread writes the other, the emulation only waits if the disk can't keep up.
+ */
+typedef struct _snes_audio snes_audio_t;
+
+typedef enum _snes_audio_format {
+	SNES_AUDIO_FORMAT_WAV,
+	SNES_AUDIO_FORMAT_RAW, //Left/right signed 16 bits little endian samples
+} snes_audio_format_t;
+
+/*rate 0 keeps 32kHz, 44100 and 48000 go through a windowed sinc resampler*/
+snes_audio_t *snes_audio_init(const char *path, snes_audio_format_t format, uint32_t rate);
+/*Writes the last frames and completes the WAV header*/
+void snes_audio_destroy(snes_audio_t *audio);
+
+/*Takes count left/right pairs, returns -1 once a write failed*/
+int snes_audio_write(snes_audio_t *audio, const int16_t *frames, uint32_t count);
+/*Frames written to the file so far, at the output rate*/
+uint64_t snes_audio_get_frames(snes_audio_t *audio);
+
+#endif //SNES_AUDIO_H
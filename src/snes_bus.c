@@ -1,16 +1,159 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "snes_bus.h"
 #include "snes_addrdecoder.h"
+#include "snes_dma.h"
+
+#define likely(x)       __builtin_expect((x),1)
+#define unlikely(x)     __builtin_expect((x),0)
 
 struct _snes_bus{
 	snes_cart_t *cart;
 	snes_ram_t *wram;
 	snes_apu_t *apu;
+	snes_irq_t *irq;
+	snes_ppu_t *ppu;
+	snes_dma_t *dma;
+	uint32_t wram_port; //WMADD ($2181-$2183), 17 bits
+	/*Direct host pointers per page, NULL means the slow path must be used*/
+	const uint8_t *read_map[SNES_ADDRDECODER_PAGE_COUNT];
+	uint8_t *write_map[SNES_ADDRDECODER_PAGE_COUNT];
+	/*Same maps with the instrumented pages, NULL for MMIO*/
+	const uint8_t *read_host[SNES_ADDRDECODER_PAGE_COUNT];
+	uint8_t *write_host[SNES_ADDRDECODER_PAGE_COUNT];
+	/*Watchpoints, the pages they cover are instrumented (left to the slow path)*/
+	snes_bus_watchpoint_t watchpoints[SNES_BUS_MAX_WATCHPOINTS];
+	uint32_t watchpoint_count;
+	uint8_t watch_map[SNES_ADDRDECODER_PAGE_COUNT]; //SNES_BUS_WATCH_* of the page
+	snes_bus_watch_hit_t watch_hit;
+	/*Pages holding decoded instructions, writes into them bump the generation*/
+	uint8_t code_map[SNES_ADDRDECODER_PAGE_COUNT];
+	uint32_t code_generation;
+	/*Pages read by the HDMA tables, writes into them are reported to the DMA*/
+	uint8_t table_map[SNES_ADDRDECODER_PAGE_COUNT];
+	uint32_t table_pages;
+	/*Master cycles spent above SNES_BUS_FAST_CYCLES per access*/
+	uint8_t wait_map[SNES_ADDRDECODER_PAGE_COUNT];
+	uint64_t cycles; //Master clock, advanced by the CPU and the wait states
+	uint8_t fastrom; //MEMSEL ($420D) bit 0
+	/*Dry run : accesses reaching the other chips are dropped and noted*/
+	uint8_t dry_run;
+	uint8_t dry_run_dropped;
 };
 
-snes_bus_t *snes_bus_init(snes_cart_t *cart, snes_ram_t *wram, snes_apu_t *apu)
+//Region speeds, from the S-CPU memory map
+static uint8_t snes_bus_access_cycles(uint8_t fastrom, uint32_t addr)
+{
+	if(addr & 0x408000) {
+		//ROM areas, banks 0x80-0xFF follow MEMSEL
+		if((addr & 0x800000) && fastrom)
+			return 6;
+		return 8;
+	}
+	//0x0000-0x1FFF (WRAM) and 0x6000-0x7FFF
+	if((addr + 0x6000) & 0x4000)
+		return 8;
+	//0x4000-0x41FF (joypad serial ports)
+	if(((addr - 0x4000) & 0x7E00) == 0)
+		return 12;
+	return 6;
+}
+
+static void snes_bus_init_wait_map(snes_bus_t *bus)
+{
+	uint32_t page;
+
+	//Pages mixing speeds are MMIO and always take the slow path
+	for(page = 0; page < SNES_ADDRDECODER_PAGE_COUNT; page++)
+		bus->wait_map[page] = snes_bus_access_cycles(bus->fastrom, page << SNES_ADDRDECODER_PAGE_SHIFT) - SNES_BUS_FAST_CYCLES;
+}
+
+//Instrumented pages go through the slow path, in the needed directions only
+static void snes_bus_update_maps(snes_bus_t *bus)
+{
+	uint32_t page;
+
+	for(page = 0; page < SNES_ADDRDECODER_PAGE_COUNT; page++) {
+		bus->read_map[page] = (bus->watch_map[page] & SNES_BUS_WATCH_READ) ? NULL : bus->read_host[page];
+		bus->write_map[page] = ((bus->watch_map[page] & SNES_BUS_WATCH_WRITE) || bus->table_map[page]) ?
+							   NULL : bus->write_host[page];
+	}
+}
+
+static uint8_t *snes_bus_page_host_ptr(uint8_t *data, uint32_t size, uint32_t dec_addr)
+{
+	if(data == NULL || size < SNES_ADDRDECODER_PAGE_SIZE || size % SNES_ADDRDECODER_PAGE_SIZE)
+		return NULL;
+	//Memories are mirrored when the decoded address is out of range
+	return data + (dec_addr % size);
+}
+
+static void snes_bus_init_maps(snes_bus_t *bus)
+{
+	snes_address_decoder_t *decoder = snes_cart_get_decoder(bus->cart);
+	snes_rom_t *rom = snes_cart_get_rom(bus->cart);
+	snes_ram_t *sram = snes_cart_get_ram(bus->cart);
+	uint32_t page;
+
+	for(page = 0; page < SNES_ADDRDECODER_PAGE_COUNT; page++) {
+		const snes_address_page_t *desc = snes_addrdecoder_get_page(decoder, page);
+
+		bus->read_host[page] = NULL;
+		bus->write_host[page] = NULL;
+		bus->code_map[page] = 0;
+		bus->watch_map[page] = 0;
+		bus->table_map[page] = 0;
+		if(!desc->linear)
+			continue;
+
+		switch(desc->base.type) {
+			case ROM:
+				bus->read_host[page] = snes_bus_page_host_ptr((uint8_t *)snes_rom_get_data(rom),
+															 snes_rom_get_size(rom),
+															 desc->base.dec_addr);
+				break;
+			case SRAM:
+				bus->write_host[page] = snes_bus_page_host_ptr(snes_ram_get_data(sram),
+															  snes_ram_get_size(sram),
+															  desc->base.dec_addr);
+				bus->read_host[page] = bus->write_host[page];
+				break;
+			case WRAM:
+				bus->write_host[page] = snes_bus_page_host_ptr(snes_ram_get_data(bus->wram),
+															  snes_ram_get_size(bus->wram),
+															  desc->base.dec_addr);
+				bus->read_host[page] = bus->write_host[page];
+				break;
+			default:
+				break;
+		}
+	}
+	snes_bus_update_maps(bus);
+}
+
+//The low RAM of every system bank must be the first 8KB of the WRAM
+static int snes_bus_check_low_ram(snes_bus_t *bus)
+{
+	uint8_t *wram = snes_ram_get_data(bus->wram);
+	uint32_t bank;
+	uint32_t offset;
+
+	for(bank = 0; bank < 0x100; bank++) {
+		if((bank & 0x7F) > 0x3F)
+			continue;
+		for(offset = 0; offset < 0x2000; offset += SNES_ADDRDECODER_PAGE_SIZE) {
+			if(bus->read_host[((bank << 16) | offset) >> SNES_ADDRDECODER_PAGE_SHIFT] != wram + offset) {
+				printf("Low RAM mirror at 0x%02X%04X misplaced !\n", bank, offset);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+snes_bus_t *snes_bus_init(snes_cart_t *cart, snes_ram_t *wram, snes_apu_t *apu, snes_irq_t *irq, snes_ppu_t *ppu)
 {
 	snes_bus_t *bus = malloc(sizeof(snes_bus_t));
 	if(bus == NULL) {
@@ -22,8 +165,9 @@ snes_bus_t *snes_bus_init(snes_cart_t *cart, snes_ram_t *wram, snes_apu_t *apu)
 		goto error_input;
 	}
 
+	//The decoded WRAM addresses are used unchecked
 	bus->wram = wram;
-	if(bus->wram == NULL) {
+	if(bus->wram == NULL || snes_ram_get_size(bus->wram) != SNES_BUS_WRAM_SIZE) {
 		goto error_input;
 	}
 
@@ -32,8 +176,40 @@ snes_bus_t *snes_bus_init(snes_cart_t *cart, snes_ram_t *wram, snes_apu_t *apu)
 		goto error_input;
 	}
 
+	bus->irq = irq;
+	if(bus->irq == NULL) {
+		goto error_input;
+	}
+
+	bus->ppu = ppu;
+	if(bus->ppu == NULL) {
+		goto error_input;
+	}
+
+	bus->dma = snes_dma_init(bus);
+	if(bus->dma == NULL) {
+		goto error_input;
+	}
+	bus->wram_port = 0;
+
+	bus->code_generation = 0;
+	bus->table_pages = 0;
+	bus->watchpoint_count = 0;
+	bus->watch_hit.type = 0;
+	snes_bus_init_maps(bus);
+	if(snes_bus_check_low_ram(bus) < 0) {
+		goto error_maps;
+	}
+	bus->cycles = 0;
+	bus->fastrom = 0;
+	bus->dry_run = 0;
+	bus->dry_run_dropped = 0;
+	snes_bus_init_wait_map(bus);
+
 	return bus;
 
+error_maps:
+	snes_dma_destroy(bus->dma);
 error_input:
 	free(bus);
 error_alloc:
@@ -45,58 +221,183 @@ void snes_bus_destroy(snes_bus_t *bus)
 	bus->cart = NULL;
 	bus->wram = NULL;
 	bus->apu = NULL;
+	bus->irq = NULL;
+	bus->ppu = NULL;
+	snes_dma_destroy(bus->dma);
 	free(bus);
 }
 
-uint8_t snes_bus_read(snes_bus_t *bus, uint32_t addr)
+//Registers and memories without host pointers
+//B bus areas
+#define SNES_BUS_B_APU 0x40
+#define SNES_BUS_B_WMDATA 0x80
+#define SNES_BUS_B_WMADDL 0x81
+#define SNES_BUS_B_WMADDM 0x82
+#define SNES_BUS_B_WMADDH 0x83
+//WRAM as seen in banks $7E-$7F, for the decoded code tracking
+#define SNES_BUS_WRAM_BASE 0x7E0000
+
+//A write through the WRAM port may hit decoded code or HDMA tables, called before the write
+static void snes_bus_wram_port_write_check(snes_bus_t *bus, uint32_t offset, uint32_t len)
+{
+	uint32_t page;
+	uint32_t last = (offset + len - 1) >> SNES_ADDRDECODER_PAGE_SHIFT;
+
+	for(page = offset >> SNES_ADDRDECODER_PAGE_SHIFT; page <= last; page++) {
+		if(bus->table_map[(SNES_BUS_WRAM_BASE >> SNES_ADDRDECODER_PAGE_SHIFT) + page]) {
+			snes_dma_table_written(bus->dma);
+			break;
+		}
+	}
+	for(page = offset >> SNES_ADDRDECODER_PAGE_SHIFT; page <= last; page++) {
+		if(bus->code_map[(SNES_BUS_WRAM_BASE >> SNES_ADDRDECODER_PAGE_SHIFT) + page]) {
+			bus->code_generation++;
+			return;
+		}
+	}
+}
+
+uint8_t snes_bus_read_b(snes_bus_t *bus, uint8_t address)
+{
+	uint8_t data;
+
+	if(address < SNES_BUS_B_APU)
+		return snes_ppu_read(bus->ppu, address);
+	if(address < SNES_BUS_B_WMDATA) {
+		snes_apu_catch_up(bus->apu, bus->cycles);
+		return snes_apu_port_read(snes_apu_get_port(bus->apu), address);
+	}
+	if(address == SNES_BUS_B_WMDATA) {
+		data = snes_ram_read(bus->wram, bus->wram_port);
+		bus->wram_port = (bus->wram_port + 1) % SNES_BUS_WRAM_SIZE;
+		return data;
+	}
+	//WMADD is write only, the rest isn't connected
+	return 0;
+}
+
+void snes_bus_write_b(snes_bus_t *bus, uint8_t address, uint8_t data)
+{
+	if(address < SNES_BUS_B_APU) {
+		snes_ppu_write(bus->ppu, address, data);
+		return;
+	}
+	if(address < SNES_BUS_B_WMDATA) {
+		snes_apu_catch_up(bus->apu, bus->cycles);
+		snes_apu_port_write(snes_apu_get_port(bus->apu), address, data);
+		return;
+	}
+	switch(address) {
+		case SNES_BUS_B_WMDATA:
+			snes_bus_wram_port_write_check(bus, bus->wram_port, 1);
+			snes_ram_write(bus->wram, bus->wram_port, data);
+			bus->wram_port = (bus->wram_port + 1) % SNES_BUS_WRAM_SIZE;
+			break;
+		case SNES_BUS_B_WMADDL:
+			bus->wram_port = (bus->wram_port & 0x1FF00) | data;
+			break;
+		case SNES_BUS_B_WMADDM:
+			bus->wram_port = (bus->wram_port & 0x100FF) | (data << 8);
+			break;
+		case SNES_BUS_B_WMADDH:
+			bus->wram_port = (bus->wram_port & 0x0FFFF) | ((data & 1) << 16);
+			break;
+		default:
+			break;
+	}
+}
+
+uint32_t snes_bus_write_b_block(snes_bus_t *bus, uint8_t address, uint8_t pair, const uint8_t *data, uint32_t len)
+{
+	uint32_t done = 0;
+	uint32_t chunk;
+
+	if(address < SNES_BUS_B_APU)
+		return snes_ppu_write_block(bus->ppu, address, pair, data, len);
+	if(address != SNES_BUS_B_WMDATA || pair)
+		return 0;
+	while(done < len) {
+		chunk = len - done;
+		if(chunk > SNES_BUS_WRAM_SIZE - bus->wram_port)
+			chunk = SNES_BUS_WRAM_SIZE - bus->wram_port;
+		snes_bus_wram_port_write_check(bus, bus->wram_port, chunk);
+		memcpy(snes_ram_get_data(bus->wram) + bus->wram_port, data + done, chunk);
+		bus->wram_port = (bus->wram_port + chunk) % SNES_BUS_WRAM_SIZE;
+		done += chunk;
+	}
+	return done;
+}
+
+const uint8_t *snes_bus_get_read_ptr(snes_bus_t *bus, uint32_t address)
+{
+	const uint8_t *page = bus->read_map[(address & 0xFFFFFF) >> SNES_ADDRDECODER_PAGE_SHIFT];
+
+	if(page == NULL)
+		return NULL;
+	return page + (address & SNES_ADDRDECODER_PAGE_MASK);
+}
+
+static uint8_t snes_bus_read_io(snes_bus_t *bus, uint32_t addr)
 {
 	snes_address_decoder_t *decoder = snes_cart_get_decoder(bus->cart);
-	snes_address_t *address = snes_addrdecoder_decode(decoder, addr);
-	enum snes_memtype type = snes_addrdecoder_get_memtype(address);
+	snes_address_t address = snes_addrdecoder_decode(decoder, addr);
 	uint8_t data = 0;
-	uint32_t translated_addr = snes_addrdecoder_get_transaddr(address);
-	switch(type) {
+
+	bus->cycles += snes_bus_access_cycles(bus->fastrom, addr) - SNES_BUS_FAST_CYCLES;
+	switch(address.type) {
 		case ROM :
 		{
 			snes_rom_t *rom = snes_cart_get_rom(bus->cart);
-			data = snes_rom_read(rom,translated_addr);
+			data = snes_rom_read(rom, address.dec_addr % snes_rom_get_size(rom));
 			break;
 		}
 		case SRAM:
 		{
 			snes_ram_t *sram = snes_cart_get_ram(bus->cart);
-			data = snes_ram_read(sram,translated_addr);
+			data = snes_ram_read(sram, address.dec_addr % snes_ram_get_size(sram));
 			break;
 		}
 		case WRAM:
 		{
-			data = snes_ram_read(bus->wram,translated_addr);
+			data = snes_ram_read(bus->wram, address.dec_addr);
 			break;
 		}
 		case PPU1_APU:
 		{
-			data = snes_apu_port_read(snes_apu_get_port(bus->apu), translated_addr);
+			snes_bus_video_catch_up(bus);
+			data = snes_bus_read_b(bus, address.dec_addr);
+			break;
+		}
+		case PPU2_DMA:
+		{
+			if(snes_irq_is_register(addr & 0xFFFF)) {
+				data = snes_irq_read(bus->irq, addr & 0xFFFF, bus->cycles);
+				break;
+			}
+			if(snes_dma_is_register(addr & 0xFFFF)) {
+				data = snes_dma_read(bus->dma, addr & 0xFFFF);
+				break;
+			}
+			printf("snes_bus : register 0x%04X not handled in read\n", addr & 0xFFFF);
 			break;
 		}
 		default:
 		{
-			printf("snes_bus : addr type (%d) not handled in read (addr = 0x%06X)!)\n",type,addr);
+			printf("snes_bus : addr type (%d) not handled in read (addr = 0x%06X)!)\n",address.type,addr);
 			break;
 		}
 	}
 
-	snes_addrdecoder_destroy_adress(address);
 	return data;
 }
 
-void snes_bus_write(snes_bus_t *bus, uint32_t addr, uint8_t data)
+static void snes_bus_write_io(snes_bus_t *bus, uint32_t addr, uint8_t data)
 {
 	snes_address_decoder_t *decoder = snes_cart_get_decoder(bus->cart);
-	snes_address_t *address = snes_addrdecoder_decode(decoder, addr);
-	enum snes_memtype type = snes_addrdecoder_get_memtype(address);
-	uint32_t translated_addr = snes_addrdecoder_get_transaddr(address);
+	snes_address_t address = snes_addrdecoder_decode(decoder, addr);
 
-	switch(type) {
+	bus->cycles += snes_bus_access_cycles(bus->fastrom, addr) - SNES_BUS_FAST_CYCLES;
+	switch(address.type) {
 		case ROM :
 		{
 			printf("Cant write ROM!!\n");
@@ -105,25 +406,415 @@ void snes_bus_write(snes_bus_t *bus, uint32_t addr, uint8_t data)
 		case SRAM:
 		{
 			snes_ram_t *sram = snes_cart_get_ram(bus->cart);
-			snes_ram_write(sram,translated_addr,data);
+			snes_ram_write(sram, address.dec_addr % snes_ram_get_size(sram), data);
 			break;
 		}
 		case WRAM:
 		{
-			snes_ram_write(bus->wram,translated_addr,data);
+			snes_ram_write(bus->wram, address.dec_addr, data);
 			break;
 		}
 		case PPU1_APU:
 		{
-			//printf("Writing to APU : translated_addr = 0x%x addr = 0x%06X; data = 0x%4X\n",translated_addr,addr,data);
-			snes_apu_port_write(snes_apu_get_port(bus->apu), translated_addr, data);
+			snes_bus_video_catch_up(bus);
+			snes_bus_write_b(bus, address.dec_addr, data);
+			break;
+		}
+		case PPU2_DMA:
+		{
+			//MEMSEL
+			if((addr & 0xFFFF) == 0x420D) {
+				bus->fastrom = data & 1;
+				snes_bus_init_wait_map(bus);
+				break;
+			}
+			if(snes_irq_is_register(addr & 0xFFFF)) {
+				snes_irq_write(bus->irq, addr & 0xFFFF, data, bus->cycles);
+				break;
+			}
+			if(snes_dma_is_register(addr & 0xFFFF)) {
+				snes_dma_write(bus->dma, addr & 0xFFFF, data);
+				break;
+			}
+			printf("snes_bus : register 0x%04X not handled in write (data = 0x%02X)\n", addr & 0xFFFF, data);
 			break;
 		}
 		default:
 		{
-			printf("snes_bus : addr type (%d) not handled in write (addr = 0x%06X; data = 0x%4X!)\n",type,addr,data);
+			printf("snes_bus : addr type (%d) not handled in write (addr = 0x%06X; data = 0x%4X!)\n",address.type,addr,data);
 			break;
 		}
 	}
-	snes_addrdecoder_destroy_adress(address);
+}
+
+static void snes_bus_watch(snes_bus_t *bus, uint8_t type, uint32_t addr, uint8_t data)
+{
+	snes_bus_watchpoint_t *watchpoint;
+	uint32_t i;
+
+	for(i = 0; i < bus->watchpoint_count; i++) {
+		watchpoint = &bus->watchpoints[i];
+		if(!(watchpoint->type & type) || addr < watchpoint->start || addr > watchpoint->end)
+			continue;
+		if(watchpoint->value >= 0 && watchpoint->value != data)
+			continue;
+		//Only the first hit is kept until the debugger clears it
+		if(bus->watch_hit.type == 0) {
+			bus->watch_hit.type = type;
+			bus->watch_hit.address = addr;
+			bus->watch_hit.value = data;
+		}
+		return;
+	}
+}
+
+static uint8_t snes_bus_read_slow(snes_bus_t *bus, uint32_t addr, uint8_t watch)
+{
+	uint32_t page = addr >> SNES_ADDRDECODER_PAGE_SHIFT;
+	uint8_t data;
+
+	if(bus->read_host[page] != NULL) {
+		bus->cycles += bus->wait_map[page];
+		data = bus->read_host[page][addr & SNES_ADDRDECODER_PAGE_MASK];
+	} else if(bus->dry_run) {
+		bus->dry_run_dropped = 1;
+		data = 0;
+	} else {
+		data = snes_bus_read_io(bus, addr);
+	}
+	if(watch && (bus->watch_map[page] & SNES_BUS_WATCH_READ))
+		snes_bus_watch(bus, SNES_BUS_WATCH_READ, addr, data);
+	return data;
+}
+
+static void snes_bus_write_slow(snes_bus_t *bus, uint32_t addr, uint8_t data)
+{
+	uint32_t page = addr >> SNES_ADDRDECODER_PAGE_SHIFT;
+
+	if(bus->write_host[page] != NULL) {
+		bus->cycles += bus->wait_map[page];
+		if(bus->table_map[page]) {
+			if(bus->dry_run)
+				bus->dry_run_dropped = 1;
+			else
+				snes_dma_table_written(bus->dma);
+		}
+		bus->write_host[page][addr & SNES_ADDRDECODER_PAGE_MASK] = data;
+		if(bus->code_map[page])
+			bus->code_generation++;
+	} else if(bus->dry_run) {
+		bus->dry_run_dropped = 1;
+	} else {
+		snes_bus_write_io(bus, addr, data);
+	}
+	if(bus->watch_map[page] & SNES_BUS_WATCH_WRITE)
+		snes_bus_watch(bus, SNES_BUS_WATCH_WRITE, addr, data);
+}
+
+uint8_t snes_bus_read(snes_bus_t *bus, uint32_t addr)
+{
+	const uint8_t *page;
+
+	addr &= 0xFFFFFF;
+	page = bus->read_map[addr >> SNES_ADDRDECODER_PAGE_SHIFT];
+	if(likely(page != NULL)) {
+		bus->cycles += bus->wait_map[addr >> SNES_ADDRDECODER_PAGE_SHIFT];
+		return page[addr & SNES_ADDRDECODER_PAGE_MASK];
+	}
+	return snes_bus_read_slow(bus, addr, 1);
+}
+
+uint8_t snes_bus_fetch(snes_bus_t *bus, uint32_t addr)
+{
+	const uint8_t *page;
+
+	addr &= 0xFFFFFF;
+	page = bus->read_map[addr >> SNES_ADDRDECODER_PAGE_SHIFT];
+	if(likely(page != NULL)) {
+		bus->cycles += bus->wait_map[addr >> SNES_ADDRDECODER_PAGE_SHIFT];
+		return page[addr & SNES_ADDRDECODER_PAGE_MASK];
+	}
+	return snes_bus_read_slow(bus, addr, 0);
+}
+
+void snes_bus_write(snes_bus_t *bus, uint32_t addr, uint8_t data)
+{
+	uint8_t *page;
+
+	addr &= 0xFFFFFF;
+	page = bus->write_map[addr >> SNES_ADDRDECODER_PAGE_SHIFT];
+	if(likely(page != NULL)) {
+		bus->cycles += bus->wait_map[addr >> SNES_ADDRDECODER_PAGE_SHIFT];
+		page[addr & SNES_ADDRDECODER_PAGE_MASK] = data;
+		if(unlikely(bus->code_map[addr >> SNES_ADDRDECODER_PAGE_SHIFT]))
+			bus->code_generation++;
+		return;
+	}
+	snes_bus_write_slow(bus, addr, data);
+}
+
+//Bytes from addr to the end of its page in the copy direction
+static uint32_t snes_bus_page_left(uint32_t addr, int step)
+{
+	if(step > 0)
+		return SNES_ADDRDECODER_PAGE_SIZE - (addr & SNES_ADDRDECODER_PAGE_MASK);
+	return (addr & SNES_ADDRDECODER_PAGE_MASK) + 1;
+}
+
+void snes_bus_copy(snes_bus_t *bus, uint32_t dest, uint32_t src, uint32_t len, int step)
+{
+	const uint8_t *src_data;
+	uint8_t *dest_data;
+	uint32_t chunk;
+	uint32_t i;
+
+	while(len > 0) {
+		src &= 0xFFFFFF;
+		dest &= 0xFFFFFF;
+		chunk = len;
+		if(chunk > snes_bus_page_left(src, step))
+			chunk = snes_bus_page_left(src, step);
+		if(chunk > snes_bus_page_left(dest, step))
+			chunk = snes_bus_page_left(dest, step);
+
+		src_data = bus->read_map[src >> SNES_ADDRDECODER_PAGE_SHIFT];
+		dest_data = bus->write_map[dest >> SNES_ADDRDECODER_PAGE_SHIFT];
+		if(src_data != NULL && dest_data != NULL) {
+			//Lowest addresses of both ranges
+			src_data += (step > 0 ? src : src - chunk + 1) & SNES_ADDRDECODER_PAGE_MASK;
+			dest_data += (step > 0 ? dest : dest - chunk + 1) & SNES_ADDRDECODER_PAGE_MASK;
+			//memmove only differs when the destination is ahead in the copy direction
+			if(step > 0 && dest_data > src_data && dest_data < src_data + chunk) {
+				for(i = 0; i < chunk; i++)
+					dest_data[i] = src_data[i];
+			} else if(step < 0 && dest_data < src_data && dest_data + chunk > src_data) {
+				for(i = chunk; i > 0; i--)
+					dest_data[i - 1] = src_data[i - 1];
+			} else {
+				memmove(dest_data, src_data, chunk);
+			}
+			bus->cycles += chunk * (bus->wait_map[src >> SNES_ADDRDECODER_PAGE_SHIFT] +
+										 bus->wait_map[dest >> SNES_ADDRDECODER_PAGE_SHIFT]);
+			if(bus->code_map[dest >> SNES_ADDRDECODER_PAGE_SHIFT])
+				bus->code_generation++;
+		} else {
+			//MMIO on either side, go through the registers
+			for(i = 0; i < chunk; i++)
+				snes_bus_write(bus, dest + i * step, snes_bus_read(bus, src + i * step));
+		}
+		src += chunk * step;
+		dest += chunk * step;
+		len -= chunk;
+	}
+}
+
+void snes_bus_start_dry_run(snes_bus_t *bus)
+{
+	bus->dry_run = 1;
+	bus->dry_run_dropped = 0;
+}
+
+int snes_bus_end_dry_run(snes_bus_t *bus)
+{
+	bus->dry_run = 0;
+	return bus->dry_run_dropped;
+}
+
+void snes_bus_video_catch_up(snes_bus_t *bus)
+{
+	uint64_t event;
+
+	//A line is rendered before the HDMA of its hblank
+	while((event = snes_dma_next_event(bus->dma)) <= bus->cycles) {
+		snes_ppu_catch_up(bus->ppu, event);
+		snes_dma_catch_up(bus->dma, event);
+	}
+	snes_ppu_catch_up(bus->ppu, bus->cycles);
+}
+
+void snes_bus_catch_up(snes_bus_t *bus)
+{
+	snes_bus_video_catch_up(bus);
+	snes_apu_catch_up(bus->apu, bus->cycles);
+}
+
+snes_ram_t *snes_bus_get_wram(snes_bus_t *bus)
+{
+	return bus->wram;
+}
+
+snes_irq_t *snes_bus_get_irq(snes_bus_t *bus)
+{
+	return bus->irq;
+}
+
+snes_apu_t *snes_bus_get_apu(snes_bus_t *bus)
+{
+	return bus->apu;
+}
+
+snes_ppu_t *snes_bus_get_ppu(snes_bus_t *bus)
+{
+	return bus->ppu;
+}
+
+int snes_bus_is_memory(snes_bus_t *bus, uint32_t addr)
+{
+	return bus->read_host[(addr & 0xFFFFFF) >> SNES_ADDRDECODER_PAGE_SHIFT] != NULL;
+}
+
+int snes_bus_watch_code(snes_bus_t *bus, uint32_t addr)
+{
+	uint32_t page = (addr & 0xFFFFFF) >> SNES_ADDRDECODER_PAGE_SHIFT;
+	uint32_t i;
+
+	if(bus->read_host[page] == NULL)
+		return -1;
+	if(bus->write_host[page] == NULL)
+		return 0;
+	if(bus->code_map[page])
+		return 1;
+
+	//Watch all the mirrors of this memory page
+	for(i = 0; i < SNES_ADDRDECODER_PAGE_COUNT; i++) {
+		if(bus->write_host[i] == bus->write_host[page])
+			bus->code_map[i] = 1;
+	}
+	return 1;
+}
+
+uint32_t snes_bus_get_code_generation(snes_bus_t *bus)
+{
+	return bus->code_generation;
+}
+
+void snes_bus_watch_table(snes_bus_t *bus, uint32_t addr)
+{
+	uint32_t page = (addr & 0xFFFFFF) >> SNES_ADDRDECODER_PAGE_SHIFT;
+	uint32_t i;
+
+	if(bus->write_host[page] == NULL || bus->table_map[page])
+		return;
+	//All the mirrors of the page leave the fast path
+	for(i = 0; i < SNES_ADDRDECODER_PAGE_COUNT; i++) {
+		if(bus->write_host[i] == bus->write_host[page]) {
+			bus->table_map[i] = 1;
+			bus->write_map[i] = NULL;
+			bus->table_pages++;
+		}
+	}
+}
+
+void snes_bus_clear_tables(snes_bus_t *bus)
+{
+	if(bus->table_pages == 0)
+		return;
+	memset(bus->table_map, 0, sizeof(bus->table_map));
+	bus->table_pages = 0;
+	snes_bus_update_maps(bus);
+}
+
+uint8_t snes_bus_get_access_cycles(snes_bus_t *bus, uint32_t addr)
+{
+	return snes_bus_access_cycles(bus->fastrom, addr & 0xFFFFFF);
+}
+
+uint8_t snes_bus_get_fastrom(snes_bus_t *bus)
+{
+	return bus->fastrom;
+}
+
+uint64_t snes_bus_get_cycles(snes_bus_t *bus)
+{
+	return bus->cycles;
+}
+
+void snes_bus_set_cycles(snes_bus_t *bus, uint64_t cycles)
+{
+	bus->cycles = cycles;
+}
+
+uint64_t *snes_bus_get_clock(snes_bus_t *bus)
+{
+	return &bus->cycles;
+}
+
+static void snes_bus_update_watch_map(snes_bus_t *bus)
+{
+	snes_bus_watchpoint_t *watchpoint;
+	uint32_t page;
+	uint32_t i;
+
+	memset(bus->watch_map, 0, sizeof(bus->watch_map));
+	for(i = 0; i < bus->watchpoint_count; i++) {
+		watchpoint = &bus->watchpoints[i];
+		for(page = watchpoint->start >> SNES_ADDRDECODER_PAGE_SHIFT;
+			page <= watchpoint->end >> SNES_ADDRDECODER_PAGE_SHIFT; page++)
+			bus->watch_map[page] |= watchpoint->type;
+	}
+	snes_bus_update_maps(bus);
+}
+
+int snes_bus_add_watchpoint(snes_bus_t *bus, uint8_t type, uint32_t start, uint32_t end, int16_t value)
+{
+	snes_bus_watchpoint_t *watchpoint;
+
+	start &= 0xFFFFFF;
+	end &= 0xFFFFFF;
+	if(bus->watchpoint_count >= SNES_BUS_MAX_WATCHPOINTS || end < start ||
+	   !(type & (SNES_BUS_WATCH_READ | SNES_BUS_WATCH_WRITE)))
+		return -1;
+
+	watchpoint = &bus->watchpoints[bus->watchpoint_count];
+	watchpoint->type = type & (SNES_BUS_WATCH_READ | SNES_BUS_WATCH_WRITE);
+	watchpoint->start = start;
+	watchpoint->end = end;
+	watchpoint->value = value < 0 ? -1 : (value & 0xFF);
+	bus->watchpoint_count++;
+	snes_bus_update_watch_map(bus);
+	return 0;
+}
+
+int snes_bus_remove_watchpoint(snes_bus_t *bus, uint8_t type, uint32_t start)
+{
+	uint32_t i;
+
+	start &= 0xFFFFFF;
+	for(i = 0; i < bus->watchpoint_count; i++) {
+		if(bus->watchpoints[i].start == start && (bus->watchpoints[i].type & type))
+			break;
+	}
+	if(i == bus->watchpoint_count)
+		return -1;
+
+	memmove(&bus->watchpoints[i], &bus->watchpoints[i + 1],
+			(bus->watchpoint_count - i - 1) * sizeof(snes_bus_watchpoint_t));
+	bus->watchpoint_count--;
+	snes_bus_update_watch_map(bus);
+	return 0;
+}
+
+uint32_t snes_bus_get_watchpoints(snes_bus_t *bus, snes_bus_watchpoint_t *watchpoints, uint32_t max)
+{
+	uint32_t count = bus->watchpoint_count < max ? bus->watchpoint_count : max;
+
+	memcpy(watchpoints, bus->watchpoints, count * sizeof(snes_bus_watchpoint_t));
+	return bus->watchpoint_count;
+}
+
+uint32_t snes_bus_get_watchpoint_count(snes_bus_t *bus)
+{
+	return bus->watchpoint_count;
+}
+
+int snes_bus_get_watch_hit(snes_bus_t *bus, snes_bus_watch_hit_t *hit)
+{
+	if(hit != NULL)
+		*hit = bus->watch_hit;
+	return bus->watch_hit.type != 0;
+}
+
+void snes_bus_clear_watch_hit(snes_bus_t *bus)
+{
+	bus->watch_hit.type = 0;
 }
@@ -5,13 +5,127 @@
 #include "snes_cart.h"
 #include "snes_ram.h"
 #include "snes_apu.h"
+#include "snes_irq.h"
+#include "snes_ppu.h"
 
 typedef struct _snes_bus snes_bus_t;
 
-snes_bus_t *snes_bus_init(snes_cart_t *cart, snes_ram_t *wram, snes_apu_t *apu);
+#define SNES_BUS_WRAM_SIZE (128 * 1024)
+
+snes_bus_t *snes_bus_init(snes_cart_t *cart, snes_ram_t *wram, snes_apu_t *apu, snes_irq_t *irq, snes_ppu_t *ppu);
 void snes_bus_destroy(snes_bus_t *bus);
 
 uint8_t snes_bus_read(snes_bus_t *bus, uint32_t address);
 void snes_bus_write(snes_bus_t *bus, uint32_t address, uint8_t data);
+/*Instruction fetch : a read that doesn't trigger the watchpoints*/
+uint8_t snes_bus_fetch(snes_bus_t *bus, uint32_t address);
+
+/*
+ * B bus ($2100-$21FF of the A bus), addressed by the low byte : PPU ($00-$3F),
+ * APU ports ($40-$7F) and WRAM port ($80-$83). For the DMA, the accesses
+ * don't add wait states.
+ */
+uint8_t snes_bus_read_b(snes_bus_t *bus, uint8_t address);
+void snes_bus_write_b(snes_bus_t *bus, uint8_t address, uint8_t data);
+/*
+ * len bytes to a B bus register, or alternately to it and the next one when
+ * pair is set, copied straight into the memory behind the register. Returns
+ * the bytes taken, 0 if they must go through snes_bus_write_b.
+ */
+uint32_t snes_bus_write_b_block(snes_bus_t *bus, uint8_t address, uint8_t pair, const uint8_t *data, uint32_t len);
+/*Host pointer to the byte at address if it's plain memory without watchpoint, NULL otherwise*/
+const uint8_t *snes_bus_get_read_ptr(snes_bus_t *bus, uint32_t address);
+
+/*
+ * Decoded code tracking :
+ * snes_bus_watch_code returns -1 if the address can't hold cacheable code (MMIO),
+ * 0 if it's read only (never invalidated) and 1 if it's RAM. In this case the
+ * page is watched and any write into it bumps the code generation.
+ */
+snes_ram_t *snes_bus_get_wram(snes_bus_t *bus);
+snes_irq_t *snes_bus_get_irq(snes_bus_t *bus);
+snes_apu_t *snes_bus_get_apu(snes_bus_t *bus);
+snes_ppu_t *snes_bus_get_ppu(snes_bus_t *bus);
+/*Returns 1 if the address is plain memory (no side effect on access)*/
+int snes_bus_is_memory(snes_bus_t *bus, uint32_t address);
+
+int snes_bus_watch_code(snes_bus_t *bus, uint32_t address);
+uint32_t snes_bus_get_code_generation(snes_bus_t *bus);
+
+/*
+ * HDMA tables : the writes into a watched RAM page (and its mirrors) go
+ * through snes_dma_table_written first. snes_bus_clear_tables drops them all.
+ */
+void snes_bus_watch_table(snes_bus_t *bus, uint32_t address);
+void snes_bus_clear_tables(snes_bus_t *bus);
+
+/*
+ * Dry run, for the JIT lockstep which can only roll back the CPU and the
+ * memories : the accesses reaching the other chips (registers, HDMA table
+ * writes and the catch up they trigger) are dropped, reads return 0.
+ * snes_bus_end_dry_run returns 1 if any access was dropped.
+ */
+void snes_bus_start_dry_run(snes_bus_t *bus);
+int snes_bus_end_dry_run(snes_bus_t *bus);
+
+/*
+ * Copies len bytes from src to dest, one byte at a time as the CPU would (an
+ * overlapping forward copy repeats the pattern), both addresses moving by step
+ * (1 or -1). The range must not wrap its bank. Plain memory is copied directly.
+ */
+void snes_bus_copy(snes_bus_t *bus, uint32_t dest, uint32_t src, uint32_t len, int step);
+
+/*
+ * Memory timings : an access takes 6 (FastROM, I/O), 8 (SlowROM, WRAM) or 12
+ * (joypad serial ports) master cycles. The bus holds the master clock : it adds
+ * the cycles spent above 6 per access, the CPU adds 6 master cycles per CPU cycle
+ * through the pointer given by snes_bus_get_clock.
+ */
+#define SNES_BUS_FAST_CYCLES 6
+uint8_t snes_bus_get_access_cycles(snes_bus_t *bus, uint32_t address);
+/*1 when banks 0x80-0xFF run at FastROM speed*/
+uint8_t snes_bus_get_fastrom(snes_bus_t *bus);
+uint64_t snes_bus_get_cycles(snes_bus_t *bus);
+void snes_bus_set_cycles(snes_bus_t *bus, uint64_t cycles);
+uint64_t *snes_bus_get_clock(snes_bus_t *bus);
+/*Runs the chips behind the bus (PPU, HDMA, APU) up to the master clock*/
+void snes_bus_catch_up(snes_bus_t *bus);
+/*
+ * Renders the PPU lines and runs the HDMA lines up to the master clock, in
+ * their order : before the PPU registers change
+ */
+void snes_bus_video_catch_up(snes_bus_t *bus);
+
+/*
+ * Watchpoints on CPU addresses (mirrors are not followed), start and end
+ * included. value is -1 or the only data value that triggers the watchpoint.
+ * Only the pages they cover leave the fast path. The first hit is kept until
+ * snes_bus_clear_watch_hit.
+ */
+#define SNES_BUS_MAX_WATCHPOINTS 16
+#define SNES_BUS_WATCH_READ (1 << 0)
+#define SNES_BUS_WATCH_WRITE (1 << 1)
+
+typedef struct {
+	uint8_t type; //SNES_BUS_WATCH_READ and/or SNES_BUS_WATCH_WRITE
+	uint32_t start;
+	uint32_t end;
+	int16_t value;
+} snes_bus_watchpoint_t;
+
+typedef struct {
+	uint8_t type; //Access that triggered, 0 when there is no hit
+	uint32_t address;
+	uint8_t value;
+} snes_bus_watch_hit_t;
+
+int snes_bus_add_watchpoint(snes_bus_t *bus, uint8_t type, uint32_t start, uint32_t end, int16_t value);
+/*Removes the first watchpoint of one of the types starting at start*/
+int snes_bus_remove_watchpoint(snes_bus_t *bus, uint8_t type, uint32_t start);
+uint32_t snes_bus_get_watchpoints(snes_bus_t *bus, snes_bus_watchpoint_t *watchpoints, uint32_t max);
+uint32_t snes_bus_get_watchpoint_count(snes_bus_t *bus);
+/*Returns 1 and fills hit (may be NULL) if a watchpoint triggered*/
+int snes_bus_get_watch_hit(snes_bus_t *bus, snes_bus_watch_hit_t *hit);
+void snes_bus_clear_watch_hit(snes_bus_t *bus);
 
 #endif //SNES_BUS_H
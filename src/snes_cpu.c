@@ -4,1337 +4,28 @@
 #include <assert.h>
 #include <pthread.h>
 #include <string.h>
+#include <time.h>
 
 #include "snes_cpu_defs.h"
+#include "snes_cpu_opcodes.h"
 #include "snes_cpu.h"
 #include "snes_cpu_registers.h"
 #include "snes_cpu_addressing_mode.h"
 #include "snes_cpu_mne.h"
 #include "snes_cpu_stack.h"
+#include "snes_cpu_internal.h"
+#include "snes_cpu_dispatch.h"
+#include "snes_cpu_idle.h"
 
-#define MAX_BREAKPOINTS 512
-
-#define likely(x)       __builtin_expect((x),1)
-#define unlikely(x)     __builtin_expect((x),0)
-
-typedef struct {
-	snes_cpu_mnemonic_t mne;
-	snes_cpu_addressing_mode_t addr;
-	int cycles;
-} snes_cpu_opcode_t;
-
-typedef struct {
-	uint8_t word; //For debug traces
-	snes_cpu_opcode_t opcode;
-	uint8_t operand_size;
-	union {
-		uint32_t operand;
-		struct {
-			uint8_t operand_low;
-			uint8_t operand_high;
-			uint8_t operand_bank;
-			uint8_t operand_pad; //pading
-		};
-	};
-} snes_cpu_instruction_t;
-
-struct _snes_cpu{
-	snes_cpu_registers_t *registers;
-	snes_cart_t *cart;
-	snes_bus_t *bus;
-	snes_cpu_stack_t *stack;
-	pthread_t execution_thread;
-	uint32_t breakpoints[MAX_BREAKPOINTS];
-	snes_cpu_instruction_t current_instruction;
-	pthread_mutex_t lock;
-	pthread_cond_t  cond;
-	snes_cpu_execution_mode exec_mode;
-};
-
-
-void snes_cpu_update_next_instruction(snes_cpu_t *cpu);
+#define SNES_CPU_OPCODE_ENTRY(opcode, mnemonic, mode, nb_cycles) \
+	[opcode] = { \
+		.mne = mnemonic, \
+		.addr = mode, \
+		.cycles = nb_cycles, \
+	},
 
 static snes_cpu_opcode_t ops[256] = {
-	[0x00] = {
-		.mne = BRK,
-		.addr = StackInterrupt,
-		.cycles = 7,
-	},
-	[0x01] = {
-		.mne = ORA,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0x02] = {
-		.mne = COP,
-		.addr = StackInterrupt,
-		.cycles = 7,
-	},
-	[0x03] = {
-		.mne = ORA,
-		.addr = StackRelative,
-		.cycles = 4,
-	},
-	[0x04] = {
-		.mne = TSB,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0x05] = {
-		.mne = ORA,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x06] = {
-		.mne = ASL,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0x07] = {
-		.mne = ORA,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0x08] = {
-		.mne = PHP,
-		.addr = StackPush,
-		.cycles = 3,
-	},
-	[0x09] = {
-		.mne = ORA,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0x0A] = {
-		.mne = ASL,
-		.addr = Accumulator,
-		.cycles = 2,
-	},
-	[0x0B] = {
-		.mne = PHD,
-		.addr = StackPush,
-		.cycles = 4,
-	},
-	[0x0C] = {
-		.mne = TSB,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0x0D] = {
-		.mne = ORA,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x0E] = {
-		.mne = ASL,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0x0F] = {
-		.mne = ORA,
-		.addr = AbsoluteLong,
-		.cycles = 5,
-	},
-	[0x10] = {
-		.mne = BLP,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0x11] = {
-		.mne = ORA,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 6,
-	},
-	[0x12] = {
-		.mne = ORA,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0x13] = {
-		.mne = ORA,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0x14] = {
-		.mne = TRB,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0x15] = {
-		.mne = ORA,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x16] = {
-		.mne = ASL,
-		.addr = DirectPageIndexedX,
-		.cycles = 6,
-	},
-	[0x17] = {
-		.mne = ORA,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 4,
-	},
-	[0x18] = {
-		.mne = CLC,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x19] = {
-		.mne = ORA,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0x1A] = {
-		.mne = INC,
-		.addr = Accumulator,
-		.cycles = 2,
-	},
-	[0x1B] = {
-		.mne = TCS,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x1C] = {
-		.mne = TRB,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0x1D] = {
-		.mne = ORA,
-		.addr = AbsoluteIndexedX,
-		.cycles = 4,
-	},
-	[0x1E] = {
-		.mne = ASL,
-		.addr = AbsoluteIndexedX,
-		.cycles = 7,
-	},
-	[0x1F] = {
-		.mne = ORA,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 5,
-	},
-	[0x20] = {
-		.mne = JSR,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0x21] = {
-		.mne = AND,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0x22] = {
-		.mne = JSR,
-		.addr = AbsoluteLong,
-		.cycles = 8,
-	},
-	[0x23] = {
-		.mne = AND,
-		.addr = StackRelative,
-		.cycles = 4,
-	},
-	[0x24] = {
-		.mne = BIT,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x25] = {
-		.mne = AND,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x26] = {
-		.mne = ROL,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0x27] = {
-		.mne = AND,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0x28] = {
-		.mne = PLP,
-		.addr = StackPull,
-		.cycles = 4,
-	},
-	[0x29] = {
-		.mne = AND,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0x2A] = {
-		.mne = ROL,
-		.addr = Accumulator,
-		.cycles = 2,
-	},
-	[0x2B] = {
-		.mne = PLD,
-		.addr = StackPull,
-		.cycles = 5,
-	},
-	[0x2C] = {
-		.mne = BIT,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x2D] = {
-		.mne = AND,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x2E] = {
-		.mne = ROL,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0x2F] = {
-		.mne = AND,
-		.addr = AbsoluteLong,
-		.cycles = 5,
-	},
-	[0x30] = {
-		.mne = BMI,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0x31] = {
-		.mne = AND,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 5,
-	},
-	[0x32] = {
-		.mne = AND,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0x33] = {
-		.mne = AND,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0x34] = {
-		.mne = BIT,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x35] = {
-		.mne = AND,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x36] = {
-		.mne = ROL,
-		.addr = DirectPageIndexedX,
-		.cycles = 6,
-	},
-	[0x37] = {
-		.mne = AND,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 6,
-	},
-	[0x38] = {
-		.mne = SEC,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x39] = {
-		.mne = AND,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0x3A] = {
-		.mne = DEC,
-		.addr = Accumulator,
-		.cycles = 2,
-	},
-	[0x3B] = {
-		.mne = TSC,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x3C] = {
-		.mne = BIT,
-		.addr = AbsoluteIndexedX,
-		.cycles = 4,
-	},
-	[0x3D] = {
-		.mne = AND,
-		.addr = AbsoluteIndexedX,
-		.cycles = 4,
-	},
-	[0x3E] = {
-		.mne = ROL,
-		.addr = AbsoluteIndexedX,
-		.cycles = 7,
-	},
-	[0x3F] = {
-		.mne = AND,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 5,
-	},
-	[0x40] = {
-		.mne = RTI,
-		.addr = StackRTI,
-		.cycles = 6,
-	},
-	[0x41] = {
-		.mne = EOR,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0x42] = {
-		.mne = WDM,
-		.addr = ProgramCounterRelative, //????
-		.cycles = 2, //???
-	},
-	[0x43] = {
-		.mne = EOR,
-		.addr = StackRelative,
-		.cycles = 4,
-	},
-	[0x44] = {
-		.mne = MVP,
-		.addr = BlockMove,
-		.cycles = 4, //??
-	},
-	[0x45] = {
-		.mne = EOR,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x46] = {
-		.mne = LSR,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0x47] = {
-		.mne = EOR,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0x48] = {
-		.mne = PHA,
-		.addr = StackPush,
-		.cycles = 3,
-	},
-	[0x49] = {
-		.mne = EOR,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0x4A] = {
-		.mne = LSR,
-		.addr = Accumulator,
-		.cycles = 2,
-	},
-	[0x4B] = {
-		.mne = PHK,
-		.addr = StackPush,
-		.cycles = 3,
-	},
-	[0x4C] = {
-		.mne = JMP,
-		.addr = Absolute,
-		.cycles = 3,
-	},
-	[0x4D] = {
-		.mne = EOR,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x4E] = {
-		.mne = LSR,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0x4F] = {
-		.mne = EOR,
-		.addr = AbsoluteLong,
-		.cycles = 5,
-	},
-	[0x50] = {
-		.mne = BVC,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0x51] = {
-		.mne = EOR,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 5,
-	},
-	[0x52] = {
-		.mne = EOR,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0x53] = {
-		.mne = EOR,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0x54] = {
-		.mne = MVN,
-		.addr = BlockMove,
-		.cycles = 2, //???
-	},
-	[0x55] = {
-		.mne = EOR,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x56] = {
-		.mne = LSR,
-		.addr = DirectPageIndexedX,
-		.cycles = 6,
-	},
-	[0x57] = {
-		.mne = EOR,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 6,
-	},
-	[0x58] = {
-		.mne = CLI,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x59] = {
-		.mne = EOR,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0x5A] = {
-		.mne = PHY,
-		.addr = StackPush,
-		.cycles = 3,
-	},
-	[0x5B] = {
-		.mne = TCD,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x5C] = {
-		.mne = JMP,
-		.addr = AbsoluteLong,
-		.cycles = 4,
-	},
-	[0x5D] = {
-		.mne = EOR,
-		.addr = AbsoluteIndexedX,
-		.cycles = 4,
-	},
-	[0x5E] = {
-		.mne = LSR,
-		.addr = AbsoluteIndexedX,
-		.cycles = 7,
-	},
-	[0x5F] = {
-		.mne = EOR,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 5,
-	},
-	[0x60] = {
-		.mne = RTS,
-		.addr = StackRTS,
-		.cycles = 6,
-	},
-	[0x61] = {
-		.mne = ADC,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0x62] = {
-		.mne = PER,
-		.addr = StackProgramCounterRelativeLong,
-		.cycles = 6,
-	},
-	[0x63] = {
-		.mne = ADC,
-		.addr = StackRelative,
-		.cycles = 4,
-	},
-	[0x64] = {
-		.mne = STZ,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x65] = {
-		.mne = ADC,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x66] = {
-		.mne = ROR,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0x67] = {
-		.mne = ADC,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0x68] = {
-		.mne = PLA,
-		.addr = StackPull,
-		.cycles = 4,
-	},
-	[0x69] = {
-		.mne = ADC,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0x6A] = {
-		.mne = ROR,
-		.addr = Accumulator,
-		.cycles = 2,
-	},
-	[0x6B] = {
-		.mne = RTL,
-		.addr = StackRTL,
-		.cycles = 6,
-	},
-	[0x6C] = {
-		.mne = JMP,
-		.addr = AbsoluteIndirect,
-		.cycles = 5,
-	},
-	[0x6D] = {
-		.mne = ADC,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x6E] = {
-		.mne = ROR,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0x6F] = {
-		.mne = ADC,
-		.addr = AbsoluteLong,
-		.cycles = 5,
-	},
-	[0x70] = {
-		.mne = BVS,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0x71] = {
-		.mne = ADC,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 5,
-	},
-	[0x72] = {
-		.mne = ADC,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0x73] = {
-		.mne = ADC,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0x74] = {
-		.mne = STZ,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x75] = {
-		.mne = ADC,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x76] = {
-		.mne = ROR,
-		.addr = DirectPageIndexedX,
-		.cycles = 6,
-	},
-	[0x77] = {
-		.mne = ADC,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 6,
-	},
-	[0x78] = {
-		.mne = SEI,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x79] = {
-		.mne = ADC,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0x7A] = {
-		.mne = PLY,
-		.addr = StackPull,
-		.cycles = 4,
-	},
-	[0x7B] = {
-		.mne = TDC,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x7C] = {
-		.mne = JMP,
-		.addr = AbsoluteIndexedIndirect,
-		.cycles = 6,
-	},
-	[0x7D] = {
-		.mne = ADC,
-		.addr = AbsoluteIndexedX,
-		.cycles = 4,
-	},
-	[0x7E] = {
-		.mne = ROR,
-		.addr = AbsoluteIndexedX,
-		.cycles = 7,
-	},
-	[0x7F] = {
-		.mne = ADC,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 5,
-	},
-	[0x80] = {
-		.mne = BRA,
-		.addr = ProgramCounterRelative,
-		.cycles = 3,
-	},
-	[0x81] = {
-		.mne = STA,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0x82] = {
-		.mne = BRL,
-		.addr = ProgramCounterRelativeLong,
-		.cycles = 4,
-	},
-	[0x83] = {
-		.mne = STA,
-		.addr = StackRelative,
-		.cycles = 4,
-	},
-	[0x84] = {
-		.mne = STY,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x85] = {
-		.mne = STA,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x86] = {
-		.mne = STX,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0x87] = {
-		.mne = STA,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0x88] = {
-		.mne = DEY,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x89] = {
-		.mne = BIT,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0x8A] = {
-		.mne = TXA,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x8B] = {
-		.mne = PHB,
-		.addr = StackPush,
-		.cycles = 3,
-	},
-	[0x8C] = {
-		.mne = STY,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x8D] = {
-		.mne = STA,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x8E] = {
-		.mne = STX,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x8F] = {
-		.mne = STA,
-		.addr = AbsoluteLong,
-		.cycles = 5,
-	},
-	[0x90] = {
-		.mne = BCC,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0x91] = {
-		.mne = STA,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 6,
-	},
-	[0x92] = {
-		.mne = STA,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0x93] = {
-		.mne = STA,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0x94] = {
-		.mne = STY,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x95] = {
-		.mne = STA,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0x96] = {
-		.mne = STX,
-		.addr = DirectPageIndexedY,
-		.cycles = 4,
-	},
-	[0x97] = {
-		.mne = STA,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 6,
-	},
-	[0x98] = {
-		.mne = TYA,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x99] = {
-		.mne = STA,
-		.addr = AbsoluteIndexedY,
-		.cycles = 5,
-	},
-	[0x9A] = {
-		.mne = TXS,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x9B] = {
-		.mne = TXY,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0x9C] = {
-		.mne = STZ,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0x9D] = {
-		.mne = STA,
-		.addr = AbsoluteIndexedX,
-		.cycles = 5,
-	},
-	[0x9E] = {
-		.mne = STZ,
-		.addr = AbsoluteIndexedX,
-		.cycles = 5,
-	},
-	[0x9F] = {
-		.mne = STA,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 6,
-	},
-	[0xA0] = {
-		.mne = LDY,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0xA1] = {
-		.mne = LDA,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0xA2] = {
-		.mne = LDX,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0xA3] = {
-		.mne = LDA,
-		.addr = StackRelative,
-		.cycles = 4,
-	},
-	[0xA4] = {
-		.mne = LDY,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0xA5] = {
-		.mne = LDA,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0xA6] = {
-		.mne = LDX,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0xA7] = {
-		.mne = LDA,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0xA8] = {
-		.mne = TAY,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xA9] = {
-		.mne = LDA,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0xAA] = {
-		.mne = TAX,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xAB] = {
-		.mne = PLB,
-		.addr = StackPull,
-		.cycles = 4,
-	},
-	[0xAC] = {
-		.mne = LDY,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0xAD] = {
-		.mne = LDA,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0xAE] = {
-		.mne = LDX,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0xAF] = {
-		.mne = LDA,
-		.addr = AbsoluteLong,
-		.cycles = 6,
-	},
-	[0xB0] = {
-		.mne = BCS,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0xB1] = {
-		.mne = LDA,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 5,
-	},
-	[0xB2] = {
-		.mne = LDA,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0xB3] = {
-		.mne = LDA,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0xB4] = {
-		.mne = LDY,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0xB5] = {
-		.mne = LDA,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0xB6] = {
-		.mne = LDX,
-		.addr = DirectPageIndexedY,
-		.cycles = 6,
-	},
-	[0xB7] = {
-		.mne = LDA,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 6,
-	},
-	[0xB8] = {
-		.mne = CLV,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xB9] = {
-		.mne = LDA,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0xBA] = {
-		.mne = TSX,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xBB] = {
-		.mne = TYX,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xBC] = {
-		.mne = LDY,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0xBD] = {
-		.mne = LDA,
-		.addr = AbsoluteIndexedX,
-		.cycles = 4,
-	},
-	[0xBE] = {
-		.mne = LDX,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0xBF] = {
-		.mne = LDA,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 6,
-	},
-	[0xC0] = {
-		.mne = CPY,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0xC1] = {
-		.mne = CMP,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0xC2] = {
-		.mne = REP,
-		.addr = Immediate,
-		.cycles = 3,
-	},
-	[0xC3] = {
-		.mne = CMP,
-		.addr = StackRelative,
-		.cycles = 4,
-	},
-	[0xC4] = {
-		.mne = CPY,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0xC5] = {
-		.mne = CMP,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0xC6] = {
-		.mne = DEC,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0xC7] = {
-		.mne = CMP,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0xC8] = {
-		.mne = INY,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xC9] = {
-		.mne = CMP,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0xCA] = {
-		.mne = DEX,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xCB] = {
-		.mne = WAI,
-		.addr = Implied,
-		.cycles = 3,
-	},
-	[0xCC] = {
-		.mne = CPY,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0xCD] = {
-		.mne = CMP,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0xCE] = {
-		.mne = DEC,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0xCF] = {
-		.mne = CMP,
-		.addr = AbsoluteLong,
-		.cycles = 6,
-	},
-	[0xD0] = {
-		.mne = BNE,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0xD1] = {
-		.mne = CMP,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 5,
-	},
-	[0xD2] = {
-		.mne = CMP,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0xD3] = {
-		.mne = CMP,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0xD4] = {
-		.mne = PEI,
-		.addr = StackDirectPageIndirect,
-		.cycles = 6,
-	},
-	[0xD5] = {
-		.mne = CMP,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0xD6] = {
-		.mne = DEC,
-		.addr = DirectPageIndexedX,
-		.cycles = 6,
-	},
-	[0xD7] = {
-		.mne = CMP,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 6,
-	},
-	[0xD8] = {
-		.mne = CLD,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xD9] = {
-		.mne = CMP,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0xDA] = {
-		.mne = PHX,
-		.addr = StackPush,
-		.cycles = 3,
-	},
-	[0xDB] = {
-		.mne = STP,
-		.addr = Implied,
-		.cycles = 3,
-	},
-	[0xDC] = {
-		.mne = JMP,
-		.addr = AbsoluteIndirectLong,
-		.cycles = 6,
-	},
-	[0xDD] = {
-		.mne = CMP,
-		.addr = AbsoluteIndexedX,
-		.cycles = 7,
-	},
-	[0xDE] = {
-		.mne = DEC,
-		.addr = AbsoluteIndexedX,
-		.cycles = 6,
-	},
-	[0xDF] = {
-		.mne = CMP,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 5,
-	},
-	[0xE0] = {
-		.mne = CPX,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0xE1] = {
-		.mne = SBC,
-		.addr = DirectPageIndexedIndirectX,
-		.cycles = 6,
-	},
-	[0xE2] = {
-		.mne = SEP,
-		.addr = Immediate,
-		.cycles = 3,
-	},
-	[0xE3] = {
-		.mne = SBC,
-		.addr = StackRelative,
-		.cycles = 3,
-	},
-	[0xE4] = {
-		.mne = CPX,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0xE5] = {
-		.mne = SBC,
-		.addr = DirectPage,
-		.cycles = 3,
-	},
-	[0xE6] = {
-		.mne = INC,
-		.addr = DirectPage,
-		.cycles = 5,
-	},
-	[0xE7] = {
-		.mne = SBC,
-		.addr = DirectPageIndirectLong,
-		.cycles = 6,
-	},
-	[0xE8] = {
-		.mne = INX,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xE9] = {
-		.mne = SBC,
-		.addr = Immediate,
-		.cycles = 2,
-	},
-	[0xEA] = {
-		.mne = NOP,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xEB] = {
-		.mne = XBA,
-		.addr = Implied,
-		.cycles = 3,
-	},
-	[0xEC] = {
-		.mne = CPX,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0xED] = {
-		.mne = SBC,
-		.addr = Absolute,
-		.cycles = 4,
-	},
-	[0xEE] = {
-		.mne = INC,
-		.addr = Absolute,
-		.cycles = 6,
-	},
-	[0xEF] = {
-		.mne = SBC,
-		.addr = AbsoluteLong,
-		.cycles = 5,
-	},
-	[0xF0] = {
-		.mne = BEQ,
-		.addr = ProgramCounterRelative,
-		.cycles = 2,
-	},
-	[0xF1] = {
-		.mne = SBC,
-		.addr = DirectPageIndirectIndexedY,
-		.cycles = 5,
-	},
-	[0xF2] = {
-		.mne = SBC,
-		.addr = DirectPageIndirect,
-		.cycles = 5,
-	},
-	[0xF3] = {
-		.mne = SBC,
-		.addr = StackRelativeIndirectIndexedY,
-		.cycles = 7,
-	},
-	[0xF4] = {
-		.mne = PEA,
-		.addr = StackAbsolute,
-		.cycles = 5,
-	},
-	[0xF5] = {
-		.mne = SBC,
-		.addr = DirectPageIndexedX,
-		.cycles = 4,
-	},
-	[0xF6] = {
-		.mne = INC,
-		.addr = DirectPageIndexedX,
-		.cycles = 6,
-	},
-	[0xF7] = {
-		.mne = SBC,
-		.addr = DirectPageIndirectLongIndexedY,
-		.cycles = 6,
-	},
-	[0xF8] = {
-		.mne = SED,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xF9] = {
-		.mne = SBC,
-		.addr = AbsoluteIndexedY,
-		.cycles = 4,
-	},
-	[0xFA] = {
-		.mne = PLX,
-		.addr = StackPull,
-		.cycles = 4,
-	},
-	[0xFB] = {
-		.mne = XCE,
-		.addr = Implied,
-		.cycles = 2,
-	},
-	[0xFC] = {
-		.mne = JSR,
-		.addr = AbsoluteIndexedIndirect,
-		.cycles = 8,
-	},
-	[0xFD] = {
-		.mne = SBC,
-		.addr = AbsoluteIndexedX,
-		.cycles = 4,
-	},
-	[0xFE] = {
-		.mne = INC,
-		.addr = AbsoluteIndexedX,
-		.cycles = 7
-	},
-	[0xFF] = {
-		.mne = SBC,
-		.addr = AbsoluteLongIndexedX,
-		.cycles = 5,
-	},
+	SNES_CPU_OPCODES(SNES_CPU_OPCODE_ENTRY)
 };
 
 static const char* addressing_mode_tostring(snes_cpu_addressing_mode_t mode)
@@ -1639,6 +330,75 @@ static uint8_t snes_cpu_mne_is_always_one(snes_cpu_mnemonic_t mne)
 	}
 }
 
+static uint8_t snes_cpu_mne_is_rmw(snes_cpu_mnemonic_t mne)
+{
+	switch(mne) {
+		case ASL:
+		case DEC:
+		case INC:
+		case LSR:
+		case ROL:
+		case ROR:
+		case TRB:
+		case TSB:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+//16 bits accumulator cost one more cycle (two for read-modify-write)
+static uint8_t snes_cpu_mne_m_cycles(snes_cpu_mnemonic_t mne, snes_cpu_addressing_mode_t mode)
+{
+	if(snes_cpu_mne_is_m_sensitive(mne))
+		return 1;
+	if(snes_cpu_mne_is_rmw(mne))
+		return mode == Accumulator ? 0 : 2;
+	switch(mne) {
+		case STA:
+		case STZ:
+		case PHA:
+		case PLA:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static uint8_t snes_cpu_mne_x_cycles(snes_cpu_mnemonic_t mne)
+{
+	if(snes_cpu_mne_is_x_sensitive(mne))
+		return 1;
+	switch(mne) {
+		case STX:
+		case STY:
+		case PHX:
+		case PHY:
+		case PLX:
+		case PLY:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static uint8_t snes_cpu_mne_is_branch(snes_cpu_mnemonic_t mne)
+{
+	switch(mne) {
+		case BCC:
+		case BCS:
+		case BEQ:
+		case BMI:
+		case BNE:
+		case BLP:
+		case BVC:
+		case BVS:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
 static uint8_t snes_cpu_get_opcode_size(snes_cpu_t *cpu, snes_cpu_opcode_t opcode)
 {
 	switch (opcode.addr) {
@@ -1712,6 +472,10 @@ snes_cpu_t *snes_cpu_init(snes_cart_t *cart, snes_bus_t *bus)
 
 	cpu->cart = cart;
 	cpu->bus = bus;
+	cpu->clock = snes_bus_get_clock(bus);
+	cpu->irq_poll = snes_irq_get_poll(snes_bus_get_irq(bus));
+	cpu->halt = SNES_CPU_HALT_NONE;
+	cpu->idle_skip = 1;
 	cpu->exec_mode = SNES_CPU_EXECUTION_MODE_UNKNOWN;
 	pthread_mutex_init(&(cpu->lock), NULL);
 	pthread_cond_init(&(cpu->cond), NULL);
@@ -1732,6 +496,8 @@ snes_cpu_t *snes_cpu_init(snes_cart_t *cart, snes_bus_t *bus)
 		goto error_stack;
 	}
 
+	snes_cpu_reset_stats(cpu);
+	snes_cpu_update_mode(cpu);
 	snes_cpu_update_next_instruction(cpu);
 
 	return cpu;
@@ -1746,6 +512,12 @@ error_alloc:
 
 void snes_cpu_destroy(snes_cpu_t *cpu)
 {
+	uint32_t page;
+
+	for(page = 0; page < SNES_CPU_BREAKPOINT_PAGE_COUNT; page++)
+		free(cpu->breakpoints[page]);
+	if(cpu->jit != NULL)
+		snes_cpu_jit_destroy(cpu->jit);
 	cpu->cart = NULL;
 	cpu->bus = NULL;
 	pthread_mutex_destroy(&(cpu->lock));
@@ -1770,40 +542,230 @@ snes_bus_t *snes_cpu_get_bus(snes_cpu_t *cpu)
 	return cpu->bus;
 }
 
-void snes_cpu_update_next_instruction(snes_cpu_t *cpu)
+void snes_cpu_update_mode(snes_cpu_t *cpu)
 {
-	int i;
-	uint16_t pc = snes_cpu_registers_program_counter_get(cpu->registers);
-	uint32_t pbr = snes_cpu_registers_program_bank_get(cpu->registers);
+	cpu->mode = snes_cpu_mne_get_mode(cpu->registers);
+	cpu->handlers = snes_cpu_mne_handlers[cpu->mode];
+}
+
+//FastROM in bit 6, M and X flags (operand sizes), handler mode in bits 1-3, E in bit 0
+uint32_t snes_cpu_get_decode_state(snes_cpu_t *cpu)
+{
+	uint32_t state = snes_cpu_registers_width_flags_get(cpu->registers) | (cpu->mode << 1);
+	state |= snes_bus_get_fastrom(cpu->bus) << 6;
+	if(snes_cpu_registers_emulation_isset(cpu->registers))
+		state |= 1;
+	return state;
+}
+
+static void snes_cpu_decode_timing(snes_cpu_t *cpu, uint32_t pbr, uint16_t pc, snes_cpu_instruction_t *instruction)
+{
+	snes_cpu_opcode_t opcode = instruction->opcode;
+	uint8_t emulation = snes_cpu_registers_emulation_isset(cpu->registers);
+	uint8_t flags = snes_cpu_registers_width_flags_get(cpu->registers);
+	uint8_t x16 = !emulation && !(flags & STATUS_FLAG_X);
+	uint32_t cycles = opcode.cycles;
+	uint32_t bytes = instruction->operand_size + 1;
+	uint32_t i;
+
+	instruction->timing.master = 0;
+	instruction->timing.flags = 0;
+	instruction->timing.pad = 0;
+
+	if(!emulation && !(flags & STATUS_FLAG_M))
+		cycles += snes_cpu_mne_m_cycles(opcode.mne, opcode.addr);
+	if(x16)
+		cycles += snes_cpu_mne_x_cycles(opcode.mne);
+	if(!emulation && (opcode.mne == BRK || opcode.mne == COP || opcode.mne == RTI))
+		cycles++;
+
+	switch(opcode.addr) {
+		case DirectPage:
+		case DirectPageIndexedX:
+		case DirectPageIndexedY:
+		case DirectPageIndexedIndirectX:
+		case DirectPageIndirect:
+		case DirectPageIndirectLong:
+		case DirectPageIndirectLongIndexedY:
+		case StackDirectPageIndirect:
+			instruction->timing.flags |= SNES_CPU_TIMING_DIRECT_PAGE;
+			break;
+		case DirectPageIndirectIndexedY:
+			instruction->timing.flags |= SNES_CPU_TIMING_DIRECT_PAGE;
+			//Fall through
+		case AbsoluteIndexedX:
+		case AbsoluteIndexedY:
+			//Writes always take the extra cycle, it's in their base count
+			if(!snes_cpu_mne_is_m_sensitive(opcode.mne) && !snes_cpu_mne_is_x_sensitive(opcode.mne))
+				break;
+			if(x16)
+				cycles++;
+			else if(opcode.addr == AbsoluteIndexedX)
+				instruction->timing.flags |= SNES_CPU_TIMING_INDEX_X;
+			else
+				instruction->timing.flags |= SNES_CPU_TIMING_INDEX_Y;
+			break;
+		case BlockMove:
+			instruction->timing.flags |= SNES_CPU_TIMING_BLOCK_MOVE;
+			break;
+		case ProgramCounterRelative:
+			if(snes_cpu_mne_is_branch(opcode.mne))
+				instruction->timing.flags |= SNES_CPU_TIMING_TAKEN;
+			if(emulation && (snes_cpu_mne_is_branch(opcode.mne) || opcode.mne == BRA))
+				instruction->timing.flags |= SNES_CPU_TIMING_PAGE;
+			break;
+		default:
+			break;
+	}
 
-	memset(&cpu->current_instruction, 0, sizeof(snes_cpu_instruction_t));
+	for(i = 0; i < bytes; i++)
+		instruction->timing.master += snes_bus_get_access_cycles(cpu->bus, pbr + (uint16_t)(pc + i));
+	if(cycles > bytes)
+		instruction->timing.master += (cycles - bytes) * SNES_BUS_FAST_CYCLES;
+}
 
-	cpu->current_instruction.word = snes_bus_read(cpu->bus, pc + pbr);
+void snes_cpu_decode_instruction(snes_cpu_t *cpu, uint32_t pbr, uint16_t pc, snes_cpu_instruction_t *instruction)
+{
+	//Fetches are accounted in the instruction timing, not as data accesses
+	uint64_t cycles = snes_bus_get_cycles(cpu->bus);
+	int i;
 
-	snes_cpu_registers_program_counter_inc(cpu->registers);
+	memset(instruction, 0, sizeof(snes_cpu_instruction_t));
 
-	cpu->current_instruction.opcode = ops[cpu->current_instruction.word];
-	cpu->current_instruction.operand_size = snes_cpu_get_opcode_size(cpu, cpu->current_instruction.opcode);
+	instruction->word = snes_bus_fetch(cpu->bus, pc + pbr);
+	instruction->opcode = ops[instruction->word];
+	instruction->operand_size = snes_cpu_get_opcode_size(cpu, instruction->opcode);
 
-	for(i = 0; i < cpu->current_instruction.operand_size; i++)
+	for(i = 0; i < instruction->operand_size; i++)
 	{
-		cpu->current_instruction.operand += (snes_bus_read(cpu->bus,snes_cpu_registers_program_counter_get(cpu->registers)) << i*8);
-		snes_cpu_registers_program_counter_inc(cpu->registers);
+		uint16_t operand_pc = pc + 1 + i;
+		instruction->operand += (snes_bus_fetch(cpu->bus, operand_pc + pbr) << i*8);
 	}
+	snes_bus_set_cycles(cpu->bus, cycles);
+	snes_cpu_decode_timing(cpu, pbr, pc, instruction);
+}
 
+static uint8_t snes_cpu_icache_is_valid(snes_cpu_t *cpu, snes_cpu_cache_entry_t *entry, uint32_t tag)
+{
+	if(entry->tag != tag)
+		return 0;
+	if(entry->ram && entry->generation != snes_bus_get_code_generation(cpu->bus))
+		return 0;
+	return 1;
+}
+
+static void snes_cpu_icache_fill(snes_cpu_t *cpu, snes_cpu_cache_entry_t *entry, uint32_t tag, uint32_t pbr, uint16_t pc)
+{
+	uint16_t last_pc;
+	int first_page;
+	int last_page;
+
+	snes_cpu_decode_instruction(cpu, pbr, pc, &entry->instruction);
+
+	last_pc = pc + entry->instruction.operand_size;
+	first_page = snes_bus_watch_code(cpu->bus, pbr + pc);
+	last_page = snes_bus_watch_code(cpu->bus, pbr + last_pc);
+	if(first_page < 0 || last_page < 0) {
+		//MMIO code, don't keep it
+		entry->tag = 0;
+		return;
+	}
+	entry->tag = tag;
+	entry->ram = first_page || last_page;
+	entry->generation = snes_bus_get_code_generation(cpu->bus);
+}
+
+void snes_cpu_update_next_instruction(snes_cpu_t *cpu)
+{
+	uint16_t pc = snes_cpu_registers_program_counter_get(cpu->registers);
+	uint32_t pbr = snes_cpu_registers_program_bank_get(cpu->registers);
+	uint32_t addr = pbr + pc;
+	uint32_t tag = INSTRUCTION_CACHE_VALID | (snes_cpu_get_decode_state(cpu) << 24) | addr;
+	snes_cpu_cache_entry_t *entry = &cpu->icache[(addr ^ (addr >> 12)) & (INSTRUCTION_CACHE_SIZE - 1)];
+
+	if(likely(snes_cpu_icache_is_valid(cpu, entry, tag))) {
+		cpu->stats.cache_hits++;
+	} else {
+		cpu->stats.cache_misses++;
+		snes_cpu_icache_fill(cpu, entry, tag, pbr, pc);
+	}
+
+	cpu->current_instruction = entry->instruction;
+	snes_cpu_registers_program_counter_set(cpu->registers, pc + 1 + entry->instruction.operand_size);
 }
 
 void snes_cpu_execute_instruction(snes_cpu_t *cpu)
 {
 	struct snes_effective_address eff_addr;
+	uint16_t next_pc = snes_cpu_registers_program_counter_get(cpu->registers);
+	uint8_t status = 0;
 
+	if(SNES_CPU_MNE_UNMASKS(cpu->current_instruction.opcode.mne))
+		status = snes_cpu_registers_status_flag_get(cpu->registers);
 	//Construct address
 	eff_addr = snes_cpu_addressing_mode_decode(cpu->bus, cpu->registers,
 									cpu->current_instruction.opcode.mne,
 									cpu->current_instruction.opcode.addr,
 									cpu->current_instruction.operand);
 	//Execute instruction
-	snes_cpu_mne_execute(cpu->current_instruction.opcode.mne, eff_addr, cpu);
+	cpu->handlers[cpu->current_instruction.opcode.mne](eff_addr, cpu->registers, cpu->bus, cpu->stack);
+	snes_cpu_add_cycles(cpu, cpu->current_instruction.timing, cpu->current_instruction.operand, &eff_addr);
+	if(SNES_CPU_MNE_SWITCHES_MODE(cpu->current_instruction.opcode.mne))
+		snes_cpu_update_mode(cpu);
+	if(SNES_CPU_MNE_UNMASKS(cpu->current_instruction.opcode.mne))
+		snes_cpu_unmask(cpu, status);
+	if(SNES_CPU_MNE_HALTS(cpu->current_instruction.opcode.mne))
+		snes_cpu_halt(cpu, cpu->current_instruction.opcode.mne);
+	else if(SNES_CPU_MNE_LOOPS(cpu->current_instruction.opcode.mne))
+		snes_cpu_idle_loop(cpu, next_pc);
+}
+
+void snes_cpu_unmask(snes_cpu_t *cpu, uint8_t status)
+{
+	if((status & STATUS_FLAG_I) && !snes_cpu_registers_status_flag_isset(cpu->registers, STATUS_FLAG_I))
+		*cpu->irq_poll = 1;
+}
+
+void snes_cpu_halt(snes_cpu_t *cpu, snes_cpu_mnemonic_t mne)
+{
+	cpu->halt = mne == WAI ? SNES_CPU_HALT_WAI : SNES_CPU_HALT_STP;
+}
+
+void snes_cpu_add_cycles(snes_cpu_t *cpu, snes_cpu_timing_t timing, uint32_t operand, struct snes_effective_address *eff_addr)
+{
+	uint32_t cycles = 0;
+	uint16_t index;
+	uint16_t target;
+
+	*cpu->clock += timing.master;
+	if(likely(timing.flags == 0))
+		return;
+
+	if((timing.flags & SNES_CPU_TIMING_DIRECT_PAGE) &&
+	   (snes_cpu_registers_direct_page_get(cpu->registers) & 0xFF))
+		cycles++;
+	if(timing.flags & (SNES_CPU_TIMING_INDEX_X | SNES_CPU_TIMING_INDEX_Y)) {
+		if(timing.flags & SNES_CPU_TIMING_INDEX_X)
+			index = snes_cpu_registers_x_get(cpu->registers).value8_low;
+		else
+			index = snes_cpu_registers_y_get(cpu->registers).value8_low;
+		if((eff_addr->simple_address ^ (eff_addr->simple_address - index)) & 0xFF00)
+			cycles++;
+	}
+	if(timing.flags & (SNES_CPU_TIMING_TAKEN | SNES_CPU_TIMING_PAGE)) {
+		target = eff_addr->simple_address;
+		if(snes_cpu_registers_program_counter_get(cpu->registers) == target) {
+			if(timing.flags & SNES_CPU_TIMING_TAKEN)
+				cycles++;
+			//Compared to the address of the next instruction
+			if((timing.flags & SNES_CPU_TIMING_PAGE) && ((target ^ (target - (int8_t)operand)) & 0xFF00))
+				cycles++;
+		}
+	}
+	*cpu->clock += cycles * SNES_BUS_FAST_CYCLES;
+	//The instruction is fetched again for each byte
+	if(timing.flags & SNES_CPU_TIMING_BLOCK_MOVE)
+		*cpu->clock += (uint64_t)(eff_addr->count - 1) * timing.master;
 }
 
 void snes_cpu_dump_instruction(snes_cpu_instruction_t instruction)
@@ -1833,28 +795,251 @@ void snes_cpu_dump(snes_cpu_t *cpu)
 	printf("\n");
 }
 
-int snes_cpu_is_breakpoint(snes_cpu_t *cpu)
+void snes_cpu_trace_instruction(snes_cpu_t *cpu)
 {
-	int i;
-	int found = 0;
+	uint16_t pc = snes_cpu_registers_program_counter_get(cpu->registers);
+	uint32_t pbr = snes_cpu_registers_program_bank_get(cpu->registers);
+	uint16_t instruction_pc = pc - cpu->current_instruction.operand_size - 1;
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(cpu->registers);
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(cpu->registers);
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(cpu->registers);
+	struct snes_cpu_register_value sp = snes_cpu_registers_stack_pointer_get(cpu->registers);
+
+	fprintf(cpu->trace, "%06X %02X %06X A:%04X X:%04X Y:%04X S:%04X D:%04X DB:%02X P:%02X E:%d\n",
+			pbr + instruction_pc,
+			cpu->current_instruction.word,
+			cpu->current_instruction.operand,
+			acc.value16, x.value16, y.value16, sp.value16,
+			snes_cpu_registers_direct_page_get(cpu->registers),
+			snes_cpu_registers_data_bank_get(cpu->registers) >> 16,
+			snes_cpu_registers_status_flag_get(cpu->registers),
+			snes_cpu_registers_emulation_isset(cpu->registers));
+}
+
+void snes_cpu_set_trace(snes_cpu_t *cpu, FILE *trace)
+{
+	cpu->trace = trace;
+}
 
+static uint8_t snes_cpu_breakpoint_isset(snes_cpu_t *cpu, uint32_t addr)
+{
+	const uint8_t *page = cpu->breakpoints[addr >> SNES_CPU_BREAKPOINT_PAGE_SHIFT];
+	uint32_t offset = addr & SNES_CPU_BREAKPOINT_PAGE_MASK;
+
+	return page != NULL && ((page[offset >> 3] >> (offset & 7)) & 1);
+}
+
+int snes_cpu_is_breakpoint(snes_cpu_t *cpu)
+{
 	uint16_t pc = snes_cpu_registers_program_counter_get(cpu->registers);
 	uint32_t pbr = snes_cpu_registers_program_bank_get(cpu->registers);
-	uint32_t instruction_addr = pc + pbr - cpu->current_instruction.operand_size - 1;
-	
-	for (i = 0; i < MAX_BREAKPOINTS; i++) {
-		if (instruction_addr == cpu->breakpoints[i]) {
-			found = 1;
+	uint16_t instruction_pc = pc - cpu->current_instruction.operand_size - 1;
+
+	//Watchpoints hit by the previous instruction stop before the next one
+	if(snes_bus_get_watch_hit(cpu->bus, NULL))
+		return SNES_CPU_STOP_WATCHPOINT;
+	if(snes_cpu_breakpoint_isset(cpu, pbr + instruction_pc))
+		return SNES_CPU_STOP_BREAKPOINT;
+	return 0;
+}
+
+int snes_cpu_interpret(snes_cpu_t *cpu, uint32_t count, uint8_t check_breakpoints)
+{
+#ifdef SNES_CPU_THREADED_DISPATCH
+	return snes_cpu_dispatch_run(cpu, count, check_breakpoints);
+#else
+	uint32_t i;
+	int ret;
+
+	for(i = 0; i < count; i++) {
+		if(check_breakpoints && unlikely((ret = snes_cpu_is_breakpoint(cpu)) != 0))
+			return ret;
+		if(unlikely(cpu->trace != NULL))
+			snes_cpu_trace_instruction(cpu);
+		snes_cpu_execute_instruction(cpu);
+		cpu->stats.instructions++;
+		snes_cpu_update_next_instruction(cpu);
+		if(unlikely(cpu->halt != SNES_CPU_HALT_NONE || *cpu->irq_poll))
 			break;
+	}
+	return 0;
+#endif
+}
+
+static int snes_cpu_run_instructions(snes_cpu_t *cpu, uint32_t count, uint8_t check_breakpoints)
+{
+	//Nothing to look up per instruction when no breakpoint or watchpoint is armed
+	check_breakpoints = check_breakpoints &&
+						(cpu->breakpoint_count > 0 || snes_bus_get_watchpoint_count(cpu->bus) > 0);
+	//Blocks are run as a whole : single steps, traces and breakpoints stay interpreted
+	if(cpu->jit != NULL && count > 1 && cpu->trace == NULL && !check_breakpoints) {
+		if(snes_cpu_jit_run(cpu->jit, count) < 0)
+			return SNES_CPU_STOP_LOCKSTEP;
+		return 0;
+	}
+	return snes_cpu_interpret(cpu, count, check_breakpoints);
+}
+
+/*
+ * Pushes the return address (the prefetched instruction) and the status, then
+ * jumps to the vector of bank 0
+ */
+static void snes_cpu_interrupt(snes_cpu_t *cpu, uint8_t line)
+{
+	snes_rom_t *rom = snes_cart_get_rom(cpu->cart);
+	uint8_t emulation = snes_cpu_registers_emulation_isset(cpu->registers);
+	snes_interrupt_vectors_t vectors = emulation ? snes_rom_get_emu_interrupt_vectors(rom) :
+												   snes_rom_get_nat_interrupt_vectors(rom);
+	uint16_t vector = line == SNES_IRQ_NMI ? vectors.nmi : vectors.irq;
+	uint16_t pc = snes_cpu_registers_program_counter_get(cpu->registers) -
+				  cpu->current_instruction.operand_size - 1;
+	uint8_t p = snes_cpu_registers_status_flag_get(cpu->registers);
+
+	snes_cpu_idle_reset(cpu);
+	if(!emulation)
+		snes_cpu_stack_push(cpu->stack, snes_cpu_registers_program_bank_get(cpu->registers) >> 16);
+	snes_cpu_stack_push(cpu->stack, pc >> 8);
+	snes_cpu_stack_push(cpu->stack, pc);
+	//The B flag tells BRK from IRQ in emulation mode
+	snes_cpu_stack_push(cpu->stack, emulation ? p & ~STATUS_FLAG_B : p);
+
+	snes_cpu_registers_status_flag_set(cpu->registers, STATUS_FLAG_I);
+	snes_cpu_registers_status_flag_reset(cpu->registers, STATUS_FLAG_D);
+	snes_cpu_registers_program_bank_set(cpu->registers, 0);
+	snes_cpu_registers_program_counter_set(cpu->registers, vector);
+	//2 internal cycles and the vector fetch, the pushes went through the bus
+	*cpu->clock += 2 * SNES_BUS_FAST_CYCLES + 2 * snes_bus_get_access_cycles(cpu->bus, 0xFFFE);
+	snes_cpu_update_next_instruction(cpu);
+}
+
+//Wakes WAI on any line and services the NMI, or the IRQ when the I flag is clear
+static void snes_cpu_check_interrupts(snes_cpu_t *cpu)
+{
+	uint8_t lines = snes_irq_poll(snes_bus_get_irq(cpu->bus), *cpu->clock);
+
+	if(likely(lines == 0) || cpu->halt == SNES_CPU_HALT_STP)
+		return;
+	cpu->halt = SNES_CPU_HALT_NONE;
+	if(lines & SNES_IRQ_NMI)
+		snes_cpu_interrupt(cpu, SNES_IRQ_NMI);
+	else if(!snes_cpu_registers_status_flag_isset(cpu->registers, STATUS_FLAG_I))
+		snes_cpu_interrupt(cpu, SNES_IRQ_IRQ);
+}
+
+/*
+ * Halted core : the clock jumps to the next interrupt event (WAI, idle loop),
+ * never past cycle, the budget of the run. STP only waits for the end of the
+ * budget. An idle loop runs again once the event is reached.
+ */
+static void snes_cpu_skip_halt(snes_cpu_t *cpu, uint64_t cycle)
+{
+	uint64_t wake = UINT64_MAX;
+	uint64_t event;
+
+	if(cpu->halt != SNES_CPU_HALT_STP)
+		wake = snes_irq_next_event(snes_bus_get_irq(cpu->bus), *cpu->clock);
+	event = wake < cycle ? wake : cycle;
+	if(event <= *cpu->clock)
+		return;
+	if(cpu->halt == SNES_CPU_HALT_IDLE) {
+		cpu->stats.idle_cycles += event - *cpu->clock;
+		if(event == wake)
+			cpu->halt = SNES_CPU_HALT_NONE;
+	} else {
+		cpu->stats.halted_cycles += event - *cpu->clock;
+	}
+	*cpu->clock = event;
+}
+
+int snes_cpu_run_until(snes_cpu_t *cpu, uint64_t cycle)
+{
+	snes_irq_t *irq = snes_bus_get_irq(cpu->bus);
+	uint64_t now = snes_cpu_get_cycles(cpu);
+	uint64_t limit;
+	uint64_t count;
+	int ret = 0;
+
+	while(now < cycle) {
+		if(unlikely(cpu->halt != SNES_CPU_HALT_NONE)) {
+			snes_cpu_skip_halt(cpu, cycle);
+		} else {
+			//Interrupts are taken between runs : a run stops at the next event, or
+			//after an instruction that asked for a poll (snes_irq_get_poll)
+			limit = snes_irq_next_event(irq, now);
+			if(limit > cycle)
+				limit = cycle;
+			//Sized so that the budget is only overrun by the last instruction (or JIT block)
+			count = (limit - now) / SNES_CPU_MAX_INSTRUCTION_CYCLES;
+			if(count == 0)
+				count = 1;
+			else if(count > SNES_CPU_RUN_BATCH)
+				count = SNES_CPU_RUN_BATCH;
+			cpu->run_limit = limit;
+			ret = snes_cpu_run_instructions(cpu, count, 1);
+			if(ret)
+				break;
 		}
+		snes_cpu_check_interrupts(cpu);
+		now = snes_cpu_get_cycles(cpu);
 	}
-	return found;
+	cpu->run_limit = 0;
+	//The other chips run behind the CPU, bring them to the same time
+	snes_bus_catch_up(cpu->bus);
+	return ret;
+}
+
+int snes_cpu_run_cycles(snes_cpu_t *cpu, uint64_t cycles)
+{
+	return snes_cpu_run_until(cpu, snes_cpu_get_cycles(cpu) + cycles);
+}
+
+int snes_cpu_step(snes_cpu_t *cpu)
+{
+	uint64_t now = snes_cpu_get_cycles(cpu);
+	int ret = 0;
+
+	//Stopped until reset, a step has no budget to wait for
+	if(cpu->halt == SNES_CPU_HALT_STP)
+		return 0;
+	if(cpu->halt != SNES_CPU_HALT_NONE)
+		snes_cpu_skip_halt(cpu, snes_irq_next_event(snes_bus_get_irq(cpu->bus), now));
+	else
+		ret = snes_cpu_run_instructions(cpu, 1, 0);
+	snes_cpu_check_interrupts(cpu);
+	return ret;
+}
+
+void snes_cpu_reset(snes_cpu_t *cpu)
+{
+	snes_rom_t *rom = snes_cart_get_rom(cpu->cart);
+
+	cpu->halt = SNES_CPU_HALT_NONE;
+	snes_cpu_registers_emulation_set(cpu->registers);
+	snes_cpu_registers_status_flag_set(cpu->registers, STATUS_FLAG_M | STATUS_FLAG_X | STATUS_FLAG_I);
+	snes_cpu_registers_status_flag_reset(cpu->registers, STATUS_FLAG_D);
+	snes_cpu_registers_direct_page_set(cpu->registers, 0);
+	snes_cpu_registers_data_bank_set(cpu->registers, 0);
+	snes_cpu_registers_program_bank_set(cpu->registers, 0);
+	snes_cpu_registers_program_counter_set(cpu->registers, snes_rom_get_emu_interrupt_vectors(rom).reset);
+	snes_cpu_update_mode(cpu);
+	snes_cpu_update_next_instruction(cpu);
 }
 
+void snes_cpu_jump(snes_cpu_t *cpu, uint32_t addr)
+{
+	cpu->halt = SNES_CPU_HALT_NONE;
+	snes_cpu_idle_reset(cpu);
+	snes_cpu_registers_program_bank_set(cpu->registers, addr >> 16);
+	snes_cpu_registers_program_counter_set(cpu->registers, addr & 0xFFFF);
+	snes_cpu_update_next_instruction(cpu);
+}
+
+//Interactive mode : a thread running the synchronous API on the main thread's orders
 void *snes_cpu_execute(void *data)
 {
 	int        should_continue = 0;
 	int        run = 0;
+	int        ret;
 	snes_cpu_t *cpu            = (snes_cpu_t *) data;
 	for(;;) {
 		if (should_continue == 0) {
@@ -1886,13 +1071,20 @@ void *snes_cpu_execute(void *data)
 		if (cpu->exec_mode == SNES_CPU_EXECUTION_MODE_STOP) {
 			goto end;
 		}
-		if(run == 1 && unlikely(snes_cpu_is_breakpoint(cpu))) {
-			snes_cpu_dump(cpu);
-			printf("Breakpoint reached !\n");
-			should_continue = 0;
+		if(run == 1) {
+			ret = snes_cpu_run_cycles(cpu, SNES_CPU_RUN_BATCH_CYCLES);
+			if(ret) {
+				snes_cpu_dump(cpu);
+				if(ret == SNES_CPU_STOP_BREAKPOINT)
+					printf("Breakpoint reached !\n");
+				else if(ret == SNES_CPU_STOP_WATCHPOINT)
+					snes_cpu_print_watch_hit(cpu);
+				else
+					printf("JIT lockstep mismatch, execution stopped !\n");
+				should_continue = 0;
+			}
 		} else {
-			snes_cpu_execute_instruction(cpu);
-			snes_cpu_update_next_instruction(cpu);
+			snes_cpu_step(cpu);
 		}
 	}
 end:
@@ -1912,27 +1104,100 @@ void snes_cpu_power_down(snes_cpu_t *cpu)
 	pthread_join(cpu->execution_thread, NULL);
 }
 
+void snes_cpu_print_watch_hit(snes_cpu_t *cpu)
+{
+	snes_bus_watch_hit_t hit;
+
+	if(!snes_bus_get_watch_hit(cpu->bus, &hit))
+		return;
+	printf("Watchpoint reached : %s 0x%02X at 0x%06X !\n",
+		   hit.type == SNES_BUS_WATCH_READ ? "read" : "write", hit.value, hit.address);
+	snes_bus_clear_watch_hit(cpu->bus);
+}
+
 int snes_cpu_set_breakpoint(snes_cpu_t *cpu, uint32_t addr)
 {
-	int i;
-	int ret = -1;
-	
-	printf("Setting breakpoint 0x%x (%d)\n", addr, addr);
-	
-	for(i = 0; i < MAX_BREAKPOINTS; i++) {
-		if (cpu->breakpoints[i] == 0) {
-			cpu->breakpoints[i] = addr;
-			ret = 0;
-			break;
+	uint8_t **page;
+	uint32_t offset;
+
+	addr &= 0xFFFFFF;
+	page = &cpu->breakpoints[addr >> SNES_CPU_BREAKPOINT_PAGE_SHIFT];
+	if(*page == NULL) {
+		*page = calloc(1, SNES_CPU_BREAKPOINT_PAGE_BYTES);
+		if(*page == NULL) {
+			printf("Error at allocation time !\n");
+			return -1;
 		}
 	}
-	
-	return ret;
+	if(snes_cpu_breakpoint_isset(cpu, addr))
+		return 0;
+	offset = addr & SNES_CPU_BREAKPOINT_PAGE_MASK;
+	(*page)[offset >> 3] |= 1 << (offset & 7);
+	cpu->breakpoint_count++;
+	return 0;
+}
+
+//The bitmaps are kept until destroy : the execution thread may be reading them
+int snes_cpu_remove_breakpoint(snes_cpu_t *cpu, uint32_t addr)
+{
+	uint8_t *page;
+	uint32_t offset;
+
+	addr &= 0xFFFFFF;
+	if(!snes_cpu_breakpoint_isset(cpu, addr))
+		return -1;
+	page = cpu->breakpoints[addr >> SNES_CPU_BREAKPOINT_PAGE_SHIFT];
+	offset = addr & SNES_CPU_BREAKPOINT_PAGE_MASK;
+	page[offset >> 3] &= ~(1 << (offset & 7));
+	cpu->breakpoint_count--;
+	return 0;
+}
+
+uint32_t snes_cpu_get_breakpoints(snes_cpu_t *cpu, uint32_t *addrs, uint32_t max)
+{
+	uint32_t count = 0;
+	uint32_t page;
+	uint32_t offset;
+
+	for(page = 0; page < SNES_CPU_BREAKPOINT_PAGE_COUNT; page++) {
+		if(cpu->breakpoints[page] == NULL)
+			continue;
+		for(offset = 0; offset <= SNES_CPU_BREAKPOINT_PAGE_MASK; offset++) {
+			if(!((cpu->breakpoints[page][offset >> 3] >> (offset & 7)) & 1))
+				continue;
+			if(count < max)
+				addrs[count] = (page << SNES_CPU_BREAKPOINT_PAGE_SHIFT) | offset;
+			count++;
+		}
+	}
+	return count;
+}
+
+void snes_cpu_set_idle_skip(snes_cpu_t *cpu, uint8_t enable)
+{
+	cpu->idle_skip = enable;
+	snes_cpu_idle_reset(cpu);
+}
+
+int snes_cpu_set_jit(snes_cpu_t *cpu, snes_cpu_jit_mode mode)
+{
+	if(cpu->jit != NULL) {
+		snes_cpu_jit_destroy(cpu->jit);
+		cpu->jit = NULL;
+	}
+	if(mode == SNES_CPU_JIT_OFF)
+		return 0;
+
+	cpu->jit = snes_cpu_jit_init(cpu, mode == SNES_CPU_JIT_LOCKSTEP);
+	if(cpu->jit == NULL)
+		return -1;
+	return 0;
 }
 
 void snes_cpu_nmi(snes_cpu_t *cpu)
 {
-	snes_cpu_registers_program_counter_set(cpu->registers, snes_rom_get_nat_interrupt_vectors(snes_cart_get_rom(cpu->cart)).nmi);
+	cpu->halt = SNES_CPU_HALT_NONE;
+	snes_cpu_interrupt(cpu, SNES_IRQ_NMI);
 }
 
 void snes_cpu_set_execution_mode(snes_cpu_t *cpu, snes_cpu_execution_mode mode)
@@ -1942,3 +1207,31 @@ void snes_cpu_set_execution_mode(snes_cpu_t *cpu, snes_cpu_execution_mode mode)
 	pthread_cond_signal(&(cpu->cond));
 	pthread_mutex_unlock(&(cpu->lock));
 }
+
+uint64_t snes_cpu_get_cycles(snes_cpu_t *cpu)
+{
+	return *cpu->clock;
+}
+
+void snes_cpu_get_stats(snes_cpu_t *cpu, snes_cpu_stats_t *stats)
+{
+	struct timespec now;
+	double elapsed;
+	uint64_t lookups;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsed = (now.tv_sec - cpu->stats_start.tv_sec) +
+			  (now.tv_nsec - cpu->stats_start.tv_nsec) / 1e9;
+
+	*stats = cpu->stats;
+	stats->cycles = snes_cpu_get_cycles(cpu);
+	lookups = stats->cache_hits + stats->cache_misses;
+	stats->hit_rate = lookups ? (double)stats->cache_hits / lookups : 0;
+	stats->instructions_per_second = elapsed > 0 ? stats->instructions / elapsed : 0;
+}
+
+void snes_cpu_reset_stats(snes_cpu_t *cpu)
+{
+	memset(&cpu->stats, 0, sizeof(snes_cpu_stats_t));
+	clock_gettime(CLOCK_MONOTONIC, &cpu->stats_start);
+}
@@ -1,6 +1,8 @@
 #ifndef SNES_CPU_H
 #define SNES_CPU_H
 
+#include <stdio.h>
+
 #include "snes_cart.h"
 #include "snes_bus.h"
 #include "snes_cpu_registers.h"
@@ -16,6 +18,31 @@ typedef enum {
 	SNES_CPU_EXECUTION_MODE_UNKNOWN,
 } snes_cpu_execution_mode;
 
+//Reasons for a run to stop before its budget
+#define SNES_CPU_STOP_BREAKPOINT 1
+#define SNES_CPU_STOP_LOCKSTEP 2
+#define SNES_CPU_STOP_WATCHPOINT 3 //See snes_bus_add_watchpoint
+
+typedef enum {
+	SNES_CPU_JIT_OFF = 0,
+	SNES_CPU_JIT_ON,
+	SNES_CPU_JIT_LOCKSTEP, //Each block is replayed by the interpreter and compared
+} snes_cpu_jit_mode;
+
+typedef struct {
+	uint64_t instructions;
+	uint64_t jit_instructions;
+	uint64_t jit_blocks;
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+	uint64_t cycles; //Master clock, not reset with the statistics
+	uint64_t halted_cycles; //Skipped in WAI or STP
+	uint64_t idle_cycles; //Skipped in detected idle loops
+	uint64_t upload_bytes; //Sent to the APU by the upload loop fast path
+	double hit_rate;
+	double instructions_per_second;
+} snes_cpu_stats_t;
+
 snes_cpu_t *snes_cpu_init(snes_cart_t *cart, snes_bus_t *bus);
 void snes_cpu_destroy(snes_cpu_t *cpu);
 
@@ -26,7 +53,52 @@ snes_cpu_registers_t *snes_cpu_get_registers(snes_cpu_t *cpu);
 snes_cpu_stack_t *snes_cpu_get_stack(snes_cpu_t *cpu);
 snes_bus_t *snes_cpu_get_bus(snes_cpu_t *cpu);
 
+/*
+ * Execution breakpoints on 24 bits addresses. snes_cpu_get_breakpoints fills
+ * addrs with up to max addresses and returns the number of breakpoints.
+ */
 int snes_cpu_set_breakpoint(snes_cpu_t *cpu, uint32_t addr);
+int snes_cpu_remove_breakpoint(snes_cpu_t *cpu, uint32_t addr);
+uint32_t snes_cpu_get_breakpoints(snes_cpu_t *cpu, uint32_t *addrs, uint32_t max);
+/*Prints and clears the pending watchpoint hit of the bus*/
+void snes_cpu_print_watch_hit(snes_cpu_t *cpu);
+
+/*
+ * Synchronous execution on the caller's thread, without any locking : not to
+ * be mixed with the execution thread running. Runs until the master clock
+ * reaches cycle (snes_cpu_run_until) or for at least cycles master cycles.
+ * Interrupts are taken between instructions, a core halted by WAI jumps to the
+ * next interrupt event. Returns 0 or the SNES_CPU_STOP_* reason. A run starting on a breakpoint
+ * stops right away, snes_cpu_step goes over it.
+ */
+int snes_cpu_run_until(snes_cpu_t *cpu, uint64_t cycle);
+int snes_cpu_run_cycles(snes_cpu_t *cpu, uint64_t cycles);
+int snes_cpu_step(snes_cpu_t *cpu);
+/*Reset line : leaves STP and restarts from the reset vector in emulation mode*/
+void snes_cpu_reset(snes_cpu_t *cpu);
+/*Leaves STP or WAI and continues at the 24 bits address addr, for benchmarks and tools*/
+void snes_cpu_jump(snes_cpu_t *cpu, uint32_t addr);
+/*Forces an NMI, whatever the state of $4200*/
+void snes_cpu_nmi(snes_cpu_t *cpu);
 void snes_cpu_set_execution_mode(snes_cpu_t *cpu, snes_cpu_execution_mode mode);
 
+/*Write one line per executed instruction in trace, NULL to disable*/
+void snes_cpu_set_trace(snes_cpu_t *cpu, FILE *trace);
+
+/*Select the execution core, to be called before power up. Returns -1 if the JIT is unavailable*/
+int snes_cpu_set_jit(snes_cpu_t *cpu, snes_cpu_jit_mode mode);
+
+/*
+ * Idle loop skipping (on by default) : a loop polling plain memory jumps to the
+ * next interrupt event. To be disabled for accuracy testing.
+ */
+void snes_cpu_set_idle_skip(snes_cpu_t *cpu, uint8_t enable);
+
+/*Master clock (21.477 MHz NTSC) cycles elapsed since power up*/
+#define SNES_MASTER_CLOCK 21477272
+uint64_t snes_cpu_get_cycles(snes_cpu_t *cpu);
+
+void snes_cpu_get_stats(snes_cpu_t *cpu, snes_cpu_stats_t *stats);
+void snes_cpu_reset_stats(snes_cpu_t *cpu);
+
 #endif //SNES_BUS_H
@@ -105,6 +105,7 @@ static struct snes_effective_address snes_cpu_addressing_mode_resolve_absolute_i
 {
 	struct snes_effective_address eff_addr;
 	eff_addr.type = SNES_ADDRESS_TYPE_SIMPLE;
+	eff_addr.simple_address = 0;
 
 	eff_addr.simple_address += snes_bus_read(bus, ind_addr);
 	eff_addr.simple_address += (snes_bus_read(bus, ind_addr + 1) << 8);
@@ -154,16 +155,21 @@ static struct snes_effective_address snes_cpu_addressing_mode_resolve_block_move
 
 	eff_addr.type = SNES_ADDRESS_TYPE_BLOCK_MOVE;
 
+	//Operand is the destination bank followed by the source bank
+	eff_addr.src = (addr & 0xFF00) << 8;
+	eff_addr.dest = (addr & 0xFF) << 16;
+
 	if(x.len == CPU_REGISTER_8_BIT)
-		eff_addr.src = x.value8_low;
+		eff_addr.src |= x.value8_low;
 	else
-		eff_addr.src = x.value16;
+		eff_addr.src |= x.value16;
 
 	if(y.len == CPU_REGISTER_8_BIT)
-		eff_addr.dest = y.value8_low;
+		eff_addr.dest |= y.value8_low;
 	else
-		eff_addr.dest = y.value16;
+		eff_addr.dest |= y.value16;
 
+	//The full 16 bits accumulator is used whatever M
 	eff_addr.count = acc.value16 + 1;
 
 	//Specific method should be called
@@ -252,6 +258,7 @@ static struct snes_effective_address snes_cpu_addressing_mode_resolve_direct_pag
 	uint32_t ind_addr = addr + snes_cpu_registers_direct_page_get(registers);
 
 	eff_addr.type = SNES_ADDRESS_TYPE_SIMPLE;
+	eff_addr.simple_address = 0;
 
 	eff_addr.simple_address += snes_bus_read(bus, ind_addr);
 	eff_addr.simple_address += snes_bus_read(bus, ind_addr + 1) << 8;
@@ -395,74 +402,187 @@ static struct snes_effective_address snes_cpu_addressing_mode_resolve_stack_rela
 	return eff_addr;
 }
 
+SNES_CPU_ADDRESSING_MODE_RESOLVER(Absolute)
+{
+	return snes_cpu_addressing_mode_resolve_absolute(registers, mne, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(AbsoluteIndexedX)
+{
+	return snes_cpu_addressing_mode_resolve_absolute_idx_x(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(AbsoluteIndexedY)
+{
+	return snes_cpu_addressing_mode_resolve_absolute_idx_y(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(AbsoluteIndexedIndirect)
+{
+	return snes_cpu_addressing_mode_resolve_absolute_idx_ind(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(AbsoluteIndirect)
+{
+	return snes_cpu_addressing_mode_resolve_absolute_ind(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(AbsoluteIndirectLong)
+{
+	return snes_cpu_addressing_mode_resolve_absolute_ind_long(bus, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(AbsoluteLong)
+{
+	return snes_cpu_addressing_mode_resolve_absolute_long(addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(AbsoluteLongIndexedX)
+{
+	return snes_cpu_addressing_mode_resolve_absolute_long_idx_x(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(Accumulator)
+{
+	return snes_cpu_addressing_mode_resolve_acc(registers);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(BlockMove)
+{
+	return snes_cpu_addressing_mode_resolve_block_move(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPage)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPageIndexedX)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page_idx_x(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPageIndexedY)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page_idx_y(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPageIndexedIndirectX)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page_idx_ind_x(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPageIndirect)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page_ind(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPageIndirectLong)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page_ind_long(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPageIndirectIndexedY)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page_ind_idx_y(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(DirectPageIndirectLongIndexedY)
+{
+	return snes_cpu_addressing_mode_resolve_direct_page_ind_long_idx_y(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(Immediate)
+{
+	return snes_cpu_addressing_mode_resolve_immediate(addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(ProgramCounterRelative)
+{
+	return snes_cpu_addressing_mode_resolve_program_counter_relative(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(ProgramCounterRelativeLong)
+{
+	return snes_cpu_addressing_mode_resolve_program_counter_relative_long(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackAbsolute)
+{
+	return snes_cpu_addressing_mode_resolve_stack_relative_absolute(addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackDirectPageIndirect)
+{
+	return snes_cpu_addressing_mode_resolve_stack_relative_direct_page_ind(bus, registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackProgramCounterRelativeLong)
+{
+	return snes_cpu_addressing_mode_resolve_stack_relative_program_counter_relative_long(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackRelative)
+{
+	return snes_cpu_addressing_mode_resolve_stack_relative(registers, addr);
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackRelativeIndirectIndexedY)
+{
+	return snes_cpu_addressing_mode_resolve_stack_relative_ind_idx_y(bus, registers, addr);
+}
+
+static struct snes_effective_address snes_cpu_addressing_mode_resolve_none(void)
+{
+	struct snes_effective_address eff_addr;
+	memset(&eff_addr, 0, sizeof(struct snes_effective_address));
+	return eff_addr;
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(Implied)
+{
+	return snes_cpu_addressing_mode_resolve_none();
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackInterrupt)
+{
+	return snes_cpu_addressing_mode_resolve_none();
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackPull)
+{
+	return snes_cpu_addressing_mode_resolve_none();
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackPush)
+{
+	return snes_cpu_addressing_mode_resolve_none();
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackRTI)
+{
+	return snes_cpu_addressing_mode_resolve_none();
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackRTL)
+{
+	return snes_cpu_addressing_mode_resolve_none();
+}
+
+SNES_CPU_ADDRESSING_MODE_RESOLVER(StackRTS)
+{
+	return snes_cpu_addressing_mode_resolve_none();
+}
+
+#define SNES_CPU_ADDRESSING_MODE_CASE(mode) \
+		case mode: \
+			return snes_cpu_addressing_mode_##mode(bus, registers, mne, addr);
+
 struct snes_effective_address snes_cpu_addressing_mode_decode(snes_bus_t *bus,  snes_cpu_registers_t *registers, snes_cpu_mnemonic_t mne, snes_cpu_addressing_mode_t mode, uint32_t addr)
 {
 	switch(mode) {
-		case Absolute:
-			return snes_cpu_addressing_mode_resolve_absolute(registers, mne, addr);
-		case AbsoluteIndexedX:
-			return snes_cpu_addressing_mode_resolve_absolute_idx_x(registers, addr);
-		case AbsoluteIndexedY:
-			return snes_cpu_addressing_mode_resolve_absolute_idx_y(registers, addr);
-		case AbsoluteIndexedIndirect:
-			return snes_cpu_addressing_mode_resolve_absolute_idx_ind(bus, registers, addr);
-		case AbsoluteIndirect:
-			return snes_cpu_addressing_mode_resolve_absolute_ind(bus, registers, addr);
-		case AbsoluteIndirectLong:
-			return snes_cpu_addressing_mode_resolve_absolute_ind_long(bus, addr);
-		case AbsoluteLong:
-			return snes_cpu_addressing_mode_resolve_absolute_long(addr);
-		case AbsoluteLongIndexedX:
-			return snes_cpu_addressing_mode_resolve_absolute_long_idx_x(registers, addr);
-		case Accumulator:
-			return snes_cpu_addressing_mode_resolve_acc(registers);
-		case BlockMove:
-			return snes_cpu_addressing_mode_resolve_block_move(registers, addr);
-		case DirectPage:
-			return snes_cpu_addressing_mode_resolve_direct_page(registers, addr);
-		case DirectPageIndexedX:
-			return snes_cpu_addressing_mode_resolve_direct_page_idx_x(registers, addr);
-		case DirectPageIndexedY:
-			return snes_cpu_addressing_mode_resolve_direct_page_idx_y(registers, addr);
-		case DirectPageIndexedIndirectX:
-			return snes_cpu_addressing_mode_resolve_direct_page_idx_ind_x(bus, registers, addr);
-		case DirectPageIndirect:
-			return snes_cpu_addressing_mode_resolve_direct_page_ind(bus, registers, addr);
-		case DirectPageIndirectLong:
-			return snes_cpu_addressing_mode_resolve_direct_page_ind_long(bus, registers, addr);
-		case DirectPageIndirectIndexedY:
-			return snes_cpu_addressing_mode_resolve_direct_page_ind_idx_y(bus, registers, addr);
-		case DirectPageIndirectLongIndexedY:
-			return snes_cpu_addressing_mode_resolve_direct_page_ind_long_idx_y(bus, registers, addr);
-		case Immediate:
-			return snes_cpu_addressing_mode_resolve_immediate(addr);
-		case ProgramCounterRelative:
-			return snes_cpu_addressing_mode_resolve_program_counter_relative(registers, addr);
-		case ProgramCounterRelativeLong:
-			return snes_cpu_addressing_mode_resolve_program_counter_relative_long(registers, addr);
-		case StackAbsolute:
-			return snes_cpu_addressing_mode_resolve_stack_relative_absolute(addr);
-		case StackDirectPageIndirect:
-			return snes_cpu_addressing_mode_resolve_stack_relative_direct_page_ind(bus, registers, addr);
-		case StackProgramCounterRelativeLong:
-			return snes_cpu_addressing_mode_resolve_stack_relative_program_counter_relative_long(registers, addr);
-		case StackRelative:
-			return snes_cpu_addressing_mode_resolve_stack_relative(registers, addr);
-		case StackRelativeIndirectIndexedY:
-			return snes_cpu_addressing_mode_resolve_stack_relative_ind_idx_y(bus, registers, addr);
-
-		case Implied:
-		case StackInterrupt:
-		case StackPull:
-		case StackPush:
-		case StackRTI:
-		case StackRTL:
-		case StackRTS:
+		SNES_CPU_ADDRESSING_MODES(SNES_CPU_ADDRESSING_MODE_CASE)
 		default:
-		{
-			struct snes_effective_address eff_addr;
-			memset(&eff_addr, 0, sizeof(struct snes_effective_address));
-			return eff_addr;
-		}
+			return snes_cpu_addressing_mode_resolve_none();
 	}
 }
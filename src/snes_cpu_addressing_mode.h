@@ -8,5 +8,12 @@
 #include "snes_cpu_defs.h"
 
 
+/*One resolver per addressing mode, so that a dispatcher knowing the mode can call it directly*/
+#define SNES_CPU_ADDRESSING_MODE_RESOLVER(mode) \
+	struct snes_effective_address snes_cpu_addressing_mode_##mode(snes_bus_t *bus, snes_cpu_registers_t *registers, snes_cpu_mnemonic_t mne, uint32_t addr)
+
+#define SNES_CPU_ADDRESSING_MODE_DECLARE(mode) SNES_CPU_ADDRESSING_MODE_RESOLVER(mode);
+SNES_CPU_ADDRESSING_MODES(SNES_CPU_ADDRESSING_MODE_DECLARE)
+
 struct snes_effective_address snes_cpu_addressing_mode_decode(snes_bus_t *bus,  snes_cpu_registers_t *registers, snes_cpu_mnemonic_t mne, snes_cpu_addressing_mode_t mode, uint32_t relative_address);
 #endif //SNES_CPU_ADDRESSING_MODE_H
@@ -3,139 +3,63 @@
 
 #include <stdint.h>
 
+#define SNES_CPU_MNEMONICS(X) \
+	X(ADC) X(AND) X(ASL) X(BCC) X(BCS) X(BEQ) X(BIT) X(BMI) \
+	X(BNE) X(BLP) X(BRA) X(BRK) X(BRL) X(BVC) X(BVS) X(CLC) \
+	X(CLD) X(CLI) X(CLV) X(CMP) X(COP) X(CPX) X(CPY) X(DEC) \
+	X(DEX) X(DEY) X(EOR) X(INC) X(INX) X(INY) X(JMP) X(JSR) \
+	X(LDA) X(LDX) X(LDY) X(LSR) X(MVN) X(MVP) X(NOP) X(ORA) \
+	X(PEA) X(PEI) X(PER) X(PHA) X(PHB) X(PHD) X(PHK) X(PHP) \
+	X(PHX) X(PHY) X(PLA) X(PLB) X(PLD) X(PLP) X(PLX) X(PLY) \
+	X(REP) X(ROL) X(ROR) X(RTI) X(RTL) X(RTS) X(SBC) X(SEC) \
+	X(SED) X(SEI) X(SEP) X(STA) X(STP) X(STX) X(STY) X(STZ) \
+	X(TAX) X(TAY) X(TCD) X(TCS) X(TDC) X(TRB) X(TSB) X(TSC) \
+	X(TSX) X(TXA) X(TXS) X(TXY) X(TYA) X(TYX) X(WAI) X(WDM) \
+	X(XBA) X(XCE)
+
+#define SNES_CPU_ENUM_ENTRY(name) name,
+
 typedef enum {
-	ADC,
-	AND,
-	ASL,
-	BCC,
-	BCS,
-	BEQ,
-	BIT,
-	BMI,
-	BNE,
-	BLP,
-	BRA,
-	BRK,
-	BRL,
-	BVC,
-	BVS,
-	CLC,
-	CLD,
-	CLI,
-	CLV,
-	CMP,
-	COP,
-	CPX,
-	CPY,
-	DEC,
-	DEX,
-	DEY,
-	EOR,
-	INC,
-	INX,
-	INY,
-	JMP,
-	JSR,
-	LDA,
-	LDX,
-	LDY,
-	LSR,
-	MVN,
-	MVP,
-	NOP,
-	ORA,
-	PEA,
-	PEI,
-	PER,
-	PHA,
-	PHB,
-	PHD,
-	PHK,
-	PHP,
-	PHX,
-	PHY,
-	PLA,
-	PLB,
-	PLD,
-	PLP,
-	PLX,
-	PLY,
-	REP,
-	ROL,
-	ROR,
-	RTI,
-	RTL,
-	RTS,
-	SBC,
-	SEC,
-	SED,
-	SEI,
-	SEP,
-	STA,
-	STP,
-	STX,
-	STY,
-	STZ,
-	TAX,
-	TAY,
-	TCD,
-	TCS,
-	TDC,
-	TRB,
-	TSB,
-	TSC,
-	TSX,
-	TXA,
-	TXS,
-	TXY,
-	TYA,
-	TYX,
-	WAI,
-	WDM,
-	XBA,
-	XCE,
+	SNES_CPU_MNEMONICS(SNES_CPU_ENUM_ENTRY)
 	MAXMNE,
 } snes_cpu_mnemonic_t;
 
 
 
+#define SNES_CPU_ADDRESSING_MODES(X) \
+	X(Absolute) X(AbsoluteIndexedX) X(AbsoluteIndexedY) X(AbsoluteIndexedIndirect) \
+	X(AbsoluteIndirect) X(AbsoluteIndirectLong) X(AbsoluteLong) X(AbsoluteLongIndexedX) \
+	X(Accumulator) X(BlockMove) X(DirectPage) X(DirectPageIndexedX) \
+	X(DirectPageIndexedY) X(DirectPageIndexedIndirectX) X(DirectPageIndirect) X(DirectPageIndirectLong) \
+	X(DirectPageIndirectIndexedY) X(DirectPageIndirectLongIndexedY) X(Immediate) X(Implied) \
+	X(ProgramCounterRelative) X(ProgramCounterRelativeLong) X(StackAbsolute) X(StackDirectPageIndirect) \
+	X(StackInterrupt) X(StackProgramCounterRelativeLong) X(StackPull) X(StackPush) \
+	X(StackRTI) X(StackRTL) X(StackRTS) X(StackRelative) \
+	X(StackRelativeIndirectIndexedY)
+
 typedef enum {
-	Absolute = 0,
-	AbsoluteIndexedX,
-	AbsoluteIndexedY,
-	AbsoluteIndexedIndirect,
-	AbsoluteIndirect,
-	AbsoluteIndirectLong,
-	AbsoluteLong,
-	AbsoluteLongIndexedX,
-	Accumulator,
-	BlockMove,
-	DirectPage,
-	DirectPageIndexedX,
-	DirectPageIndexedY,
-	DirectPageIndexedIndirectX,
-	DirectPageIndirect,
-	DirectPageIndirectLong,
-	DirectPageIndirectIndexedY,
-	DirectPageIndirectLongIndexedY,
-	Immediate,
-	Implied,
-	ProgramCounterRelative,
-	ProgramCounterRelativeLong,
-	StackAbsolute,
-	StackDirectPageIndirect,
-	StackInterrupt,
-	StackProgramCounterRelativeLong,
-	StackPull,
-	StackPush,
-	StackRTI,
-	StackRTL,
-	StackRTS,
-	StackRelative,
-	StackRelativeIndirectIndexedY
+	SNES_CPU_ADDRESSING_MODES(SNES_CPU_ENUM_ENTRY)
 } snes_cpu_addressing_mode_t;
 
 
+/*
+ * Register width modes the instruction handlers are specialised for :
+ * name, 16 bits accumulator, 16 bits index registers, emulation
+ */
+#define SNES_CPU_MODES(X) \
+	X(M8X8, 0, 0, 0) \
+	X(M8X16, 0, 1, 0) \
+	X(M16X8, 1, 0, 0) \
+	X(M16X16, 1, 1, 0) \
+	X(EMU, 0, 0, 1)
+
+#define SNES_CPU_MODE_ENUM_ENTRY(name, m16, x16, emu) SNES_CPU_MODE_##name,
+
+typedef enum {
+	SNES_CPU_MODES(SNES_CPU_MODE_ENUM_ENTRY)
+	SNES_CPU_MODE_COUNT,
+} snes_cpu_mode_t;
+
 enum snes_address_type{
 	SNES_ADDRESS_TYPE_SIMPLE,
 	SNES_ADDRESS_TYPE_BLOCK_MOVE,
@@ -151,7 +75,7 @@ struct snes_effective_address{
 		struct{
 			uint32_t dest;
 			uint32_t src;
-			uint16_t count;
+			uint32_t count;
 		};
 	};
 };
@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "snes_cpu_dispatch.h"
+#include "snes_cpu_internal.h"
+#include "snes_cpu_opcodes.h"
+#include "snes_cpu_addressing_mode.h"
+#include "snes_cpu_mne.h"
+#include "snes_cpu_idle.h"
+
+//Use GCC labels as values when available, a plain switch otherwise
+#if defined(__GNUC__) && !defined(SNES_CPU_DISPATCH_SWITCH)
+#define SNES_CPU_DISPATCH_COMPUTED_GOTO
+#endif
+
+#ifdef SNES_CPU_DISPATCH_COMPUTED_GOTO
+#define SNES_CPU_DISPATCH_LABEL(opcode, variant) [opcode] = &&op_##opcode##_##variant,
+#define SNES_CPU_DISPATCH_CASE(opcode, variant) op_##opcode##_##variant
+#define SNES_CPU_DISPATCH_BEGIN() goto *dispatch_table[cpu->current_instruction.word];
+#define SNES_CPU_DISPATCH_JUMP() goto *dispatch_table[cpu->current_instruction.word];
+#define SNES_CPU_DISPATCH_END()
+#define SNES_CPU_DISPATCH_SET_MODE() dispatch_table = dispatch_tables[cpu->mode];
+#else
+#define SNES_CPU_DISPATCH_CASE(opcode, variant) case (opcode) | (SNES_CPU_MODE_##variant << 8)
+#define SNES_CPU_DISPATCH_BEGIN() switch(cpu->current_instruction.word | (mode << 8)) {
+#define SNES_CPU_DISPATCH_JUMP() break;
+#define SNES_CPU_DISPATCH_END() }
+#define SNES_CPU_DISPATCH_SET_MODE() mode = cpu->mode;
+#endif
+
+#define SNES_CPU_DISPATCH_NEXT() \
+	{ \
+		cpu->stats.instructions++; \
+		snes_cpu_update_next_instruction(cpu); \
+		if(unlikely(++executed >= count)) \
+			goto end; \
+		if(unlikely(*cpu->irq_poll)) \
+			goto end; \
+		if(check_breakpoints && unlikely((breakpoint = snes_cpu_is_breakpoint(cpu)) != 0)) \
+			goto end; \
+		if(unlikely(cpu->trace != NULL)) \
+			snes_cpu_trace_instruction(cpu); \
+	} \
+	SNES_CPU_DISPATCH_JUMP()
+
+//REP, SEP, XCE, PLP and RTI swap the active table, WAI, STP and idle loops leave the loop
+#define SNES_CPU_DISPATCH_HANDLER(opcode, mne, mode, variant) \
+	SNES_CPU_DISPATCH_CASE(opcode, variant): \
+		if(SNES_CPU_MNE_LOOPS(mne)) \
+			next_pc = snes_cpu_registers_program_counter_get(registers); \
+		if(SNES_CPU_MNE_UNMASKS(mne)) \
+			status = snes_cpu_registers_status_flag_get(registers); \
+		eff_addr = snes_cpu_addressing_mode_##mode(bus, registers, mne, cpu->current_instruction.operand); \
+		snes_cpu_mne_execute_##mne##_##variant(eff_addr, registers, bus, stack); \
+		snes_cpu_add_cycles(cpu, cpu->current_instruction.timing, cpu->current_instruction.operand, &eff_addr); \
+		if(SNES_CPU_MNE_SWITCHES_MODE(mne)) { \
+			snes_cpu_update_mode(cpu); \
+			SNES_CPU_DISPATCH_SET_MODE() \
+		} \
+		if(SNES_CPU_MNE_UNMASKS(mne)) \
+			snes_cpu_unmask(cpu, status); \
+		if(SNES_CPU_MNE_HALTS(mne) || (SNES_CPU_MNE_LOOPS(mne) && unlikely(snes_cpu_idle_loop(cpu, next_pc)))) { \
+			if(SNES_CPU_MNE_HALTS(mne)) \
+				snes_cpu_halt(cpu, mne); \
+			cpu->stats.instructions++; \
+			snes_cpu_update_next_instruction(cpu); \
+			goto end; \
+		} \
+		SNES_CPU_DISPATCH_NEXT()
+
+#define SNES_CPU_DISPATCH_LABEL_M8X8(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_LABEL(opcode, M8X8)
+#define SNES_CPU_DISPATCH_LABEL_M8X16(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_LABEL(opcode, M8X16)
+#define SNES_CPU_DISPATCH_LABEL_M16X8(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_LABEL(opcode, M16X8)
+#define SNES_CPU_DISPATCH_LABEL_M16X16(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_LABEL(opcode, M16X16)
+#define SNES_CPU_DISPATCH_LABEL_EMU(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_LABEL(opcode, EMU)
+
+#define SNES_CPU_DISPATCH_HANDLER_M8X8(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_HANDLER(opcode, mne, mode, M8X8)
+#define SNES_CPU_DISPATCH_HANDLER_M8X16(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_HANDLER(opcode, mne, mode, M8X16)
+#define SNES_CPU_DISPATCH_HANDLER_M16X8(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_HANDLER(opcode, mne, mode, M16X8)
+#define SNES_CPU_DISPATCH_HANDLER_M16X16(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_HANDLER(opcode, mne, mode, M16X16)
+#define SNES_CPU_DISPATCH_HANDLER_EMU(opcode, mne, mode, cycles) SNES_CPU_DISPATCH_HANDLER(opcode, mne, mode, EMU)
+
+int snes_cpu_dispatch_run(snes_cpu_t *cpu, uint32_t count, uint8_t check_breakpoints)
+{
+	snes_cpu_registers_t *registers = cpu->registers;
+	snes_bus_t *bus = cpu->bus;
+	snes_cpu_stack_t *stack = cpu->stack;
+	struct snes_effective_address eff_addr;
+	uint16_t next_pc = 0;
+	uint8_t status = 0;
+	uint32_t executed = 0;
+	int breakpoint = 0;
+#ifdef SNES_CPU_DISPATCH_COMPUTED_GOTO
+	static const void *const dispatch_tables[SNES_CPU_MODE_COUNT][256] = {
+		[SNES_CPU_MODE_M8X8] = { SNES_CPU_OPCODES(SNES_CPU_DISPATCH_LABEL_M8X8) },
+		[SNES_CPU_MODE_M8X16] = { SNES_CPU_OPCODES(SNES_CPU_DISPATCH_LABEL_M8X16) },
+		[SNES_CPU_MODE_M16X8] = { SNES_CPU_OPCODES(SNES_CPU_DISPATCH_LABEL_M16X8) },
+		[SNES_CPU_MODE_M16X16] = { SNES_CPU_OPCODES(SNES_CPU_DISPATCH_LABEL_M16X16) },
+		[SNES_CPU_MODE_EMU] = { SNES_CPU_OPCODES(SNES_CPU_DISPATCH_LABEL_EMU) },
+	};
+	const void *const *dispatch_table;
+#else
+	snes_cpu_mode_t mode;
+#endif
+
+	if(count == 0)
+		return 0;
+	if(check_breakpoints && (breakpoint = snes_cpu_is_breakpoint(cpu)) != 0)
+		return breakpoint;
+	if(unlikely(cpu->trace != NULL))
+		snes_cpu_trace_instruction(cpu);
+
+	SNES_CPU_DISPATCH_SET_MODE()
+	for(;;) {
+		SNES_CPU_DISPATCH_BEGIN()
+		SNES_CPU_OPCODES(SNES_CPU_DISPATCH_HANDLER_M8X8)
+		SNES_CPU_OPCODES(SNES_CPU_DISPATCH_HANDLER_M8X16)
+		SNES_CPU_OPCODES(SNES_CPU_DISPATCH_HANDLER_M16X8)
+		SNES_CPU_OPCODES(SNES_CPU_DISPATCH_HANDLER_M16X16)
+		SNES_CPU_OPCODES(SNES_CPU_DISPATCH_HANDLER_EMU)
+		SNES_CPU_DISPATCH_END()
+	}
+end:
+	return breakpoint;
+}
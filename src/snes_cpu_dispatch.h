@@ -0,0 +1,15 @@
+#ifndef SNES_CPU_DISPATCH_H
+#define SNES_CPU_DISPATCH_H
+
+#include <stdint.h>
+#include "snes_cpu.h"
+
+/*
+ * Threaded interpreter core : dispatches directly on the opcode, each handler
+ * having its addressing mode fused in.
+ * Executes up to count instructions, returns SNES_CPU_STOP_BREAKPOINT or
+ * SNES_CPU_STOP_WATCHPOINT if it stopped on a breakpoint or a watchpoint.
+ */
+int snes_cpu_dispatch_run(snes_cpu_t *cpu, uint32_t count, uint8_t check_breakpoints);
+
+#endif //SNES_CPU_DISPATCH_H
@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_cpu_idle.h"
+#include "snes_cpu_upload.h"
+#include "snes_cpu_registers.h"
+
+#define SNES_CPU_IDLE_VALID (1u << 31)
+
+//Instructions only changing registers and flags
+static uint8_t snes_cpu_idle_mne_is_safe(snes_cpu_mnemonic_t mne, snes_cpu_addressing_mode_t mode)
+{
+	switch(mne) {
+		case LDA: case LDX: case LDY:
+		case CMP: case CPX: case CPY: case BIT:
+		case AND: case ORA: case EOR: case ADC: case SBC:
+		case TAX: case TAY: case TXA: case TYA: case TXY: case TYX: case TSX: case TDC:
+		case INX: case INY: case DEX: case DEY:
+		case CLC: case SEC: case CLV: case NOP: case XBA:
+			return 1;
+		case INC: case DEC: case ASL: case LSR: case ROL: case ROR:
+			return mode == Accumulator;
+		default:
+			return 0;
+	}
+}
+
+//Both bytes of the data must be plain memory, MMIO reads may have side effects
+static uint8_t snes_cpu_idle_is_memory(snes_cpu_t *cpu, uint32_t addr)
+{
+	return snes_bus_is_memory(cpu->bus, addr) && snes_bus_is_memory(cpu->bus, addr + 1);
+}
+
+static uint8_t snes_cpu_idle_access_is_safe(snes_cpu_t *cpu, snes_cpu_instruction_t *instruction, uint8_t dbr, uint16_t d)
+{
+	switch(instruction->opcode.addr) {
+		case Immediate:
+		case Implied:
+		case Accumulator:
+			return 1;
+		case Absolute:
+			return snes_cpu_idle_is_memory(cpu, (dbr << 16) + (instruction->operand & 0xFFFF));
+		case AbsoluteLong:
+			return snes_cpu_idle_is_memory(cpu, instruction->operand);
+		case DirectPage:
+			return snes_cpu_idle_is_memory(cpu, (uint16_t)(d + instruction->operand));
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Walks the loop body from the branch target up to the branch : every branch
+ * must stay in the loop and no instruction may write memory or read MMIO.
+ */
+static uint8_t snes_cpu_idle_analyze(snes_cpu_t *cpu, uint32_t pbr, uint16_t start, uint16_t next_pc,
+									 uint8_t dbr, uint16_t d)
+{
+	snes_cpu_instruction_t instruction;
+	uint16_t pc = start;
+	uint16_t target;
+
+	while(pc < next_pc) {
+		if(!snes_bus_is_memory(cpu->bus, pbr + pc))
+			return 0;
+		snes_cpu_decode_instruction(cpu, pbr, pc, &instruction);
+		pc += instruction.operand_size + 1;
+		if(SNES_CPU_MNE_LOOPS(instruction.opcode.mne)) {
+			if(instruction.opcode.addr == ProgramCounterRelative)
+				target = pc + (int8_t)instruction.operand;
+			else if(instruction.opcode.addr == ProgramCounterRelativeLong)
+				target = pc + (int16_t)instruction.operand;
+			else if(instruction.opcode.addr == Absolute)
+				target = instruction.operand;
+			else
+				return 0;
+			if(target < start || target >= next_pc)
+				return 0;
+		} else if(!snes_cpu_idle_mne_is_safe(instruction.opcode.mne, instruction.opcode.addr) ||
+				  !snes_cpu_idle_access_is_safe(cpu, &instruction, dbr, d)) {
+			return 0;
+		}
+	}
+	//The branch must end the body, not be in the middle of an instruction
+	return pc == next_pc;
+}
+
+static snes_cpu_idle_entry_t *snes_cpu_idle_lookup(snes_cpu_t *cpu, uint32_t pbr, uint16_t start, uint16_t next_pc)
+{
+	uint32_t addr = pbr + next_pc;
+	uint32_t tag = SNES_CPU_IDLE_VALID | (snes_cpu_get_decode_state(cpu) << 24) | addr;
+	snes_cpu_idle_entry_t *entry = &cpu->idle_cache[(addr ^ (addr >> 8)) & (SNES_CPU_IDLE_CACHE_SIZE - 1)];
+	uint8_t dbr = snes_cpu_registers_data_bank_get(cpu->registers) >> 16;
+	uint16_t d = snes_cpu_registers_direct_page_get(cpu->registers);
+	int first_page;
+	int last_page;
+
+	if(entry->tag == tag && entry->dbr == dbr && entry->d == d &&
+	   (!entry->ram || entry->generation == snes_bus_get_code_generation(cpu->bus)))
+		return entry;
+
+	first_page = snes_bus_watch_code(cpu->bus, pbr + start);
+	last_page = snes_bus_watch_code(cpu->bus, pbr + next_pc - 1);
+	entry->tag = tag;
+	entry->dbr = dbr;
+	entry->d = d;
+	entry->ram = first_page > 0 || last_page > 0;
+	entry->generation = snes_bus_get_code_generation(cpu->bus);
+	entry->idle = first_page >= 0 && last_page >= 0 &&
+				  snes_cpu_idle_analyze(cpu, pbr, start, next_pc, dbr, d);
+	entry->upload.valid = 0;
+	if(!entry->idle && first_page >= 0 && last_page >= 0)
+		snes_cpu_upload_analyze(cpu, pbr, start, next_pc, dbr, &entry->upload);
+	return entry;
+}
+
+static void snes_cpu_idle_save(snes_cpu_t *cpu, snes_cpu_idle_state_t *state, uint32_t address)
+{
+	memset(state, 0, sizeof(snes_cpu_idle_state_t));
+	state->address = address;
+	state->a = snes_cpu_registers_accumulator_get(cpu->registers).value16;
+	state->x = snes_cpu_registers_x_get(cpu->registers).value16;
+	state->y = snes_cpu_registers_y_get(cpu->registers).value16;
+	state->s = snes_cpu_registers_stack_pointer_get(cpu->registers).value16;
+	state->d = snes_cpu_registers_direct_page_get(cpu->registers);
+	state->dbr = snes_cpu_registers_data_bank_get(cpu->registers) >> 16;
+	state->p = snes_cpu_registers_status_flag_get(cpu->registers);
+	state->e = snes_cpu_registers_emulation_isset(cpu->registers);
+}
+
+int snes_cpu_idle_check(snes_cpu_t *cpu, uint16_t next_pc)
+{
+	uint32_t pbr = snes_cpu_registers_program_bank_get(cpu->registers);
+	uint16_t start = snes_cpu_registers_program_counter_get(cpu->registers);
+	uint32_t address = SNES_CPU_IDLE_VALID | (pbr + next_pc);
+	snes_cpu_idle_entry_t *entry = snes_cpu_idle_lookup(cpu, pbr, start, next_pc);
+	snes_cpu_idle_state_t state;
+
+	if(!entry->idle)
+		return entry->upload.valid ? snes_cpu_upload_run(cpu, &entry->upload) : 0;
+
+	//Same registers after a whole iteration : the loop can only be left by an interrupt
+	snes_cpu_idle_save(cpu, &state, address);
+	if(memcmp(&state, &cpu->idle_state, sizeof(state)) == 0) {
+		cpu->halt = SNES_CPU_HALT_IDLE;
+		snes_cpu_idle_reset(cpu);
+		return 1;
+	}
+	cpu->idle_state = state;
+	return 0;
+}
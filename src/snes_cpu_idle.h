@@ -0,0 +1,44 @@
+#ifndef SNES_CPU_IDLE_H
+#define SNES_CPU_IDLE_H
+
+#include <stdint.h>
+#include "snes_cpu_internal.h"
+
+/*
+ * Idle loop detection : a short backward branch whose loop body only reads
+ * plain memory and registers, and which comes back to the branch with the same
+ * registers, spins until an interrupt changes the memory. The core is then
+ * halted in SNES_CPU_HALT_IDLE and the run loop moves the clock to the next
+ * interrupt event.
+ */
+
+//Longest loop body looked at, in bytes
+#define SNES_CPU_IDLE_LOOP_BYTES 32
+
+//Instructions closing a loop
+#define SNES_CPU_MNE_LOOPS(mne) \
+	((mne) == BCC || (mne) == BCS || (mne) == BEQ || (mne) == BMI || (mne) == BNE || (mne) == BLP || \
+	 (mne) == BVC || (mne) == BVS || (mne) == BRA || (mne) == BRL || (mne) == JMP)
+
+//Called once the instruction ending at next_pc has been executed, returns 1 if the core is now idle
+int snes_cpu_idle_check(snes_cpu_t *cpu, uint16_t next_pc);
+
+static inline int snes_cpu_idle_loop(snes_cpu_t *cpu, uint16_t next_pc)
+{
+	uint16_t pc;
+
+	if(!cpu->idle_skip)
+		return 0;
+	pc = snes_cpu_registers_program_counter_get(cpu->registers);
+	if(likely(pc >= next_pc || next_pc - pc > SNES_CPU_IDLE_LOOP_BYTES))
+		return 0;
+	return snes_cpu_idle_check(cpu, next_pc);
+}
+
+//Forgets the last loop iteration, the memory may have changed
+static inline void snes_cpu_idle_reset(snes_cpu_t *cpu)
+{
+	cpu->idle_state.address = 0;
+}
+
+#endif //SNES_CPU_IDLE_H
@@ -0,0 +1,178 @@
+#ifndef SNES_CPU_INTERNAL_H
+#define SNES_CPU_INTERNAL_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "snes_cpu.h"
+#include "snes_cpu_defs.h"
+#include "snes_cpu_jit.h"
+#include "snes_cpu_mne.h"
+
+/*
+ * Breakpoints : one bit per address of the 24 bits space, in bitmaps of 4KB
+ * of address space allocated on first use
+ */
+#define SNES_CPU_BREAKPOINT_PAGE_SHIFT 12
+#define SNES_CPU_BREAKPOINT_PAGE_COUNT (1 << (24 - SNES_CPU_BREAKPOINT_PAGE_SHIFT))
+#define SNES_CPU_BREAKPOINT_PAGE_MASK ((1 << SNES_CPU_BREAKPOINT_PAGE_SHIFT) - 1)
+#define SNES_CPU_BREAKPOINT_PAGE_BYTES (1 << (SNES_CPU_BREAKPOINT_PAGE_SHIFT - 3))
+
+//Maximum number of instructions run by a single call to an execution core
+#define SNES_CPU_RUN_BATCH 4096
+//Master cycles run by the execution thread between two checks of the execution mode
+#define SNES_CPU_RUN_BATCH_CYCLES 65536
+//Upper bound of the master cycles of an instruction, to size the runs to a cycle budget
+#define SNES_CPU_MAX_INSTRUCTION_CYCLES (12 * 12)
+
+#define INSTRUCTION_CACHE_SIZE 4096
+#define SNES_CPU_IDLE_CACHE_SIZE 64
+#define INSTRUCTION_CACHE_VALID (1u << 31)
+
+#define likely(x)       __builtin_expect((x),1)
+#define unlikely(x)     __builtin_expect((x),0)
+
+typedef struct {
+	snes_cpu_mnemonic_t mne;
+	snes_cpu_addressing_mode_t addr;
+	int cycles;
+} snes_cpu_opcode_t;
+
+//Penalties of snes_cpu_timing_t only known at execution time
+#define SNES_CPU_TIMING_DIRECT_PAGE (1 << 0) //+1 cycle when the low byte of D isn't 0
+#define SNES_CPU_TIMING_INDEX_X (1 << 1) //+1 cycle when indexing crosses a page
+#define SNES_CPU_TIMING_INDEX_Y (1 << 2)
+#define SNES_CPU_TIMING_TAKEN (1 << 3) //+1 cycle when the branch is taken
+#define SNES_CPU_TIMING_PAGE (1 << 4) //+1 cycle when a taken branch crosses a page (emulation)
+#define SNES_CPU_TIMING_BLOCK_MOVE (1 << 5) //Whole timing again for each byte after the first
+
+/*
+ * Instruction timing : the opcode and operand fetches at the speed of the
+ * program region and the other cycles at 6 master cycles are known at decode
+ * time. Data accesses add their wait states through the bus. Fits in a register.
+ */
+typedef struct {
+	uint16_t master;
+	uint8_t flags;
+	uint8_t pad;
+} snes_cpu_timing_t;
+
+typedef struct {
+	uint8_t word; //For debug traces
+	snes_cpu_opcode_t opcode;
+	snes_cpu_timing_t timing;
+	uint8_t operand_size;
+	union {
+		uint32_t operand;
+		struct {
+			uint8_t operand_low;
+			uint8_t operand_high;
+			uint8_t operand_bank;
+			uint8_t operand_pad; //pading
+		};
+	};
+} snes_cpu_instruction_t;
+
+//Halted states entered by WAI and STP, the clock is then moved by the run loop
+typedef enum {
+	SNES_CPU_HALT_NONE = 0,
+	SNES_CPU_HALT_WAI, //Until an interrupt line is asserted
+	SNES_CPU_HALT_STP, //Until reset
+	SNES_CPU_HALT_IDLE, //Idle loop, until the next interrupt event
+} snes_cpu_halt_t;
+
+//Registers at the end of a loop iteration, see snes_cpu_idle.h
+typedef struct {
+	uint32_t address; //Valid bit and 24 bits address of the branch
+	uint16_t a;
+	uint16_t x;
+	uint16_t y;
+	uint16_t s;
+	uint16_t d;
+	uint8_t dbr;
+	uint8_t p;
+	uint8_t e;
+} snes_cpu_idle_state_t;
+
+//Value left in A by an upload loop iteration, see snes_cpu_upload.h
+typedef enum {
+	SNES_CPU_UPLOAD_A_DATA, //Last byte sent
+	SNES_CPU_UPLOAD_A_INDEX, //Index of the last byte
+	SNES_CPU_UPLOAD_A_NEXT, //Index of the next byte
+} snes_cpu_upload_a_t;
+
+typedef struct {
+	uint8_t valid;
+	uint8_t index_y; //Index register : X or Y
+	snes_cpu_upload_a_t a;
+	snes_cpu_addressing_mode_t source_mode; //Indexed load of the data
+	uint32_t source_operand;
+	uint16_t end; //Index the loop stops at
+	uint32_t cycles; //Master cycles of the body for a byte, data wait states included
+} snes_cpu_upload_loop_t;
+
+typedef struct {
+	uint32_t tag; //valid bit, decode state and 24 bits address of the branch
+	uint8_t ram;
+	uint8_t idle; //Loop body without side effect for this DBR and D
+	snes_cpu_upload_loop_t upload; //When not idle
+	uint8_t dbr;
+	uint16_t d;
+	uint32_t generation;
+} snes_cpu_idle_entry_t;
+
+typedef struct {
+	uint32_t tag; //valid bit, decode state and 24 bits address
+	uint8_t ram; //Instruction comes from RAM and may be overwritten
+	uint32_t generation;
+	snes_cpu_instruction_t instruction;
+} snes_cpu_cache_entry_t;
+
+struct _snes_cpu{
+	snes_cpu_registers_t *registers;
+	snes_cart_t *cart;
+	snes_bus_t *bus;
+	snes_cpu_stack_t *stack;
+	pthread_t execution_thread;
+	uint8_t *breakpoints[SNES_CPU_BREAKPOINT_PAGE_COUNT];
+	uint32_t breakpoint_count; //Breakpoints are armed when not 0
+	snes_cpu_instruction_t current_instruction;
+	snes_cpu_mode_t mode; //Register width mode of the handlers
+	const snes_cpu_mne_handler_t *handlers; //Active handler table, follows mode
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	snes_cpu_execution_mode exec_mode;
+	snes_cpu_cache_entry_t icache[INSTRUCTION_CACHE_SIZE];
+	snes_cpu_stats_t stats;
+	struct timespec stats_start;
+	FILE *trace;
+	snes_cpu_jit_t *jit;
+	uint64_t *clock; //Master clock, held by the bus
+	snes_cpu_halt_t halt;
+	uint8_t *irq_poll; //Run loops leave when set, see snes_irq_get_poll
+	uint8_t idle_skip;
+	uint64_t run_limit; //Run budget of snes_cpu_run_until, 0 outside of it
+	snes_cpu_idle_state_t idle_state;
+	snes_cpu_idle_entry_t idle_cache[SNES_CPU_IDLE_CACHE_SIZE];
+};
+
+//To be called when the register widths may have changed
+void snes_cpu_update_mode(snes_cpu_t *cpu);
+uint32_t snes_cpu_get_decode_state(snes_cpu_t *cpu);
+void snes_cpu_decode_instruction(snes_cpu_t *cpu, uint32_t pbr, uint16_t pc, snes_cpu_instruction_t *instruction);
+void snes_cpu_update_next_instruction(snes_cpu_t *cpu);
+void snes_cpu_execute_instruction(snes_cpu_t *cpu);
+//Advances the master clock once the instruction has been executed
+void snes_cpu_add_cycles(snes_cpu_t *cpu, snes_cpu_timing_t timing, uint32_t operand, struct snes_effective_address *eff_addr);
+//Enters the halted state of WAI or STP, the instruction must be the last one run
+void snes_cpu_halt(snes_cpu_t *cpu, snes_cpu_mnemonic_t mne);
+//Asks for an interrupt poll if the instruction cleared the I flag, status being the flags before it
+void snes_cpu_unmask(snes_cpu_t *cpu, uint8_t status);
+//Returns the SNES_CPU_STOP_* reason to stop before the prefetched instruction, only called when armed
+int snes_cpu_is_breakpoint(snes_cpu_t *cpu);
+void snes_cpu_trace_instruction(snes_cpu_t *cpu);
+//Runs count instructions with the interpreter core, returns 0 or the SNES_CPU_STOP_* reason
+int snes_cpu_interpret(snes_cpu_t *cpu, uint32_t count, uint8_t check_breakpoints);
+
+#endif //SNES_CPU_INTERNAL_H
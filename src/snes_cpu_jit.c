@@ -0,0 +1,566 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_cpu_jit.h"
+#include "snes_cpu_internal.h"
+#include "snes_cpu_opcodes.h"
+#include "snes_cpu_addressing_mode.h"
+#include "snes_cpu_mne.h"
+#include "snes_cpu_idle.h"
+#include "snes_ram.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+
+#define SNES_CPU_JIT_BLOCKS 4096
+//Maximum number of 65816 instructions in a block
+#define SNES_CPU_JIT_MAX_BLOCK 32
+#define SNES_CPU_JIT_CODE_SIZE (16 * 1024 * 1024)
+//Host bytes needed by the largest block
+#define SNES_CPU_JIT_MAX_BLOCK_SIZE (SNES_CPU_JIT_MAX_BLOCK * 48 + 16)
+//A RAM block rewritten this many times is left to the interpreter
+#define SNES_CPU_JIT_SMC_THRESHOLD 8
+
+//Generated block, returns the number of executed instructions
+typedef uint32_t (*snes_cpu_jit_code_t)(snes_cpu_t *cpu);
+//Handler of one opcode, returns the bus code generation after execution
+typedef uint32_t (*snes_cpu_jit_handler_t)(snes_cpu_t *cpu, uint32_t operand, uint32_t next_pc, snes_cpu_timing_t timing);
+
+typedef struct {
+	uint32_t tag; //valid bit, decode state and 24 bits address
+	uint8_t ram; //Block comes from RAM and may be overwritten
+	uint8_t invalidations;
+	uint32_t generation;
+	uint32_t length;
+	snes_cpu_jit_code_t code; //NULL : executed by the interpreter
+} snes_cpu_jit_block_t;
+
+struct _snes_cpu_jit {
+	snes_cpu_t *cpu;
+	uint8_t *code;
+	uint32_t code_offset;
+	snes_cpu_jit_block_t blocks[SNES_CPU_JIT_BLOCKS];
+	uint8_t lockstep;
+	//Lockstep comparison state
+	snes_cpu_registers_t *saved_registers;
+	snes_cpu_registers_t *jit_registers;
+	uint8_t *saved_wram;
+	uint8_t *jit_wram;
+	uint8_t *saved_sram;
+	uint8_t *jit_sram;
+};
+
+#define SNES_CPU_JIT_HANDLER(opcode, mne, mode, variant) \
+static uint32_t snes_cpu_jit_op_##opcode##_##variant(snes_cpu_t *cpu, uint32_t operand, uint32_t next_pc, \
+													 snes_cpu_timing_t timing) \
+{ \
+	struct snes_effective_address eff_addr; \
+	uint8_t status = 0; \
+	if(SNES_CPU_MNE_UNMASKS(mne)) \
+		status = snes_cpu_registers_status_flag_get(cpu->registers); \
+	snes_cpu_registers_program_counter_set(cpu->registers, next_pc); \
+	eff_addr = snes_cpu_addressing_mode_##mode(cpu->bus, cpu->registers, mne, operand); \
+	snes_cpu_mne_execute_##mne##_##variant(eff_addr, cpu->registers, cpu->bus, cpu->stack); \
+	snes_cpu_add_cycles(cpu, timing, operand, &eff_addr); \
+	if(SNES_CPU_MNE_SWITCHES_MODE(mne)) \
+		snes_cpu_update_mode(cpu); \
+	if(SNES_CPU_MNE_UNMASKS(mne)) \
+		snes_cpu_unmask(cpu, status); \
+	if(SNES_CPU_MNE_HALTS(mne)) \
+		snes_cpu_halt(cpu, mne); \
+	if(SNES_CPU_MNE_LOOPS(mne)) \
+		snes_cpu_idle_loop(cpu, next_pc); \
+	return snes_bus_get_code_generation(cpu->bus); \
+}
+
+#define SNES_CPU_JIT_HANDLER_M8X8(opcode, mne, mode, cycles) SNES_CPU_JIT_HANDLER(opcode, mne, mode, M8X8)
+#define SNES_CPU_JIT_HANDLER_M8X16(opcode, mne, mode, cycles) SNES_CPU_JIT_HANDLER(opcode, mne, mode, M8X16)
+#define SNES_CPU_JIT_HANDLER_M16X8(opcode, mne, mode, cycles) SNES_CPU_JIT_HANDLER(opcode, mne, mode, M16X8)
+#define SNES_CPU_JIT_HANDLER_M16X16(opcode, mne, mode, cycles) SNES_CPU_JIT_HANDLER(opcode, mne, mode, M16X16)
+#define SNES_CPU_JIT_HANDLER_EMU(opcode, mne, mode, cycles) SNES_CPU_JIT_HANDLER(opcode, mne, mode, EMU)
+
+SNES_CPU_OPCODES(SNES_CPU_JIT_HANDLER_M8X8)
+SNES_CPU_OPCODES(SNES_CPU_JIT_HANDLER_M8X16)
+SNES_CPU_OPCODES(SNES_CPU_JIT_HANDLER_M16X8)
+SNES_CPU_OPCODES(SNES_CPU_JIT_HANDLER_M16X16)
+SNES_CPU_OPCODES(SNES_CPU_JIT_HANDLER_EMU)
+
+#define SNES_CPU_JIT_ENTRY_M8X8(opcode, mne, mode, cycles) [opcode] = snes_cpu_jit_op_##opcode##_M8X8,
+#define SNES_CPU_JIT_ENTRY_M8X16(opcode, mne, mode, cycles) [opcode] = snes_cpu_jit_op_##opcode##_M8X16,
+#define SNES_CPU_JIT_ENTRY_M16X8(opcode, mne, mode, cycles) [opcode] = snes_cpu_jit_op_##opcode##_M16X8,
+#define SNES_CPU_JIT_ENTRY_M16X16(opcode, mne, mode, cycles) [opcode] = snes_cpu_jit_op_##opcode##_M16X16,
+#define SNES_CPU_JIT_ENTRY_EMU(opcode, mne, mode, cycles) [opcode] = snes_cpu_jit_op_##opcode##_EMU,
+
+//Blocks never span a mode switch, the mode is resolved at translation time
+static const snes_cpu_jit_handler_t handlers[SNES_CPU_MODE_COUNT][256] = {
+	[SNES_CPU_MODE_M8X8] = { SNES_CPU_OPCODES(SNES_CPU_JIT_ENTRY_M8X8) },
+	[SNES_CPU_MODE_M8X16] = { SNES_CPU_OPCODES(SNES_CPU_JIT_ENTRY_M8X16) },
+	[SNES_CPU_MODE_M16X8] = { SNES_CPU_OPCODES(SNES_CPU_JIT_ENTRY_M16X8) },
+	[SNES_CPU_MODE_M16X16] = { SNES_CPU_OPCODES(SNES_CPU_JIT_ENTRY_M16X16) },
+	[SNES_CPU_MODE_EMU] = { SNES_CPU_OPCODES(SNES_CPU_JIT_ENTRY_EMU) },
+};
+
+static void snes_cpu_jit_emit8(snes_cpu_jit_t *jit, uint8_t value)
+{
+	jit->code[jit->code_offset++] = value;
+}
+
+static void snes_cpu_jit_emit32(snes_cpu_jit_t *jit, uint32_t value)
+{
+	memcpy(jit->code + jit->code_offset, &value, sizeof(value));
+	jit->code_offset += sizeof(value);
+}
+
+static void snes_cpu_jit_emit64(snes_cpu_jit_t *jit, uint64_t value)
+{
+	memcpy(jit->code + jit->code_offset, &value, sizeof(value));
+	jit->code_offset += sizeof(value);
+}
+
+static void snes_cpu_jit_flush(snes_cpu_jit_t *jit)
+{
+	memset(jit->blocks, 0, sizeof(jit->blocks));
+	jit->code_offset = 0;
+}
+
+/*
+ * Block layout :
+ *   exit:  pop rbx ; ret
+ *   entry: push rbx ; mov rbx, rdi
+ *          for each instruction :
+ *            mov rdi, rbx ; mov esi, operand ; mov edx, next_pc ; mov ecx, timing
+ *            mov rax, handler ; call rax
+ *            (RAM blocks) cmp eax, generation ; je next ; mov eax, done ; jmp exit
+ *          mov eax, length ; pop rbx ; ret
+ */
+static snes_cpu_jit_code_t snes_cpu_jit_emit_block(snes_cpu_jit_t *jit, snes_cpu_instruction_t *instructions,
+												   uint16_t *next_pcs, uint32_t length,
+												   uint8_t ram, uint32_t generation)
+{
+	uint32_t exit;
+	uint32_t entry;
+	uint32_t timing;
+	uint32_t i;
+
+	if(jit->code_offset + SNES_CPU_JIT_MAX_BLOCK_SIZE > SNES_CPU_JIT_CODE_SIZE)
+		snes_cpu_jit_flush(jit);
+
+	exit = jit->code_offset;
+	snes_cpu_jit_emit8(jit, 0x5B);
+	snes_cpu_jit_emit8(jit, 0xC3);
+
+	entry = jit->code_offset;
+	snes_cpu_jit_emit8(jit, 0x53);
+	snes_cpu_jit_emit8(jit, 0x48);
+	snes_cpu_jit_emit8(jit, 0x89);
+	snes_cpu_jit_emit8(jit, 0xFB);
+
+	for(i = 0; i < length; i++) {
+		snes_cpu_jit_emit8(jit, 0x48);
+		snes_cpu_jit_emit8(jit, 0x89);
+		snes_cpu_jit_emit8(jit, 0xDF);
+		snes_cpu_jit_emit8(jit, 0xBE);
+		snes_cpu_jit_emit32(jit, instructions[i].operand);
+		snes_cpu_jit_emit8(jit, 0xBA);
+		snes_cpu_jit_emit32(jit, next_pcs[i]);
+		//The timing structure is passed by value in ecx
+		memcpy(&timing, &instructions[i].timing, sizeof(timing));
+		snes_cpu_jit_emit8(jit, 0xB9);
+		snes_cpu_jit_emit32(jit, timing);
+		snes_cpu_jit_emit8(jit, 0x48);
+		snes_cpu_jit_emit8(jit, 0xB8);
+		snes_cpu_jit_emit64(jit, (uint64_t)(uintptr_t)handlers[jit->cpu->mode][instructions[i].word]);
+		snes_cpu_jit_emit8(jit, 0xFF);
+		snes_cpu_jit_emit8(jit, 0xD0);
+
+		if(ram && i + 1 < length) {
+			//Leave as soon as the block may have been overwritten
+			snes_cpu_jit_emit8(jit, 0x3D);
+			snes_cpu_jit_emit32(jit, generation);
+			snes_cpu_jit_emit8(jit, 0x74);
+			snes_cpu_jit_emit8(jit, 0x0A);
+			snes_cpu_jit_emit8(jit, 0xB8);
+			snes_cpu_jit_emit32(jit, i + 1);
+			snes_cpu_jit_emit8(jit, 0xE9);
+			snes_cpu_jit_emit32(jit, exit - (jit->code_offset + 4));
+		}
+	}
+
+	snes_cpu_jit_emit8(jit, 0xB8);
+	snes_cpu_jit_emit32(jit, length);
+	snes_cpu_jit_emit8(jit, 0x5B);
+	snes_cpu_jit_emit8(jit, 0xC3);
+
+	return (snes_cpu_jit_code_t)(void *)(jit->code + entry);
+}
+
+//Instructions after which the next PC or the decoding state is only known at run time
+static uint8_t snes_cpu_jit_ends_block(snes_cpu_mnemonic_t mne)
+{
+	switch (mne) {
+		case BCC: case BCS: case BEQ: case BMI: case BNE: case BLP:
+		case BRA: case BRL: case BVC: case BVS:
+		case JMP: case JSR: case RTS: case RTL: case RTI:
+		case BRK: case COP: case WAI: case STP:
+		case REP: case SEP: case XCE: case PLP:
+		case MVN: case MVP:
+			return 1;
+		case CLI:
+			//A pending IRQ is taken right after it
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Static check of the data access : registers live in 0x2000-0x7FFF of the
+ * system banks, long addresses are checked against the bus map. The other
+ * accesses (direct page, indirect, stack) go through the bus as usual, the
+ * lockstep catches them at run time with a dry run.
+ */
+static uint8_t snes_cpu_jit_touches_mmio(snes_cpu_jit_t *jit, snes_cpu_instruction_t *instruction)
+{
+	uint16_t offset = instruction->operand & 0xFFFF;
+
+	if(instruction->opcode.mne == JMP || instruction->opcode.mne == JSR)
+		return 0;
+
+	switch (instruction->opcode.addr) {
+		case Absolute:
+		case AbsoluteIndexedX:
+		case AbsoluteIndexedY:
+			return offset >= 0x2000 && offset < 0x8000;
+		case AbsoluteLong:
+		case AbsoluteLongIndexedX:
+			return !snes_bus_is_memory(jit->cpu->bus, instruction->operand);
+		default:
+			return 0;
+	}
+}
+
+static void snes_cpu_jit_translate(snes_cpu_jit_t *jit, snes_cpu_jit_block_t *block, uint32_t tag,
+								   uint32_t pbr, uint16_t pc)
+{
+	snes_cpu_instruction_t instructions[SNES_CPU_JIT_MAX_BLOCK];
+	uint16_t next_pcs[SNES_CPU_JIT_MAX_BLOCK];
+	snes_bus_t *bus = jit->cpu->bus;
+	uint32_t length = 0;
+	uint8_t ram = 0;
+	uint8_t invalidations = 0;
+	uint32_t generation;
+	snes_cpu_jit_code_t block_code;
+
+	//Same block rewritten : count it to detect self-modifying code
+	if(block->tag == tag && block->ram)
+		invalidations = block->invalidations + 1;
+
+	while(length < SNES_CPU_JIT_MAX_BLOCK) {
+		snes_cpu_instruction_t *instruction = &instructions[length];
+		uint16_t last_pc;
+		int first_page;
+		int last_page;
+
+		first_page = snes_bus_watch_code(bus, pbr + pc);
+		if(first_page < 0)
+			break;
+		snes_cpu_decode_instruction(jit->cpu, pbr, pc, instruction);
+		last_pc = pc + instruction->operand_size;
+		last_page = snes_bus_watch_code(bus, pbr + last_pc);
+		if(last_page < 0 || snes_cpu_jit_touches_mmio(jit, instruction))
+			break;
+
+		ram |= first_page || last_page;
+		pc = last_pc + 1;
+		next_pcs[length++] = pc;
+		if(snes_cpu_jit_ends_block(instruction->opcode.mne))
+			break;
+	}
+	generation = snes_bus_get_code_generation(bus);
+
+	if(invalidations >= SNES_CPU_JIT_SMC_THRESHOLD) {
+		//Self-modifying code, keep the entry so that it stays interpreted
+		ram = 0;
+		length = 0;
+	}
+
+	//Emitting may flush the whole cache, fill the entry afterwards
+	block_code = NULL;
+	if(length > 0) {
+		block_code = snes_cpu_jit_emit_block(jit, instructions, next_pcs, length, ram, generation);
+		jit->cpu->stats.jit_blocks++;
+	}
+	block->tag = tag;
+	block->ram = ram;
+	block->invalidations = invalidations;
+	block->generation = generation;
+	block->length = length;
+	block->code = block_code;
+}
+
+static uint8_t snes_cpu_jit_block_is_valid(snes_cpu_jit_t *jit, snes_cpu_jit_block_t *block, uint32_t tag)
+{
+	if(block->tag != tag)
+		return 0;
+	if(block->ram && block->generation != snes_bus_get_code_generation(jit->cpu->bus))
+		return 0;
+	return 1;
+}
+
+static uint32_t snes_cpu_jit_execute(snes_cpu_jit_t *jit, snes_cpu_jit_block_t *block, uint16_t pc)
+{
+	snes_cpu_t *cpu = jit->cpu;
+	uint32_t executed;
+
+	//The interpreter prefetches the next instruction, restart from its address
+	snes_cpu_registers_program_counter_set(cpu->registers, pc);
+	executed = block->code(cpu);
+	cpu->stats.instructions += executed;
+	snes_cpu_update_next_instruction(cpu);
+	return executed;
+}
+
+static void snes_cpu_jit_save_memory(snes_ram_t *ram, uint8_t *buffer)
+{
+	if(ram != NULL && buffer != NULL)
+		memcpy(buffer, snes_ram_get_data(ram), snes_ram_get_size(ram));
+}
+
+static void snes_cpu_jit_restore_memory(snes_ram_t *ram, uint8_t *buffer)
+{
+	if(ram != NULL && buffer != NULL)
+		memcpy(snes_ram_get_data(ram), buffer, snes_ram_get_size(ram));
+}
+
+static int snes_cpu_jit_compare_memory(const char *name, snes_ram_t *ram, uint8_t *buffer)
+{
+	uint8_t *data;
+	uint32_t i;
+
+	if(ram == NULL || buffer == NULL)
+		return 0;
+	data = snes_ram_get_data(ram);
+	if(memcmp(data, buffer, snes_ram_get_size(ram)) == 0)
+		return 0;
+	for(i = 0; i < snes_ram_get_size(ram); i++) {
+		if(data[i] != buffer[i]) {
+			printf("%s differs at 0x%06X : interpreter 0x%02X, jit 0x%02X\n", name, i, data[i], buffer[i]);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Runs the block, keeps its results, rolls back and runs the same number of
+ * instructions with the interpreter. The interpreter state is kept. The block
+ * runs on a dry run bus : only the CPU and the memories can be rolled back, a
+ * block reaching the other chips is only run by the interpreter, unchecked.
+ */
+static int snes_cpu_jit_lockstep(snes_cpu_jit_t *jit, snes_cpu_jit_block_t *block, uint16_t pc)
+{
+	snes_cpu_t *cpu = jit->cpu;
+	snes_ram_t *wram = snes_bus_get_wram(cpu->bus);
+	snes_ram_t *sram = snes_cart_get_ram(cpu->cart);
+	snes_cpu_instruction_t saved_instruction = cpu->current_instruction;
+	snes_cpu_stats_t saved_stats = cpu->stats;
+	uint64_t saved_cycles = snes_bus_get_cycles(cpu->bus);
+	snes_cpu_halt_t saved_halt = cpu->halt;
+	snes_cpu_idle_state_t saved_idle_state = cpu->idle_state;
+	uint64_t saved_run_limit = cpu->run_limit;
+	uint8_t saved_poll = *cpu->irq_poll;
+	snes_cpu_halt_t jit_halt;
+	uint64_t jit_cycles;
+	uint32_t address = snes_cpu_registers_program_bank_get(cpu->registers) + pc;
+	uint32_t executed;
+	uint64_t target;
+	int dropped;
+	int mismatch;
+
+	snes_cpu_registers_copy(jit->saved_registers, cpu->registers);
+	snes_cpu_jit_save_memory(wram, jit->saved_wram);
+	snes_cpu_jit_save_memory(sram, jit->saved_sram);
+	//The APU isn't replayed, no upload fast path on either side
+	cpu->run_limit = 0;
+
+	snes_bus_start_dry_run(cpu->bus);
+	executed = snes_cpu_jit_execute(jit, block, pc);
+	dropped = snes_bus_end_dry_run(cpu->bus);
+
+	snes_cpu_registers_copy(jit->jit_registers, cpu->registers);
+	jit_cycles = snes_cpu_get_cycles(cpu);
+	jit_halt = cpu->halt;
+	snes_cpu_jit_save_memory(wram, jit->jit_wram);
+	snes_cpu_jit_save_memory(sram, jit->jit_sram);
+
+	snes_cpu_registers_copy(cpu->registers, jit->saved_registers);
+	snes_cpu_jit_restore_memory(wram, jit->saved_wram);
+	snes_cpu_jit_restore_memory(sram, jit->saved_sram);
+	cpu->current_instruction = saved_instruction;
+	cpu->stats = saved_stats;
+	snes_bus_set_cycles(cpu->bus, saved_cycles);
+	cpu->halt = saved_halt;
+	cpu->idle_state = saved_idle_state;
+	*cpu->irq_poll = saved_poll;
+	snes_cpu_update_mode(cpu);
+
+	//The interpreter stops at the interrupt poll requests, the block doesn't
+	target = cpu->stats.instructions + executed;
+	do {
+		snes_cpu_interpret(cpu, target - cpu->stats.instructions, 0);
+	} while(cpu->stats.instructions < target && cpu->halt == SNES_CPU_HALT_NONE);
+	cpu->run_limit = saved_run_limit;
+	if(dropped)
+		return executed;
+
+	mismatch = snes_cpu_registers_compare(cpu->registers, jit->jit_registers);
+	if(mismatch) {
+		printf("Registers differ\n");
+		printf("interpreter : ");
+		snes_cpu_registers_dump(cpu->registers);
+		printf("\njit         : ");
+		snes_cpu_registers_dump(jit->jit_registers);
+		printf("\n");
+	}
+	if(snes_cpu_get_cycles(cpu) != jit_cycles) {
+		printf("Cycles differ : interpreter %llu, jit %llu\n", (unsigned long long)snes_cpu_get_cycles(cpu),
+			   (unsigned long long)jit_cycles);
+		mismatch = 1;
+	}
+	if(cpu->halt != jit_halt) {
+		printf("Halt state differs : interpreter %d, jit %d\n", cpu->halt, jit_halt);
+		mismatch = 1;
+	}
+	mismatch |= snes_cpu_jit_compare_memory("WRAM", wram, jit->jit_wram);
+	mismatch |= snes_cpu_jit_compare_memory("SRAM", sram, jit->jit_sram);
+	if(mismatch) {
+		printf("JIT lockstep mismatch in block 0x%06X (%u instructions)\n", address, executed);
+		return -1;
+	}
+	return executed;
+}
+
+int snes_cpu_jit_run(snes_cpu_jit_t *jit, uint32_t count)
+{
+	snes_cpu_t *cpu = jit->cpu;
+	uint32_t executed = 0;
+
+	while(executed < count) {
+		uint16_t pc = snes_cpu_registers_program_counter_get(cpu->registers) -
+					  cpu->current_instruction.operand_size - 1;
+		uint32_t pbr = snes_cpu_registers_program_bank_get(cpu->registers);
+		uint32_t addr = pbr + pc;
+		uint32_t tag = INSTRUCTION_CACHE_VALID | (snes_cpu_get_decode_state(cpu) << 24) | addr;
+		snes_cpu_jit_block_t *block = &jit->blocks[(addr ^ (addr >> 12)) & (SNES_CPU_JIT_BLOCKS - 1)];
+		int ret;
+
+		if(unlikely(!snes_cpu_jit_block_is_valid(jit, block, tag)))
+			snes_cpu_jit_translate(jit, block, tag, pbr, pc);
+
+		if(block->code == NULL) {
+			snes_cpu_interpret(cpu, 1, 0);
+			executed++;
+			if(cpu->halt != SNES_CPU_HALT_NONE || *cpu->irq_poll)
+				break;
+			continue;
+		}
+
+		if(jit->lockstep) {
+			ret = snes_cpu_jit_lockstep(jit, block, pc);
+			if(ret < 0)
+				return -1;
+		} else {
+			ret = snes_cpu_jit_execute(jit, block, pc);
+		}
+		cpu->stats.jit_instructions += ret;
+		executed += ret;
+		if(cpu->halt != SNES_CPU_HALT_NONE || *cpu->irq_poll)
+			break;
+	}
+	return executed;
+}
+
+static uint8_t *snes_cpu_jit_alloc_copy(snes_ram_t *ram)
+{
+	if(ram == NULL || snes_ram_get_size(ram) == 0)
+		return NULL;
+	return malloc(snes_ram_get_size(ram));
+}
+
+snes_cpu_jit_t *snes_cpu_jit_init(snes_cpu_t *cpu, uint8_t lockstep)
+{
+	snes_ram_t *wram = snes_bus_get_wram(cpu->bus);
+	snes_ram_t *sram = snes_cart_get_ram(cpu->cart);
+	snes_cpu_jit_t *jit = calloc(1, sizeof(snes_cpu_jit_t));
+	if(jit == NULL) {
+		printf("Error at allocation time !\n");
+		goto error_alloc;
+	}
+	jit->cpu = cpu;
+	jit->lockstep = lockstep;
+
+	jit->code = mmap(NULL, SNES_CPU_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+					 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(jit->code == MAP_FAILED) {
+		printf("Unable to map JIT code buffer !\n");
+		jit->code = NULL;
+		goto error_init;
+	}
+
+	if(lockstep) {
+		jit->saved_registers = snes_cpu_registers_init();
+		jit->jit_registers = snes_cpu_registers_init();
+		jit->saved_wram = snes_cpu_jit_alloc_copy(wram);
+		jit->jit_wram = snes_cpu_jit_alloc_copy(wram);
+		jit->saved_sram = snes_cpu_jit_alloc_copy(sram);
+		jit->jit_sram = snes_cpu_jit_alloc_copy(sram);
+		if(jit->saved_registers == NULL || jit->jit_registers == NULL ||
+		   jit->saved_wram == NULL || jit->jit_wram == NULL) {
+			printf("Unable to allocate lockstep state !\n");
+			goto error_init;
+		}
+	}
+	return jit;
+
+error_init:
+	snes_cpu_jit_destroy(jit);
+error_alloc:
+	return NULL;
+}
+
+void snes_cpu_jit_destroy(snes_cpu_jit_t *jit)
+{
+	if(jit->code != NULL)
+		munmap(jit->code, SNES_CPU_JIT_CODE_SIZE);
+	if(jit->saved_registers != NULL)
+		snes_cpu_registers_destroy(jit->saved_registers);
+	if(jit->jit_registers != NULL)
+		snes_cpu_registers_destroy(jit->jit_registers);
+	free(jit->saved_wram);
+	free(jit->jit_wram);
+	free(jit->saved_sram);
+	free(jit->jit_sram);
+	free(jit);
+}
+
+#else
+
+snes_cpu_jit_t *snes_cpu_jit_init(snes_cpu_t *cpu, uint8_t lockstep)
+{
+	printf("JIT is only available on x86-64 Linux hosts !\n");
+	return NULL;
+}
+
+void snes_cpu_jit_destroy(snes_cpu_jit_t *jit)
+{
+}
+
+int snes_cpu_jit_run(snes_cpu_jit_t *jit, uint32_t count)
+{
+	return -1;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef SNES_CPU_JIT_H
+#define SNES_CPU_JIT_H
+
+#include <stdint.h>
+#include "snes_cpu.h"
+
+typedef struct _snes_cpu_jit snes_cpu_jit_t;
+
+/*
+ * Basic-block recompiler : straight-line 65816 code is translated into x86-64
+ * host code calling one handler per instruction. Blocks are keyed by PBR:PC
+ * and the M/X/E flags, code coming from RAM is dropped on the next write to a
+ * watched page and MMIO accesses are left to the interpreter.
+ * Returns NULL when the host is not supported.
+ */
+snes_cpu_jit_t *snes_cpu_jit_init(snes_cpu_t *cpu, uint8_t lockstep);
+void snes_cpu_jit_destroy(snes_cpu_jit_t *jit);
+
+/*
+ * Executes at least count instructions (a block is never cut), returns the
+ * number of executed instructions or -1 if the lockstep comparison failed.
+ */
+int snes_cpu_jit_run(snes_cpu_jit_t *jit, uint32_t count);
+
+#endif //SNES_CPU_JIT_H
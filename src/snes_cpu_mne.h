@@ -5,6 +5,41 @@
 #include "snes_cpu_addressing_mode.h"
 #include "snes_cpu_stack.h"
 
-void snes_cpu_mne_execute(snes_cpu_mnemonic_t mne, struct snes_effective_address eff_addr, snes_cpu_t *cpu);
+/*
+ * One handler per mnemonic and register width mode (see SNES_CPU_MODES), so
+ * that a dispatcher knowing both can call it directly
+ */
+#define SNES_CPU_MNE_NAME_(mne, mode) snes_cpu_mne_execute_##mne##_##mode
+#define SNES_CPU_MNE_NAME(mne, mode) SNES_CPU_MNE_NAME_(mne, mode)
+#define SNES_CPU_MNE_HANDLER(mne, mode) \
+	void SNES_CPU_MNE_NAME(mne, mode)(struct snes_effective_address eff_addr, snes_cpu_registers_t *registers, snes_bus_t *bus, snes_cpu_stack_t *stack)
+
+#define SNES_CPU_MNE_DECLARE_M8X8(mne) SNES_CPU_MNE_HANDLER(mne, M8X8);
+#define SNES_CPU_MNE_DECLARE_M8X16(mne) SNES_CPU_MNE_HANDLER(mne, M8X16);
+#define SNES_CPU_MNE_DECLARE_M16X8(mne) SNES_CPU_MNE_HANDLER(mne, M16X8);
+#define SNES_CPU_MNE_DECLARE_M16X16(mne) SNES_CPU_MNE_HANDLER(mne, M16X16);
+#define SNES_CPU_MNE_DECLARE_EMU(mne) SNES_CPU_MNE_HANDLER(mne, EMU);
+SNES_CPU_MNEMONICS(SNES_CPU_MNE_DECLARE_M8X8)
+SNES_CPU_MNEMONICS(SNES_CPU_MNE_DECLARE_M8X16)
+SNES_CPU_MNEMONICS(SNES_CPU_MNE_DECLARE_M16X8)
+SNES_CPU_MNEMONICS(SNES_CPU_MNE_DECLARE_M16X16)
+SNES_CPU_MNEMONICS(SNES_CPU_MNE_DECLARE_EMU)
+
+//Instructions after which the register width mode must be looked up again
+#define SNES_CPU_MNE_SWITCHES_MODE(mne) \
+	((mne) == REP || (mne) == SEP || (mne) == XCE || (mne) == PLP || (mne) == RTI)
+
+//Instructions that may clear the I flag, a pending IRQ is taken right after them
+#define SNES_CPU_MNE_UNMASKS(mne) ((mne) == CLI || (mne) == REP || (mne) == PLP || (mne) == RTI)
+
+//Instructions halting the core, the execution loops stop after them
+#define SNES_CPU_MNE_HALTS(mne) ((mne) == WAI || (mne) == STP)
+
+typedef void (*snes_cpu_mne_handler_t)(struct snes_effective_address eff_addr, snes_cpu_registers_t *registers, snes_bus_t *bus, snes_cpu_stack_t *stack);
+
+//Handlers indexed by mnemonic, one table per mode
+extern const snes_cpu_mne_handler_t *const snes_cpu_mne_handlers[SNES_CPU_MODE_COUNT];
+
+snes_cpu_mode_t snes_cpu_mne_get_mode(snes_cpu_registers_t *registers);
 
 #endif //SNES_CPU_MNE_H
@@ -0,0 +1,897 @@
+/*
+ * Instruction handlers template, included by snes_cpu_mne.c once per register
+ * width mode with SNES_CPU_MNE_MODE, SNES_CPU_MNE_M16, SNES_CPU_MNE_X16 and
+ * SNES_CPU_MNE_EMU defined. The width tests below are constant and compiled
+ * out of each variant. No include guard on purpose.
+ */
+
+#define SNES_CPU_MNE_TEMPLATE_HANDLER(mne) SNES_CPU_MNE_HANDLER(mne, SNES_CPU_MNE_MODE)
+
+#if SNES_CPU_MNE_M16
+#define SNES_CPU_MNE_ACC_SIZE 2
+#define SNES_CPU_MNE_ACC_SET snes_cpu_registers_accumulator_set16
+#else
+#define SNES_CPU_MNE_ACC_SIZE 1
+#define SNES_CPU_MNE_ACC_SET snes_cpu_registers_accumulator_set8
+#endif
+
+#if SNES_CPU_MNE_X16
+#define SNES_CPU_MNE_INDEX_SIZE 2
+#define SNES_CPU_MNE_X_SET snes_cpu_registers_x_set16
+#define SNES_CPU_MNE_Y_SET snes_cpu_registers_y_set16
+#else
+#define SNES_CPU_MNE_INDEX_SIZE 1
+#define SNES_CPU_MNE_X_SET snes_cpu_registers_x_set8
+#define SNES_CPU_MNE_Y_SET snes_cpu_registers_y_set8
+#endif
+
+//Set N -> negative result; V -> signed overflow; Z -> result is zero; C -> unsigned overflow
+SNES_CPU_MNE_TEMPLATE_HANDLER(ADC)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t value = 0;
+	uint16_t result16 = 0;
+	uint8_t result8 = 0;
+	uint8_t is_carry_set = 0;
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C))
+		is_carry_set = 1;
+
+	value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	//ADD
+	if(!snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_D)) {
+		//Binary addition
+		if(SNES_CPU_MNE_M16) {
+			result16 = acc.value16 + value + is_carry_set;
+			snes_cpu_registers_update16_add(registers, acc.value16, value, result16);
+			SNES_CPU_MNE_ACC_SET(registers, result16);
+		} else {
+			result8 = acc.value8_low + (uint8_t)value + is_carry_set;
+			snes_cpu_registers_update8_add(registers, acc.value8_low, value, result8);
+			SNES_CPU_MNE_ACC_SET(registers, result8);
+		}
+	} else {
+		SNES_CPU_MNE_ACC_SET(registers, decimal_add(registers, acc.value16, value, is_carry_set, 0, SNES_CPU_MNE_ACC_SIZE));
+	}
+}
+
+//Update N (negative) and Z (zero)
+SNES_CPU_MNE_TEMPLATE_HANDLER(AND)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t value = 0;
+	uint16_t result = 0;
+
+	//Get the value
+	value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	result = acc.value16 & value;
+
+	//This will set N and Z flag
+	SNES_CPU_MNE_ACC_SET(registers, result);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(ASL)
+{
+	uint16_t value = 0;
+	uint16_t result = 0;
+	uint8_t high_bit_set = 0;
+
+	value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	if(!SNES_CPU_MNE_M16)
+		high_bit_set = value & 0x80 >> 7;
+	else
+		high_bit_set = value & 0x8000 >> 15;
+
+	result = value << 1;
+
+	store_data(eff_addr, registers, bus, result,  SNES_CPU_MNE_ACC_SIZE);
+
+	if(high_bit_set)
+		snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+	else
+		snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BCC)
+{
+	if(!snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BCS)
+{
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BEQ)
+{
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_Z))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BIT)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t value;
+	uint16_t result;
+
+	value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	if(SNES_CPU_MNE_M16) {
+		snes_cpu_registers_update16(registers, value);
+		result = acc.value16 & value;
+	} else {
+		snes_cpu_registers_update8(registers, value);
+		result = acc.value8_low & value;
+	}
+
+	if(result)
+		snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_Z);
+	else
+		snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_Z);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BMI)
+{
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_N))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BNE)
+{
+	if(!snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_Z))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+//BPL
+SNES_CPU_MNE_TEMPLATE_HANDLER(BLP)
+{
+	if(!snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_N))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BRA)
+{
+	snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BRK)
+{
+ //Call interrupt, do nothing for now
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BRL)
+{
+	snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BVC)
+{
+	if(!snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_V))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(BVS)
+{
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_V))
+		snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(CLC)
+{
+	snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(CLD)
+{
+	snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_D);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(CLI)
+{
+	snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_I);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(CLV)
+{
+	snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_V);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(CMP)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t data;
+	int32_t result32;
+	int16_t result16;
+
+	data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	//Execute sub
+	if(SNES_CPU_MNE_M16) {
+		result32 = acc.value16 - (int32_t)data;
+		snes_cpu_registers_update16(registers, result32);
+		if(result32 >= 0)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+	} else {
+		result16 = acc.value8_low - (int16_t)(uint8_t)data;
+		snes_cpu_registers_update8(registers, result16);
+		if(result16 >= 0)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(COP)
+{
+	//Enable coproc, must ASSERT
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(CPX)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	uint16_t data;
+	int32_t result32;
+	int16_t result16;
+
+	data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_INDEX_SIZE);
+
+	//Execute sub
+	if(SNES_CPU_MNE_X16) {
+		result32 = x.value16 - (int32_t)data;
+		snes_cpu_registers_update16(registers, result32);
+		if(result32 >= 0)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+	} else {
+		result16 = x.value8_low - (int16_t)(uint8_t)data;
+		snes_cpu_registers_update8(registers, data);
+		if(result16 >= 0)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(CPY)
+{
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(registers);
+	uint16_t data;
+	int32_t result32;
+	int16_t result16;
+
+	data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_INDEX_SIZE);
+
+	//Execute sub
+	if(SNES_CPU_MNE_X16) {
+		result32 = y.value16 - (int32_t)data;
+		snes_cpu_registers_update16(registers, result32);
+		if(result32 >= 0)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+	} else {
+		result16 = y.value8_low - (int16_t)(uint8_t)data;
+		snes_cpu_registers_update8(registers, data);
+		if(result16 >= 0)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(DEC)
+{
+	uint16_t data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE) - 1;
+	store_data(eff_addr, registers, bus, data, SNES_CPU_MNE_ACC_SIZE);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(DEX)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	SNES_CPU_MNE_X_SET(registers, x.value16 - 1);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(DEY)
+{
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(registers);
+	SNES_CPU_MNE_Y_SET(registers, y.value16 - 1);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(EOR)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t data;
+	uint16_t result;
+
+	data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	result = data ^ acc.value16;
+	SNES_CPU_MNE_ACC_SET(registers, result);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(INC)
+{
+	uint16_t data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE) + 1;
+	store_data(eff_addr, registers, bus, data, SNES_CPU_MNE_ACC_SIZE);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(INX)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	SNES_CPU_MNE_X_SET(registers, x.value16 + 1);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(INY)
+{
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(registers);
+	SNES_CPU_MNE_Y_SET(registers, y.value16 + 1);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(JMP)
+{
+	snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+	if(eff_addr.simple_address >> 16)
+		snes_cpu_registers_program_bank_set(registers, eff_addr.simple_address >> 16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(JSR)
+{
+	uint16_t pc = snes_cpu_registers_program_counter_get(registers) - 1;
+	snes_cpu_stack_push(stack, (uint8_t)(pc >> 8));
+	snes_cpu_stack_push(stack, (uint8_t)(pc));
+	snes_cpu_registers_program_counter_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(LDA)
+{
+	uint16_t data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+	SNES_CPU_MNE_ACC_SET(registers, data);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(LDX)
+{
+	uint16_t data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_INDEX_SIZE);
+	SNES_CPU_MNE_X_SET(registers, data);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(LDY)
+{
+	uint16_t data = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_INDEX_SIZE);
+	SNES_CPU_MNE_Y_SET(registers, data);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(LSR)
+{
+	uint16_t value = 0;
+	uint16_t result = 0;
+
+	value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+	result = value >> 1;
+	store_data(eff_addr, registers, bus, result, SNES_CPU_MNE_ACC_SIZE);
+
+	if(value & 1)
+		snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+	else
+		snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(MVN)
+{
+	block_move(eff_addr, registers, bus, 1, SNES_CPU_MNE_X16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(MVP)
+{
+	block_move(eff_addr, registers, bus, -1, SNES_CPU_MNE_X16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(NOP)
+{
+	return;
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(ORA)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t value = 0;
+	uint16_t result = 0;
+
+	//Get the value
+	value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	result = acc.value16 | value;
+
+	//This will set N and Z flag
+	SNES_CPU_MNE_ACC_SET(registers, result);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PEA)
+{
+	uint16_t value;
+	value = fetch_data(eff_addr, registers, bus, 2);
+	snes_cpu_stack_push(stack, value >> 8);
+	snes_cpu_stack_push(stack, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PEI)
+{
+	uint16_t value;
+	value = fetch_data(eff_addr, registers, bus, 2);
+	snes_cpu_stack_push(stack, value >> 8);
+	snes_cpu_stack_push(stack, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PER)
+{
+	uint16_t value;
+	value = fetch_data(eff_addr, registers, bus, 2);
+	snes_cpu_stack_push(stack, value >> 8);
+	snes_cpu_stack_push(stack, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PHA)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	if(SNES_CPU_MNE_M16)
+		snes_cpu_stack_push(stack, acc.value8_high);
+	snes_cpu_stack_push(stack, acc.value8_low);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PHB)
+{
+	uint32_t dbr = snes_cpu_registers_data_bank_get(registers);
+	snes_cpu_stack_push(stack,dbr >> 16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PHD)
+{
+	uint16_t dpr = snes_cpu_registers_direct_page_get(registers);
+	snes_cpu_stack_push(stack, dpr >> 8);
+	snes_cpu_stack_push(stack, dpr);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PHK)
+{
+	uint32_t pbr = snes_cpu_registers_program_bank_get(registers);
+	snes_cpu_stack_push(stack,pbr >> 16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PHP)
+{
+	uint8_t p = snes_cpu_registers_status_flag_get(registers);
+	snes_cpu_stack_push(stack,p);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PHX)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	if(SNES_CPU_MNE_X16)
+		snes_cpu_stack_push(stack, x.value8_high);
+	snes_cpu_stack_push(stack, x.value8_low);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PHY)
+{
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(registers);
+	if(SNES_CPU_MNE_X16)
+		snes_cpu_stack_push(stack, y.value8_high);
+	snes_cpu_stack_push(stack, y.value8_low);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PLA)
+{
+	uint16_t value;
+	value = snes_cpu_stack_pull(stack);
+	if(SNES_CPU_MNE_M16)
+		value += snes_cpu_stack_pull(stack) << 8;
+	SNES_CPU_MNE_ACC_SET(registers, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PLB)
+{
+	uint8_t value = snes_cpu_stack_pull(stack);
+	snes_cpu_registers_data_bank_set(registers, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PLD)
+{
+	uint16_t value = snes_cpu_stack_pull(stack);
+	value += snes_cpu_stack_pull(stack) << 8;
+	snes_cpu_registers_direct_page_set(registers, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PLP)
+{
+	uint8_t value = snes_cpu_stack_pull(stack);
+	snes_cpu_registers_status_flag_force(registers, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PLX)
+{
+	uint16_t value = snes_cpu_stack_pull(stack);
+	if(SNES_CPU_MNE_X16)
+		value += snes_cpu_stack_pull(stack) << 8;
+	SNES_CPU_MNE_X_SET(registers, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(PLY)
+{
+	uint16_t value = snes_cpu_stack_pull(stack);
+	if(SNES_CPU_MNE_X16)
+		value += snes_cpu_stack_pull(stack) << 8;
+	SNES_CPU_MNE_Y_SET(registers, value);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(REP)
+{
+	snes_cpu_registers_status_flag_reset(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(ROL)
+{
+	uint16_t value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+	if(!SNES_CPU_MNE_M16) {
+		uint8_t result = (uint8_t)value << 1;
+		if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C))
+			result++;
+		if(value & 0x80)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+		SNES_CPU_MNE_ACC_SET(registers, result);
+	} else {
+		uint16_t result = value << 1;
+		if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C))
+			result++;
+		if(value & 0x8000)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+		SNES_CPU_MNE_ACC_SET(registers, result);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(ROR)
+{
+	uint16_t value = fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+	uint8_t c_wasset = 0;
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C))
+			c_wasset = 1;
+	if(!SNES_CPU_MNE_M16) {
+		uint8_t result = (uint8_t)value >> 1;
+		if(value & 0x80)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+		if(c_wasset)
+			result += 0x80;
+		SNES_CPU_MNE_ACC_SET(registers, result);
+	} else {
+		uint16_t result = value >> 1;
+		if(value & 0x8000)
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_C);
+		if(c_wasset)
+			result += 0x8000;
+		SNES_CPU_MNE_ACC_SET(registers, result);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(RTI)
+{
+	uint16_t pc;
+	uint8_t pbr;
+	uint8_t p;
+
+	//Reverse order of snes_cpu_interrupt, there is no bank in emulation mode
+	p = snes_cpu_stack_pull(stack);
+	pc = snes_cpu_stack_pull(stack);
+	pc += snes_cpu_stack_pull(stack) << 8;
+	pbr = SNES_CPU_MNE_EMU ? 0 : snes_cpu_stack_pull(stack);
+
+	snes_cpu_registers_status_flag_force(registers, p);
+	snes_cpu_registers_program_counter_set(registers, pc);
+	if(!SNES_CPU_MNE_EMU)
+		snes_cpu_registers_program_bank_set(registers, pbr);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(RTL)
+{
+	printf("RTL\n");
+	uint16_t pc;
+	uint8_t pbr;
+	pc = snes_cpu_stack_pull(stack);
+	pc += snes_cpu_stack_pull(stack) << 8;
+	pc++;
+	pbr = snes_cpu_stack_pull(stack);
+	snes_cpu_registers_program_counter_set(registers, pc);
+	snes_cpu_registers_program_bank_set(registers, pbr);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(RTS)
+{
+	printf("RTS\n");
+	uint16_t pc;
+	uint16_t high;
+	pc = snes_cpu_stack_pull(stack);
+	high = snes_cpu_stack_pull(stack) << 8;
+	pc += high;
+	pc++;
+	snes_cpu_registers_program_counter_set(registers, pc);
+}
+
+//A - data - borrow is A + ~data + C, with the flags of ADC
+SNES_CPU_MNE_TEMPLATE_HANDLER(SBC)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t data;
+	uint16_t result16;
+	uint8_t result8;
+	uint8_t carry = 0;
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C))
+		carry = 1;
+
+	data = ~fetch_data(eff_addr, registers, bus, SNES_CPU_MNE_ACC_SIZE);
+
+	if(snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_D)) {
+		SNES_CPU_MNE_ACC_SET(registers, decimal_add(registers, acc.value16, data, carry, 1, SNES_CPU_MNE_ACC_SIZE));
+	} else if(SNES_CPU_MNE_M16) {
+		result16 = acc.value16 + data + carry;
+		snes_cpu_registers_update16_add(registers, acc.value16, data, result16);
+		SNES_CPU_MNE_ACC_SET(registers, result16);
+	} else {
+		result8 = acc.value8_low + (uint8_t)data + carry;
+		snes_cpu_registers_update8_add(registers, acc.value8_low, data, result8);
+		SNES_CPU_MNE_ACC_SET(registers, result8);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(SEC)
+{
+	snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_C);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(SED)
+{
+	snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_D);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(SEI)
+{
+	snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_I);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(SEP)
+{
+	snes_cpu_registers_status_flag_set(registers, eff_addr.simple_address);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(STA)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	snes_bus_write(bus, eff_addr.simple_address, acc.value8_low);
+	if(SNES_CPU_MNE_M16)
+		snes_bus_write(bus, eff_addr.simple_address + 1, acc.value8_high);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(STP)
+{
+	//Halts the core until reset, see snes_cpu_halt
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(STX)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	snes_bus_write(bus, eff_addr.simple_address, x.value8_low);
+	if(SNES_CPU_MNE_X16)
+		snes_bus_write(bus, eff_addr.simple_address + 1, x.value8_high);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(STY)
+{
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(registers);
+	snes_bus_write(bus, eff_addr.simple_address, y.value8_low);
+	if(SNES_CPU_MNE_X16)
+		snes_bus_write(bus, eff_addr.simple_address + 1, y.value8_high);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(STZ)
+{
+	snes_bus_write(bus, eff_addr.simple_address, 0);
+	if(SNES_CPU_MNE_M16)
+		snes_bus_write(bus, eff_addr.simple_address + 1, 0);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TAX)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	if(SNES_CPU_MNE_X16)
+		SNES_CPU_MNE_X_SET(registers, acc.value16);
+	else
+		SNES_CPU_MNE_X_SET(registers, acc.value8_low);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TAY)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	if(SNES_CPU_MNE_X16)
+		SNES_CPU_MNE_Y_SET(registers, acc.value16);
+	else
+		SNES_CPU_MNE_Y_SET(registers, acc.value8_low);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TCD)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	snes_cpu_registers_direct_page_set(registers, acc.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TCS)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	snes_cpu_registers_stack_pointer_set(registers, acc.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TDC)
+{
+	snes_cpu_registers_accumulator_set16(registers, snes_cpu_registers_direct_page_get(registers));
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TRB)
+{
+	uint16_t value = snes_bus_read(bus, eff_addr.simple_address);
+	uint16_t result = 0;
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+
+	//First test and store
+	if(SNES_CPU_MNE_M16)
+		value += snes_bus_read(bus, eff_addr.simple_address + 1) << 8;
+
+	result = value & ~acc.value16;
+
+	snes_bus_write(bus, eff_addr.simple_address, (uint8_t) result);
+	if(SNES_CPU_MNE_M16)
+		snes_bus_write(bus, eff_addr.simple_address + 1, (uint8_t) (result >> 8));
+
+	//Second test and set Z flag
+	if(!SNES_CPU_MNE_M16) {
+		if(!(value & acc.value8_low))
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_Z);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_Z);
+	} else {
+		if(!(value & acc.value16))
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_Z);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_Z);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TSB)
+{
+	uint16_t value = snes_bus_read(bus, eff_addr.simple_address);
+	uint16_t result = 0;
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+
+	//First test and store
+	if(SNES_CPU_MNE_M16)
+		value += snes_bus_read(bus, eff_addr.simple_address + 1) << 8;
+
+	result = value | acc.value16;
+
+	snes_bus_write(bus, eff_addr.simple_address, (uint8_t) result);
+	if(SNES_CPU_MNE_M16)
+		snes_bus_write(bus, eff_addr.simple_address + 1, (uint8_t) (result >> 8));
+
+	//Second test and set Z flag
+	if(!SNES_CPU_MNE_M16) {
+		if(!(value & acc.value8_low))
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_Z);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_Z);
+	} else {
+		if(!(value & acc.value16))
+			snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_Z);
+		else
+			snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_Z);
+	}
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TSC)
+{
+	struct snes_cpu_register_value sp = snes_cpu_registers_stack_pointer_get(registers);
+	snes_cpu_registers_accumulator_set16(registers, sp.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TSX)
+{
+	struct snes_cpu_register_value sp = snes_cpu_registers_stack_pointer_get(registers);
+	SNES_CPU_MNE_X_SET(registers, sp.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TXA)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	SNES_CPU_MNE_ACC_SET(registers, x.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TXS)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	snes_cpu_registers_stack_pointer_set(registers, x.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TXY)
+{
+	struct snes_cpu_register_value x = snes_cpu_registers_x_get(registers);
+	SNES_CPU_MNE_Y_SET(registers, x.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TYA)
+{
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(registers);
+	SNES_CPU_MNE_ACC_SET(registers, y.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(TYX)
+{
+	struct snes_cpu_register_value y = snes_cpu_registers_y_get(registers);
+	SNES_CPU_MNE_X_SET(registers, y.value16);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(WAI)
+{
+	//Halts the core until an interrupt, see snes_cpu_halt
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(WDM)
+{
+	//reserved, must assert
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(XBA)
+{
+	struct snes_cpu_register_value acc = snes_cpu_registers_accumulator_get(registers);
+	uint16_t value = acc.value8_high;
+	value += acc.value8_low << 8;
+	snes_cpu_registers_accumulator_set16(registers, value);
+	snes_cpu_registers_update8(registers, acc.value8_high);
+}
+
+SNES_CPU_MNE_TEMPLATE_HANDLER(XCE)
+{
+	uint8_t carry = snes_cpu_registers_status_flag_isset(registers, STATUS_FLAG_C);
+	uint8_t emu = snes_cpu_registers_emulation_isset(registers);
+	if(carry != emu) {
+		if(carry)
+			snes_cpu_registers_emulation_set(registers);
+		else
+			snes_cpu_registers_emulation_reset(registers);
+	}
+}
+
+#define SNES_CPU_MNE_TABLE_ENTRY(mne) [mne] = SNES_CPU_MNE_NAME(mne, SNES_CPU_MNE_MODE),
+
+static const snes_cpu_mne_handler_t SNES_CPU_MNE_NAME(table, SNES_CPU_MNE_MODE)[MAXMNE] = {
+	SNES_CPU_MNEMONICS(SNES_CPU_MNE_TABLE_ENTRY)
+};
+
+#undef SNES_CPU_MNE_TABLE_ENTRY
+#undef SNES_CPU_MNE_TEMPLATE_HANDLER
+#undef SNES_CPU_MNE_ACC_SIZE
+#undef SNES_CPU_MNE_ACC_SET
+#undef SNES_CPU_MNE_INDEX_SIZE
+#undef SNES_CPU_MNE_X_SET
+#undef SNES_CPU_MNE_Y_SET
+#undef SNES_CPU_MNE_MODE
+#undef SNES_CPU_MNE_M16
+#undef SNES_CPU_MNE_X16
+#undef SNES_CPU_MNE_EMU
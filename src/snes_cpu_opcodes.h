@@ -0,0 +1,270 @@
+#ifndef SNES_CPU_OPCODES_H
+#define SNES_CPU_OPCODES_H
+
+#include "snes_cpu_defs.h"
+
+/*
+ * 65816 opcode table : OP(opcode, mnemonic, addressing mode, cycles)
+ * Cycles are the base count : 8 bits registers, emulation mode for BRK/COP/RTI,
+ * D low byte at 0, no page crossing and conditional branch not taken.
+ * Shared by the opcode decoder and the threaded dispatch core.
+ */
+#define SNES_CPU_OPCODES(OP) \
+	OP(0x00, BRK, StackInterrupt, 7) \
+	OP(0x01, ORA, DirectPageIndexedIndirectX, 6) \
+	OP(0x02, COP, StackInterrupt, 7) \
+	OP(0x03, ORA, StackRelative, 4) \
+	OP(0x04, TSB, DirectPage, 5) \
+	OP(0x05, ORA, DirectPage, 3) \
+	OP(0x06, ASL, DirectPage, 5) \
+	OP(0x07, ORA, DirectPageIndirectLong, 6) \
+	OP(0x08, PHP, StackPush, 3) \
+	OP(0x09, ORA, Immediate, 2) \
+	OP(0x0A, ASL, Accumulator, 2) \
+	OP(0x0B, PHD, StackPush, 4) \
+	OP(0x0C, TSB, Absolute, 6) \
+	OP(0x0D, ORA, Absolute, 4) \
+	OP(0x0E, ASL, Absolute, 6) \
+	OP(0x0F, ORA, AbsoluteLong, 5) \
+	OP(0x10, BLP, ProgramCounterRelative, 2) \
+	OP(0x11, ORA, DirectPageIndirectIndexedY, 5) \
+	OP(0x12, ORA, DirectPageIndirect, 5) \
+	OP(0x13, ORA, StackRelativeIndirectIndexedY, 7) \
+	OP(0x14, TRB, DirectPage, 5) \
+	OP(0x15, ORA, DirectPageIndexedX, 4) \
+	OP(0x16, ASL, DirectPageIndexedX, 6) \
+	OP(0x17, ORA, DirectPageIndirectLongIndexedY, 6) \
+	OP(0x18, CLC, Implied, 2) \
+	OP(0x19, ORA, AbsoluteIndexedY, 4) \
+	OP(0x1A, INC, Accumulator, 2) \
+	OP(0x1B, TCS, Implied, 2) \
+	OP(0x1C, TRB, Absolute, 6) \
+	OP(0x1D, ORA, AbsoluteIndexedX, 4) \
+	OP(0x1E, ASL, AbsoluteIndexedX, 7) \
+	OP(0x1F, ORA, AbsoluteLongIndexedX, 5) \
+	OP(0x20, JSR, Absolute, 6) \
+	OP(0x21, AND, DirectPageIndexedIndirectX, 6) \
+	OP(0x22, JSR, AbsoluteLong, 8) \
+	OP(0x23, AND, StackRelative, 4) \
+	OP(0x24, BIT, DirectPage, 3) \
+	OP(0x25, AND, DirectPage, 3) \
+	OP(0x26, ROL, DirectPage, 5) \
+	OP(0x27, AND, DirectPageIndirectLong, 6) \
+	OP(0x28, PLP, StackPull, 4) \
+	OP(0x29, AND, Immediate, 2) \
+	OP(0x2A, ROL, Accumulator, 2) \
+	OP(0x2B, PLD, StackPull, 5) \
+	OP(0x2C, BIT, Absolute, 4) \
+	OP(0x2D, AND, Absolute, 4) \
+	OP(0x2E, ROL, Absolute, 6) \
+	OP(0x2F, AND, AbsoluteLong, 5) \
+	OP(0x30, BMI, ProgramCounterRelative, 2) \
+	OP(0x31, AND, DirectPageIndirectIndexedY, 5) \
+	OP(0x32, AND, DirectPageIndirect, 5) \
+	OP(0x33, AND, StackRelativeIndirectIndexedY, 7) \
+	OP(0x34, BIT, DirectPageIndexedX, 4) \
+	OP(0x35, AND, DirectPageIndexedX, 4) \
+	OP(0x36, ROL, DirectPageIndexedX, 6) \
+	OP(0x37, AND, DirectPageIndirectLongIndexedY, 6) \
+	OP(0x38, SEC, Implied, 2) \
+	OP(0x39, AND, AbsoluteIndexedY, 4) \
+	OP(0x3A, DEC, Accumulator, 2) \
+	OP(0x3B, TSC, Implied, 2) \
+	OP(0x3C, BIT, AbsoluteIndexedX, 4) \
+	OP(0x3D, AND, AbsoluteIndexedX, 4) \
+	OP(0x3E, ROL, AbsoluteIndexedX, 7) \
+	OP(0x3F, AND, AbsoluteLongIndexedX, 5) \
+	OP(0x40, RTI, StackRTI, 6) \
+	OP(0x41, EOR, DirectPageIndexedIndirectX, 6) \
+	OP(0x42, WDM, ProgramCounterRelative, 2) \
+	OP(0x43, EOR, StackRelative, 4) \
+	OP(0x44, MVP, BlockMove, 7) \
+	OP(0x45, EOR, DirectPage, 3) \
+	OP(0x46, LSR, DirectPage, 5) \
+	OP(0x47, EOR, DirectPageIndirectLong, 6) \
+	OP(0x48, PHA, StackPush, 3) \
+	OP(0x49, EOR, Immediate, 2) \
+	OP(0x4A, LSR, Accumulator, 2) \
+	OP(0x4B, PHK, StackPush, 3) \
+	OP(0x4C, JMP, Absolute, 3) \
+	OP(0x4D, EOR, Absolute, 4) \
+	OP(0x4E, LSR, Absolute, 6) \
+	OP(0x4F, EOR, AbsoluteLong, 5) \
+	OP(0x50, BVC, ProgramCounterRelative, 2) \
+	OP(0x51, EOR, DirectPageIndirectIndexedY, 5) \
+	OP(0x52, EOR, DirectPageIndirect, 5) \
+	OP(0x53, EOR, StackRelativeIndirectIndexedY, 7) \
+	OP(0x54, MVN, BlockMove, 7) \
+	OP(0x55, EOR, DirectPageIndexedX, 4) \
+	OP(0x56, LSR, DirectPageIndexedX, 6) \
+	OP(0x57, EOR, DirectPageIndirectLongIndexedY, 6) \
+	OP(0x58, CLI, Implied, 2) \
+	OP(0x59, EOR, AbsoluteIndexedY, 4) \
+	OP(0x5A, PHY, StackPush, 3) \
+	OP(0x5B, TCD, Implied, 2) \
+	OP(0x5C, JMP, AbsoluteLong, 4) \
+	OP(0x5D, EOR, AbsoluteIndexedX, 4) \
+	OP(0x5E, LSR, AbsoluteIndexedX, 7) \
+	OP(0x5F, EOR, AbsoluteLongIndexedX, 5) \
+	OP(0x60, RTS, StackRTS, 6) \
+	OP(0x61, ADC, DirectPageIndexedIndirectX, 6) \
+	OP(0x62, PER, StackProgramCounterRelativeLong, 6) \
+	OP(0x63, ADC, StackRelative, 4) \
+	OP(0x64, STZ, DirectPage, 3) \
+	OP(0x65, ADC, DirectPage, 3) \
+	OP(0x66, ROR, DirectPage, 5) \
+	OP(0x67, ADC, DirectPageIndirectLong, 6) \
+	OP(0x68, PLA, StackPull, 4) \
+	OP(0x69, ADC, Immediate, 2) \
+	OP(0x6A, ROR, Accumulator, 2) \
+	OP(0x6B, RTL, StackRTL, 6) \
+	OP(0x6C, JMP, AbsoluteIndirect, 5) \
+	OP(0x6D, ADC, Absolute, 4) \
+	OP(0x6E, ROR, Absolute, 6) \
+	OP(0x6F, ADC, AbsoluteLong, 5) \
+	OP(0x70, BVS, ProgramCounterRelative, 2) \
+	OP(0x71, ADC, DirectPageIndirectIndexedY, 5) \
+	OP(0x72, ADC, DirectPageIndirect, 5) \
+	OP(0x73, ADC, StackRelativeIndirectIndexedY, 7) \
+	OP(0x74, STZ, DirectPageIndexedX, 4) \
+	OP(0x75, ADC, DirectPageIndexedX, 4) \
+	OP(0x76, ROR, DirectPageIndexedX, 6) \
+	OP(0x77, ADC, DirectPageIndirectLongIndexedY, 6) \
+	OP(0x78, SEI, Implied, 2) \
+	OP(0x79, ADC, AbsoluteIndexedY, 4) \
+	OP(0x7A, PLY, StackPull, 4) \
+	OP(0x7B, TDC, Implied, 2) \
+	OP(0x7C, JMP, AbsoluteIndexedIndirect, 6) \
+	OP(0x7D, ADC, AbsoluteIndexedX, 4) \
+	OP(0x7E, ROR, AbsoluteIndexedX, 7) \
+	OP(0x7F, ADC, AbsoluteLongIndexedX, 5) \
+	OP(0x80, BRA, ProgramCounterRelative, 3) \
+	OP(0x81, STA, DirectPageIndexedIndirectX, 6) \
+	OP(0x82, BRL, ProgramCounterRelativeLong, 4) \
+	OP(0x83, STA, StackRelative, 4) \
+	OP(0x84, STY, DirectPage, 3) \
+	OP(0x85, STA, DirectPage, 3) \
+	OP(0x86, STX, DirectPage, 3) \
+	OP(0x87, STA, DirectPageIndirectLong, 6) \
+	OP(0x88, DEY, Implied, 2) \
+	OP(0x89, BIT, Immediate, 2) \
+	OP(0x8A, TXA, Implied, 2) \
+	OP(0x8B, PHB, StackPush, 3) \
+	OP(0x8C, STY, Absolute, 4) \
+	OP(0x8D, STA, Absolute, 4) \
+	OP(0x8E, STX, Absolute, 4) \
+	OP(0x8F, STA, AbsoluteLong, 5) \
+	OP(0x90, BCC, ProgramCounterRelative, 2) \
+	OP(0x91, STA, DirectPageIndirectIndexedY, 6) \
+	OP(0x92, STA, DirectPageIndirect, 5) \
+	OP(0x93, STA, StackRelativeIndirectIndexedY, 7) \
+	OP(0x94, STY, DirectPageIndexedX, 4) \
+	OP(0x95, STA, DirectPageIndexedX, 4) \
+	OP(0x96, STX, DirectPageIndexedY, 4) \
+	OP(0x97, STA, DirectPageIndirectLongIndexedY, 6) \
+	OP(0x98, TYA, Implied, 2) \
+	OP(0x99, STA, AbsoluteIndexedY, 5) \
+	OP(0x9A, TXS, Implied, 2) \
+	OP(0x9B, TXY, Implied, 2) \
+	OP(0x9C, STZ, Absolute, 4) \
+	OP(0x9D, STA, AbsoluteIndexedX, 5) \
+	OP(0x9E, STZ, AbsoluteIndexedX, 5) \
+	OP(0x9F, STA, AbsoluteLongIndexedX, 5) \
+	OP(0xA0, LDY, Immediate, 2) \
+	OP(0xA1, LDA, DirectPageIndexedIndirectX, 6) \
+	OP(0xA2, LDX, Immediate, 2) \
+	OP(0xA3, LDA, StackRelative, 4) \
+	OP(0xA4, LDY, DirectPage, 3) \
+	OP(0xA5, LDA, DirectPage, 3) \
+	OP(0xA6, LDX, DirectPage, 3) \
+	OP(0xA7, LDA, DirectPageIndirectLong, 6) \
+	OP(0xA8, TAY, Implied, 2) \
+	OP(0xA9, LDA, Immediate, 2) \
+	OP(0xAA, TAX, Implied, 2) \
+	OP(0xAB, PLB, StackPull, 4) \
+	OP(0xAC, LDY, Absolute, 4) \
+	OP(0xAD, LDA, Absolute, 4) \
+	OP(0xAE, LDX, Absolute, 4) \
+	OP(0xAF, LDA, AbsoluteLong, 5) \
+	OP(0xB0, BCS, ProgramCounterRelative, 2) \
+	OP(0xB1, LDA, DirectPageIndirectIndexedY, 5) \
+	OP(0xB2, LDA, DirectPageIndirect, 5) \
+	OP(0xB3, LDA, StackRelativeIndirectIndexedY, 7) \
+	OP(0xB4, LDY, DirectPageIndexedX, 4) \
+	OP(0xB5, LDA, DirectPageIndexedX, 4) \
+	OP(0xB6, LDX, DirectPageIndexedY, 4) \
+	OP(0xB7, LDA, DirectPageIndirectLongIndexedY, 6) \
+	OP(0xB8, CLV, Implied, 2) \
+	OP(0xB9, LDA, AbsoluteIndexedY, 4) \
+	OP(0xBA, TSX, Implied, 2) \
+	OP(0xBB, TYX, Implied, 2) \
+	OP(0xBC, LDY, AbsoluteIndexedY, 4) \
+	OP(0xBD, LDA, AbsoluteIndexedX, 4) \
+	OP(0xBE, LDX, AbsoluteIndexedY, 4) \
+	OP(0xBF, LDA, AbsoluteLongIndexedX, 5) \
+	OP(0xC0, CPY, Immediate, 2) \
+	OP(0xC1, CMP, DirectPageIndexedIndirectX, 6) \
+	OP(0xC2, REP, Immediate, 3) \
+	OP(0xC3, CMP, StackRelative, 4) \
+	OP(0xC4, CPY, DirectPage, 3) \
+	OP(0xC5, CMP, DirectPage, 3) \
+	OP(0xC6, DEC, DirectPage, 5) \
+	OP(0xC7, CMP, DirectPageIndirectLong, 6) \
+	OP(0xC8, INY, Implied, 2) \
+	OP(0xC9, CMP, Immediate, 2) \
+	OP(0xCA, DEX, Implied, 2) \
+	OP(0xCB, WAI, Implied, 3) \
+	OP(0xCC, CPY, Absolute, 4) \
+	OP(0xCD, CMP, Absolute, 4) \
+	OP(0xCE, DEC, Absolute, 6) \
+	OP(0xCF, CMP, AbsoluteLong, 5) \
+	OP(0xD0, BNE, ProgramCounterRelative, 2) \
+	OP(0xD1, CMP, DirectPageIndirectIndexedY, 5) \
+	OP(0xD2, CMP, DirectPageIndirect, 5) \
+	OP(0xD3, CMP, StackRelativeIndirectIndexedY, 7) \
+	OP(0xD4, PEI, StackDirectPageIndirect, 6) \
+	OP(0xD5, CMP, DirectPageIndexedX, 4) \
+	OP(0xD6, DEC, DirectPageIndexedX, 6) \
+	OP(0xD7, CMP, DirectPageIndirectLongIndexedY, 6) \
+	OP(0xD8, CLD, Implied, 2) \
+	OP(0xD9, CMP, AbsoluteIndexedY, 4) \
+	OP(0xDA, PHX, StackPush, 3) \
+	OP(0xDB, STP, Implied, 3) \
+	OP(0xDC, JMP, AbsoluteIndirectLong, 6) \
+	OP(0xDD, CMP, AbsoluteIndexedX, 4) \
+	OP(0xDE, DEC, AbsoluteIndexedX, 7) \
+	OP(0xDF, CMP, AbsoluteLongIndexedX, 5) \
+	OP(0xE0, CPX, Immediate, 2) \
+	OP(0xE1, SBC, DirectPageIndexedIndirectX, 6) \
+	OP(0xE2, SEP, Immediate, 3) \
+	OP(0xE3, SBC, StackRelative, 4) \
+	OP(0xE4, CPX, DirectPage, 3) \
+	OP(0xE5, SBC, DirectPage, 3) \
+	OP(0xE6, INC, DirectPage, 5) \
+	OP(0xE7, SBC, DirectPageIndirectLong, 6) \
+	OP(0xE8, INX, Implied, 2) \
+	OP(0xE9, SBC, Immediate, 2) \
+	OP(0xEA, NOP, Implied, 2) \
+	OP(0xEB, XBA, Implied, 3) \
+	OP(0xEC, CPX, Absolute, 4) \
+	OP(0xED, SBC, Absolute, 4) \
+	OP(0xEE, INC, Absolute, 6) \
+	OP(0xEF, SBC, AbsoluteLong, 5) \
+	OP(0xF0, BEQ, ProgramCounterRelative, 2) \
+	OP(0xF1, SBC, DirectPageIndirectIndexedY, 5) \
+	OP(0xF2, SBC, DirectPageIndirect, 5) \
+	OP(0xF3, SBC, StackRelativeIndirectIndexedY, 7) \
+	OP(0xF4, PEA, StackAbsolute, 5) \
+	OP(0xF5, SBC, DirectPageIndexedX, 4) \
+	OP(0xF6, INC, DirectPageIndexedX, 6) \
+	OP(0xF7, SBC, DirectPageIndirectLongIndexedY, 6) \
+	OP(0xF8, SED, Implied, 2) \
+	OP(0xF9, SBC, AbsoluteIndexedY, 4) \
+	OP(0xFA, PLX, StackPull, 4) \
+	OP(0xFB, XCE, Implied, 2) \
+	OP(0xFC, JSR, AbsoluteIndexedIndirect, 8) \
+	OP(0xFD, SBC, AbsoluteIndexedX, 4) \
+	OP(0xFE, INC, AbsoluteIndexedX, 7) \
+	OP(0xFF, SBC, AbsoluteLongIndexedX, 5)
+
+#endif //SNES_CPU_OPCODES_H
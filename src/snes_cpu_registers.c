@@ -16,8 +16,47 @@ struct _snes_cpu_registers{
 	uint16_t pc;
 	uint8_t status;
 	uint8_t emulation;
+	//Lazy flags : flags in pending are computed from the last operation on read
+	uint8_t pending;
+	uint8_t nz_16bit;
+	uint16_t nz_result;
+	uint8_t cv_16bit;
+	uint16_t cv_value1;
+	uint16_t cv_value2;
+	uint16_t cv_result;
 };
 
+static void snes_cpu_registers_status_flag_resolve(snes_cpu_registers_t *registers, uint8_t flags)
+{
+	uint8_t pending = registers->pending & flags;
+	uint8_t computed = 0;
+	uint16_t sign;
+
+	if(pending & (STATUS_FLAG_N | STATUS_FLAG_Z)) {
+		uint16_t result = registers->nz_result;
+		sign = registers->nz_16bit ? 0x8000 : 0x80;
+		if(result == 0)
+			computed |= STATUS_FLAG_Z;
+		if(result & sign)
+			computed |= STATUS_FLAG_N;
+	}
+
+	if(pending & (STATUS_FLAG_C | STATUS_FLAG_V)) {
+		uint16_t value1 = registers->cv_value1;
+		uint16_t value2 = registers->cv_value2;
+		uint16_t result = registers->cv_result;
+		sign = registers->cv_16bit ? 0x8000 : 0x80;
+		//Carry out of the sign bit : both set, or one set and the result clear
+		if(((value1 & value2) | ((value1 | value2) & ~result)) & sign)
+			computed |= STATUS_FLAG_C;
+		if(~(value1 ^ value2) & (value1 ^ result) & sign)
+			computed |= STATUS_FLAG_V;
+	}
+
+	registers->status = (registers->status & ~pending) | (computed & pending);
+	registers->pending &= ~pending;
+}
+
 snes_cpu_registers_t *snes_cpu_registers_init()
 {
 	snes_cpu_registers_t *registers = malloc(sizeof(snes_cpu_registers_t));
@@ -43,6 +82,33 @@ void snes_cpu_registers_destroy(snes_cpu_registers_t *registers)
 	free(registers);
 }
 
+void snes_cpu_registers_copy(snes_cpu_registers_t *dest, snes_cpu_registers_t *src)
+{
+	memcpy(dest, src, sizeof(snes_cpu_registers_t));
+}
+
+static int snes_cpu_registers_compare_value(struct snes_cpu_register_value a, struct snes_cpu_register_value b)
+{
+	return a.len != b.len || a.value16 != b.value16;
+}
+
+//Returns 0 when both register files hold the same state
+int snes_cpu_registers_compare(snes_cpu_registers_t *a, snes_cpu_registers_t *b)
+{
+	snes_cpu_registers_status_flag_resolve(a, 0xFF);
+	snes_cpu_registers_status_flag_resolve(b, 0xFF);
+	return snes_cpu_registers_compare_value(a->accumulator, b->accumulator) ||
+		   snes_cpu_registers_compare_value(a->x, b->x) ||
+		   snes_cpu_registers_compare_value(a->y, b->y) ||
+		   snes_cpu_registers_compare_value(a->stack_pointer, b->stack_pointer) ||
+		   a->data_bank != b->data_bank ||
+		   a->direct_page != b->direct_page ||
+		   a->program_bank != b->program_bank ||
+		   a->pc != b->pc ||
+		   a->status != b->status ||
+		   a->emulation != b->emulation;
+}
+
 static void snes_cpu_registers_switch_reg_len(snes_cpu_registers_t *registers, enum snes_cpu_register_length len)
 {
 	registers->x.len = len;
@@ -61,27 +127,35 @@ static void snes_cpu_registers_switch_mem_len(snes_cpu_registers_t *registers, e
 
 void snes_cpu_registers_update8(snes_cpu_registers_t *registers, uint8_t value)
 {
-
-	if(value == 0)
-		snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_Z);
-	else
-		snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_Z);
-	if((int8_t)value < 0)
-		snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_N);
-	else
-		snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_N);
+	registers->nz_result = value;
+	registers->nz_16bit = 0;
+	registers->pending |= STATUS_FLAG_N | STATUS_FLAG_Z;
 }
 
 void snes_cpu_registers_update16(snes_cpu_registers_t *registers, uint16_t value)
 {
-	if(value == 0)
-		snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_Z);
-	else
-		snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_Z);
-	if((int16_t)value < 0)
-		snes_cpu_registers_status_flag_set(registers, STATUS_FLAG_N);
-	else
-		snes_cpu_registers_status_flag_reset(registers, STATUS_FLAG_N);
+	registers->nz_result = value;
+	registers->nz_16bit = 1;
+	registers->pending |= STATUS_FLAG_N | STATUS_FLAG_Z;
+}
+
+//C -> unsigned overflow; V -> signed overflow
+void snes_cpu_registers_update8_add(snes_cpu_registers_t *registers, uint8_t value1, uint8_t value2, uint8_t result)
+{
+	registers->cv_value1 = value1;
+	registers->cv_value2 = value2;
+	registers->cv_result = result;
+	registers->cv_16bit = 0;
+	registers->pending |= STATUS_FLAG_C | STATUS_FLAG_V;
+}
+
+void snes_cpu_registers_update16_add(snes_cpu_registers_t *registers, uint16_t value1, uint16_t value2, uint16_t result)
+{
+	registers->cv_value1 = value1;
+	registers->cv_value2 = value2;
+	registers->cv_result = result;
+	registers->cv_16bit = 1;
+	registers->pending |= STATUS_FLAG_C | STATUS_FLAG_V;
 }
 
 ///////////////////ACCUMULATOR//////////////////////
@@ -96,6 +170,12 @@ void snes_cpu_registers_accumulator_set(snes_cpu_registers_t *registers, uint16_
 	}
 }
 
+void snes_cpu_registers_accumulator_set8(snes_cpu_registers_t *registers, uint8_t value)
+{
+	registers->accumulator.value8_low = value;
+	snes_cpu_registers_update8(registers, value);
+}
+
 void snes_cpu_registers_accumulator_set16(snes_cpu_registers_t *registers, uint16_t value)
 {
 	registers->accumulator.value16 = value;
@@ -117,6 +197,19 @@ void snes_cpu_registers_x_set(snes_cpu_registers_t *registers, uint16_t value)
 		snes_cpu_registers_update16(registers, registers->x.value16);
 }
 
+//Width known by the caller, the value is kept as is like with x_set
+void snes_cpu_registers_x_set8(snes_cpu_registers_t *registers, uint16_t value)
+{
+	registers->x.value16 = value;
+	snes_cpu_registers_update8(registers, registers->x.value8_low);
+}
+
+void snes_cpu_registers_x_set16(snes_cpu_registers_t *registers, uint16_t value)
+{
+	registers->x.value16 = value;
+	snes_cpu_registers_update16(registers, value);
+}
+
 struct snes_cpu_register_value snes_cpu_registers_x_get(snes_cpu_registers_t *registers)
 {
 	return registers->x;
@@ -132,6 +225,26 @@ void snes_cpu_registers_y_set(snes_cpu_registers_t *registers, uint16_t value)
 		snes_cpu_registers_update16(registers, registers->y.value16);
 }
 
+//Width known by the caller, the value is kept as is like with y_set
+void snes_cpu_registers_y_set8(snes_cpu_registers_t *registers, uint16_t value)
+{
+	registers->y.value16 = value;
+	snes_cpu_registers_update8(registers, registers->y.value8_low);
+}
+
+void snes_cpu_registers_y_set16(snes_cpu_registers_t *registers, uint16_t value)
+{
+	registers->y.value16 = value;
+	snes_cpu_registers_update16(registers, value);
+}
+
+void snes_cpu_registers_block_move_set(snes_cpu_registers_t *registers, uint16_t x, uint16_t y, uint16_t acc)
+{
+	registers->x.value16 = x;
+	registers->y.value16 = y;
+	registers->accumulator.value16 = acc;
+}
+
 struct snes_cpu_register_value snes_cpu_registers_y_get(snes_cpu_registers_t *registers)
 {
 	return registers->y;
@@ -208,35 +321,39 @@ uint32_t snes_cpu_registers_data_bank_get(snes_cpu_registers_t *registers)
 ///////////////////Status register//////////////////////
 uint8_t snes_cpu_registers_status_flag_get(snes_cpu_registers_t *registers)
 {
+	snes_cpu_registers_status_flag_resolve(registers, 0xFF);
 	return registers->status;
 }
 
+uint8_t snes_cpu_registers_width_flags_get(snes_cpu_registers_t *registers)
+{
+	return registers->status & (STATUS_FLAG_M | STATUS_FLAG_X);
+}
+
 void snes_cpu_registers_status_flag_force(snes_cpu_registers_t *registers, uint8_t flags)
 {
+	registers->pending = 0;
+	//PLP and RTI may widen the registers, never in emulation mode
+	if(registers->emulation)
+		flags |= STATUS_FLAG_M | STATUS_FLAG_X;
 	registers->status = flags;
-	if(flags & STATUS_FLAG_X)
-		snes_cpu_registers_switch_reg_len(registers, CPU_REGISTER_8_BIT);
-	if(flags & STATUS_FLAG_M)
-		snes_cpu_registers_switch_mem_len(registers, CPU_REGISTER_8_BIT);
-	///TODO implement the BCD mode
-	if(flags & STATUS_FLAG_D)
-		printf("Error BCD mode not supported !\n");
+	snes_cpu_registers_switch_reg_len(registers, (flags & STATUS_FLAG_X) ? CPU_REGISTER_8_BIT : CPU_REGISTER_16_BIT);
+	snes_cpu_registers_switch_mem_len(registers, (flags & STATUS_FLAG_M) ? CPU_REGISTER_8_BIT : CPU_REGISTER_16_BIT);
 }
 
 void snes_cpu_registers_status_flag_set(snes_cpu_registers_t *registers, uint8_t flags)
 {
+	registers->pending &= ~flags;
 	registers->status |= flags;
 	if(flags & STATUS_FLAG_X)
 		snes_cpu_registers_switch_reg_len(registers, CPU_REGISTER_8_BIT);
 	if(flags & STATUS_FLAG_M)
 		snes_cpu_registers_switch_mem_len(registers, CPU_REGISTER_8_BIT);
-	///TODO implement the BCD mode
-	if(flags & STATUS_FLAG_D)
-		printf("Error BCD mode not supported !\n");
 }
 
 void snes_cpu_registers_status_flag_reset(snes_cpu_registers_t *registers, uint8_t flags)
 {
+	registers->pending &= ~flags;
 	registers->status &= ~flags;
 	if(flags & STATUS_FLAG_X)
 		snes_cpu_registers_switch_reg_len(registers, CPU_REGISTER_16_BIT);
@@ -246,6 +363,8 @@ void snes_cpu_registers_status_flag_reset(snes_cpu_registers_t *registers, uint8
 
 uint8_t snes_cpu_registers_status_flag_isset(snes_cpu_registers_t *registers, uint8_t flag)
 {
+	if(registers->pending & flag)
+		snes_cpu_registers_status_flag_resolve(registers, flag);
 	return !!(registers->status & flag);
 }
 
@@ -21,36 +21,52 @@ struct snes_cpu_register_value{
 	};
 };
 
-#define STATUS_FLAG_C 1 << 0
-#define STATUS_FLAG_Z 1 << 1
-#define STATUS_FLAG_I 1 << 2
-#define STATUS_FLAG_D 1 << 3
-#define STATUS_FLAG_X 1 << 4
-#define STATUS_FLAG_B 1 << 4
-#define STATUS_FLAG_M 1 << 5
-#define STATUS_FLAG_V 1 << 6
-#define STATUS_FLAG_N 1 << 7
+#define STATUS_FLAG_C (1 << 0)
+#define STATUS_FLAG_Z (1 << 1)
+#define STATUS_FLAG_I (1 << 2)
+#define STATUS_FLAG_D (1 << 3)
+#define STATUS_FLAG_X (1 << 4)
+#define STATUS_FLAG_B (1 << 4)
+#define STATUS_FLAG_M (1 << 5)
+#define STATUS_FLAG_V (1 << 6)
+#define STATUS_FLAG_N (1 << 7)
 
 snes_cpu_registers_t *snes_cpu_registers_init();
 void snes_cpu_registers_destroy(snes_cpu_registers_t *registers);
 
 
 void snes_cpu_registers_dump(snes_cpu_registers_t *registers);
+void snes_cpu_registers_copy(snes_cpu_registers_t *dest, snes_cpu_registers_t *src);
+int snes_cpu_registers_compare(snes_cpu_registers_t *a, snes_cpu_registers_t *b);
 
 void snes_cpu_registers_update16_z(snes_cpu_registers_t *registers, uint16_t value);
 void snes_cpu_registers_update8_z(snes_cpu_registers_t *registers, uint8_t value);
 void snes_cpu_registers_update16_c(snes_cpu_registers_t *registers, uint16_t value);
 void snes_cpu_registers_update8_c(snes_cpu_registers_t *registers, uint8_t value);
 
+/*
+ * N/Z (and C/V for additions) are not computed when an instruction executes :
+ * the result and operands are kept and the flags only evaluated when P is read.
+ * SBC goes through update*_add with the complement of its operand.
+ */
 void snes_cpu_registers_update8(snes_cpu_registers_t *registers, uint8_t value);
 void snes_cpu_registers_update16(snes_cpu_registers_t *registers, uint16_t value);
+void snes_cpu_registers_update8_add(snes_cpu_registers_t *registers, uint8_t value1, uint8_t value2, uint8_t result);
+void snes_cpu_registers_update16_add(snes_cpu_registers_t *registers, uint16_t value1, uint16_t value2, uint16_t result);
 void snes_cpu_registers_accumulator_set(snes_cpu_registers_t *registers, uint16_t value);
+void snes_cpu_registers_accumulator_set8(snes_cpu_registers_t *registers, uint8_t value);
 void snes_cpu_registers_accumulator_set16(snes_cpu_registers_t *registers, uint16_t value);
 struct snes_cpu_register_value snes_cpu_registers_accumulator_get(snes_cpu_registers_t *registers);
 void snes_cpu_registers_x_set(snes_cpu_registers_t *registers, uint16_t value);
+void snes_cpu_registers_x_set8(snes_cpu_registers_t *registers, uint16_t value);
+void snes_cpu_registers_x_set16(snes_cpu_registers_t *registers, uint16_t value);
 struct snes_cpu_register_value snes_cpu_registers_x_get(snes_cpu_registers_t *registers);
 void snes_cpu_registers_y_set(snes_cpu_registers_t *registers, uint16_t value);
+void snes_cpu_registers_y_set8(snes_cpu_registers_t *registers, uint16_t value);
+void snes_cpu_registers_y_set16(snes_cpu_registers_t *registers, uint16_t value);
 struct snes_cpu_register_value snes_cpu_registers_y_get(snes_cpu_registers_t *registers);
+/*End of a block move : X, Y and the 16 bits accumulator are set without touching the flags*/
+void snes_cpu_registers_block_move_set(snes_cpu_registers_t *registers, uint16_t x, uint16_t y, uint16_t acc);
 void snes_cpu_registers_direct_page_set(snes_cpu_registers_t *registers, uint16_t value);
 uint16_t snes_cpu_registers_direct_page_get(snes_cpu_registers_t *registers);
 void snes_cpu_registers_stack_pointer_set(snes_cpu_registers_t *registers, uint16_t value);
@@ -63,6 +79,8 @@ uint32_t snes_cpu_registers_program_bank_get(snes_cpu_registers_t *registers);
 void snes_cpu_registers_data_bank_set(snes_cpu_registers_t *registers, uint8_t value);
 uint32_t snes_cpu_registers_data_bank_get(snes_cpu_registers_t *registers);
 uint8_t snes_cpu_registers_status_flag_get(snes_cpu_registers_t *registers);
+/*M and X only, never deferred so cheaper than a full read of P*/
+uint8_t snes_cpu_registers_width_flags_get(snes_cpu_registers_t *registers);
 void snes_cpu_registers_status_flag_force(snes_cpu_registers_t *registers, uint8_t flags);
 void snes_cpu_registers_status_flag_set(snes_cpu_registers_t *registers, uint8_t flags);
 void snes_cpu_registers_status_flag_reset(snes_cpu_registers_t *registers, uint8_t flags);
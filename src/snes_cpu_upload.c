@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_cpu_upload.h"
+#include "snes_cpu_idle.h"
+#include "snes_cpu_registers.h"
+#include "snes_bus.h"
+#include "snes_apu.h"
+
+//APU ports as seen from the loop, the bank must map the I/O
+#define SNES_CPU_UPLOAD_PORT0 0x2140
+#define SNES_CPU_UPLOAD_PORT1 0x2141
+
+//Steps of an iteration, in the order they must happen
+#define SNES_CPU_UPLOAD_LOADED (1 << 0)
+#define SNES_CPU_UPLOAD_DATA_SENT (1 << 1)
+#define SNES_CPU_UPLOAD_INDEX_SENT (1 << 2)
+#define SNES_CPU_UPLOAD_ACKED (1 << 3)
+#define SNES_CPU_UPLOAD_INCREMENTED (1 << 4)
+#define SNES_CPU_UPLOAD_COMPARED (1 << 5)
+#define SNES_CPU_UPLOAD_ALL ((1 << 6) - 1)
+
+//What A holds during the analysis
+typedef enum {
+	SNES_CPU_UPLOAD_UNKNOWN,
+	SNES_CPU_UPLOAD_DATA,
+	SNES_CPU_UPLOAD_INDEX, //Index before the increment
+	SNES_CPU_UPLOAD_NEXT, //Index after the increment
+} snes_cpu_upload_value_t;
+
+//Index register of an indexed data load, -1 if it isn't one
+static int snes_cpu_upload_source_index(snes_cpu_addressing_mode_t mode)
+{
+	switch(mode) {
+		case AbsoluteIndexedX:
+		case AbsoluteLongIndexedX:
+			return 0;
+		case AbsoluteIndexedY:
+		case DirectPageIndirectIndexedY:
+		case DirectPageIndirectLongIndexedY:
+			return 1;
+		default:
+			return -1;
+	}
+}
+
+//The index register used by an instruction must be the loop's one
+static uint8_t snes_cpu_upload_use_index(int *index, int used)
+{
+	if(*index < 0)
+		*index = used;
+	return *index == used;
+}
+
+void snes_cpu_upload_analyze(snes_cpu_t *cpu, uint32_t pbr, uint16_t start, uint16_t next_pc,
+							 uint8_t dbr, snes_cpu_upload_loop_t *loop)
+{
+	snes_cpu_instruction_t instruction;
+	snes_cpu_upload_value_t a = SNES_CPU_UPLOAD_UNKNOWN;
+	uint16_t d = snes_cpu_registers_direct_page_get(cpu->registers);
+	uint16_t pc = start;
+	uint16_t target;
+	uint16_t wait = 0; //Address of the CMP $2140 waiting for the ack
+	uint32_t steps = 0;
+	uint32_t cycles = 0;
+	int index = -1;
+	int used;
+
+	memset(loop, 0, sizeof(snes_cpu_upload_loop_t));
+	//8 bits data, I/O in the data bank
+	if(cpu->mode == SNES_CPU_MODE_M16X8 || cpu->mode == SNES_CPU_MODE_M16X16 || (dbr & 0x40))
+		return;
+
+	while(pc < next_pc) {
+		if(!snes_bus_is_memory(cpu->bus, pbr + pc))
+			return;
+		snes_cpu_decode_instruction(cpu, pbr, pc, &instruction);
+		cycles += instruction.timing.master;
+		if((instruction.timing.flags & SNES_CPU_TIMING_DIRECT_PAGE) && (d & 0xFF))
+			cycles += SNES_BUS_FAST_CYCLES;
+		//The ack wait is only the CMP and its BNE
+		if(wait && instruction.opcode.mne != BNE)
+			return;
+		switch(instruction.opcode.mne) {
+			case LDA:
+				used = snes_cpu_upload_source_index(instruction.opcode.addr);
+				if(used < 0 || steps || !snes_cpu_upload_use_index(&index, used))
+					return;
+				loop->source_mode = instruction.opcode.addr;
+				loop->source_operand = instruction.operand;
+				a = SNES_CPU_UPLOAD_DATA;
+				steps |= SNES_CPU_UPLOAD_LOADED;
+				break;
+			case STA:
+				if(instruction.opcode.addr != Absolute)
+					return;
+				if(instruction.operand == SNES_CPU_UPLOAD_PORT1 && a == SNES_CPU_UPLOAD_DATA &&
+				   steps == SNES_CPU_UPLOAD_LOADED)
+					steps |= SNES_CPU_UPLOAD_DATA_SENT;
+				else if(instruction.operand == SNES_CPU_UPLOAD_PORT0 && a == SNES_CPU_UPLOAD_INDEX &&
+						steps == (SNES_CPU_UPLOAD_LOADED | SNES_CPU_UPLOAD_DATA_SENT))
+					steps |= SNES_CPU_UPLOAD_INDEX_SENT;
+				else
+					return;
+				break;
+			case STX:
+			case STY:
+				if(instruction.opcode.addr != Absolute || instruction.operand != SNES_CPU_UPLOAD_PORT0 ||
+				   steps != (SNES_CPU_UPLOAD_LOADED | SNES_CPU_UPLOAD_DATA_SENT) ||
+				   !snes_cpu_upload_use_index(&index, instruction.opcode.mne == STY))
+					return;
+				steps |= SNES_CPU_UPLOAD_INDEX_SENT;
+				break;
+			case TXA:
+			case TYA:
+				if(!snes_cpu_upload_use_index(&index, instruction.opcode.mne == TYA))
+					return;
+				a = (steps & SNES_CPU_UPLOAD_INCREMENTED) ? SNES_CPU_UPLOAD_NEXT : SNES_CPU_UPLOAD_INDEX;
+				break;
+			case CMP:
+				if(instruction.opcode.addr == Absolute && instruction.operand == SNES_CPU_UPLOAD_PORT0 &&
+				   a == SNES_CPU_UPLOAD_INDEX && (steps & SNES_CPU_UPLOAD_INDEX_SENT) &&
+				   !(steps & SNES_CPU_UPLOAD_ACKED)) {
+					wait = pc;
+				} else if(instruction.opcode.addr == Immediate && a == SNES_CPU_UPLOAD_NEXT &&
+						  (steps & SNES_CPU_UPLOAD_INCREMENTED)) {
+					loop->end = instruction.operand;
+					steps |= SNES_CPU_UPLOAD_COMPARED;
+				} else {
+					return;
+				}
+				break;
+			case INX:
+			case INY:
+				if(!(steps & SNES_CPU_UPLOAD_ACKED) || (steps & SNES_CPU_UPLOAD_INCREMENTED) ||
+				   !snes_cpu_upload_use_index(&index, instruction.opcode.mne == INY))
+					return;
+				if(a == SNES_CPU_UPLOAD_INDEX)
+					a = SNES_CPU_UPLOAD_UNKNOWN;
+				steps |= SNES_CPU_UPLOAD_INCREMENTED;
+				break;
+			case CPX:
+			case CPY:
+				if(!snes_cpu_upload_use_index(&index, instruction.opcode.mne == CPY))
+					return;
+				if(instruction.opcode.addr == Absolute && instruction.operand == SNES_CPU_UPLOAD_PORT0 &&
+				   (steps & SNES_CPU_UPLOAD_INDEX_SENT) && !(steps & SNES_CPU_UPLOAD_ACKED)) {
+					wait = pc;
+				} else if(instruction.opcode.addr == Immediate && (steps & SNES_CPU_UPLOAD_INCREMENTED)) {
+					loop->end = instruction.operand;
+					steps |= SNES_CPU_UPLOAD_COMPARED;
+				} else {
+					return;
+				}
+				break;
+			case BNE:
+				target = pc + instruction.operand_size + 1 + (int8_t)instruction.operand;
+				if(wait) {
+					if(target != wait)
+						return;
+					wait = 0;
+					steps |= SNES_CPU_UPLOAD_ACKED;
+				} else if(target != start || pc + instruction.operand_size + 1 != next_pc ||
+						  steps != SNES_CPU_UPLOAD_ALL) {
+					return;
+				} else {
+					//Closing branch, taken
+					cycles += SNES_BUS_FAST_CYCLES;
+				}
+				break;
+			default:
+				return;
+		}
+		pc += instruction.operand_size + 1;
+	}
+	if(pc != next_pc || steps != SNES_CPU_UPLOAD_ALL)
+		return;
+
+	loop->index_y = index;
+	switch(a) {
+		case SNES_CPU_UPLOAD_DATA:
+			loop->a = SNES_CPU_UPLOAD_A_DATA;
+			break;
+		case SNES_CPU_UPLOAD_INDEX:
+			loop->a = SNES_CPU_UPLOAD_A_INDEX;
+			break;
+		case SNES_CPU_UPLOAD_NEXT:
+			loop->a = SNES_CPU_UPLOAD_A_NEXT;
+			break;
+		default:
+			return;
+	}
+	loop->cycles = cycles;
+	loop->valid = 1;
+}
+
+//Address of the data byte at index, -1 if the pointer isn't plain memory
+static int snes_cpu_upload_source(snes_cpu_t *cpu, snes_cpu_upload_loop_t *loop, uint16_t index, uint32_t *source)
+{
+	uint32_t dbr = snes_cpu_registers_data_bank_get(cpu->registers);
+	uint16_t pointer = snes_cpu_registers_direct_page_get(cpu->registers) + loop->source_operand;
+	uint32_t base;
+	int i;
+
+	switch(loop->source_mode) {
+		case AbsoluteIndexedX:
+		case AbsoluteIndexedY:
+			base = dbr + (loop->source_operand & 0xFFFF);
+			break;
+		case AbsoluteLongIndexedX:
+			base = loop->source_operand;
+			break;
+		case DirectPageIndirectIndexedY:
+		case DirectPageIndirectLongIndexedY:
+			base = loop->source_mode == DirectPageIndirectIndexedY ? dbr : 0;
+			for(i = 0; i < (loop->source_mode == DirectPageIndirectIndexedY ? 2 : 3); i++) {
+				if(!snes_bus_is_memory(cpu->bus, (uint16_t)(pointer + i)))
+					return -1;
+				base += snes_bus_read(cpu->bus, (uint16_t)(pointer + i)) << (8 * i);
+			}
+			break;
+		default:
+			return -1;
+	}
+	*source = (base + index) & 0xFFFFFF;
+	return 0;
+}
+
+int snes_cpu_upload_run(snes_cpu_t *cpu, snes_cpu_upload_loop_t *loop)
+{
+	uint8_t data[256];
+	struct snes_cpu_register_value reg;
+	uint64_t now = *cpu->clock;
+	uint16_t mask = cpu->mode == SNES_CPU_MODE_M8X16 ? 0xFFFF : 0xFF;
+	uint16_t index;
+	uint16_t next;
+	uint32_t remaining;
+	uint32_t count;
+	uint32_t source;
+	uint32_t per_byte = loop->cycles + SNES_CPU_UPLOAD_IPL_CYCLES;
+	uint32_t i;
+
+	//Watched accesses must really happen
+	if(cpu->breakpoint_count > 0 || snes_bus_get_watchpoint_count(cpu->bus) > 0)
+		return 0;
+
+	reg = loop->index_y ? snes_cpu_registers_y_get(cpu->registers) : snes_cpu_registers_x_get(cpu->registers);
+	index = reg.value16 & mask;
+	/*
+	 * All but the last byte of the block, without overrunning the run budget
+	 * and without wrapping the IPL's Y
+	 */
+	remaining = (loop->end - index) & mask;
+	if(remaining <= 1 || cpu->run_limit <= now)
+		return 0;
+	count = remaining - 1;
+	if(count > 0xFFu - (index & 0xFF))
+		count = 0xFFu - (index & 0xFF);
+	if(count > (cpu->run_limit - now) / per_byte)
+		count = (cpu->run_limit - now) / per_byte;
+	if(count == 0)
+		return 0;
+
+	if(snes_cpu_upload_source(cpu, loop, index, &source) < 0)
+		return 0;
+	for(i = 0; i < count; i++) {
+		if(!snes_bus_is_memory(cpu->bus, source + i))
+			break;
+		data[i] = snes_bus_read(cpu->bus, source + i);
+	}
+	if(i < count || snes_apu_ipl_upload(snes_bus_get_apu(cpu->bus), now, index & 0xFF, data, count) < 0) {
+		*cpu->clock = now;
+		return 0;
+	}
+
+	//Registers as the last iteration leaves them, the data reads are already on the clock
+	next = (index + count) & mask;
+	if(loop->a == SNES_CPU_UPLOAD_A_DATA)
+		snes_cpu_registers_accumulator_set8(cpu->registers, data[count - 1]);
+	else
+		snes_cpu_registers_accumulator_set8(cpu->registers, next - (loop->a == SNES_CPU_UPLOAD_A_INDEX));
+	if(loop->index_y)
+		snes_cpu_registers_y_set(cpu->registers, next);
+	else
+		snes_cpu_registers_x_set(cpu->registers, next);
+	if(mask == 0xFF)
+		snes_cpu_registers_update8(cpu->registers, next - loop->end);
+	else
+		snes_cpu_registers_update16(cpu->registers, next - loop->end);
+	if(next >= (loop->end & mask))
+		snes_cpu_registers_status_flag_set(cpu->registers, STATUS_FLAG_C);
+	else
+		snes_cpu_registers_status_flag_reset(cpu->registers, STATUS_FLAG_C);
+
+	*cpu->clock += (uint64_t)count * per_byte;
+	cpu->stats.upload_bytes += count;
+	snes_cpu_idle_reset(cpu);
+	return 1;
+}
@@ -0,0 +1,29 @@
+#ifndef SNES_CPU_UPLOAD_H
+#define SNES_CPU_UPLOAD_H
+
+#include <stdint.h>
+#include "snes_cpu_internal.h"
+
+/*
+ * APU upload loop fast path : the loop sending a block to the IPL one byte at
+ * a time through $2140-$2141,
+ *   loop: LDA source,X / STA $2141 / TXA / STA $2140
+ *   wait: CMP $2140 / BNE wait
+ *         INX / CPX #end / BNE loop
+ * (Y instead of X, STX $2140, TXA/CMP #end, the long and indirect sources) is
+ * recognized by the idle loop detection when it closes on its branch. While
+ * the IPL waits for the next byte, the bytes up to the last one are stored
+ * into the APU RAM at once and the clock moved by their cost, instead of
+ * spinning on the handshake for each byte. The last byte goes the normal way.
+ */
+
+//CPU side of the handshake for a byte is the loop body, the IPL side 25 SPC700 cycles
+#define SNES_CPU_UPLOAD_IPL_CYCLES (25ULL * SNES_MASTER_CLOCK / SNES_APU_SPC_CLOCK)
+
+//Fills loop, loop->valid is 0 if the body isn't an upload loop
+void snes_cpu_upload_analyze(snes_cpu_t *cpu, uint32_t pbr, uint16_t start, uint16_t next_pc,
+							 uint8_t dbr, snes_cpu_upload_loop_t *loop);
+//Called at the start of an iteration, returns 1 if bytes were transferred
+int snes_cpu_upload_run(snes_cpu_t *cpu, snes_cpu_upload_loop_t *loop);
+
+#endif //SNES_CPU_UPLOAD_H
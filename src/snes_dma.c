@@ -0,0 +1,529 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_dma.h"
+#include "snes_bus.h"
+#include "snes_irq.h"
+#include "snes_addrdecoder.h"
+
+#define SNES_DMA_MDMAEN 0x420B
+#define SNES_DMA_HDMAEN 0x420C
+#define SNES_DMA_BASE 0x4300
+#define SNES_DMA_END 0x437F
+
+//Registers of a channel, $43x0-$43xF
+#define SNES_DMA_DMAP 0x0
+#define SNES_DMA_BBAD 0x1
+#define SNES_DMA_A1TL 0x2
+#define SNES_DMA_A1TH 0x3
+#define SNES_DMA_A1B 0x4
+#define SNES_DMA_DASL 0x5 //Also the HDMA indirect address
+#define SNES_DMA_DASH 0x6
+#define SNES_DMA_DASB 0x7 //HDMA indirect bank
+#define SNES_DMA_A2AL 0x8 //HDMA table address
+#define SNES_DMA_A2AH 0x9
+#define SNES_DMA_NLTR 0xA //HDMA line counter, bit 7 repeats the transfer
+#define SNES_DMA_REGISTERS 16
+
+#define SNES_DMA_DMAP_B_TO_A 0x80
+#define SNES_DMA_DMAP_INDIRECT 0x40
+#define SNES_DMA_DMAP_FIXED 0x08
+#define SNES_DMA_DMAP_DECREMENT 0x10
+#define SNES_DMA_DMAP_MODE(dmap) ((dmap) & 7)
+
+#define SNES_DMA_NLTR_REPEAT 0x80
+#define SNES_DMA_NLTR_COUNT 0x7F
+
+/*
+ * Timings in master cycles : 8 per byte and per channel, and about 12 to 24
+ * to start, depending on the alignment on the CPU clock
+ */
+#define SNES_DMA_START_CYCLES 18
+#define SNES_DMA_CHANNEL_CYCLES 8
+#define SNES_DMA_BYTE_CYCLES 8
+
+//Fixed source bytes are repeated in a buffer to be written as a block
+#define SNES_DMA_FILL_SIZE 256
+
+/*
+ * HDMA runs at the start of hblank (dot 278) of the lines 0 to 224, its tables
+ * are set up at the start of the frame
+ */
+#define SNES_DMA_HDMA_LINES SNES_IRQ_VBLANK_LINE
+#define SNES_DMA_HDMA_CYCLE (278 * 4)
+#define SNES_DMA_HDMA_INIT -1
+//At most 4 bytes per channel and per line
+#define SNES_DMA_HDMA_MAX_WRITES (SNES_DMA_HDMA_LINES * SNES_DMA_CHANNELS * 4)
+
+//B bus address offsets of the transfer modes, repeated every 4 bytes
+static const uint8_t snes_dma_patterns[8][4] = {
+	{ 0, 0, 0, 0 },
+	{ 0, 1, 0, 1 },
+	{ 0, 0, 0, 0 },
+	{ 0, 0, 1, 1 },
+	{ 0, 1, 2, 3 },
+	{ 0, 1, 0, 1 },
+	{ 0, 0, 0, 0 },
+	{ 0, 0, 1, 1 },
+};
+
+//Bytes of an HDMA transfer for each mode
+static const uint8_t snes_dma_hdma_sizes[8] = { 1, 2, 2, 4, 4, 4, 2, 4 };
+
+//Block writes of a mode : 0 to a single register, 1 to a pair, -1 none
+static const int8_t snes_dma_blocks[8] = { 0, 1, 0, -1, -1, 1, 0, -1 };
+
+//What a walk through the HDMA tables changes
+typedef struct {
+	uint8_t regs[SNES_DMA_CHANNELS][SNES_DMA_REGISTERS];
+	uint8_t transfer; //Channels writing on their next line
+	uint8_t completed; //Channels at the end of their table
+} snes_dma_state_t;
+
+//A byte moved by HDMA, the A to B ones are read from the tables beforehand
+typedef struct {
+	uint32_t a;
+	uint8_t b;
+	uint8_t data;
+	uint8_t to_a;
+} snes_dma_hdma_write_t;
+
+/*
+ * Writes of the lines from first to the end of the frame, from the tables as
+ * they were when it was compiled
+ */
+typedef struct {
+	uint8_t valid;
+	int first;
+	snes_dma_state_t base; //State at the first line, the live one is the state after the last
+	uint16_t starts[SNES_DMA_HDMA_LINES + 1]; //First write of each line
+	uint16_t cycles[SNES_DMA_HDMA_LINES];
+	snes_dma_hdma_write_t writes[SNES_DMA_HDMA_MAX_WRITES];
+} snes_dma_hdma_list_t;
+
+struct _snes_dma {
+	snes_bus_t *bus;
+	snes_dma_state_t state;
+	uint8_t hdmaen;
+	uint8_t fill[SNES_DMA_FILL_SIZE];
+	uint64_t frame; //Start of the frame of the next HDMA line
+	int line; //Next HDMA line, SNES_DMA_HDMA_INIT for the setup of the frame
+	uint64_t next; //Clock of that line
+	uint8_t busy; //A transfer is running, the catch up waits
+	uint8_t dirty; //A table was written by the running HDMA
+	snes_dma_hdma_list_t list;
+};
+
+static void snes_dma_update_next(snes_dma_t *dma)
+{
+	if(dma->line == SNES_DMA_HDMA_INIT)
+		dma->next = dma->frame;
+	else
+		dma->next = dma->frame + dma->line * SNES_IRQ_LINE_CYCLES + SNES_DMA_HDMA_CYCLE;
+}
+
+snes_dma_t *snes_dma_init(snes_bus_t *bus)
+{
+	snes_dma_t *dma = malloc(sizeof(snes_dma_t));
+	if(dma == NULL) {
+		printf("Error at allocation time !\n");
+		return NULL;
+	}
+	memset(dma, 0, sizeof(snes_dma_t));
+	//Undefined at power up, the usual $FF
+	memset(dma->state.regs, 0xFF, sizeof(dma->state.regs));
+	dma->bus = bus;
+	dma->line = SNES_DMA_HDMA_INIT;
+	snes_dma_update_next(dma);
+	return dma;
+}
+
+void snes_dma_destroy(snes_dma_t *dma)
+{
+	free(dma);
+}
+
+int snes_dma_is_register(uint16_t offset)
+{
+	return offset == SNES_DMA_MDMAEN || offset == SNES_DMA_HDMAEN ||
+		   (offset >= SNES_DMA_BASE && offset <= SNES_DMA_END);
+}
+
+static void snes_dma_transfer_byte(snes_dma_t *dma, uint8_t dmap, uint8_t b, uint32_t a)
+{
+	if(dmap & SNES_DMA_DMAP_B_TO_A)
+		snes_bus_write(dma->bus, a, snes_bus_read_b(dma->bus, b));
+	else
+		snes_bus_write_b(dma->bus, b, snes_bus_read(dma->bus, a));
+}
+
+/*
+ * A to B with a source in plain memory, as long as the mode allows it : up
+ * to the end of the source page (or of the fill buffer for a fixed source).
+ * Returns the bytes written, 0 if they must go one by one.
+ */
+static uint32_t snes_dma_transfer_block(snes_dma_t *dma, uint8_t dmap, uint8_t bbad, uint32_t a,
+										 uint32_t done, uint32_t len)
+{
+	int8_t block = snes_dma_blocks[SNES_DMA_DMAP_MODE(dmap)];
+	const uint8_t *src;
+	uint32_t left;
+
+	//A pair of registers must start with the first one
+	if((dmap & SNES_DMA_DMAP_B_TO_A) || block < 0 || (block && (done & 1)) ||
+	   (dmap & (SNES_DMA_DMAP_FIXED | SNES_DMA_DMAP_DECREMENT)) == SNES_DMA_DMAP_DECREMENT)
+		return 0;
+	src = snes_bus_get_read_ptr(dma->bus, a);
+	if(src == NULL)
+		return 0;
+
+	if(dmap & SNES_DMA_DMAP_FIXED) {
+		if(len > SNES_DMA_FILL_SIZE)
+			len = SNES_DMA_FILL_SIZE;
+		memset(dma->fill, *src, len);
+		src = dma->fill;
+	} else {
+		//The address wraps in its bank, and its page may be followed by another memory
+		left = SNES_ADDRDECODER_PAGE_SIZE - (a & SNES_ADDRDECODER_PAGE_MASK);
+		if(len > left)
+			len = left;
+	}
+	return snes_bus_write_b_block(dma->bus, bbad, block, src, len);
+}
+
+static uint32_t snes_dma_run_channel(snes_dma_t *dma, uint8_t *regs)
+{
+	uint8_t dmap = regs[SNES_DMA_DMAP];
+	const uint8_t *pattern = snes_dma_patterns[SNES_DMA_DMAP_MODE(dmap)];
+	uint32_t bank = regs[SNES_DMA_A1B] << 16;
+	uint16_t a = regs[SNES_DMA_A1TL] | (regs[SNES_DMA_A1TH] << 8);
+	uint32_t count = regs[SNES_DMA_DASL] | (regs[SNES_DMA_DASH] << 8);
+	int step = 1;
+	uint32_t done = 0;
+	uint32_t block;
+
+	if(dmap & SNES_DMA_DMAP_FIXED)
+		step = 0;
+	else if(dmap & SNES_DMA_DMAP_DECREMENT)
+		step = -1;
+	//A count of 0 is 65536 bytes
+	if(count == 0)
+		count = 0x10000;
+
+	while(done < count) {
+		block = snes_dma_transfer_block(dma, dmap, regs[SNES_DMA_BBAD], bank | a, done, count - done);
+		if(block > 0) {
+			a += step * (int)block;
+			done += block;
+			continue;
+		}
+		snes_dma_transfer_byte(dma, dmap, regs[SNES_DMA_BBAD] + pattern[done & 3], bank | a);
+		a += step;
+		done++;
+	}
+
+	regs[SNES_DMA_A1TL] = a;
+	regs[SNES_DMA_A1TH] = a >> 8;
+	regs[SNES_DMA_DASL] = 0;
+	regs[SNES_DMA_DASH] = 0;
+	return count;
+}
+
+static void snes_dma_run(snes_dma_t *dma, uint8_t channels)
+{
+	uint64_t *clock = snes_bus_get_clock(dma->bus);
+	uint64_t start = *clock;
+	uint64_t cycles = SNES_DMA_START_CYCLES;
+	int i;
+
+	//Lowest channel first
+	for(i = 0; i < SNES_DMA_CHANNELS; i++) {
+		if(!(channels & (1 << i)))
+			continue;
+		cycles += SNES_DMA_CHANNEL_CYCLES;
+		cycles += (uint64_t)snes_dma_run_channel(dma, dma->state.regs[i]) * SNES_DMA_BYTE_CYCLES;
+	}
+	//The accesses take the DMA speed whatever the memory
+	*clock = start + cycles;
+}
+
+/*
+ * HDMA table read, without wait states : the tables are walked ahead of time.
+ * Writes into the pages read are reported by snes_dma_table_written.
+ */
+static uint8_t snes_dma_hdma_read(snes_dma_t *dma, uint32_t a)
+{
+	const uint8_t *ptr = snes_bus_get_read_ptr(dma->bus, a);
+	uint64_t *clock;
+	uint64_t saved;
+	uint8_t data;
+
+	if(ptr != NULL) {
+		snes_bus_watch_table(dma->bus, a);
+		return *ptr;
+	}
+	clock = snes_bus_get_clock(dma->bus);
+	saved = *clock;
+	data = snes_bus_read(dma->bus, a);
+	*clock = saved;
+	return data;
+}
+
+//Next entry of the table when the line counter is out, returns the bytes read
+static uint32_t snes_dma_hdma_reload(snes_dma_t *dma, snes_dma_state_t *state, int channel)
+{
+	uint8_t *regs = state->regs[channel];
+	uint32_t bank = regs[SNES_DMA_A1B] << 16;
+	uint16_t a2a = regs[SNES_DMA_A2AL] | (regs[SNES_DMA_A2AH] << 8);
+	uint32_t bytes = 1;
+
+	if(regs[SNES_DMA_NLTR] & SNES_DMA_NLTR_COUNT)
+		return 0;
+	regs[SNES_DMA_NLTR] = snes_dma_hdma_read(dma, bank | a2a++);
+	if(regs[SNES_DMA_NLTR] == 0) {
+		state->completed |= 1 << channel;
+		state->transfer &= ~(1 << channel);
+	} else {
+		state->transfer |= 1 << channel;
+		if(regs[SNES_DMA_DMAP] & SNES_DMA_DMAP_INDIRECT) {
+			regs[SNES_DMA_DASL] = snes_dma_hdma_read(dma, bank | a2a++);
+			regs[SNES_DMA_DASH] = snes_dma_hdma_read(dma, bank | a2a++);
+			bytes += 2;
+		}
+	}
+	regs[SNES_DMA_A2AL] = a2a;
+	regs[SNES_DMA_A2AH] = a2a >> 8;
+	return bytes;
+}
+
+//Setup at the start of the frame : the tables restart. Returns the cycles taken
+static uint32_t snes_dma_hdma_setup(snes_dma_t *dma)
+{
+	snes_dma_state_t *state = &dma->state;
+	uint32_t cycles = 0;
+	int i;
+
+	state->transfer = 0xFF;
+	state->completed = 0;
+	for(i = 0; i < SNES_DMA_CHANNELS; i++) {
+		if(!(dma->hdmaen & (1 << i)))
+			continue;
+		state->regs[i][SNES_DMA_A2AL] = state->regs[i][SNES_DMA_A1TL];
+		state->regs[i][SNES_DMA_A2AH] = state->regs[i][SNES_DMA_A1TH];
+		state->regs[i][SNES_DMA_NLTR] = 0;
+		cycles += SNES_DMA_CHANNEL_CYCLES + snes_dma_hdma_reload(dma, state, i) * SNES_DMA_BYTE_CYCLES;
+	}
+	return cycles > 0 ? cycles + SNES_DMA_START_CYCLES : 0;
+}
+
+/*
+ * Walks one line of the tables in state, the writes are added to list when
+ * given. Returns the cycles taken.
+ */
+static uint32_t snes_dma_hdma_walk(snes_dma_t *dma, snes_dma_state_t *state, snes_dma_hdma_list_t *list,
+								   uint32_t *count)
+{
+	uint8_t active = dma->hdmaen & ~state->completed;
+	snes_dma_hdma_write_t *write;
+	uint8_t *regs;
+	uint8_t dmap;
+	uint32_t bank;
+	uint16_t a;
+	uint32_t bytes = 0;
+	uint32_t channels = 0;
+	uint32_t i;
+	int c;
+
+	for(c = 0; c < SNES_DMA_CHANNELS; c++) {
+		if(!(active & (1 << c)))
+			continue;
+		regs = state->regs[c];
+		dmap = regs[SNES_DMA_DMAP];
+		channels++;
+		if(state->transfer & (1 << c)) {
+			//Direct tables hold the data after the line counter, indirect ones point to it
+			if(dmap & SNES_DMA_DMAP_INDIRECT) {
+				bank = regs[SNES_DMA_DASB] << 16;
+				a = regs[SNES_DMA_DASL] | (regs[SNES_DMA_DASH] << 8);
+			} else {
+				bank = regs[SNES_DMA_A1B] << 16;
+				a = regs[SNES_DMA_A2AL] | (regs[SNES_DMA_A2AH] << 8);
+			}
+			for(i = 0; i < snes_dma_hdma_sizes[SNES_DMA_DMAP_MODE(dmap)]; i++, a++) {
+				if(list != NULL) {
+					write = &list->writes[(*count)++];
+					write->a = bank | a;
+					write->b = regs[SNES_DMA_BBAD] + snes_dma_patterns[SNES_DMA_DMAP_MODE(dmap)][i];
+					write->to_a = (dmap & SNES_DMA_DMAP_B_TO_A) != 0;
+					write->data = write->to_a ? 0 : snes_dma_hdma_read(dma, bank | a);
+				}
+				bytes++;
+			}
+			if(dmap & SNES_DMA_DMAP_INDIRECT) {
+				regs[SNES_DMA_DASL] = a;
+				regs[SNES_DMA_DASH] = a >> 8;
+			} else {
+				regs[SNES_DMA_A2AL] = a;
+				regs[SNES_DMA_A2AH] = a >> 8;
+			}
+		}
+		//The repeat bit is only seen on the first line of an entry of $80 lines
+		regs[SNES_DMA_NLTR]--;
+		if(regs[SNES_DMA_NLTR] & SNES_DMA_NLTR_REPEAT)
+			state->transfer |= 1 << c;
+		else
+			state->transfer &= ~(1 << c);
+		bytes += snes_dma_hdma_reload(dma, state, c);
+	}
+	if(channels == 0)
+		return 0;
+	return SNES_DMA_START_CYCLES + channels * SNES_DMA_CHANNEL_CYCLES + bytes * SNES_DMA_BYTE_CYCLES;
+}
+
+/*
+ * Parses the tables once for the rest of the frame : the lines then only
+ * replay their writes. The live state moves to the end of the frame.
+ */
+static void snes_dma_hdma_compile(snes_dma_t *dma)
+{
+	snes_dma_hdma_list_t *list = &dma->list;
+	uint32_t count = 0;
+	int line;
+
+	snes_bus_clear_tables(dma->bus);
+	list->base = dma->state;
+	list->first = dma->line;
+	for(line = dma->line; line < SNES_DMA_HDMA_LINES; line++) {
+		list->starts[line] = count;
+		list->cycles[line] = snes_dma_hdma_walk(dma, &dma->state, list, &count);
+	}
+	list->starts[SNES_DMA_HDMA_LINES] = count;
+	list->valid = 1;
+}
+
+/*
+ * Brings the live state to the next line out of the compiled list, which is
+ * dropped : for the register accesses and the writes into the tables
+ */
+static void snes_dma_hdma_sync(snes_dma_t *dma)
+{
+	snes_dma_hdma_list_t *list = &dma->list;
+	uint32_t count = 0;
+	int line;
+
+	if(!list->valid)
+		return;
+	list->valid = 0;
+	//After the last line, the live state is already the one of the end of the frame
+	if(dma->line == SNES_DMA_HDMA_INIT)
+		return;
+	dma->state = list->base;
+	for(line = list->first; line < dma->line; line++)
+		snes_dma_hdma_walk(dma, &dma->state, NULL, &count);
+}
+
+static uint32_t snes_dma_hdma_run_line(snes_dma_t *dma)
+{
+	snes_dma_hdma_list_t *list = &dma->list;
+	snes_dma_hdma_write_t *write;
+	uint32_t i;
+
+	if(!list->valid)
+		snes_dma_hdma_compile(dma);
+	for(i = list->starts[dma->line]; i < list->starts[dma->line + 1]; i++) {
+		write = &list->writes[i];
+		if(write->to_a)
+			snes_bus_write(dma->bus, write->a, snes_bus_read_b(dma->bus, write->b));
+		else
+			snes_bus_write_b(dma->bus, write->b, write->data);
+	}
+	return list->cycles[dma->line];
+}
+
+uint64_t snes_dma_next_event(snes_dma_t *dma)
+{
+	return dma->busy ? UINT64_MAX : dma->next;
+}
+
+void snes_dma_catch_up(snes_dma_t *dma, uint64_t until)
+{
+	uint64_t *clock = snes_bus_get_clock(dma->bus);
+	uint64_t start;
+	uint32_t cycles;
+
+	if(dma->busy)
+		return;
+	dma->busy = 1;
+	while(dma->next <= until) {
+		start = *clock;
+		if(dma->line == SNES_DMA_HDMA_INIT) {
+			cycles = snes_dma_hdma_setup(dma);
+			dma->list.valid = 0;
+			dma->line = 0;
+		} else {
+			cycles = snes_dma_hdma_run_line(dma);
+			dma->line++;
+			if(dma->line == SNES_DMA_HDMA_LINES) {
+				dma->line = SNES_DMA_HDMA_INIT;
+				dma->frame += SNES_IRQ_FRAME_CYCLES;
+			}
+			if(dma->dirty) {
+				dma->dirty = 0;
+				snes_dma_hdma_sync(dma);
+			}
+		}
+		//The CPU is halted meanwhile, the stolen cycles are charged at catch up time
+		*clock = start + cycles;
+		snes_dma_update_next(dma);
+	}
+	dma->busy = 0;
+}
+
+void snes_dma_table_written(snes_dma_t *dma)
+{
+	if(!dma->list.valid)
+		return;
+	if(dma->busy) {
+		dma->dirty = 1;
+		return;
+	}
+	snes_bus_video_catch_up(dma->bus);
+	snes_dma_hdma_sync(dma);
+}
+
+uint8_t snes_dma_read(snes_dma_t *dma, uint16_t offset)
+{
+	if(offset == SNES_DMA_MDMAEN || offset == SNES_DMA_HDMAEN) {
+		//Write only
+		return 0;
+	}
+	//Only the HDMA channels move during the frame
+	if(dma->hdmaen & (1 << ((offset >> 4) & 7))) {
+		snes_bus_video_catch_up(dma->bus);
+		snes_dma_hdma_sync(dma);
+	}
+	return dma->state.regs[(offset >> 4) & 7][offset & 0xF];
+}
+
+void snes_dma_write(snes_dma_t *dma, uint16_t offset, uint8_t data)
+{
+	//Any write may change the lines to come : the list is compiled again
+	snes_bus_video_catch_up(dma->bus);
+	snes_dma_hdma_sync(dma);
+	switch(offset) {
+		case SNES_DMA_MDMAEN:
+			if(data) {
+				dma->busy = 1;
+				snes_dma_run(dma, data);
+				dma->busy = 0;
+			}
+			break;
+		case SNES_DMA_HDMAEN:
+			dma->hdmaen = data;
+			break;
+		default:
+			dma->state.regs[(offset >> 4) & 7][offset & 0xF] = data;
+			break;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef SNES_DMA_H
+#define SNES_DMA_H
+
+#include <stdint.h>
+
+typedef struct _snes_dma snes_dma_t;
+typedef struct _snes_bus snes_bus_t;
+
+#define SNES_DMA_CHANNELS 8
+
+/*
+ * General purpose DMA ($420B, $43x0-$43xF) between the A bus and the B bus.
+ * A write to MDMAEN runs the enabled channels at once, the CPU being halted
+ * meanwhile : the cycles are added to the master clock. Sources in plain
+ * memory written to the PPU memories or to the WRAM port are block copies.
+ */
+snes_dma_t *snes_dma_init(snes_bus_t *bus);
+void snes_dma_destroy(snes_dma_t *dma);
+
+/*
+ * HDMA ($420C, $43x7-$43xA) : the tables are parsed once per frame into the
+ * writes of each line. The lines are run by snes_bus_video_catch_up, before
+ * the B bus and DMA registers are accessed.
+ */
+/*Clock of the next HDMA line or frame setup, UINT64_MAX while a transfer runs*/
+uint64_t snes_dma_next_event(snes_dma_t *dma);
+/*Runs the HDMA events up to until, the master clock is charged with their cycles*/
+void snes_dma_catch_up(snes_dma_t *dma, uint64_t until);
+/*A page read by the HDMA tables is about to be written : the lines left are parsed again*/
+void snes_dma_table_written(snes_dma_t *dma);
+
+/*Returns 1 if the register at offset (bank removed) belongs to the DMA*/
+int snes_dma_is_register(uint16_t offset);
+uint8_t snes_dma_read(snes_dma_t *dma, uint16_t offset);
+void snes_dma_write(snes_dma_t *dma, uint16_t offset, uint8_t data);
+
+#endif //SNES_DMA_H
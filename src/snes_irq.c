@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_irq.h"
+
+#define SNES_IRQ_NMITIMEN 0x4200
+#define SNES_IRQ_HTIMEL 0x4207
+#define SNES_IRQ_HTIMEH 0x4208
+#define SNES_IRQ_VTIMEL 0x4209
+#define SNES_IRQ_VTIMEH 0x420A
+#define SNES_IRQ_RDNMI 0x4210
+#define SNES_IRQ_TIMEUP 0x4211
+#define SNES_IRQ_HVBJOY 0x4212
+
+#define SNES_IRQ_NMI_ENABLE 0x80
+#define SNES_IRQ_TIMER_MODE(nmitimen) (((nmitimen) >> 4) & 3)
+#define SNES_IRQ_TIMER_H 1
+#define SNES_IRQ_TIMER_V 2
+#define SNES_IRQ_TIMER_HV 3
+
+//A dot is 4 master cycles, hblank runs from dot 274 to the end of the line
+#define SNES_IRQ_DOT_CYCLES 4
+#define SNES_IRQ_DOTS 340
+#define SNES_IRQ_HBLANK_DOT 274
+#define SNES_IRQ_VBLANK_START (SNES_IRQ_VBLANK_LINE * SNES_IRQ_LINE_CYCLES)
+
+//CPU version number, read in RDNMI
+#define SNES_IRQ_CPU_VERSION 0x02
+
+#define SNES_IRQ_NEVER UINT64_MAX
+
+struct _snes_irq {
+	uint8_t nmitimen;
+	uint16_t htime;
+	uint16_t vtime;
+	uint8_t nmi_flag; //RDNMI bit 7, set from vblank start until read or vblank end
+	uint8_t nmi_pending; //NMI edge not serviced yet
+	uint8_t timeup; //TIMEUP bit 7, it's the IRQ line
+	uint8_t poll; //Lines to be polled before the next event, see snes_irq_get_poll
+	uint64_t last; //Clock of the last update
+};
+
+snes_irq_t *snes_irq_init()
+{
+	snes_irq_t *irq = malloc(sizeof(snes_irq_t));
+	if(irq == NULL) {
+		printf("Error at allocation time !\n");
+		return NULL;
+	}
+	memset(irq, 0, sizeof(snes_irq_t));
+	irq->htime = 0x1FF;
+	irq->vtime = 0x1FF;
+	return irq;
+}
+
+void snes_irq_destroy(snes_irq_t *irq)
+{
+	free(irq);
+}
+
+static uint8_t snes_irq_in_vblank(uint64_t now)
+{
+	return now % SNES_IRQ_FRAME_CYCLES >= SNES_IRQ_VBLANK_START;
+}
+
+static uint64_t snes_irq_next_vblank(uint64_t now)
+{
+	uint64_t event = now - now % SNES_IRQ_FRAME_CYCLES + SNES_IRQ_VBLANK_START;
+	if(event <= now)
+		event += SNES_IRQ_FRAME_CYCLES;
+	return event;
+}
+
+static uint64_t snes_irq_next_timer(snes_irq_t *irq, uint64_t now)
+{
+	uint64_t event;
+	uint32_t h = irq->htime * SNES_IRQ_DOT_CYCLES;
+
+	switch(SNES_IRQ_TIMER_MODE(irq->nmitimen)) {
+		case SNES_IRQ_TIMER_H:
+			if(irq->htime >= SNES_IRQ_DOTS)
+				return SNES_IRQ_NEVER;
+			event = now - now % SNES_IRQ_LINE_CYCLES + h;
+			if(event <= now)
+				event += SNES_IRQ_LINE_CYCLES;
+			return event;
+		case SNES_IRQ_TIMER_HV:
+			if(irq->htime >= SNES_IRQ_DOTS)
+				return SNES_IRQ_NEVER;
+			//Fall through
+		case SNES_IRQ_TIMER_V:
+			//At the start of the line, HTIME isn't used
+			if(SNES_IRQ_TIMER_MODE(irq->nmitimen) == SNES_IRQ_TIMER_V)
+				h = 0;
+			if(irq->vtime >= SNES_IRQ_LINES)
+				return SNES_IRQ_NEVER;
+			event = now - now % SNES_IRQ_FRAME_CYCLES + irq->vtime * SNES_IRQ_LINE_CYCLES + h;
+			if(event <= now)
+				event += SNES_IRQ_FRAME_CYCLES;
+			return event;
+		default:
+			return SNES_IRQ_NEVER;
+	}
+}
+
+//Catches up with the events between the last update and now
+static void snes_irq_update(snes_irq_t *irq, uint64_t now)
+{
+	uint8_t vblank_started;
+
+	if(now <= irq->last)
+		return;
+	vblank_started = snes_irq_next_vblank(irq->last) <= now;
+	if(vblank_started && (irq->nmitimen & SNES_IRQ_NMI_ENABLE))
+		irq->nmi_pending = 1;
+	irq->nmi_flag = (irq->nmi_flag || vblank_started) && snes_irq_in_vblank(now);
+	if(snes_irq_next_timer(irq, irq->last) <= now)
+		irq->timeup = 1;
+	irq->last = now;
+}
+
+int snes_irq_is_register(uint16_t offset)
+{
+	switch(offset) {
+		case SNES_IRQ_NMITIMEN:
+		case SNES_IRQ_HTIMEL:
+		case SNES_IRQ_HTIMEH:
+		case SNES_IRQ_VTIMEL:
+		case SNES_IRQ_VTIMEH:
+		case SNES_IRQ_RDNMI:
+		case SNES_IRQ_TIMEUP:
+		case SNES_IRQ_HVBJOY:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+uint8_t snes_irq_read(snes_irq_t *irq, uint16_t offset, uint64_t now)
+{
+	uint8_t data = 0;
+	uint32_t dot;
+
+	snes_irq_update(irq, now);
+	switch(offset) {
+		case SNES_IRQ_RDNMI:
+			data = (irq->nmi_flag << 7) | SNES_IRQ_CPU_VERSION;
+			irq->nmi_flag = 0;
+			break;
+		case SNES_IRQ_TIMEUP:
+			data = irq->timeup << 7;
+			irq->timeup = 0;
+			break;
+		case SNES_IRQ_HVBJOY:
+			dot = now % SNES_IRQ_LINE_CYCLES / SNES_IRQ_DOT_CYCLES;
+			data = snes_irq_in_vblank(now) << 7;
+			if(dot == 0 || dot >= SNES_IRQ_HBLANK_DOT)
+				data |= 1 << 6;
+			break;
+		default:
+			//Write only registers, open bus
+			break;
+	}
+	return data;
+}
+
+void snes_irq_write(snes_irq_t *irq, uint16_t offset, uint8_t data, uint64_t now)
+{
+	snes_irq_update(irq, now);
+	//The lines or the next timer event may change
+	irq->poll = 1;
+	switch(offset) {
+		case SNES_IRQ_NMITIMEN:
+			//Enabling NMI during vblank before RDNMI is read raises it at once
+			if(!(irq->nmitimen & SNES_IRQ_NMI_ENABLE) && (data & SNES_IRQ_NMI_ENABLE) && irq->nmi_flag)
+				irq->nmi_pending = 1;
+			irq->nmitimen = data;
+			if(SNES_IRQ_TIMER_MODE(data) == 0)
+				irq->timeup = 0;
+			break;
+		case SNES_IRQ_HTIMEL:
+			irq->htime = (irq->htime & 0x100) | data;
+			break;
+		case SNES_IRQ_HTIMEH:
+			irq->htime = (irq->htime & 0xFF) | ((data & 1) << 8);
+			break;
+		case SNES_IRQ_VTIMEL:
+			irq->vtime = (irq->vtime & 0x100) | data;
+			break;
+		case SNES_IRQ_VTIMEH:
+			irq->vtime = (irq->vtime & 0xFF) | ((data & 1) << 8);
+			break;
+		default:
+			//Read only registers
+			break;
+	}
+}
+
+uint8_t snes_irq_poll(snes_irq_t *irq, uint64_t now)
+{
+	uint8_t lines = 0;
+
+	snes_irq_update(irq, now);
+	irq->poll = 0;
+	if(irq->nmi_pending) {
+		irq->nmi_pending = 0;
+		lines |= SNES_IRQ_NMI;
+	}
+	if(irq->timeup)
+		lines |= SNES_IRQ_IRQ;
+	return lines;
+}
+
+uint8_t *snes_irq_get_poll(snes_irq_t *irq)
+{
+	return &irq->poll;
+}
+
+uint64_t snes_irq_next_event(snes_irq_t *irq, uint64_t now)
+{
+	uint64_t vblank = snes_irq_next_vblank(now);
+	uint64_t timer = snes_irq_next_timer(irq, now);
+
+	return timer < vblank ? timer : vblank;
+}
@@ -0,0 +1,44 @@
+#ifndef SNES_IRQ_H
+#define SNES_IRQ_H
+
+#include <stdint.h>
+
+typedef struct _snes_irq snes_irq_t;
+
+//NTSC timings in master cycles
+#define SNES_IRQ_LINE_CYCLES 1364
+#define SNES_IRQ_LINES 262
+#define SNES_IRQ_FRAME_CYCLES (SNES_IRQ_LINES * SNES_IRQ_LINE_CYCLES)
+#define SNES_IRQ_VBLANK_LINE 225
+
+//Interrupt lines returned by snes_irq_poll
+#define SNES_IRQ_NMI (1 << 0)
+#define SNES_IRQ_IRQ (1 << 1)
+
+/*
+ * Vblank NMI and H/V timer IRQ ($4200, $4207-$420A, $4210-$4212). There are no
+ * counters : the events are computed from the master clock given by the caller.
+ */
+snes_irq_t *snes_irq_init();
+void snes_irq_destroy(snes_irq_t *irq);
+
+/*Returns 1 if the register at offset (bank removed) belongs to the interrupt unit*/
+int snes_irq_is_register(uint16_t offset);
+uint8_t snes_irq_read(snes_irq_t *irq, uint16_t offset, uint64_t now);
+void snes_irq_write(snes_irq_t *irq, uint16_t offset, uint8_t data, uint64_t now);
+
+/*
+ * Lines asserted at now : the NMI edge is consumed by the call, the IRQ line
+ * stays asserted until TIMEUP ($4211) is read.
+ */
+uint8_t snes_irq_poll(snes_irq_t *irq, uint64_t now);
+/*
+ * Set when the lines may change before the next event (register writes, the
+ * CPU clearing its I flag) : the CPU then polls after the current instruction.
+ * Lowered by snes_irq_poll.
+ */
+uint8_t *snes_irq_get_poll(snes_irq_t *irq);
+/*First cycle after now where an interrupt may be raised (vblank start or timer)*/
+uint64_t snes_irq_next_event(snes_irq_t *irq, uint64_t now);
+
+#endif //SNES_IRQ_H
@@ -0,0 +1,396 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_ppu_internal.h"
+#include "snes_irq.h"
+
+#define SNES_PPU_VRAM_WORDS (SNES_PPU_VRAM_SIZE / 2)
+#define SNES_PPU_OAM_LOW 0x200 //Low table, written by pairs
+
+//Lines are rendered at the start of their hblank (dot 274), before HDMA
+#define SNES_PPU_RENDER_CYCLE (274 * 4)
+
+//COLDATA : the components written and their value
+#define SNES_PPU_COLDATA_RED 0x20
+#define SNES_PPU_COLDATA_GREEN 0x40
+#define SNES_PPU_COLDATA_BLUE 0x80
+#define SNES_PPU_COLDATA_VALUE(coldata) ((coldata) & 0x1F)
+
+//VMAIN bits 0-1
+static const uint16_t snes_ppu_vram_steps[4] = { 1, 32, 128, 128 };
+
+snes_ppu_t *snes_ppu_init()
+{
+	snes_ppu_t *ppu = malloc(sizeof(snes_ppu_t));
+	if(ppu == NULL) {
+		printf("Error at allocation time !\n");
+		goto error_alloc;
+	}
+	memset(ppu, 0, sizeof(snes_ppu_t));
+
+	ppu->vram = snes_ram_init(SNES_PPU_VRAM_SIZE);
+	if(ppu->vram == NULL) {
+		goto error_vram;
+	}
+
+	ppu->tiles = snes_ppu_tile_init(snes_ram_get_data(ppu->vram));
+	if(ppu->tiles == NULL) {
+		goto error_tiles;
+	}
+	ppu->mode7_simd = snes_ppu_mode7_get_max_simd();
+
+	ppu->framebuffer = calloc(SNES_PPU_WIDTH * SNES_PPU_HEIGHT, sizeof(uint32_t));
+	if(ppu->framebuffer == NULL) {
+		printf("Error at allocation time !\n");
+		goto error_framebuffer;
+	}
+	//Forced blank until the game sets up the display
+	ppu->regs[SNES_PPU_INIDISP] = SNES_PPU_INIDISP_BLANK;
+	ppu->line = 1;
+	ppu->next = SNES_IRQ_LINE_CYCLES + SNES_PPU_RENDER_CYCLE;
+	return ppu;
+
+error_framebuffer:
+	snes_ppu_tile_destroy(ppu->tiles);
+error_tiles:
+	snes_ram_destroy(ppu->vram);
+error_vram:
+	free(ppu);
+error_alloc:
+	return NULL;
+}
+
+void snes_ppu_destroy(snes_ppu_t *ppu)
+{
+	free(ppu->framebuffer);
+	snes_ppu_tile_destroy(ppu->tiles);
+	snes_ram_destroy(ppu->vram);
+	free(ppu);
+}
+
+//VMAIN bits 2-3 rotate the low bits of the address, for bitplane graphics
+static uint16_t snes_ppu_vram_translate(uint8_t vmain, uint16_t addr)
+{
+	switch(SNES_PPU_VMAIN_REMAP(vmain)) {
+		case 1:
+			return (addr & 0xFF00) | ((addr & 0x001F) << 3) | ((addr >> 5) & 7);
+		case 2:
+			return (addr & 0xFE00) | ((addr & 0x003F) << 3) | ((addr >> 6) & 7);
+		case 3:
+			return (addr & 0xFC00) | ((addr & 0x007F) << 3) | ((addr >> 7) & 7);
+		default:
+			return addr;
+	}
+}
+
+//Byte address in VRAM of the current word
+static inline uint32_t snes_ppu_vram_offset(snes_ppu_t *ppu)
+{
+	return (snes_ppu_vram_translate(ppu->regs[SNES_PPU_VMAIN], ppu->vram_addr) % SNES_PPU_VRAM_WORDS) * 2;
+}
+
+static inline void snes_ppu_vram_increment(snes_ppu_t *ppu, uint8_t high)
+{
+	if(!(ppu->regs[SNES_PPU_VMAIN] & SNES_PPU_VMAIN_HIGH) == !high)
+		ppu->vram_addr += snes_ppu_vram_steps[ppu->regs[SNES_PPU_VMAIN] & 3];
+}
+
+static void snes_ppu_vram_prefetch(snes_ppu_t *ppu)
+{
+	ppu->vram_latch = snes_ram_read16(ppu->vram, snes_ppu_vram_offset(ppu));
+}
+
+static inline void snes_ppu_vram_write(snes_ppu_t *ppu, uint8_t high, uint8_t data)
+{
+	uint32_t offset = snes_ppu_vram_offset(ppu) + high;
+
+	snes_ram_write(ppu->vram, offset, data);
+	snes_ppu_tile_invalidate(ppu->tiles, offset, 1);
+	snes_ppu_vram_increment(ppu, high);
+}
+
+static inline void snes_ppu_oam_write(snes_ppu_t *ppu, uint8_t data)
+{
+	uint16_t addr = ppu->oam_addr;
+
+	if(addr >= SNES_PPU_OAM_LOW)
+		ppu->oam[SNES_PPU_OAM_LOW | (addr & 0x1F)] = data;
+	else if(!(addr & 1))
+		ppu->oam_latch = data;
+	else {
+		ppu->oam[addr - 1] = ppu->oam_latch;
+		ppu->oam[addr] = data;
+	}
+	ppu->oam_addr = (addr + 1) & 0x3FF;
+}
+
+static inline void snes_ppu_cgram_write(snes_ppu_t *ppu, uint8_t data)
+{
+	if(!ppu->cgram_high) {
+		ppu->cgram_latch = data;
+	} else {
+		ppu->cgram[ppu->cgram_addr * 2] = ppu->cgram_latch;
+		ppu->cgram[ppu->cgram_addr * 2 + 1] = data & 0x7F;
+		ppu->cgram_addr++;
+	}
+	ppu->cgram_high ^= 1;
+}
+
+/*
+ * Scrolling registers are written twice, low byte first. The horizontal ones
+ * keep their fine scroll bits from the previous write to a horizontal one.
+ */
+static void snes_ppu_scroll_write(snes_ppu_t *ppu, uint8_t addr, uint8_t data)
+{
+	uint8_t bg = (addr - SNES_PPU_BG1HOFS) / 2;
+
+	if(!((addr - SNES_PPU_BG1HOFS) & 1)) {
+		ppu->hofs[bg] = ((data << 8) | (ppu->ofs_latch & ~7) | (ppu->hofs_latch & 7)) & 0x3FF;
+		ppu->hofs_latch = data;
+	} else {
+		ppu->vofs[bg] = ((data << 8) | ppu->ofs_latch) & 0x3FF;
+	}
+	ppu->ofs_latch = data;
+}
+
+//13 bits values of the mode 7 center and offsets
+#define SNES_PPU_SIGN13(value) ((int16_t)((value) << 3) >> 3)
+
+static void snes_ppu_mode7_write(snes_ppu_t *ppu, uint8_t addr, uint8_t data)
+{
+	int16_t value = (data << 8) | ppu->mode7_latch;
+
+	ppu->mode7_latch = data;
+	switch(addr) {
+		case SNES_PPU_BG1HOFS:
+			ppu->mode7.hofs = SNES_PPU_SIGN13(value);
+			break;
+		case SNES_PPU_BG1HOFS + 1:
+			ppu->mode7.vofs = SNES_PPU_SIGN13(value);
+			break;
+		case SNES_PPU_M7A:
+			ppu->mode7.a = value;
+			break;
+		case SNES_PPU_M7A + 1:
+			ppu->mode7.b = value;
+			break;
+		case SNES_PPU_M7A + 2:
+			ppu->mode7.c = value;
+			break;
+		case SNES_PPU_M7A + 3:
+			ppu->mode7.d = value;
+			break;
+		case SNES_PPU_M7A + 4:
+			ppu->mode7.x = SNES_PPU_SIGN13(value);
+			break;
+		case SNES_PPU_M7Y:
+			ppu->mode7.y = SNES_PPU_SIGN13(value);
+			break;
+		default:
+			break;
+	}
+}
+
+uint8_t snes_ppu_read(snes_ppu_t *ppu, uint8_t addr)
+{
+	uint8_t data;
+	int32_t product;
+
+	switch(addr & (SNES_PPU_REGISTERS - 1)) {
+		case SNES_PPU_MPYL:
+		case SNES_PPU_MPYL + 1:
+		case SNES_PPU_MPYH:
+			//M7A by the last byte written to M7B, signed
+			product = ppu->mode7.a * (int8_t)(ppu->mode7.b >> 8);
+			return product >> (((addr & (SNES_PPU_REGISTERS - 1)) - SNES_PPU_MPYL) * 8);
+		case SNES_PPU_RDOAM:
+			if(ppu->oam_addr >= SNES_PPU_OAM_LOW)
+				data = ppu->oam[SNES_PPU_OAM_LOW | (ppu->oam_addr & 0x1F)];
+			else
+				data = ppu->oam[ppu->oam_addr];
+			ppu->oam_addr = (ppu->oam_addr + 1) & 0x3FF;
+			return data;
+		case SNES_PPU_RDVRAML:
+		case SNES_PPU_RDVRAMH:
+			//The word was read ahead, the next one is read when the address moves
+			data = addr == SNES_PPU_RDVRAML ? ppu->vram_latch : ppu->vram_latch >> 8;
+			if(!(ppu->regs[SNES_PPU_VMAIN] & SNES_PPU_VMAIN_HIGH) == (addr == SNES_PPU_RDVRAML)) {
+				snes_ppu_vram_prefetch(ppu);
+				snes_ppu_vram_increment(ppu, addr == SNES_PPU_RDVRAMH);
+			}
+			return data;
+		case SNES_PPU_RDCGRAM:
+			data = ppu->cgram[ppu->cgram_addr * 2 + ppu->cgram_high];
+			if(ppu->cgram_high)
+				ppu->cgram_addr++;
+			ppu->cgram_high ^= 1;
+			return data;
+		default:
+			//Write only, the PPU open bus isn't emulated
+			return 0;
+	}
+}
+
+void snes_ppu_write(snes_ppu_t *ppu, uint8_t addr, uint8_t data)
+{
+	addr &= SNES_PPU_REGISTERS - 1;
+	switch(addr) {
+		case SNES_PPU_OAMDATA:
+			snes_ppu_oam_write(ppu, data);
+			return;
+		case SNES_PPU_VMDATAL:
+		case SNES_PPU_VMDATAH:
+			snes_ppu_vram_write(ppu, addr == SNES_PPU_VMDATAH, data);
+			return;
+		case SNES_PPU_CGDATA:
+			snes_ppu_cgram_write(ppu, data);
+			return;
+		default:
+			break;
+	}
+
+	ppu->regs[addr] = data;
+	switch(addr) {
+		case SNES_PPU_OAMADDL:
+		case SNES_PPU_OAMADDH:
+			ppu->oam_addr = (((ppu->regs[SNES_PPU_OAMADDH] & 1) << 8) | ppu->regs[SNES_PPU_OAMADDL]) << 1;
+			break;
+		case SNES_PPU_VMADDL:
+		case SNES_PPU_VMADDH:
+			ppu->vram_addr = ppu->regs[SNES_PPU_VMADDL] | (ppu->regs[SNES_PPU_VMADDH] << 8);
+			snes_ppu_vram_prefetch(ppu);
+			break;
+		case SNES_PPU_CGADD:
+			ppu->cgram_addr = data;
+			ppu->cgram_high = 0;
+			break;
+		case SNES_PPU_COLDATA:
+			if(data & SNES_PPU_COLDATA_RED)
+				ppu->fixed_color = (ppu->fixed_color & ~0x001F) | SNES_PPU_COLDATA_VALUE(data);
+			if(data & SNES_PPU_COLDATA_GREEN)
+				ppu->fixed_color = (ppu->fixed_color & ~0x03E0) | (SNES_PPU_COLDATA_VALUE(data) << 5);
+			if(data & SNES_PPU_COLDATA_BLUE)
+				ppu->fixed_color = (ppu->fixed_color & ~0x7C00) | (SNES_PPU_COLDATA_VALUE(data) << 10);
+			break;
+		case SNES_PPU_M7SEL:
+			ppu->mode7.sel = data;
+			break;
+		default:
+			if(addr >= SNES_PPU_BG1HOFS && addr <= SNES_PPU_BG4VOFS)
+				snes_ppu_scroll_write(ppu, addr, data);
+			if((addr >= SNES_PPU_BG1HOFS && addr <= SNES_PPU_BG1HOFS + 1) ||
+			   (addr >= SNES_PPU_M7A && addr <= SNES_PPU_M7Y))
+				snes_ppu_mode7_write(ppu, addr, data);
+			break;
+	}
+}
+
+//Word writes with a step of 1 and no remapping are a plain copy
+static uint32_t snes_ppu_vram_copy(snes_ppu_t *ppu, const uint8_t *data, uint32_t words)
+{
+	uint32_t done = 0;
+	uint32_t offset;
+	uint32_t chunk;
+
+	while(done < words) {
+		offset = ppu->vram_addr % SNES_PPU_VRAM_WORDS;
+		chunk = words - done;
+		if(chunk > SNES_PPU_VRAM_WORDS - offset)
+			chunk = SNES_PPU_VRAM_WORDS - offset;
+		memcpy(snes_ram_get_data(ppu->vram) + offset * 2, data + done * 2, chunk * 2);
+		snes_ppu_tile_invalidate(ppu->tiles, offset * 2, chunk * 2);
+		ppu->vram_addr += chunk;
+		done += chunk;
+	}
+	return done * 2;
+}
+
+uint32_t snes_ppu_write_block(snes_ppu_t *ppu, uint8_t addr, uint8_t pair, const uint8_t *data, uint32_t len)
+{
+	uint8_t vmain = ppu->regs[SNES_PPU_VMAIN];
+	uint32_t chunk;
+	uint32_t i;
+
+	addr &= SNES_PPU_REGISTERS - 1;
+	if(pair) {
+		if(addr != SNES_PPU_VMDATAL)
+			return 0;
+		len &= ~1;
+		if((vmain & SNES_PPU_VMAIN_HIGH) && (vmain & 0x0F) == 0)
+			return snes_ppu_vram_copy(ppu, data, len / 2);
+		for(i = 0; i < len; i++)
+			snes_ppu_vram_write(ppu, i & 1, data[i]);
+		return len;
+	}
+
+	switch(addr) {
+		case SNES_PPU_VMDATAL:
+		case SNES_PPU_VMDATAH:
+			for(i = 0; i < len; i++)
+				snes_ppu_vram_write(ppu, addr == SNES_PPU_VMDATAH, data[i]);
+			return len;
+		case SNES_PPU_OAMDATA:
+			i = 0;
+			//Whole pairs of the low table are copied as they are
+			if(ppu->oam_addr < SNES_PPU_OAM_LOW && !(ppu->oam_addr & 1)) {
+				chunk = SNES_PPU_OAM_LOW - ppu->oam_addr;
+				if(chunk > (len & ~1))
+					chunk = len & ~1;
+				if(chunk > 0) {
+					memcpy(&ppu->oam[ppu->oam_addr], data, chunk);
+					ppu->oam_latch = data[chunk - 2];
+					ppu->oam_addr += chunk;
+					i = chunk;
+				}
+			}
+			for(; i < len; i++)
+				snes_ppu_oam_write(ppu, data[i]);
+			return len;
+		case SNES_PPU_CGDATA:
+			for(i = 0; i < len; i++)
+				snes_ppu_cgram_write(ppu, data[i]);
+			return len;
+		default:
+			return 0;
+	}
+}
+
+snes_ram_t *snes_ppu_get_vram(snes_ppu_t *ppu)
+{
+	return ppu->vram;
+}
+
+const uint8_t *snes_ppu_get_cgram(snes_ppu_t *ppu)
+{
+	return ppu->cgram;
+}
+
+const uint8_t *snes_ppu_get_oam(snes_ppu_t *ppu)
+{
+	return ppu->oam;
+}
+
+void snes_ppu_catch_up(snes_ppu_t *ppu, uint64_t now)
+{
+	while(ppu->next <= now) {
+		snes_ppu_render_line(ppu, ppu->line);
+		ppu->line++;
+		if(ppu->line > SNES_PPU_HEIGHT) {
+			ppu->line = 1;
+			ppu->frame += SNES_IRQ_FRAME_CYCLES;
+			ppu->frames++;
+		}
+		ppu->next = ppu->frame + ppu->line * SNES_IRQ_LINE_CYCLES + SNES_PPU_RENDER_CYCLE;
+	}
+}
+
+const uint32_t *snes_ppu_get_framebuffer(snes_ppu_t *ppu)
+{
+	return ppu->framebuffer;
+}
+
+uint64_t snes_ppu_get_frames(snes_ppu_t *ppu)
+{
+	return ppu->frames;
+}
@@ -0,0 +1,57 @@
+#ifndef SNES_PPU_H
+#define SNES_PPU_H
+
+#include <stdint.h>
+#include "snes_ram.h"
+
+#define SNES_PPU_VRAM_SIZE (64 * 1024)
+#define SNES_PPU_CGRAM_SIZE 512
+#define SNES_PPU_OAM_SIZE 544
+
+//Visible lines 1 to 224, as 0x00RRGGBB pixels
+#define SNES_PPU_WIDTH 256
+#define SNES_PPU_HEIGHT 224
+
+//B bus addresses of the memory ports
+#define SNES_PPU_OAMDATA 0x04
+#define SNES_PPU_VMDATAL 0x18
+#define SNES_PPU_VMDATAH 0x19
+#define SNES_PPU_CGDATA 0x22
+
+typedef struct _snes_ppu snes_ppu_t;
+
+/*
+ * PPU registers ($2100-$213F, given by their B bus address $00-$3F) and the
+ * memories behind them : VRAM, CGRAM and OAM with their address increments,
+ * remapping and write latches. The screen is rendered a line at a time:
+ * BG modes 0 to 7, sprites, windows and color math.
+ */
+snes_ppu_t *snes_ppu_init();
+void snes_ppu_destroy(snes_ppu_t *ppu);
+
+uint8_t snes_ppu_read(snes_ppu_t *ppu, uint8_t addr);
+void snes_ppu_write(snes_ppu_t *ppu, uint8_t addr, uint8_t data);
+
+/*
+ * DMA fast path : len bytes written to addr, or alternately to addr and
+ * addr + 1 when pair is set, straight into the memory as that many
+ * snes_ppu_write would. Returns the bytes taken (a pair is never split), 0
+ * when addr isn't a memory port.
+ */
+uint32_t snes_ppu_write_block(snes_ppu_t *ppu, uint8_t addr, uint8_t pair, const uint8_t *data, uint32_t len);
+
+/*
+ * Renders the lines whose hblank started before now (master clock), with the
+ * registers as they are : to be called before they change
+ */
+void snes_ppu_catch_up(snes_ppu_t *ppu, uint64_t now);
+/*SNES_PPU_WIDTH x SNES_PPU_HEIGHT pixels, complete once a frame's last line is rendered*/
+const uint32_t *snes_ppu_get_framebuffer(snes_ppu_t *ppu);
+/*Frames whose last line was rendered*/
+uint64_t snes_ppu_get_frames(snes_ppu_t *ppu);
+
+snes_ram_t *snes_ppu_get_vram(snes_ppu_t *ppu);
+const uint8_t *snes_ppu_get_cgram(snes_ppu_t *ppu);
+const uint8_t *snes_ppu_get_oam(snes_ppu_t *ppu);
+
+#endif //SNES_PPU_H
@@ -0,0 +1,99 @@
+#ifndef SNES_PPU_INTERNAL_H
+#define SNES_PPU_INTERNAL_H
+
+#include "snes_ppu.h"
+#include "snes_ppu_tile.h"
+#include "snes_ppu_mode7.h"
+
+#define SNES_PPU_REGISTERS 0x40
+
+//Registers, by B bus address
+#define SNES_PPU_INIDISP 0x00
+#define SNES_PPU_OBSEL 0x01
+#define SNES_PPU_OAMADDL 0x02
+#define SNES_PPU_OAMADDH 0x03
+#define SNES_PPU_BGMODE 0x05
+#define SNES_PPU_MOSAIC 0x06
+#define SNES_PPU_BG1SC 0x07 //To BG4SC 0x0A
+#define SNES_PPU_BG12NBA 0x0B
+#define SNES_PPU_BG34NBA 0x0C
+#define SNES_PPU_BG1HOFS 0x0D //Then BG1VOFS, to BG4VOFS 0x14
+#define SNES_PPU_BG4VOFS 0x14
+#define SNES_PPU_VMAIN 0x15
+#define SNES_PPU_VMADDL 0x16
+#define SNES_PPU_VMADDH 0x17
+#define SNES_PPU_M7SEL 0x1A
+#define SNES_PPU_M7A 0x1B //Then M7B to M7D, M7X and M7Y 0x20
+#define SNES_PPU_M7Y 0x20
+#define SNES_PPU_CGADD 0x21
+#define SNES_PPU_W12SEL 0x23
+#define SNES_PPU_W34SEL 0x24
+#define SNES_PPU_WOBJSEL 0x25
+#define SNES_PPU_WH0 0x26 //To WH3 0x29
+#define SNES_PPU_WBGLOG 0x2A
+#define SNES_PPU_WOBJLOG 0x2B
+#define SNES_PPU_TM 0x2C
+#define SNES_PPU_TS 0x2D
+#define SNES_PPU_TMW 0x2E
+#define SNES_PPU_TSW 0x2F
+#define SNES_PPU_CGWSEL 0x30
+#define SNES_PPU_CGADSUB 0x31
+#define SNES_PPU_COLDATA 0x32
+#define SNES_PPU_SETINI 0x33
+#define SNES_PPU_MPYL 0x34 //To MPYH 0x36
+#define SNES_PPU_MPYH 0x36
+#define SNES_PPU_RDOAM 0x38
+#define SNES_PPU_RDVRAML 0x39
+#define SNES_PPU_RDVRAMH 0x3A
+#define SNES_PPU_RDCGRAM 0x3B
+
+#define SNES_PPU_INIDISP_BLANK 0x80
+#define SNES_PPU_INIDISP_BRIGHTNESS(inidisp) ((inidisp) & 0x0F)
+#define SNES_PPU_BGMODE_MODE(bgmode) ((bgmode) & 7)
+#define SNES_PPU_BGMODE_BG3_PRIORITY 0x08
+#define SNES_PPU_SETINI_EXTBG 0x40
+#define SNES_PPU_VMAIN_HIGH 0x80 //Increment after the high byte
+#define SNES_PPU_VMAIN_REMAP(vmain) (((vmain) >> 2) & 3)
+
+#define SNES_PPU_BGS 4
+//Layers of the screens, in the order of the enable bits (TM, TS, CGADSUB...)
+#define SNES_PPU_LAYER_OBJ 4
+#define SNES_PPU_LAYER_BACKDROP 5
+#define SNES_PPU_LAYER_MATH 5 //Color window, in the window settings
+#define SNES_PPU_LAYERS 6
+
+struct _snes_ppu {
+	uint8_t regs[SNES_PPU_REGISTERS]; //Last value written
+	snes_ram_t *vram;
+	uint8_t cgram[SNES_PPU_CGRAM_SIZE];
+	uint8_t oam[SNES_PPU_OAM_SIZE];
+	uint16_t vram_addr; //VMADD, in words
+	uint16_t vram_latch; //Word prefetched for $2139-$213A
+	uint16_t oam_addr; //Internal byte address, 10 bits
+	uint8_t oam_latch; //Even byte of the low table, written with the odd one
+	uint8_t cgram_addr; //In words
+	uint8_t cgram_high; //Flip flop : next access is the high byte
+	uint8_t cgram_latch;
+	//BGnHOFS/BGnVOFS, written twice through latches shared by the BGs
+	uint16_t hofs[SNES_PPU_BGS];
+	uint16_t vofs[SNES_PPU_BGS];
+	uint8_t ofs_latch;
+	uint8_t hofs_latch;
+	uint16_t fixed_color; //COLDATA, BGR555
+	//Mode 7 registers and M7HOFS/M7VOFS ($210D-$210E), written twice through their own latch
+	snes_ppu_mode7_t mode7;
+	uint8_t mode7_latch;
+	snes_ppu_mode7_simd_t mode7_simd;
+	//Lines are rendered once the master clock is past their hblank
+	snes_ppu_tile_cache_t *tiles;
+	uint32_t *framebuffer;
+	uint64_t frame; //Start of the frame of the next line
+	uint32_t line; //Next line to render, from 1
+	uint64_t next; //Clock of its hblank
+	uint64_t frames;
+};
+
+/*Renders the line (1 to SNES_PPU_HEIGHT) to the row line - 1 of the framebuffer*/
+void snes_ppu_render_line(snes_ppu_t *ppu, uint32_t line);
+
+#endif //SNES_PPU_INTERNAL_H
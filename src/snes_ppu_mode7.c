@@ -0,0 +1,148 @@
+#include "snes_ppu_mode7.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SNES_PPU_MODE7_X86
+#include <immintrin.h>
+#endif
+
+#define SNES_PPU_MODE7_WIDTH 256
+#define SNES_PPU_MODE7_MAP_MASK (~1023) //Coordinates out of the map
+
+static const char *const snes_ppu_mode7_simd_names[] = {
+	[SNES_PPU_MODE7_SIMD_SCALAR] = "scalar",
+	[SNES_PPU_MODE7_SIMD_AVX2] = "AVX2",
+};
+
+//Offsets from the center are taken on 10 bits and a sign
+static inline int32_t snes_ppu_mode7_clip(int32_t n)
+{
+	return (n & 0x2000) ? (n | ~1023) : (n & 1023);
+}
+
+/*
+ * Map coordinates of the line's first pixel, in 1/256 of a pixel : the
+ * products are truncated to 1/4 of a pixel as the hardware does
+ */
+static void snes_ppu_mode7_origin(const snes_ppu_mode7_t *mode7, uint8_t y, int32_t *sx, int32_t *sy)
+{
+	int32_t h = snes_ppu_mode7_clip(mode7->hofs - mode7->x);
+	int32_t v = snes_ppu_mode7_clip(mode7->vofs - mode7->y);
+
+	if(mode7->sel & SNES_PPU_MODE7_VFLIP)
+		y = 255 - y;
+	*sx = ((mode7->a * h) & ~63) + ((mode7->b * v) & ~63) + ((mode7->b * y) & ~63) + mode7->x * 256;
+	*sy = ((mode7->c * h) & ~63) + ((mode7->d * v) & ~63) + ((mode7->d * y) & ~63) + mode7->y * 256;
+}
+
+static void snes_ppu_mode7_render_scalar(const snes_ppu_mode7_t *mode7, const uint8_t *vram, uint8_t y,
+										 uint8_t *pixels)
+{
+	uint8_t outside = SNES_PPU_MODE7_OUTSIDE(mode7->sel);
+	int32_t sx, sy;
+	int32_t px, py;
+	uint32_t x;
+	uint8_t tile;
+	int32_t column;
+
+	snes_ppu_mode7_origin(mode7, y, &sx, &sy);
+	for(x = 0; x < SNES_PPU_MODE7_WIDTH; x++) {
+		column = (mode7->sel & SNES_PPU_MODE7_HFLIP) ? 255 - x : x;
+		px = (sx + mode7->a * column) >> 8;
+		py = (sy + mode7->c * column) >> 8;
+		tile = vram[(((py >> 3) & 127) * 128 + ((px >> 3) & 127)) * 2];
+		if((px | py) & SNES_PPU_MODE7_MAP_MASK) {
+			if(outside == SNES_PPU_MODE7_TRANSPARENT) {
+				pixels[x] = 0;
+				continue;
+			}
+			if(outside == SNES_PPU_MODE7_TILE0)
+				tile = 0;
+		}
+		pixels[x] = vram[(tile * 64 + (py & 7) * 8 + (px & 7)) * 2 + 1];
+	}
+}
+
+#ifdef SNES_PPU_MODE7_X86
+/*
+ * 8 pixels per step : their coordinates on 32 bits lanes, moved by 8 * A and
+ * 8 * C, then the tile numbers and the pixels gathered from the VRAM words
+ * (4 bytes are read, the map ends 32KB before the end of the VRAM)
+ */
+__attribute__((target("avx2")))
+static void snes_ppu_mode7_render_avx2(const snes_ppu_mode7_t *mode7, const uint8_t *vram, uint8_t y,
+									   uint8_t *pixels)
+{
+	uint8_t outside = SNES_PPU_MODE7_OUTSIDE(mode7->sel);
+	int32_t step = (mode7->sel & SNES_PPU_MODE7_HFLIP) ? -8 : 8;
+	__m256i columns = (mode7->sel & SNES_PPU_MODE7_HFLIP) ? _mm256_setr_epi32(255, 254, 253, 252, 251, 250, 249, 248) :
+															_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i step_x = _mm256_set1_epi32(mode7->a * step);
+	__m256i step_y = _mm256_set1_epi32(mode7->c * step);
+	__m256i byte = _mm256_set1_epi32(0xFF);
+	__m256i seven = _mm256_set1_epi32(7);
+	__m256i tile_mask = _mm256_set1_epi32(127 << 3);
+	__m256i map_mask = _mm256_set1_epi32(SNES_PPU_MODE7_MAP_MASK);
+	//Low byte of each lane to the first 4 bytes of each half, then the halves together
+	__m256i pack = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+									0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	__m256i halves = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+	__m256i sx, sy, px, py, inside, tile;
+	int32_t origin_x, origin_y;
+	uint32_t x;
+
+	snes_ppu_mode7_origin(mode7, y, &origin_x, &origin_y);
+	sx = _mm256_add_epi32(_mm256_set1_epi32(origin_x), _mm256_mullo_epi32(_mm256_set1_epi32(mode7->a), columns));
+	sy = _mm256_add_epi32(_mm256_set1_epi32(origin_y), _mm256_mullo_epi32(_mm256_set1_epi32(mode7->c), columns));
+	for(x = 0; x < SNES_PPU_MODE7_WIDTH; x += 8) {
+		px = _mm256_srai_epi32(sx, 8);
+		py = _mm256_srai_epi32(sy, 8);
+		sx = _mm256_add_epi32(sx, step_x);
+		sy = _mm256_add_epi32(sy, step_y);
+		inside = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_or_si256(px, py), map_mask), _mm256_setzero_si256());
+
+		//Tilemap byte offset : ((py >> 3) * 128 + (px >> 3)) * 2
+		tile = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(py, tile_mask), 5),
+							   _mm256_srli_epi32(_mm256_and_si256(px, tile_mask), 2));
+		tile = _mm256_and_si256(_mm256_i32gather_epi32((const int *)vram, tile, 1), byte);
+		if(outside == SNES_PPU_MODE7_TILE0)
+			tile = _mm256_and_si256(tile, inside);
+
+		//Pixel byte offset : (tile * 64 + (py & 7) * 8 + (px & 7)) * 2 + 1
+		tile = _mm256_or_si256(_mm256_slli_epi32(tile, 7),
+							   _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(py, seven), 4),
+											   _mm256_slli_epi32(_mm256_and_si256(px, seven), 1)));
+		tile = _mm256_and_si256(_mm256_srli_epi32(_mm256_i32gather_epi32((const int *)vram, tile, 1), 8), byte);
+		if(outside == SNES_PPU_MODE7_TRANSPARENT)
+			tile = _mm256_and_si256(tile, inside);
+
+		tile = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(tile, pack), halves);
+		_mm_storel_epi64((__m128i *)(pixels + x), _mm256_castsi256_si128(tile));
+	}
+}
+#endif
+
+void snes_ppu_mode7_render(snes_ppu_mode7_simd_t simd, const snes_ppu_mode7_t *mode7, const uint8_t *vram,
+						   uint8_t y, uint8_t *pixels)
+{
+#ifdef SNES_PPU_MODE7_X86
+	if(simd == SNES_PPU_MODE7_SIMD_AVX2) {
+		snes_ppu_mode7_render_avx2(mode7, vram, y, pixels);
+		return;
+	}
+#endif
+	snes_ppu_mode7_render_scalar(mode7, vram, y, pixels);
+}
+
+snes_ppu_mode7_simd_t snes_ppu_mode7_get_max_simd()
+{
+#ifdef SNES_PPU_MODE7_X86
+	if(__builtin_cpu_supports("avx2"))
+		return SNES_PPU_MODE7_SIMD_AVX2;
+#endif
+	return SNES_PPU_MODE7_SIMD_SCALAR;
+}
+
+const char *snes_ppu_mode7_simd_tostring(snes_ppu_mode7_simd_t simd)
+{
+	return snes_ppu_mode7_simd_names[simd];
+}
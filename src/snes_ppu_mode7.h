@@ -0,0 +1,46 @@
+#ifndef SNES_PPU_MODE7_H
+#define SNES_PPU_MODE7_H
+
+#include <stdint.h>
+
+//Code paths of the mode 7 line renderer
+typedef enum _snes_ppu_mode7_simd {
+	SNES_PPU_MODE7_SIMD_SCALAR, //Reference
+	SNES_PPU_MODE7_SIMD_AVX2,
+} snes_ppu_mode7_simd_t;
+
+//M7SEL
+#define SNES_PPU_MODE7_HFLIP 0x01
+#define SNES_PPU_MODE7_VFLIP 0x02
+#define SNES_PPU_MODE7_OUTSIDE(sel) (((sel) >> 6) & 3) //Out of the map : wrap, transparent or tile 0
+#define SNES_PPU_MODE7_TRANSPARENT 2
+#define SNES_PPU_MODE7_TILE0 3
+
+//Registers of the transform, sign extended (13 bits for the center and the offsets)
+typedef struct {
+	int16_t a;
+	int16_t b;
+	int16_t c;
+	int16_t d;
+	int16_t x; //Center
+	int16_t y;
+	int16_t hofs;
+	int16_t vofs;
+	uint8_t sel;
+} snes_ppu_mode7_t;
+
+/*
+ * Mode 7 : the screen pixels are mapped through the 2x2 matrix around the
+ * center to a 1024x1024 map of 128x128 tiles, in the first 32KB of the VRAM
+ * (tile numbers in the low bytes, 8 bits pixels in the high bytes).
+ * Renders the line y (0-255, mosaic applied) to 256 pixels, 0 being
+ * transparent.
+ */
+void snes_ppu_mode7_render(snes_ppu_mode7_simd_t simd, const snes_ppu_mode7_t *mode7, const uint8_t *vram,
+						   uint8_t y, uint8_t *pixels);
+
+/*Best path of the host, the default*/
+snes_ppu_mode7_simd_t snes_ppu_mode7_get_max_simd();
+const char *snes_ppu_mode7_simd_tostring(snes_ppu_mode7_simd_t simd);
+
+#endif //SNES_PPU_MODE7_H
@@ -0,0 +1,509 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "snes_ppu_internal.h"
+
+#define SNES_PPU_NONE 0xFF //Priority of a transparent pixel
+
+//Sprites in range of a line, and their 8 pixels slivers fetched
+#define SNES_PPU_OBJ_COUNT 128
+#define SNES_PPU_OBJ_RANGE 32
+#define SNES_PPU_OBJ_SLIVERS 34
+#define SNES_PPU_OBJ_PALETTES 128 //CGRAM colors before the sprite ones
+#define SNES_PPU_OBJ_MATH_PALETTE 4 //Sprite palettes below don't take color math
+
+//Window settings of a layer : 2 bits per window, enable and invert
+#define SNES_PPU_WINDOW_INVERT(window) (1 << ((window) * 2))
+#define SNES_PPU_WINDOW_ENABLE(window) (2 << ((window) * 2))
+#define SNES_PPU_WINDOW_OR 0
+#define SNES_PPU_WINDOW_AND 1
+#define SNES_PPU_WINDOW_XOR 2
+
+//CGWSEL, CGADSUB
+#define SNES_PPU_CGWSEL_DIRECT 0x01
+#define SNES_PPU_CGWSEL_SUBSCREEN 0x02
+#define SNES_PPU_CGWSEL_MATH(cgwsel) (((cgwsel) >> 4) & 3)
+#define SNES_PPU_CGWSEL_BLACK(cgwsel) (((cgwsel) >> 6) & 3)
+#define SNES_PPU_CGADSUB_HALF 0x40
+#define SNES_PPU_CGADSUB_SUBTRACT 0x80
+
+typedef struct {
+	uint8_t bpp[SNES_PPU_BGS]; //0 when the mode has no such BG
+	uint8_t offset_per_tile; //BG3 holds scrolling values for the columns of BG1 and BG2
+	uint8_t hires; //512 pixels wide, the main screen pixels are kept
+} snes_ppu_mode_t;
+
+static const snes_ppu_mode_t snes_ppu_modes[8] = {
+	{ { 2, 2, 2, 2 }, 0, 0 },
+	{ { 4, 4, 2, 0 }, 0, 0 },
+	{ { 4, 4, 0, 0 }, 1, 0 },
+	{ { 8, 4, 0, 0 }, 0, 0 },
+	{ { 8, 2, 0, 0 }, 1, 0 },
+	{ { 4, 2, 0, 0 }, 0, 1 },
+	{ { 4, 0, 0, 0 }, 1, 1 },
+	//Mode 7 : BG1, and BG2 with EXTBG, see snes_ppu_render_mode7
+	{ { 8, 0, 0, 0 }, 0, 0 },
+};
+
+/*
+ * Depth of the layers (the highest is in front) : BG1 to BG4 with their low
+ * and high priority tiles, then the sprites of priority 0 to 3
+ */
+static const uint8_t snes_ppu_depths[5][SNES_PPU_BGS * 2 + 4] = {
+	//Mode 0 : S3 1H 2H S2 1L 2L S1 3H 4H S0 3L 4L
+	{ 8, 11, 7, 10, 2, 5, 1, 4, 3, 6, 9, 12 },
+	//Mode 1 : S3 1H 2H S2 1L 2L S1 3H S0 3L
+	{ 6, 9, 5, 8, 1, 3, 0, 0, 2, 4, 7, 10 },
+	//Mode 1 with the BG3 priority bit : 3H S3 1H 2H S2 1L 2L S1 S0 3L
+	{ 5, 8, 4, 7, 1, 10, 0, 0, 2, 3, 6, 9 },
+	//Modes 2 to 6 : S3 1H S2 2H S1 1L S0 2L
+	{ 3, 7, 1, 5, 0, 0, 0, 0, 2, 4, 6, 8 },
+	//Mode 7, BG1 without priority : S3 S2 2H S1 1 S0 2L
+	{ 3, 3, 1, 5, 0, 0, 0, 0, 2, 4, 6, 7 },
+};
+
+//OBSEL sizes (width, height) of the small and large sprites
+static const uint8_t snes_ppu_obj_sizes[8][2][2] = {
+	{ { 8, 8 }, { 16, 16 } },
+	{ { 8, 8 }, { 32, 32 } },
+	{ { 8, 8 }, { 64, 64 } },
+	{ { 16, 16 }, { 32, 32 } },
+	{ { 16, 16 }, { 64, 64 } },
+	{ { 32, 32 }, { 64, 64 } },
+	{ { 16, 32 }, { 32, 64 } },
+	{ { 16, 32 }, { 32, 32 } },
+};
+
+//Pixels of a layer on the line
+typedef struct {
+	uint16_t color[SNES_PPU_WIDTH]; //BGR555
+	uint8_t priority[SNES_PPU_WIDTH]; //SNES_PPU_NONE when transparent
+	uint8_t math[SNES_PPU_WIDTH]; //Sprites : color math allowed by the palette
+} snes_ppu_layer_t;
+
+//Front pixels of the main or sub screen
+typedef struct {
+	uint16_t color[SNES_PPU_WIDTH];
+	uint8_t depth[SNES_PPU_WIDTH]; //0 for the backdrop
+	uint8_t math[SNES_PPU_WIDTH]; //Color math enabled for the pixel's layer
+} snes_ppu_screen_t;
+
+static inline uint16_t snes_ppu_cgram_color(snes_ppu_t *ppu, uint8_t index)
+{
+	return ppu->cgram[index * 2] | (ppu->cgram[index * 2 + 1] << 8);
+}
+
+//8 bits per pixel BG in direct color : BBGGGRRR and the palette bits as low bits
+static inline uint16_t snes_ppu_direct_color(uint8_t palette, uint8_t pixel)
+{
+	return ((pixel << 2) & 0x001C) | ((palette << 1) & 0x0002) |
+		   ((pixel << 4) & 0x0380) | ((palette << 5) & 0x0040) |
+		   ((pixel << 7) & 0x6000) | ((palette << 10) & 0x1000);
+}
+
+static inline uint16_t snes_ppu_vram_word(snes_ppu_t *ppu, uint32_t word)
+{
+	return snes_ram_read16(ppu->vram, (word & 0x7FFF) * 2);
+}
+
+//Tilemap entry at (tx, ty) in tiles, the map being 32 or 64 tiles on each side
+static uint16_t snes_ppu_bg_entry(snes_ppu_t *ppu, uint8_t bg, uint32_t tx, uint32_t ty)
+{
+	uint8_t sc = ppu->regs[SNES_PPU_BG1SC + bg];
+	uint32_t word = (sc & 0xFC) << 8;
+
+	tx &= (sc & 1) ? 63 : 31;
+	ty &= (sc & 2) ? 63 : 31;
+	word += (tx & 31) | ((ty & 31) << 5);
+	if(tx & 32)
+		word += 0x400;
+	if(ty & 32)
+		word += (sc & 1) ? 0x800 : 0x400;
+	return snes_ppu_vram_word(ppu, word);
+}
+
+/*
+ * Offset per tile (modes 2, 4 and 6) : the BG3 tilemap row at its scroll
+ * gives new scrolling values for the columns after the first one
+ */
+static void snes_ppu_bg_column_offsets(snes_ppu_t *ppu, uint8_t bg, uint32_t column, uint32_t *hofs, uint32_t *vofs)
+{
+	uint8_t mode = SNES_PPU_BGMODE_MODE(ppu->regs[SNES_PPU_BGMODE]);
+	uint16_t valid = 0x2000 << bg;
+	uint32_t tx = ((ppu->hofs[2] >> 3) + column - 1);
+	uint32_t ty = ppu->vofs[2] >> 3;
+	uint16_t h = snes_ppu_bg_entry(ppu, 2, tx, ty);
+	uint16_t v;
+
+	if(mode == 4) {
+		//A single value, bit 15 tells which one
+		if(h & valid) {
+			if(h & 0x8000)
+				*vofs = h & 0x3FF;
+			else
+				*hofs = (*hofs & 7) | (h & 0x3F8);
+		}
+		return;
+	}
+	v = snes_ppu_bg_entry(ppu, 2, tx, ty + 1);
+	if(h & valid)
+		*hofs = (*hofs & 7) | (h & 0x3F8);
+	if(v & valid)
+		*vofs = v & 0x3FF;
+}
+
+static void snes_ppu_render_bg(snes_ppu_t *ppu, uint8_t bg, uint32_t line, const snes_ppu_mode_t *mode,
+							   snes_ppu_layer_t *out)
+{
+	uint8_t bgmode = ppu->regs[SNES_PPU_BGMODE];
+	uint8_t bpp = mode->bpp[bg];
+	uint8_t large = bgmode & (0x10 << bg);
+	uint8_t sc = ppu->regs[SNES_PPU_BG1SC + bg];
+	uint32_t tile_w = (large || mode->hires) ? 16 : 8;
+	uint32_t tile_h = large ? 16 : 8;
+	uint32_t map_w = tile_w * ((sc & 1) ? 64 : 32);
+	uint32_t map_h = tile_h * ((sc & 2) ? 64 : 32);
+	uint8_t nba = ppu->regs[SNES_PPU_BG12NBA + bg / 2] >> ((bg & 1) * 4);
+	uint32_t char_base = ((nba & 0xF) << 13) / (8 * bpp); //In tiles of the format
+	uint8_t palette_base = SNES_PPU_BGMODE_MODE(bgmode) == 0 ? bg * 32 : 0;
+	uint8_t direct = bpp == 8 && (ppu->regs[SNES_PPU_CGWSEL] & SNES_PPU_CGWSEL_DIRECT);
+	uint32_t mosaic = (ppu->regs[SNES_PPU_MOSAIC] & (1 << bg)) ? (ppu->regs[SNES_PPU_MOSAIC] >> 4) + 1 : 1;
+	uint32_t y = line - (line - 1) % mosaic;
+	uint32_t column = UINT32_MAX;
+	uint32_t hofs = ppu->hofs[bg];
+	uint32_t vofs = ppu->vofs[bg];
+	uint32_t last_tx = UINT32_MAX;
+	uint32_t last_ty = UINT32_MAX;
+	uint16_t entry = 0;
+	const uint8_t *pixels;
+	uint32_t px, py, fx, fy;
+	uint32_t x, mx;
+	uint16_t ch;
+	uint8_t pixel;
+
+	for(x = 0; x < SNES_PPU_WIDTH; x++) {
+		mx = x - x % mosaic;
+		if(mode->offset_per_tile && bg < 2 && (mx + (ppu->hofs[bg] & 7)) / 8 != column) {
+			column = (mx + (ppu->hofs[bg] & 7)) / 8;
+			hofs = ppu->hofs[bg];
+			vofs = ppu->vofs[bg];
+			if(column > 0)
+				snes_ppu_bg_column_offsets(ppu, bg, column, &hofs, &vofs);
+		}
+		if(mode->hires)
+			px = (mx * 2 + 1 + hofs * 2) % map_w;
+		else
+			px = (mx + hofs) % map_w;
+		py = (y + vofs) % map_h;
+
+		if(px / tile_w != last_tx || py / tile_h != last_ty) {
+			last_tx = px / tile_w;
+			last_ty = py / tile_h;
+			entry = snes_ppu_bg_entry(ppu, bg, last_tx, last_ty);
+		}
+		fx = px % tile_w;
+		fy = py % tile_h;
+		if(entry & 0x4000)
+			fx = tile_w - 1 - fx;
+		if(entry & 0x8000)
+			fy = tile_h - 1 - fy;
+		ch = ((entry & 0x3FF) + (fx >> 3) + ((fy >> 3) << 4)) & 0x3FF;
+		pixels = snes_ppu_tile_get(ppu->tiles, bpp, char_base + ch);
+		pixel = pixels[(fy & 7) * 8 + (fx & 7)];
+		if(pixel == 0) {
+			out->priority[x] = SNES_PPU_NONE;
+			continue;
+		}
+		out->priority[x] = (entry >> 13) & 1;
+		if(direct)
+			out->color[x] = snes_ppu_direct_color((entry >> 10) & 7, pixel);
+		else
+			out->color[x] = snes_ppu_cgram_color(ppu, palette_base + (((entry >> 10) & 7) << bpp) + pixel);
+	}
+}
+
+/*
+ * Mode 7 : BG1 has 8 bits pixels, BG2 (EXTBG) the same pixels with the top
+ * bit as priority. The matrix is the one of the line, HDMA included.
+ */
+static void snes_ppu_render_mode7(snes_ppu_t *ppu, uint8_t bg, uint32_t line, snes_ppu_layer_t *out)
+{
+	uint8_t direct = bg == 0 && (ppu->regs[SNES_PPU_CGWSEL] & SNES_PPU_CGWSEL_DIRECT);
+	uint32_t mosaic = (ppu->regs[SNES_PPU_MOSAIC] & (1 << bg)) ? (ppu->regs[SNES_PPU_MOSAIC] >> 4) + 1 : 1;
+	uint8_t pixels[SNES_PPU_WIDTH];
+	uint32_t x;
+	uint8_t pixel;
+
+	snes_ppu_mode7_render(ppu->mode7_simd, &ppu->mode7, snes_ram_get_data(ppu->vram),
+						  line - (line - 1) % mosaic, pixels);
+	for(x = 0; x < SNES_PPU_WIDTH; x++) {
+		pixel = pixels[x - x % mosaic];
+		out->priority[x] = 0;
+		if(bg == 1) {
+			out->priority[x] = pixel >> 7;
+			pixel &= 0x7F;
+		}
+		if(pixel == 0) {
+			out->priority[x] = SNES_PPU_NONE;
+			continue;
+		}
+		if(direct)
+			out->color[x] = snes_ppu_direct_color(0, pixel);
+		else
+			out->color[x] = snes_ppu_cgram_color(ppu, pixel);
+	}
+}
+
+/*
+ * Sprites : the first 32 in range of the line from the first sprite (OAM
+ * priority rotation), and 34 slivers of 8 pixels fetched from the last one.
+ * The lowest sprite is in front of the others whatever their priorities.
+ */
+static void snes_ppu_render_obj(snes_ppu_t *ppu, uint32_t line, snes_ppu_layer_t *out)
+{
+	uint8_t obsel = ppu->regs[SNES_PPU_OBSEL];
+	uint32_t base = (obsel & 7) << 14;
+	uint32_t gap = (((obsel >> 3) & 3) + 1) << 13;
+	uint8_t first = 0;
+	uint8_t range[SNES_PPU_OBJ_RANGE];
+	uint32_t count = 0;
+	uint32_t slivers = 0;
+	uint32_t i, n, k, c, p;
+	uint8_t *obj;
+	uint8_t high;
+	uint8_t w, h;
+	int x, sx;
+	uint32_t row;
+	uint8_t tile;
+	const uint8_t *pixels;
+	uint8_t pixel;
+
+	memset(out->priority, SNES_PPU_NONE, sizeof(out->priority));
+	if(ppu->regs[SNES_PPU_OAMADDH] & 0x80)
+		first = (((ppu->regs[SNES_PPU_OAMADDH] & 1) << 8 | ppu->regs[SNES_PPU_OAMADDL]) >> 1) & 0x7F;
+
+	//Sprites rows are compared with the previous line
+	for(i = 0; i < SNES_PPU_OBJ_COUNT && count < SNES_PPU_OBJ_RANGE; i++) {
+		n = (first + i) % SNES_PPU_OBJ_COUNT;
+		obj = &ppu->oam[n * 4];
+		high = ppu->oam[0x200 + n / 4] >> ((n % 4) * 2);
+		w = snes_ppu_obj_sizes[obsel >> 5][(high >> 1) & 1][0];
+		h = snes_ppu_obj_sizes[obsel >> 5][(high >> 1) & 1][1];
+		x = obj[0] | ((high & 1) << 8);
+		if(x >= 256)
+			x -= 512;
+		if(((line - 1 - obj[1]) & 0xFF) >= h || x + w <= 0)
+			continue;
+		range[count++] = n;
+	}
+
+	for(k = count; k > 0 && slivers < SNES_PPU_OBJ_SLIVERS; k--) {
+		n = range[k - 1];
+		obj = &ppu->oam[n * 4];
+		high = ppu->oam[0x200 + n / 4] >> ((n % 4) * 2);
+		w = snes_ppu_obj_sizes[obsel >> 5][(high >> 1) & 1][0];
+		h = snes_ppu_obj_sizes[obsel >> 5][(high >> 1) & 1][1];
+		x = obj[0] | ((high & 1) << 8);
+		if(x >= 256)
+			x -= 512;
+		row = (line - 1 - obj[1]) & 0xFF;
+		if(obj[3] & 0x80)
+			row = h - 1 - row;
+		for(c = 0; c < w / 8u && slivers < SNES_PPU_OBJ_SLIVERS; c++) {
+			sx = x + c * 8;
+			if(sx <= -8 || sx >= SNES_PPU_WIDTH)
+				continue;
+			slivers++;
+			//The tile numbers wrap in their row of 16
+			i = (obj[3] & 0x40) ? w / 8 - 1 - c : c;
+			tile = ((obj[2] + ((row >> 3) << 4)) & 0xF0) | ((obj[2] + i) & 0x0F);
+			pixels = snes_ppu_tile_get(ppu->tiles, 4, ((base + ((obj[3] & 1) ? gap : 0) + tile * 32) & 0xFFFF) / 32);
+			for(p = 0; p < 8; p++) {
+				if(sx + (int)p < 0 || sx + p >= SNES_PPU_WIDTH)
+					continue;
+				pixel = pixels[(row & 7) * 8 + ((obj[3] & 0x40) ? 7 - p : p)];
+				if(pixel == 0)
+					continue;
+				out->priority[sx + p] = (obj[3] >> 4) & 3;
+				out->color[sx + p] = snes_ppu_cgram_color(ppu, SNES_PPU_OBJ_PALETTES + ((obj[3] >> 1) & 7) * 16 + pixel);
+				out->math[sx + p] = ((obj[3] >> 1) & 7) >= SNES_PPU_OBJ_MATH_PALETTE;
+			}
+		}
+	}
+}
+
+//1 for the pixels inside the window area of a layer, as set by its 4 bits
+static void snes_ppu_render_window(snes_ppu_t *ppu, uint8_t layer, uint8_t *out)
+{
+	static const uint8_t sel[SNES_PPU_LAYERS] = { SNES_PPU_W12SEL, SNES_PPU_W12SEL, SNES_PPU_W34SEL,
+												  SNES_PPU_W34SEL, SNES_PPU_WOBJSEL, SNES_PPU_WOBJSEL };
+	uint8_t settings = (ppu->regs[sel[layer]] >> ((layer & 1) * 4)) & 0xF;
+	uint8_t logic = layer < SNES_PPU_BGS ? (ppu->regs[SNES_PPU_WBGLOG] >> (layer * 2)) & 3 :
+					(ppu->regs[SNES_PPU_WOBJLOG] >> ((layer - SNES_PPU_BGS) * 2)) & 3;
+	uint8_t inside[2];
+	uint32_t x;
+	uint8_t w;
+
+	if(!(settings & (SNES_PPU_WINDOW_ENABLE(0) | SNES_PPU_WINDOW_ENABLE(1)))) {
+		memset(out, 0, SNES_PPU_WIDTH);
+		return;
+	}
+	for(x = 0; x < SNES_PPU_WIDTH; x++) {
+		for(w = 0; w < 2; w++) {
+			inside[w] = x >= ppu->regs[SNES_PPU_WH0 + w * 2] && x <= ppu->regs[SNES_PPU_WH0 + w * 2 + 1];
+			if(settings & SNES_PPU_WINDOW_INVERT(w))
+				inside[w] ^= 1;
+		}
+		//A single window is used as it is
+		if(!(settings & SNES_PPU_WINDOW_ENABLE(1)))
+			out[x] = inside[0];
+		else if(!(settings & SNES_PPU_WINDOW_ENABLE(0)))
+			out[x] = inside[1];
+		else if(logic == SNES_PPU_WINDOW_OR)
+			out[x] = inside[0] | inside[1];
+		else if(logic == SNES_PPU_WINDOW_AND)
+			out[x] = inside[0] & inside[1];
+		else if(logic == SNES_PPU_WINDOW_XOR)
+			out[x] = inside[0] ^ inside[1];
+		else
+			out[x] = !(inside[0] ^ inside[1]);
+	}
+}
+
+//Puts the layer's pixels in front of the screen's where they are deeper, but for the window
+static void snes_ppu_draw_layer(snes_ppu_screen_t *screen, const snes_ppu_layer_t *layer, uint8_t obj,
+								const uint8_t *depths, const uint8_t *window, uint8_t math)
+{
+	uint32_t x;
+	uint8_t depth;
+
+	for(x = 0; x < SNES_PPU_WIDTH; x++) {
+		if(layer->priority[x] == SNES_PPU_NONE || (window != NULL && window[x]))
+			continue;
+		depth = depths[layer->priority[x]];
+		if(depth <= screen->depth[x])
+			continue;
+		screen->depth[x] = depth;
+		screen->color[x] = layer->color[x];
+		screen->math[x] = math && (!obj || layer->math[x]);
+	}
+}
+
+static inline uint8_t snes_ppu_window_region(uint8_t setting, uint8_t inside)
+{
+	//0 : never, 1 : outside the window, 2 : inside, 3 : always
+	return setting == 3 || (setting == 1 && !inside) || (setting == 2 && inside);
+}
+
+static uint16_t snes_ppu_color_math(uint16_t a, uint16_t b, uint8_t subtract, uint8_t half)
+{
+	int r = a & 0x1F, g = (a >> 5) & 0x1F, bl = (a >> 10) & 0x1F;
+
+	if(subtract) {
+		r -= b & 0x1F;
+		g -= (b >> 5) & 0x1F;
+		bl -= (b >> 10) & 0x1F;
+	} else {
+		r += b & 0x1F;
+		g += (b >> 5) & 0x1F;
+		bl += (b >> 10) & 0x1F;
+	}
+	if(half) {
+		r >>= 1;
+		g >>= 1;
+		bl >>= 1;
+	}
+	r = r < 0 ? 0 : r > 31 ? 31 : r;
+	g = g < 0 ? 0 : g > 31 ? 31 : g;
+	bl = bl < 0 ? 0 : bl > 31 ? 31 : bl;
+	return r | (g << 5) | (bl << 10);
+}
+
+void snes_ppu_render_line(snes_ppu_t *ppu, uint32_t line)
+{
+	uint32_t *row = ppu->framebuffer + (line - 1) * SNES_PPU_WIDTH;
+	uint8_t bgmode = ppu->regs[SNES_PPU_BGMODE];
+	uint8_t mode_number = SNES_PPU_BGMODE_MODE(bgmode);
+	const snes_ppu_mode_t *mode = &snes_ppu_modes[mode_number];
+	const uint8_t *depths;
+	uint8_t tm = ppu->regs[SNES_PPU_TM];
+	uint8_t ts = ppu->regs[SNES_PPU_TS];
+	uint8_t cgwsel = ppu->regs[SNES_PPU_CGWSEL];
+	uint8_t cgadsub = ppu->regs[SNES_PPU_CGADSUB];
+	uint8_t brightness = SNES_PPU_INIDISP_BRIGHTNESS(ppu->regs[SNES_PPU_INIDISP]);
+	snes_ppu_screen_t main_screen, sub_screen;
+	snes_ppu_layer_t layer;
+	uint8_t windows[SNES_PPU_LAYERS][SNES_PPU_WIDTH];
+	uint8_t levels[32];
+	uint16_t color, sub;
+	uint8_t black, math, use_sub;
+	uint32_t x;
+	uint8_t l;
+
+	if(ppu->regs[SNES_PPU_INIDISP] & SNES_PPU_INIDISP_BLANK) {
+		memset(row, 0, SNES_PPU_WIDTH * sizeof(uint32_t));
+		return;
+	}
+	if(mode_number == 0)
+		depths = snes_ppu_depths[0];
+	else if(mode_number == 1)
+		depths = snes_ppu_depths[(bgmode & SNES_PPU_BGMODE_BG3_PRIORITY) ? 2 : 1];
+	else if(mode_number == 7)
+		depths = snes_ppu_depths[4];
+	else
+		depths = snes_ppu_depths[3];
+
+	memset(main_screen.depth, 0, sizeof(main_screen.depth));
+	memset(sub_screen.depth, 0, sizeof(sub_screen.depth));
+	for(l = 0; l < SNES_PPU_LAYERS; l++) {
+		//Windows are only computed for the layers masked by one, and color math
+		if(l == SNES_PPU_LAYER_MATH || ((ppu->regs[SNES_PPU_TMW] | ppu->regs[SNES_PPU_TSW]) & (1 << l)))
+			snes_ppu_render_window(ppu, l, windows[l]);
+	}
+	for(l = 0; l <= SNES_PPU_LAYER_OBJ; l++) {
+		if(!((tm | ts) & (1 << l)))
+			continue;
+		if(l == SNES_PPU_LAYER_OBJ) {
+			snes_ppu_render_obj(ppu, line, &layer);
+		} else if(mode_number == 7) {
+			if(l > 1 || (l == 1 && !(ppu->regs[SNES_PPU_SETINI] & SNES_PPU_SETINI_EXTBG)))
+				continue;
+			snes_ppu_render_mode7(ppu, l, line, &layer);
+		} else {
+			if(mode->bpp[l] == 0)
+				continue;
+			snes_ppu_render_bg(ppu, l, line, mode, &layer);
+		}
+		if(tm & (1 << l))
+			snes_ppu_draw_layer(&main_screen, &layer, l == SNES_PPU_LAYER_OBJ, &depths[l * 2],
+								(ppu->regs[SNES_PPU_TMW] & (1 << l)) ? windows[l] : NULL, (cgadsub >> l) & 1);
+		if(ts & (1 << l))
+			snes_ppu_draw_layer(&sub_screen, &layer, l == SNES_PPU_LAYER_OBJ, &depths[l * 2],
+								(ppu->regs[SNES_PPU_TSW] & (1 << l)) ? windows[l] : NULL, 0);
+	}
+
+	for(x = 0; x < 32; x++)
+		levels[x] = (x * 255 / 31) * (brightness + 1) / 16;
+	for(x = 0; x < SNES_PPU_WIDTH; x++) {
+		if(main_screen.depth[x]) {
+			color = main_screen.color[x];
+			math = main_screen.math[x];
+		} else {
+			color = snes_ppu_cgram_color(ppu, 0);
+			math = (cgadsub >> SNES_PPU_LAYER_BACKDROP) & 1;
+		}
+		black = snes_ppu_window_region(SNES_PPU_CGWSEL_BLACK(cgwsel), windows[SNES_PPU_LAYER_MATH][x]);
+		math = math && snes_ppu_window_region(3 - SNES_PPU_CGWSEL_MATH(cgwsel), windows[SNES_PPU_LAYER_MATH][x]);
+		if(black)
+			color = 0;
+		if(math) {
+			//The sub screen backdrop is the fixed color, not halved
+			use_sub = (cgwsel & SNES_PPU_CGWSEL_SUBSCREEN) && sub_screen.depth[x];
+			sub = use_sub ? sub_screen.color[x] : ppu->fixed_color;
+			color = snes_ppu_color_math(color, sub, cgadsub & SNES_PPU_CGADSUB_SUBTRACT,
+										(cgadsub & SNES_PPU_CGADSUB_HALF) && !black &&
+										(use_sub || !(cgwsel & SNES_PPU_CGWSEL_SUBSCREEN)));
+		}
+		row[x] = (levels[color & 0x1F] << 16) | (levels[(color >> 5) & 0x1F] << 8) | levels[(color >> 10) & 0x1F];
+	}
+}
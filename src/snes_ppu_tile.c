@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snes_ppu_tile.h"
+#include "snes_ppu.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SNES_PPU_TILE_X86
+#include <immintrin.h>
+#endif
+
+//Formats by bits per pixel : 2, 4 and 8
+#define SNES_PPU_TILE_FORMATS 3
+#define SNES_PPU_TILE_FORMAT(bpp) ((bpp) == 2 ? 0 : (bpp) == 4 ? 1 : 2)
+
+typedef void (*snes_ppu_tile_decoder_t)(const uint8_t *planes, uint8_t bpp, uint8_t *pixels);
+
+struct _snes_ppu_tile_cache {
+	const uint8_t *vram;
+	snes_ppu_tile_decoder_t decode;
+	uint8_t *pixels[SNES_PPU_TILE_FORMATS];
+	uint8_t *valid[SNES_PPU_TILE_FORMATS];
+};
+
+//Tiles of a format in the VRAM
+static inline uint32_t snes_ppu_tile_count(uint8_t format)
+{
+	return SNES_PPU_VRAM_SIZE / (16 << format);
+}
+
+snes_ppu_tile_cache_t *snes_ppu_tile_init(const uint8_t *vram)
+{
+	snes_ppu_tile_cache_t *cache = malloc(sizeof(snes_ppu_tile_cache_t));
+	uint8_t format;
+
+	if(cache == NULL) {
+		printf("Error at allocation time !\n");
+		goto error_alloc;
+	}
+	memset(cache, 0, sizeof(snes_ppu_tile_cache_t));
+	cache->vram = vram;
+	snes_ppu_tile_set_simd(cache, snes_ppu_tile_get_max_simd());
+	for(format = 0; format < SNES_PPU_TILE_FORMATS; format++) {
+		cache->pixels[format] = malloc(snes_ppu_tile_count(format) * SNES_PPU_TILE_PIXELS);
+		cache->valid[format] = calloc(snes_ppu_tile_count(format), 1);
+		if(cache->pixels[format] == NULL || cache->valid[format] == NULL) {
+			printf("Error at allocation time !\n");
+			goto error_tiles;
+		}
+	}
+	return cache;
+
+error_tiles:
+	snes_ppu_tile_destroy(cache);
+error_alloc:
+	return NULL;
+}
+
+void snes_ppu_tile_destroy(snes_ppu_tile_cache_t *cache)
+{
+	uint8_t format;
+
+	for(format = 0; format < SNES_PPU_TILE_FORMATS; format++) {
+		free(cache->pixels[format]);
+		free(cache->valid[format]);
+	}
+	free(cache);
+}
+
+/*
+ * Bitplanes are interleaved by pairs : the rows of planes 0-1 (two bytes per
+ * row), then the rows of planes 2-3 and so on. The leftmost pixel is bit 7.
+ */
+static void snes_ppu_tile_decode_scalar(const uint8_t *planes, uint8_t bpp, uint8_t *pixels)
+{
+	uint8_t row;
+	uint8_t x;
+	uint8_t pair;
+	uint8_t pixel;
+
+	for(row = 0; row < 8; row++) {
+		for(x = 0; x < 8; x++) {
+			pixel = 0;
+			for(pair = 0; pair < bpp / 2; pair++) {
+				pixel |= ((planes[pair * 16 + row * 2] >> (7 - x)) & 1) << (pair * 2);
+				pixel |= ((planes[pair * 16 + row * 2 + 1] >> (7 - x)) & 1) << (pair * 2 + 1);
+			}
+			pixels[row * 8 + x] = pixel;
+		}
+	}
+}
+
+#ifdef SNES_PPU_TILE_X86
+/*
+ * The SIMD paths spread each plane byte over the 8 bytes of its row, keep
+ * the bit of each pixel (0x80 for the first one) and turn the set bits into
+ * the plane's bit of the pixel.
+ */
+#define SNES_PPU_TILE_BITS 0x0102040810204080LL
+
+//Planes of 2 rows, as 8 copies of a row's byte then 8 of the other row's
+static inline __m128i snes_ppu_tile_bits_sse2(__m128i rows, __m128i value)
+{
+	__m128i bits = _mm_set1_epi64x(SNES_PPU_TILE_BITS);
+
+	return _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(rows, bits), bits), value);
+}
+
+//Without byte shuffles, the bytes are doubled up to 8 copies by unpacking
+static void snes_ppu_tile_decode_sse2(const uint8_t *planes, uint8_t bpp, uint8_t *pixels)
+{
+	__m128i out[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+	__m128i rows, half, quarter, first, second, value;
+	uint8_t pair;
+	uint8_t k;
+
+	for(pair = 0; pair < bpp / 2; pair++) {
+		//Low plane of the pair in the first 8 bytes of a row, high plane in the last 8
+		value = _mm_set_epi64x(0x0202020202020202ULL << (pair * 2), 0x0101010101010101ULL << (pair * 2));
+		rows = _mm_loadu_si128((const __m128i *)(planes + pair * 16));
+		for(k = 0; k < 4; k++) {
+			half = (k & 2) ? _mm_unpackhi_epi8(rows, rows) : _mm_unpacklo_epi8(rows, rows);
+			quarter = (k & 1) ? _mm_unpackhi_epi16(half, half) : _mm_unpacklo_epi16(half, half);
+			first = snes_ppu_tile_bits_sse2(_mm_unpacklo_epi32(quarter, quarter), value);
+			second = snes_ppu_tile_bits_sse2(_mm_unpackhi_epi32(quarter, quarter), value);
+			out[k] = _mm_or_si128(out[k], _mm_or_si128(_mm_unpacklo_epi64(first, second),
+													   _mm_unpackhi_epi64(first, second)));
+		}
+	}
+	for(k = 0; k < 4; k++)
+		_mm_storeu_si128((__m128i *)(pixels + k * 16), out[k]);
+}
+
+//A shuffle spreads the bytes of a plane for 2 rows at once
+__attribute__((target("ssse3")))
+static void snes_ppu_tile_decode_ssse3(const uint8_t *planes, uint8_t bpp, uint8_t *pixels)
+{
+	const __m128i shuffles[4] = {
+		_mm_set_epi64x(0x0202020202020202LL, 0x0000000000000000LL),
+		_mm_set_epi64x(0x0606060606060606LL, 0x0404040404040404LL),
+		_mm_set_epi64x(0x0A0A0A0A0A0A0A0ALL, 0x0808080808080808LL),
+		_mm_set_epi64x(0x0E0E0E0E0E0E0E0ELL, 0x0C0C0C0C0C0C0C0CLL),
+	};
+	__m128i bits = _mm_set1_epi64x(SNES_PPU_TILE_BITS);
+	__m128i one = _mm_set1_epi8(1);
+	__m128i out[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+	__m128i rows, low, high, low_value, high_value;
+	uint8_t pair;
+	uint8_t k;
+
+	for(pair = 0; pair < bpp / 2; pair++) {
+		rows = _mm_loadu_si128((const __m128i *)(planes + pair * 16));
+		low_value = _mm_set1_epi8(1 << (pair * 2));
+		high_value = _mm_set1_epi8(2 << (pair * 2));
+		for(k = 0; k < 4; k++) {
+			low = _mm_shuffle_epi8(rows, shuffles[k]);
+			high = _mm_shuffle_epi8(rows, _mm_add_epi8(shuffles[k], one));
+			low = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(low, bits), bits), low_value);
+			high = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(high, bits), bits), high_value);
+			out[k] = _mm_or_si128(out[k], _mm_or_si128(low, high));
+		}
+	}
+	for(k = 0; k < 4; k++)
+		_mm_storeu_si128((__m128i *)(pixels + k * 16), out[k]);
+}
+
+//4 rows per register, the planes being copied in both lanes for the in-lane shuffle
+__attribute__((target("avx2")))
+static void snes_ppu_tile_decode_avx2(const uint8_t *planes, uint8_t bpp, uint8_t *pixels)
+{
+	const __m256i shuffles[2] = {
+		_mm256_set_epi64x(0x0606060606060606LL, 0x0404040404040404LL, 0x0202020202020202LL, 0x0000000000000000LL),
+		_mm256_set_epi64x(0x0E0E0E0E0E0E0E0ELL, 0x0C0C0C0C0C0C0C0CLL, 0x0A0A0A0A0A0A0A0ALL, 0x0808080808080808LL),
+	};
+	__m256i bits = _mm256_set1_epi64x(SNES_PPU_TILE_BITS);
+	__m256i one = _mm256_set1_epi8(1);
+	__m256i out[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+	__m256i rows, low, high, low_value, high_value;
+	uint8_t pair;
+	uint8_t k;
+
+	for(pair = 0; pair < bpp / 2; pair++) {
+		rows = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(planes + pair * 16)));
+		low_value = _mm256_set1_epi8(1 << (pair * 2));
+		high_value = _mm256_set1_epi8(2 << (pair * 2));
+		for(k = 0; k < 2; k++) {
+			low = _mm256_shuffle_epi8(rows, shuffles[k]);
+			high = _mm256_shuffle_epi8(rows, _mm256_add_epi8(shuffles[k], one));
+			low = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(low, bits), bits), low_value);
+			high = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(high, bits), bits), high_value);
+			out[k] = _mm256_or_si256(out[k], _mm256_or_si256(low, high));
+		}
+	}
+	_mm256_storeu_si256((__m256i *)pixels, out[0]);
+	_mm256_storeu_si256((__m256i *)(pixels + 32), out[1]);
+}
+#endif
+
+static const snes_ppu_tile_decoder_t snes_ppu_tile_decoders[] = {
+	[SNES_PPU_TILE_SIMD_SCALAR] = snes_ppu_tile_decode_scalar,
+#ifdef SNES_PPU_TILE_X86
+	[SNES_PPU_TILE_SIMD_SSE2] = snes_ppu_tile_decode_sse2,
+	[SNES_PPU_TILE_SIMD_SSSE3] = snes_ppu_tile_decode_ssse3,
+	[SNES_PPU_TILE_SIMD_AVX2] = snes_ppu_tile_decode_avx2,
+#endif
+};
+
+static const char *const snes_ppu_tile_simd_names[] = {
+	[SNES_PPU_TILE_SIMD_SCALAR] = "scalar",
+	[SNES_PPU_TILE_SIMD_SSE2] = "SSE2",
+	[SNES_PPU_TILE_SIMD_SSSE3] = "SSSE3",
+	[SNES_PPU_TILE_SIMD_AVX2] = "AVX2",
+};
+
+void snes_ppu_tile_decode(snes_ppu_tile_simd_t simd, const uint8_t *planes, uint8_t bpp, uint8_t *pixels)
+{
+	snes_ppu_tile_decoders[simd](planes, bpp, pixels);
+}
+
+snes_ppu_tile_simd_t snes_ppu_tile_get_max_simd()
+{
+#ifdef SNES_PPU_TILE_X86
+	if(__builtin_cpu_supports("avx2"))
+		return SNES_PPU_TILE_SIMD_AVX2;
+	if(__builtin_cpu_supports("ssse3"))
+		return SNES_PPU_TILE_SIMD_SSSE3;
+	return SNES_PPU_TILE_SIMD_SSE2;
+#else
+	return SNES_PPU_TILE_SIMD_SCALAR;
+#endif
+}
+
+int snes_ppu_tile_set_simd(snes_ppu_tile_cache_t *cache, snes_ppu_tile_simd_t simd)
+{
+	if(simd > snes_ppu_tile_get_max_simd())
+		return -1;
+	cache->decode = snes_ppu_tile_decoders[simd];
+	return 0;
+}
+
+const char *snes_ppu_tile_simd_tostring(snes_ppu_tile_simd_t simd)
+{
+	return snes_ppu_tile_simd_names[simd];
+}
+
+const uint8_t *snes_ppu_tile_get(snes_ppu_tile_cache_t *cache, uint8_t bpp, uint32_t index)
+{
+	uint8_t format = SNES_PPU_TILE_FORMAT(bpp);
+	uint8_t *pixels;
+
+	index &= snes_ppu_tile_count(format) - 1;
+	pixels = cache->pixels[format] + index * SNES_PPU_TILE_PIXELS;
+	if(!cache->valid[format][index]) {
+		cache->decode(cache->vram + index * 8 * bpp, bpp, pixels);
+		cache->valid[format][index] = 1;
+	}
+	return pixels;
+}
+
+void snes_ppu_tile_invalidate(snes_ppu_tile_cache_t *cache, uint32_t offset, uint32_t len)
+{
+	uint8_t format;
+	uint32_t first;
+	uint32_t last;
+
+	if(len == 0)
+		return;
+	for(format = 0; format < SNES_PPU_TILE_FORMATS; format++) {
+		first = offset / (16 << format);
+		last = (offset + len - 1) / (16 << format);
+		memset(cache->valid[format] + first, 0, last - first + 1);
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef SNES_PPU_TILE_H
+#define SNES_PPU_TILE_H
+
+#include <stdint.h>
+
+typedef struct _snes_ppu_tile_cache snes_ppu_tile_cache_t;
+
+//An 8x8 tile decoded to one byte per pixel, row by row
+#define SNES_PPU_TILE_PIXELS 64
+
+//Code paths of the bitplanes decoder
+typedef enum _snes_ppu_tile_simd {
+	SNES_PPU_TILE_SIMD_SCALAR, //Reference
+	SNES_PPU_TILE_SIMD_SSE2,
+	SNES_PPU_TILE_SIMD_SSSE3,
+	SNES_PPU_TILE_SIMD_AVX2,
+} snes_ppu_tile_simd_t;
+
+/*
+ * Decoded tiles of the VRAM, for the 2, 4 and 8 bits per pixel formats. A
+ * tile is converted from its bitplanes on first use, and again after a VRAM
+ * write into it.
+ */
+snes_ppu_tile_cache_t *snes_ppu_tile_init(const uint8_t *vram);
+void snes_ppu_tile_destroy(snes_ppu_tile_cache_t *cache);
+
+/*Pixels of the tile at VRAM byte offset index * 8 * bpp, bpp being 2, 4 or 8*/
+const uint8_t *snes_ppu_tile_get(snes_ppu_tile_cache_t *cache, uint8_t bpp, uint32_t index);
+/*len bytes of the VRAM from offset were written*/
+void snes_ppu_tile_invalidate(snes_ppu_tile_cache_t *cache, uint32_t offset, uint32_t len);
+
+/*Converts a tile of bpp bitplanes (8 * bpp bytes) to 64 pixels with a code path of the host*/
+void snes_ppu_tile_decode(snes_ppu_tile_simd_t simd, const uint8_t *planes, uint8_t bpp, uint8_t *pixels);
+
+/*Best path of the host, the default. Returns -1 for a path the host lacks*/
+snes_ppu_tile_simd_t snes_ppu_tile_get_max_simd();
+int snes_ppu_tile_set_simd(snes_ppu_tile_cache_t *cache, snes_ppu_tile_simd_t simd);
+const char *snes_ppu_tile_simd_tostring(snes_ppu_tile_simd_t simd);
+
+#endif //SNES_PPU_TILE_H
@@ -1,14 +1,42 @@
 #include <stdlib.h>
 #include <stdio.h>
-#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "snes_ram.h"
 
-struct _snes_ram {
-	uint32_t size;
-	int8_t *data;
-};
+//Huge page size tried first when built with SNES_RAM_HUGEPAGES
+#define SNES_RAM_HUGEPAGE_SIZE (2 * 1024 * 1024)
 
+static uint32_t snes_ram_round(uint32_t size, uint32_t unit)
+{
+	return (size + unit - 1) / unit * unit;
+}
+
+/*
+ * Anonymous mappings are page aligned and zeroed. Huge pages need some
+ * reserved by the system (vm.nr_hugepages), normal pages are used otherwise.
+ */
+static uint8_t *snes_ram_map(uint32_t size, uint32_t *map_size)
+{
+	void *data;
+
+#if defined(SNES_RAM_HUGEPAGES) && defined(MAP_HUGETLB)
+	*map_size = snes_ram_round(size, SNES_RAM_HUGEPAGE_SIZE);
+	data = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if(data != MAP_FAILED)
+		return data;
+#endif
+	*map_size = snes_ram_round(size, sysconf(_SC_PAGESIZE));
+	data = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(data == MAP_FAILED)
+		return NULL;
+#if defined(SNES_RAM_HUGEPAGES) && defined(MADV_HUGEPAGE)
+	//Transparent huge pages then, if the mapping is large enough
+	madvise(data, *map_size, MADV_HUGEPAGE);
+#endif
+	return data;
+}
 
 snes_ram_t *snes_ram_init(uint32_t size)
 {
@@ -18,7 +46,11 @@ snes_ram_t *snes_ram_init(uint32_t size)
 		goto error_alloc;
 	}
 	ram->size = size;
-	ram->data = (int8_t *)malloc(size * sizeof(int8_t));
+	ram->map_size = 0;
+	ram->data = NULL;
+	if(size == 0)
+		return ram;
+	ram->data = snes_ram_map(size, &ram->map_size);
 	if(ram->data == NULL) {
 		printf("Error when allocating the RAM !\n");
 		goto error_alloc_data;
@@ -32,19 +64,8 @@ error_alloc:
 
 void snes_ram_destroy(snes_ram_t *ram)
 {
-	free(ram->data);
+	if(ram->data != NULL)
+		munmap(ram->data, ram->map_size);
 	ram->data = NULL;
 	free(ram);
 }
-
-uint8_t snes_ram_read(snes_ram_t *ram, uint32_t addr)
-{
-	assert(addr < ram->size);
-	return ram->data[addr];
-}
-
-void snes_ram_write(snes_ram_t *ram, uint32_t addr, int8_t data)
-{
-	assert(addr < ram->size);
-	ram->data[addr] = data;
-}
@@ -5,11 +5,63 @@
 
 typedef struct _snes_ram snes_ram_t;
 
+/*
+ * Visible so that the accessors inline into their callers. The buffer is
+ * zeroed and page aligned. The accessors don't check the address : the bus
+ * reduces it to the size when it decodes it (a read16 or read24 must not
+ * start in the last 1 or 2 bytes).
+ */
+struct _snes_ram {
+	uint8_t *data;
+	uint32_t size;
+	uint32_t map_size; //Length of the mapping, rounded to the pages
+};
+
 snes_ram_t *snes_ram_init(uint32_t size);
 void snes_ram_destroy(snes_ram_t *ram);
 
-uint8_t snes_ram_read(snes_ram_t *ram, uint32_t addr);
-void snes_ram_write(snes_ram_t *ram, uint32_t addr, int8_t data);
+static inline uint8_t snes_ram_read(snes_ram_t *ram, uint32_t addr)
+{
+	return ram->data[addr];
+}
+
+static inline uint16_t snes_ram_read16(snes_ram_t *ram, uint32_t addr)
+{
+	return ram->data[addr] | (ram->data[addr + 1] << 8);
+}
+
+static inline uint32_t snes_ram_read24(snes_ram_t *ram, uint32_t addr)
+{
+	return ram->data[addr] | (ram->data[addr + 1] << 8) | (ram->data[addr + 2] << 16);
+}
+
+static inline void snes_ram_write(snes_ram_t *ram, uint32_t addr, uint8_t data)
+{
+	ram->data[addr] = data;
+}
+
+static inline void snes_ram_write16(snes_ram_t *ram, uint32_t addr, uint16_t data)
+{
+	ram->data[addr] = data;
+	ram->data[addr + 1] = data >> 8;
+}
+
+static inline void snes_ram_write24(snes_ram_t *ram, uint32_t addr, uint32_t data)
+{
+	ram->data[addr] = data;
+	ram->data[addr + 1] = data >> 8;
+	ram->data[addr + 2] = data >> 16;
+}
+
+//Base pointer for the direct accesses of the bus fast path
+static inline uint8_t *snes_ram_get_data(snes_ram_t *ram)
+{
+	return ram->data;
+}
 
+static inline uint32_t snes_ram_get_size(snes_ram_t *ram)
+{
+	return ram->size;
+}
 
 #endif //SNES_RAM_H
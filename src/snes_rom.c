@@ -190,6 +190,16 @@ uint8_t snes_rom_read(snes_rom_t *rom, uint32_t address)
 	return rom->usefullrom[address];
 }
 
+const uint8_t *snes_rom_get_data(snes_rom_t *rom)
+{
+	return rom->usefullrom;
+}
+
+uint32_t snes_rom_get_size(snes_rom_t *rom)
+{
+	return rom->usefull_size;
+}
+
 snes_interrupt_vectors_t snes_rom_get_emu_interrupt_vectors(snes_rom_t *rom)
 {
 	return rom->header.emulation_vectors;
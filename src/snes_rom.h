@@ -35,5 +35,7 @@ snes_interrupt_vectors_t snes_rom_get_nat_interrupt_vectors(snes_rom_t *rom);
 void snes_rom_print_header(snes_rom_t *rom);
 
 uint8_t snes_rom_read(snes_rom_t *rom, uint32_t address);
+const uint8_t *snes_rom_get_data(snes_rom_t *rom);
+uint32_t snes_rom_get_size(snes_rom_t *rom);
 
 #endif //SNES_ROM_H